@@ -0,0 +1,294 @@
+#include "atlas.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+/* Function:    SkylinePacker
+   Description: Constructs an empty packer, the skyline starts out as one flat segment across the bin
+   Parameters:  uint32_t - Width of the bin
+                uint32_t - Height no rectangle may reach below
+   Returns:     None
+ */
+SkylinePacker::SkylinePacker(const uint32_t cWidth, const uint32_t cMaxHeight) :
+  mWidth(cWidth), mMaxHeight(cMaxHeight), mHeight(0)
+{
+  mSkyline.push_back({0, 0, cWidth});
+}
+
+/* Function:    fits
+   Description: Finds how low a rectangle starting at a skyline segment can sit, resting on the highest segment it
+                spans
+   Parameters:  size_t - Index of the segment the rectangle starts at
+                uint32_t - Width of the rectangle
+                uint32_t - Set to the top of the rectangle
+   Returns:     bool - False if the rectangle would stick out of the bin on the right
+ */
+bool SkylinePacker::fits(const size_t cIndex, const uint32_t cWidth, uint32_t &rY) const
+{
+  const uint32_t cX = mSkyline[cIndex].x;
+  uint32_t remaining = cWidth;
+  uint32_t y = 0;
+
+  if (cWidth > mWidth - cX)
+  {
+    return false;
+  }
+
+  // The segments cover the whole bin, so a rectangle that ends inside it always runs out of width first
+  for (size_t i = cIndex; remaining > 0; i ++)
+  {
+    y = std::max(y, mSkyline[i].y);
+    remaining -= std::min(remaining, mSkyline[i].width);
+  }
+
+  rY = y;
+
+  return true;
+}
+
+/* Function:    place
+   Description: Raises the skyline over a placed rectangle, trimming the segments it covers and merging neighbours
+                of equal height
+   Parameters:  size_t - Index of the segment the rectangle starts at
+                uint32_t - Left of the rectangle
+                uint32_t - Top of the rectangle
+                uint32_t - Width of the rectangle
+                uint32_t - Height of the rectangle
+   Returns:     None
+ */
+void SkylinePacker::place(const size_t cIndex, const uint32_t cX, const uint32_t cY, const uint32_t cWidth,
+                          const uint32_t cHeight)
+{
+  const uint32_t cRight = cX + cWidth;
+
+  mSkyline.insert(mSkyline.begin() + cIndex, {cX, cY + cHeight, cWidth});
+
+  while (cIndex + 1 < mSkyline.size() && mSkyline[cIndex + 1].x < cRight)
+  {
+    Segment &rNext = mSkyline[cIndex + 1];
+    const uint32_t cCovered = cRight - rNext.x;
+
+    if (cCovered < rNext.width)
+    {
+      rNext.x += cCovered;
+      rNext.width -= cCovered;
+      break;
+    }
+
+    mSkyline.erase(mSkyline.begin() + cIndex + 1);
+  }
+
+  for (size_t i = 0; i + 1 < mSkyline.size();)
+  {
+    if (mSkyline[i].y == mSkyline[i + 1].y)
+    {
+      mSkyline[i].width += mSkyline[i + 1].width;
+      mSkyline.erase(mSkyline.begin() + i + 1);
+    }
+    else
+    {
+      i ++;
+    }
+  }
+
+  mHeight = std::max(mHeight, cY + cHeight);
+}
+
+/* Function:    insert
+   Description: Places a rectangle where its bottom ends up highest, leftmost on ties
+   Parameters:  uint32_t - Width of the rectangle
+                uint32_t - Height of the rectangle
+                uint32_t - Set to the left of the rectangle
+                uint32_t - Set to the top of the rectangle
+   Returns:     bool - False if the rectangle is wider than the bin or nowhere ends above the height limit
+ */
+bool SkylinePacker::insert(const uint32_t cWidth, const uint32_t cHeight, uint32_t &rX, uint32_t &rY)
+{
+  size_t best = mSkyline.size();
+  uint64_t bestBottom = UINT64_MAX;
+  uint32_t y = 0;
+
+  for (size_t i = 0; i < mSkyline.size(); i ++)
+  {
+    if (fits(i, cWidth, y) && static_cast<uint64_t>(y) + cHeight <= mMaxHeight &&
+        static_cast<uint64_t>(y) + cHeight < bestBottom)
+    {
+      best = i;
+      bestBottom = static_cast<uint64_t>(y) + cHeight;
+      rY = y;
+    }
+  }
+
+  if (best == mSkyline.size())
+  {
+    return false;
+  }
+
+  rX = mSkyline[best].x;
+  place(best, rX, rY, cWidth, cHeight);
+
+  return true;
+}
+
+/* Function:    getHeight
+   Description: Gets how far down the bin is used
+   Parameters:  None
+   Returns:     uint32_t - Bottom of the lowest rectangle placed so far
+ */
+uint32_t SkylinePacker::getHeight() const
+{
+  return mHeight;
+}
+
+/* Function:    getDefaultAtlasOptions
+   Description: Gets the options atlases are built with unless told otherwise
+   Parameters:  None
+   Returns:     AtlasOptions - Straight alpha RGBA8 as stored, one pixel of padding and an automatic width
+ */
+AtlasOptions getDefaultAtlasOptions()
+{
+  AtlasOptions options;
+
+  options.format = PIXEL_RGBA8;
+  options.alpha = ALPHA_STRAIGHT;
+  options.orientation = Png::ORIENT_NONE;
+  options.padding = 1;
+  options.width = 0;
+
+  return options;
+}
+
+/* Function:    packAtlas
+   Description: Lays out an atlas from the IHDR of every entry that probed successfully. Entries are placed tallest
+                first and every one is given padding on its right and bottom, which the atlas edge does not need.
+                The atlas never takes more than ATLAS_MAX_BYTES, entries wider than the atlas or that do not fit
+                under that limit fail on their own. Sets the size of the atlas, the rectangle and texture
+                coordinates of every entry, but allocates no pixels.
+   Parameters:  AtlasOptions - Format, orientation, padding and width to pack for
+                Atlas - Entries to place, with status and ihdr set by the header pass
+   Returns:     Status - FAIL if the format is not a four byte one, the width given is over the limit or no entry
+                         could be placed
+ */
+Status packAtlas(const AtlasOptions &crOptions, Atlas &rAtlas)
+{
+  const bool cTransposed = (crOptions.orientation == Png::ORIENT_ROTATE_90) ||
+                           (crOptions.orientation == Png::ORIENT_ROTATE_270);
+  const uint32_t cPadding = crOptions.padding;
+  const uint64_t cMaxPixels = std::min<uint64_t>(ATLAS_MAX_BYTES, SIZE_MAX) / ATLAS_PIXEL_SIZE;
+  std::vector<size_t> order;
+  uint64_t area = 0;
+  uint64_t widest = 0;
+  uint64_t width = crOptions.width;
+
+  rAtlas.width = 0;
+  rAtlas.height = 0;
+  rAtlas.stride = 0;
+
+  if (crOptions.format != PIXEL_RGBA8 && crOptions.format != PIXEL_BGRA8 && crOptions.format != PIXEL_RGBX8)
+  {
+    return FAIL;
+  }
+
+  for (size_t i = 0; i < rAtlas.entries.size(); i ++)
+  {
+    AtlasEntry &rEntry = rAtlas.entries[i];
+
+    if (rEntry.status != SUCCESS)
+    {
+      continue;
+    }
+
+    rEntry.width = cTransposed ? rEntry.ihdr.height : rEntry.ihdr.width;
+    rEntry.height = cTransposed ? rEntry.ihdr.width : rEntry.ihdr.height;
+
+    if (static_cast<uint64_t>(rEntry.width) * rEntry.height > cMaxPixels)
+    {
+      rEntry.status = FAIL;
+      rEntry.error = "Image is larger than an atlas may be";
+      continue;
+    }
+
+    // Only sizes the square, so it saturates at the limit rather than growing without bound
+    area = std::min(cMaxPixels, area + (std::min(static_cast<uint64_t>(rEntry.width) + cPadding, cMaxPixels) *
+                                        std::min(static_cast<uint64_t>(rEntry.height) + cPadding, cMaxPixels)));
+    widest = std::max<uint64_t>(widest, rEntry.width);
+    order.push_back(i);
+  }
+
+  if (width == 0)
+  {
+    const uint64_t cSide = static_cast<uint64_t>(std::ceil(std::sqrt(static_cast<double>(area))));
+
+    width = 1;
+
+    // The square stops at the largest the limit allows, entries that do not fit under it then fail on their own
+    while ((width < cSide && (width * width) < cMaxPixels) || width < widest)
+    {
+      width <<= 1;
+    }
+  }
+
+  if (width > cMaxPixels || (width + cPadding) > UINT32_MAX)
+  {
+    return FAIL;
+  }
+
+  std::stable_sort(order.begin(), order.end(), [&rAtlas](const size_t cA, const size_t cB)
+  {
+    const AtlasEntry &crA = rAtlas.entries[cA];
+    const AtlasEntry &crB = rAtlas.entries[cB];
+
+    return (crA.height != crB.height) ? (crA.height > crB.height) : (crA.width > crB.width);
+  });
+
+  // The bin is one padding wider and taller than the atlas so the last images can end right at its edges
+  const uint64_t cBinHeight = std::min<uint64_t>((cMaxPixels / width) + cPadding, UINT32_MAX);
+  SkylinePacker packer(static_cast<uint32_t>(width + cPadding), static_cast<uint32_t>(cBinHeight));
+  uint32_t height = 0;
+
+  for (const size_t cIndex : order)
+  {
+    AtlasEntry &rEntry = rAtlas.entries[cIndex];
+    const uint64_t cCellWidth = static_cast<uint64_t>(rEntry.width) + cPadding;
+    const uint64_t cCellHeight = static_cast<uint64_t>(rEntry.height) + cPadding;
+
+    if (cCellWidth > width + cPadding)
+    {
+      rEntry.status = FAIL;
+      rEntry.error = "Image is wider than the atlas";
+      continue;
+    }
+
+    if (cCellHeight > cBinHeight || !packer.insert(static_cast<uint32_t>(cCellWidth),
+                                                   static_cast<uint32_t>(cCellHeight), rEntry.x, rEntry.y))
+    {
+      rEntry.status = FAIL;
+      rEntry.error = "Image does not fit in an atlas under the size limit";
+      continue;
+    }
+
+    height = std::max(height, rEntry.y + rEntry.height);
+  }
+
+  if (height == 0)
+  {
+    return FAIL;
+  }
+
+  rAtlas.width = static_cast<uint32_t>(width);
+  rAtlas.height = height;
+  rAtlas.stride = static_cast<size_t>(width) * ATLAS_PIXEL_SIZE;
+
+  for (AtlasEntry &rEntry : rAtlas.entries)
+  {
+    if (rEntry.status == SUCCESS)
+    {
+      rEntry.u0 = static_cast<float>(rEntry.x) / width;
+      rEntry.v0 = static_cast<float>(rEntry.y) / height;
+      rEntry.u1 = static_cast<float>(rEntry.x + rEntry.width) / width;
+      rEntry.v1 = static_cast<float>(rEntry.y + rEntry.height) / height;
+    }
+  }
+
+  return SUCCESS;
+}
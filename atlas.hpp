@@ -0,0 +1,86 @@
+#ifndef ATLAS_HPP
+#define ATLAS_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+#include "png.hpp"
+
+// Bytes per atlas pixel, atlases only hold the four byte output formats
+#define ATLAS_PIXEL_SIZE 4
+
+// Most bytes of pixels an atlas may take, a square of 32768 pixels, as large as any GPU takes a texture
+#define ATLAS_MAX_BYTES (static_cast<uint64_t>(1) << 32)
+
+// Settings of an atlas build, the orientation is applied to every image as it is decoded into place
+struct AtlasOptions {
+  PixelFormat format;
+  AlphaMode alpha;
+  Png::Orientation orientation;
+
+  // Empty pixels between neighbouring images, so filtering at the edge of one never samples the next
+  uint32_t padding;
+
+  // Width of the atlas, 0 picks the smallest power of two that fits the widest image and the side of a square
+  // holding every image
+  uint32_t width;
+};
+
+// Where one image went, in pixels and as texture coordinates that grow right and down like the pixel rows
+struct AtlasEntry {
+  Status status;
+  std::string error;
+  struct Png::IHDR ihdr;
+  uint32_t x;
+  uint32_t y;
+  uint32_t width;
+  uint32_t height;
+  float u0;
+  float v0;
+  float u1;
+  float v1;
+};
+
+// Atlas pixels, stride bytes per row and transparent black where no image went, with one entry per input image
+struct Atlas {
+  uint32_t width;
+  uint32_t height;
+  size_t stride;
+  std::vector<uint8_t> pixels;
+  std::vector<AtlasEntry> entries;
+};
+
+/* Skyline packer for rectangles of a fixed width bin that grows down as far as needed, up to a height limit. The
+   skyline is the top edge of everything placed so far, every rectangle goes where its bottom ends up highest and ties
+   go left, which keeps the holes below the skyline small for sprites of similar heights when they come tallest first.
+ */
+class SkylinePacker {
+public:
+  SkylinePacker(const uint32_t cWidth, const uint32_t cMaxHeight);
+  bool insert(const uint32_t cWidth, const uint32_t cHeight, uint32_t &rX, uint32_t &rY);
+  uint32_t getHeight() const;
+
+private:
+  struct Segment {
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+  };
+
+  bool fits(const size_t cIndex, const uint32_t cWidth, uint32_t &rY) const;
+  void place(const size_t cIndex, const uint32_t cX, const uint32_t cY, const uint32_t cWidth,
+             const uint32_t cHeight);
+
+  uint32_t mWidth;
+  uint32_t mMaxHeight;
+  uint32_t mHeight;
+  std::vector<Segment> mSkyline;
+};
+
+AtlasOptions getDefaultAtlasOptions();
+Status packAtlas(const AtlasOptions &crOptions, Atlas &rAtlas);
+
+#endif
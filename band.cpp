@@ -0,0 +1,773 @@
+#include "band.hpp"
+
+#include <cstring>
+#include <algorithm>
+
+#ifdef __linux__
+  #include <arpa/inet.h>
+#elif _WIN32
+  #include <winsock2.h>
+#endif
+
+/* Function:    readBand32
+   Description: Reads a 4 byte big endian value out of the iDOT chunk
+   Parameters:  uint8_t* - First byte of the value
+   Returns:     uint32_t - Value in host byte order
+ */
+static uint32_t readBand32(const uint8_t *cpData)
+{
+  uint32_t value = 0;
+
+  memcpy(&value, cpData, sizeof(uint32_t));
+
+  return htonl(value);
+}
+
+/* Function:    BandDecoder
+   Description: Constructs band decoder, inflate backends are created the first time a band needs them
+   Parameters:  None
+   Returns:     None
+ */
+BandDecoder::BandDecoder() : mEngine(INFLATE_ZLIB), mRowBytes(0), mRows(0), mRowsDone(0), mKernels(), mNeeded(0),
+                             mBand(0), mComplete(false), mHaveAdler(false), mAdler(0), mReady(0), mNext(0),
+                             mRunning(0), mStop(false), mCollectStats(false), mStats()
+{
+}
+
+/* Function:    ~BandDecoder
+   Description: Destroys band decoder, waiting for the bands of a decode that never finished and joining the workers
+   Parameters:  None
+   Returns:     None
+ */
+BandDecoder::~BandDecoder()
+{
+  abort();
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStop = true;
+  }
+
+  mWork.notify_all();
+
+  for (std::thread &rThread : mThreads)
+  {
+    rThread.join();
+  }
+}
+
+/* Function:    begin
+   Description: Prepares for a new image, reusing the inflate backends and buffers of the previous one
+   Parameters:  std::vector<IdotBand> - Bands from parseIdot
+                size_t - Bytes in one scanline, not counting the filter type byte
+                uint32_t - Rows to decode from the top, bands below them are never inflated
+                uint8_t - Bytes per complete pixel, rounded up to 1
+                RowSink - Called with every reconstructed scanline, from several threads at once
+   Returns:     Status - FAIL if there are no bands
+ */
+Status BandDecoder::begin(const std::vector<IdotBand> &crBands, const size_t cRowBytes, const uint32_t cRows,
+                          const uint8_t cBpp, const RowSink &crSink)
+{
+  const size_t cFilteredCapacity = mFiltered.capacity();
+
+  abort();
+
+  if (crBands.empty())
+  {
+    mError = "No iDOT bands to decode";
+    return FAIL;
+  }
+
+  mBands = crBands;
+  mRowBytes = cRowBytes;
+  mRows = cRows;
+  mRowsDone = 0;
+  mKernels = getUnfilterKernels(cBpp);
+  mSink = crSink;
+  mError.clear();
+  mNeeded = 0;
+  mBand = 0;
+  mComplete = false;
+
+  while (mNeeded < mBands.size() && mBands[mNeeded].firstRow < mRows)
+  {
+    mNeeded ++;
+  }
+
+  mData.resize(mBands.size());
+
+  for (std::vector<uint8_t> &rData : mData)
+  {
+    rData.clear();
+  }
+
+  mPieces.clear();
+
+  if (mInflaters.size() < mBands.size())
+  {
+    mInflaters.resize(mBands.size());
+  }
+
+  // Row -1 is all zeros, it is the previous row of the first row of the image
+  mFiltered.resize((static_cast<size_t>(mRows) + 1) * (mRowBytes + 1));
+  memset(mFiltered.data(), 0, mRowBytes + 1);
+  mAdlers.assign(mBands.size(), 0);
+  mHaveAdler = false;
+  mAdler = 0;
+  mBandStats.assign(mBands.size(), DecodeStats());
+  mStats = DecodeStats();
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStates.assign(mBands.size(), BAND_PENDING);
+    mReady = 0;
+    mNext = 0;
+  }
+
+  if (STATS_ENABLED && mCollectStats)
+  {
+    mStats.allocations += (mFiltered.capacity() > cFilteredCapacity);
+  }
+
+  return SUCCESS;
+}
+
+/* Function:    startChunk
+   Description: Tells the decoder where the next IDAT chunk starts. A chunk that starts the next band hands the
+                data collected so far to the workers, starting another one while there are fewer than hardware
+                threads and bands handed out. The band that starts below the decoded rows ends collecting.
+   Parameters:  uint64_t - Offset of the chunk from the start of the iDOT chunk
+   Returns:     None
+ */
+void BandDecoder::startChunk(const uint64_t cOffset)
+{
+  if (mComplete)
+  {
+    return;
+  }
+
+  if ((mBand + 1) < mBands.size() && cOffset == mBands[mBand + 1].offset)
+  {
+    if ((mBand + 1) == mNeeded)
+    {
+      mComplete = true;
+      return;
+    }
+
+    const size_t cWorkers = std::max<size_t>(1, std::thread::hardware_concurrency());
+
+    mBand ++;
+
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mReady = mBand;
+    }
+
+    mWork.notify_one();
+
+    if (mThreads.size() < std::min(cWorkers, mBand))
+    {
+      mThreads.emplace_back(&BandDecoder::workerLoop, this);
+    }
+  }
+}
+
+/* Function:    feed
+   Description: Adds IDAT data to the band collecting it, the data is copied so the source can move on. The size
+                of every piece is kept to decode the stream again in the same pieces if the bands fail.
+   Parameters:  uint8_t* - Compressed data
+                size_t - Bytes of compressed data
+   Returns:     None
+ */
+void BandDecoder::feed(const uint8_t *cpData, const size_t cSize)
+{
+  if (!mComplete)
+  {
+    mData[mBand].insert(mData[mBand].end(), cpData, cpData + cSize);
+    mPieces.push_back(cSize);
+  }
+}
+
+/* Function:    finish
+   Description: Decodes the last band on the calling thread and waits for the other bands. If any band could not be
+                decoded on its own the whole stream is decoded again in one piece.
+   Parameters:  None
+   Returns:     Status - FAIL on corrupt compressed data or an invalid filter type
+ */
+Status BandDecoder::finish()
+{
+  bool banded = (mBand + 1) == mNeeded;
+  Status status = SUCCESS;
+  size_t scratch = mFiltered.capacity();
+
+  if (banded)
+  {
+    decodeBand(mBand);
+  }
+
+  waitForWorkers();
+
+  for (size_t i = 0; i < mNeeded; i ++)
+  {
+    banded = banded && (mStates[i] == BAND_UNFILTERED);
+  }
+
+  // zlib checks the adler32 at the end of the stream as soon as it arrives, so a whole image is checked the same.
+  // Without one the stream is decoded again to fail or stop where a plain decode would.
+  if (banded && mRows == (mBands.back().firstRow + mBands.back().rows))
+  {
+    uLong adler = mAdlers[0];
+
+    for (size_t i = 1; i < mBands.size(); i ++)
+    {
+      adler = adler32_combine(adler, mAdlers[i], static_cast<z_off_t>(mBands[i].rows * (mRowBytes + 1)));
+    }
+
+    banded = mHaveAdler && (adler == mAdler);
+  }
+
+  if (banded)
+  {
+    mRowsDone = mRows;
+  }
+  else
+  {
+    status = decodeWhole();
+  }
+
+  for (size_t i = 0; i < mBands.size(); i ++)
+  {
+    addDecodeStats(mStats, mBandStats[i]);
+    scratch += mData[i].capacity();
+  }
+
+  mStats.peakScratchBytes = std::max(mStats.peakScratchBytes, scratch);
+
+  return status;
+}
+
+/* Function:    abort
+   Description: Waits for the bands of the current decode handed out to the workers, bands that were never handed
+                out are dropped
+   Parameters:  None
+   Returns:     None
+ */
+void BandDecoder::abort()
+{
+  waitForWorkers();
+}
+
+/* Function:    workerLoop
+   Description: Decodes bands in the order they were handed out until the decoder is destroyed. A band only ever
+                waits on bands above it, which were taken before it, so the first band not yet done is always
+                running or next in line and every band runs to the end.
+   Parameters:  None
+   Returns:     None
+ */
+void BandDecoder::workerLoop()
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+
+  while (true)
+  {
+    mWork.wait(lock, [this]() { return mStop || mNext < mReady; });
+
+    if (mNext >= mReady)
+    {
+      return;
+    }
+
+    const size_t cIndex = mNext ++;
+
+    mRunning ++;
+    lock.unlock();
+    decodeBand(cIndex);
+    lock.lock();
+    mRunning --;
+    mChanged.notify_all();
+  }
+}
+
+/* Function:    waitForWorkers
+   Description: Waits until every band handed out has been decoded, the workers stay to take the next image
+   Parameters:  None
+   Returns:     None
+ */
+void BandDecoder::waitForWorkers()
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+
+  mChanged.wait(lock, [this]() { return mNext == mReady && mRunning == 0; });
+}
+
+/* Function:    getInflater
+   Description: Gets the inflate backend of a band, creating it the first time
+   Parameters:  size_t - Band index
+   Returns:     InflateBackend - Backend only ever used for that band
+ */
+InflateBackend &BandDecoder::getInflater(const size_t cIndex)
+{
+  if (!mInflaters[cIndex])
+  {
+    mInflaters[cIndex].reset(createInflater(mEngine));
+
+    if (STATS_ENABLED && mCollectStats)
+    {
+      mBandStats[cIndex].allocations ++;
+    }
+  }
+
+  return *mInflaters[cIndex];
+}
+
+/* Function:    inflateSome
+   Description: Inflates until the output is full, the input runs out or the stream ends
+   Parameters:  InflateBackend - Backend
+                uint8_t* - Compressed input, advanced past what was consumed
+                size_t - Bytes of input, reduced by what was consumed
+                uint8_t* - Output, advanced past what was produced
+                size_t - Space in the output, reduced by what was produced
+   Returns:     InflateStatus - INFLATE_ERROR on corrupt compressed data
+ */
+static InflateStatus inflateSome(InflateBackend &rInflater, const uint8_t *&rpIn, size_t &rInSize, uint8_t *&rpOut,
+                                 size_t &rOutSize)
+{
+  InflateStatus status = INFLATE_OK;
+
+  while (rInSize > 0 && rOutSize > 0 && status == INFLATE_OK)
+  {
+    status = rInflater.inflate(rpIn, rInSize, rpOut, rOutSize);
+  }
+
+  return status;
+}
+
+/* Function:    drainBand
+   Description: Inflates what is left of a band once its scanlines are full. A band followed by another one only
+                holds the flush that ends it there, the last band the end of the stream.
+   Parameters:  InflateBackend - Backend
+                uint8_t* - Compressed input, advanced past what was consumed
+                size_t - Bytes of input, reduced by what was consumed
+   Returns:     InflateStatus - INFLATE_ERROR on corrupt compressed data or data that inflates to more bytes
+ */
+static InflateStatus drainBand(InflateBackend &rInflater, const uint8_t *&rpIn, size_t &rInSize)
+{
+  InflateStatus status = INFLATE_OK;
+
+  // Runs at least once, a backend may hold decoded bytes even with every input byte consumed
+  do
+  {
+    uint8_t spare = 0;
+    uint8_t *pSpare = &spare;
+    size_t spareSize = sizeof(spare);
+
+    status = rInflater.inflate(rpIn, rInSize, pSpare, spareSize);
+
+    if (spareSize == 0)
+    {
+      return INFLATE_ERROR;
+    }
+  } while (rInSize > 0 && status == INFLATE_OK);
+
+  return status;
+}
+
+/* Function:    unfilterRows
+   Description: Reconstructs filtered scanlines in place, every row reads the one above it in mFiltered
+   Parameters:  uint32_t - First row
+                uint32_t - Amount of rows
+                DecodeStats - Counters of the band
+   Returns:     uint32_t - Rows reconstructed, fewer than asked for if a row has an invalid filter type
+ */
+uint32_t BandDecoder::unfilterRows(const uint32_t cFirstRow, const uint32_t cRows, DecodeStats &rStats)
+{
+  const size_t cStride = mRowBytes + 1;
+  const uint64_t cStart = statsStart(mCollectStats);
+  uint8_t *pRow = mFiltered.data() + ((static_cast<size_t>(cFirstRow) + 1) * cStride);
+  uint32_t row = 0;
+
+  for (; row < cRows; row ++, pRow += cStride)
+  {
+    if (unfilterRow(mKernels, pRow[0], pRow + 1, pRow - cStride + 1, mRowBytes) != SUCCESS)
+    {
+      break;
+    }
+
+    if (STATS_ENABLED && mCollectStats)
+    {
+      rStats.filterCounts[pRow[0]] ++;
+    }
+  }
+
+  statsStop(rStats.stageNs[STATS_UNFILTER], cStart, mCollectStats);
+
+  return row;
+}
+
+/* Function:    sinkRows
+   Description: Hands reconstructed scanlines to the row sink
+   Parameters:  uint32_t - First row
+                uint32_t - Amount of rows
+                DecodeStats - Counters of the band
+   Returns:     None
+ */
+void BandDecoder::sinkRows(const uint32_t cFirstRow, const uint32_t cRows, DecodeStats &rStats)
+{
+  const size_t cStride = mRowBytes + 1;
+  const uint64_t cStart = statsStart(mCollectStats);
+  const uint8_t *cpRow = mFiltered.data() + ((static_cast<size_t>(cFirstRow) + 1) * cStride);
+
+  for (uint32_t row = 0; row < cRows; row ++, cpRow += cStride)
+  {
+    mSink(cFirstRow + row, cpRow + 1);
+  }
+
+  statsStop(rStats.stageNs[STATS_STORE], cStart, mCollectStats);
+}
+
+/* Function:    decodeBand
+   Description: Inflates, reconstructs and stores the rows of one band. The first band is the start of the zlib
+                stream, every other band is raw deflate data. A band with another decoded band below it has to end
+                right after its rows, as a plain decode reads on through it, and the last band has to end with the
+                adler32 of the stream. The band above is only waited for when the first row is filtered against it,
+                None and Sub filters never read the previous row.
+   Parameters:  size_t - Band index
+   Returns:     None
+ */
+void BandDecoder::decodeBand(const size_t cIndex)
+{
+  const IdotBand &crBand = mBands[cIndex];
+  const uint32_t cRows = std::min(crBand.rows, mRows - crBand.firstRow);
+  const size_t cSize = static_cast<size_t>(cRows) * (mRowBytes + 1);
+  const bool cLast = (cIndex + 1) == mBands.size() && cRows == crBand.rows;
+  uint8_t *pFirst = mFiltered.data() + ((static_cast<size_t>(crBand.firstRow) + 1) * (mRowBytes + 1));
+  const uint8_t *cpIn = mData[cIndex].data();
+  size_t inSize = mData[cIndex].size();
+  uint8_t *pOut = pFirst;
+  size_t outSize = cSize;
+  DecodeStats &rStats = mBandStats[cIndex];
+  InflateBackend &rInflater = getInflater(cIndex);
+  const uint64_t cStart = statsStart(mCollectStats);
+  InflateStatus status = INFLATE_ERROR;
+  bool decoded = false;
+
+  rInflater.setRaw(cIndex != 0);
+
+  if (rInflater.reset() == SUCCESS)
+  {
+    status = inflateSome(rInflater, cpIn, inSize, pOut, outSize);
+  }
+
+  if (status == INFLATE_OK && outSize == 0 && (((cIndex + 1) < mNeeded) || cLast))
+  {
+    status = drainBand(rInflater, cpIn, inSize);
+  }
+
+  decoded = (status != INFLATE_ERROR) && (outSize == 0);
+
+  // Only a decode of the whole image reaches the adler32 at the end of the stream
+  if (decoded && mRows == (mBands.back().firstRow + mBands.back().rows))
+  {
+    mAdlers[cIndex] = adler32_z(adler32(0, Z_NULL, 0), pFirst, cSize);
+
+    // Backends may buffer the bytes after a raw stream, the adler32 is taken from the end of the band instead
+    if (cLast && status == INFLATE_STREAM_END && mData[cIndex].size() >= sizeof(uint32_t))
+    {
+      mAdler = readBand32(mData[cIndex].data() + mData[cIndex].size() - sizeof(uint32_t));
+      mHaveAdler = true;
+    }
+  }
+
+  statsStop(rStats.stageNs[STATS_INFLATE], cStart, mCollectStats);
+
+  if (STATS_ENABLED && mCollectStats)
+  {
+    rStats.filteredBytes += cSize - outSize;
+  }
+
+  if (decoded && cIndex > 0 && pFirst[0] > 1)
+  {
+    decoded = waitForBand(cIndex - 1);
+  }
+
+  decoded = decoded && (unfilterRows(crBand.firstRow, cRows, rStats) == cRows);
+  setBandState(cIndex, decoded ? BAND_UNFILTERED : BAND_FAILED);
+
+  if (decoded)
+  {
+    sinkRows(crBand.firstRow, cRows, rStats);
+  }
+}
+
+/* Function:    setBandState
+   Description: Records how a band ended and wakes the band below if it is waiting
+   Parameters:  size_t - Band index
+                BandState - BAND_UNFILTERED once its rows are reconstructed, BAND_FAILED otherwise
+   Returns:     None
+ */
+void BandDecoder::setBandState(const size_t cIndex, const BandState cState)
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStates[cIndex] = cState;
+  }
+
+  mChanged.notify_all();
+}
+
+/* Function:    waitForBand
+   Description: Blocks until a band has reconstructed its rows or failed
+   Parameters:  size_t - Band index
+   Returns:     bool - True if its last row can be read
+ */
+bool BandDecoder::waitForBand(const size_t cIndex)
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+
+  mChanged.wait(lock, [this, cIndex]()
+  {
+    return mStates[cIndex] != BAND_PENDING;
+  });
+
+  return mStates[cIndex] == BAND_UNFILTERED;
+}
+
+/* Function:    decodeWhole
+   Description: Decodes the IDAT data of every band as the one zlib stream it is, on the calling thread and in the
+                pieces it arrived in, so it stops at the same place a plain decode does. Rows up to the first error
+                are still handed to the sink.
+   Parameters:  None
+   Returns:     Status - FAIL on corrupt compressed data or an invalid filter type
+ */
+Status BandDecoder::decodeWhole()
+{
+  const size_t cStride = mRowBytes + 1;
+  const size_t cSize = static_cast<size_t>(mRows) * cStride;
+  InflateBackend &rInflater = getInflater(0);
+  const uint64_t cStart = statsStart(mCollectStats);
+  uint8_t *pOut = mFiltered.data() + cStride;
+  size_t outSize = cSize;
+  InflateStatus status = INFLATE_OK;
+  size_t band = 0;
+  size_t used = 0;
+
+  rInflater.setRaw(false);
+
+  if (rInflater.reset() != SUCCESS)
+  {
+    mError = rInflater.getError();
+    return FAIL;
+  }
+
+  for (size_t i = 0; i < mPieces.size() && outSize > 0 && status == INFLATE_OK; i ++)
+  {
+    // Pieces never span two bands
+    while ((mData[band].size() - used) < mPieces[i])
+    {
+      band ++;
+      used = 0;
+    }
+
+    const uint8_t *cpIn = mData[band].data() + used;
+    size_t inSize = mPieces[i];
+
+    used += mPieces[i];
+    status = inflateSome(rInflater, cpIn, inSize, pOut, outSize);
+  }
+
+  statsStop(mBandStats[0].stageNs[STATS_INFLATE], cStart, mCollectStats);
+
+  if (STATS_ENABLED && mCollectStats)
+  {
+    mBandStats[0].filteredBytes += cSize - outSize;
+  }
+
+  const uint32_t cRows = static_cast<uint32_t>((cSize - outSize) / cStride);
+
+  mRowsDone = unfilterRows(0, cRows, mBandStats[0]);
+  sinkRows(0, mRowsDone, mBandStats[0]);
+
+  if (mRowsDone < cRows)
+  {
+    mError = "Invalid filter type " + std::to_string(mFiltered[(static_cast<size_t>(mRowsDone) + 1) * cStride]) +
+             " on row " + std::to_string(mRowsDone);
+    return FAIL;
+  }
+
+  if (status == INFLATE_ERROR)
+  {
+    mError = rInflater.getError();
+    return FAIL;
+  }
+
+  return SUCCESS;
+}
+
+/* Function:    setInflateEngine
+   Description: Selects the decompression backend, takes effect from the next begin
+   Parameters:  InflateEngine - INFLATE_ZLIB for zlib, INFLATE_FAST for the built in inflater
+   Returns:     None
+ */
+void BandDecoder::setInflateEngine(const InflateEngine cEngine)
+{
+  if (cEngine != mEngine)
+  {
+    abort();
+    mEngine = cEngine;
+    mInflaters.clear();
+  }
+}
+
+/* Function:    setCollectStats
+   Description: Turns stats collection on or off from the next begin, only has an effect when built with
+                LESTPNG_STATS
+   Parameters:  bool - True to collect stats
+   Returns:     None
+ */
+void BandDecoder::setCollectStats(const bool cCollect)
+{
+  mCollectStats = cCollect;
+}
+
+/* Function:    getStats
+   Description: Gets the inflate, unfilter and store counters of every band added up, complete once finish returns
+   Parameters:  None
+   Returns:     DecodeStats - Counters since the last begin
+ */
+const DecodeStats &BandDecoder::getStats() const
+{
+  return mStats;
+}
+
+/* Function:    finished
+   Description: Checks if the IDAT data of every band holding decoded rows has been collected
+   Parameters:  None
+   Returns:     bool - True once a chunk of a band below the decoded rows has started
+ */
+bool BandDecoder::finished() const
+{
+  return mComplete;
+}
+
+/* Function:    rowsDone
+   Description: Getter function for the number of reconstructed scanlines, only valid once finish returns
+   Parameters:  None
+   Returns:     uint32_t - Rows handed to the sink
+ */
+uint32_t BandDecoder::rowsDone() const
+{
+  return mRowsDone;
+}
+
+/* Function:    rows
+   Description: Getter function for the number of scanlines the current decode needs
+   Parameters:  None
+   Returns:     uint32_t - Rows passed to begin
+ */
+uint32_t BandDecoder::rows() const
+{
+  return mRows;
+}
+
+/* Function:    getError
+   Description: Getter function for the last error message
+   Parameters:  None
+   Returns:     std::string - Error message, empty if nothing failed
+ */
+const std::string &BandDecoder::getError() const
+{
+  return mError;
+}
+
+static std::atomic<BandMode> &activeBandMode()
+{
+  static std::atomic<BandMode> mode(BAND_MODE_AUTO);
+  return mode;
+}
+
+/* Function:    getBandMode
+   Description: Gets when iDOT images decode their bands on worker threads
+   Parameters:  None
+   Returns:     BandMode - Active mode
+ */
+BandMode getBandMode()
+{
+  return activeBandMode().load(std::memory_order_relaxed);
+}
+
+/* Function:    setBandMode
+   Description: Sets when iDOT images decode their bands on worker threads for every png object, mainly for testing
+                and benchmarking the band decoder on machines that would not use it
+   Parameters:  BandMode - Requested mode
+   Returns:     None
+ */
+void setBandMode(const BandMode cMode)
+{
+  activeBandMode().store(cMode, std::memory_order_relaxed);
+}
+
+/* Function:    useBandThreads
+   Description: Gets whether an iDOT image decodes its bands on worker threads under the active mode, a single
+                core gains nothing from the bands but the copy of their data
+   Parameters:  None
+   Returns:     bool - True to decode bands on worker threads
+ */
+bool useBandThreads()
+{
+  const BandMode cMode = getBandMode();
+
+  return (cMode == BAND_MODE_FORCE) || ((cMode == BAND_MODE_AUTO) && (std::thread::hardware_concurrency() > 1));
+}
+
+/* Function:    parseIdot
+   Description: Parses an iDOT chunk, a band count followed by the first row, row count and IDAT offset of every
+                band. Bands have to cover the image from top to bottom in order.
+   Parameters:  uint8_t* - Chunk data
+                uint32_t - Bytes of chunk data
+                uint32_t - Image height
+                std::vector<IdotBand> - Set to the bands
+   Returns:     Status - FAIL if the chunk is malformed, holds a single band or more than IDOT_MAX_BANDS
+ */
+Status parseIdot(const uint8_t *cpData, const uint32_t cLength, const uint32_t cHeight,
+                 std::vector<IdotBand> &rBands)
+{
+  uint32_t nextRow = 0;
+
+  rBands.clear();
+
+  if (cpData == nullptr || cLength < IDOT_HEADER_SIZE)
+  {
+    return FAIL;
+  }
+
+  const uint32_t cCount = readBand32(cpData);
+
+  if (cCount < 2 || cCount > IDOT_MAX_BANDS || cLength != IDOT_HEADER_SIZE + (cCount * IDOT_BAND_SIZE))
+  {
+    return FAIL;
+  }
+
+  for (uint32_t i = 0; i < cCount; i ++)
+  {
+    const uint8_t *cpBand = cpData + IDOT_HEADER_SIZE + (i * IDOT_BAND_SIZE);
+    const IdotBand cBand = {readBand32(cpBand), readBand32(cpBand + 4), readBand32(cpBand + 8)};
+
+    if (cBand.firstRow != nextRow || cBand.rows == 0 || cBand.rows > cHeight - nextRow ||
+        (i > 0 && cBand.offset <= rBands.back().offset))
+    {
+      rBands.clear();
+      return FAIL;
+    }
+
+    rBands.push_back(cBand);
+    nextRow += cBand.rows;
+  }
+
+  if (nextRow != cHeight)
+  {
+    rBands.clear();
+    return FAIL;
+  }
+
+  return SUCCESS;
+}
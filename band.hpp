@@ -0,0 +1,146 @@
+#ifndef BAND_HPP
+#define BAND_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <condition_variable>
+#include <atomic>
+
+#include "common.hpp"
+#include "inflater.hpp"
+#include "unfilter.hpp"
+#include "scanline.hpp"
+#include "stats.hpp"
+
+// Most bands an iDOT chunk may split an image into, files with more are decoded on one thread
+#define IDOT_MAX_BANDS 64
+
+// Bytes of the iDOT band count and of every band entry after it
+#define IDOT_HEADER_SIZE 4
+#define IDOT_BAND_SIZE   12
+
+/* When images split into iDOT bands decode them on worker threads. BAND_MODE_AUTO does whenever the machine has
+   more than one core, BAND_MODE_FORCE also on a single core and BAND_MODE_OFF never, mainly for testing.
+ */
+enum BandMode {
+  BAND_MODE_OFF,
+  BAND_MODE_AUTO,
+  BAND_MODE_FORCE
+};
+
+/* Rows of one iDOT band and where its first IDAT chunk starts, in bytes from the start of the iDOT chunk. Bands
+   follow each other down the image, the IDAT data of every band after the first is raw deflate data that starts
+   after a full flush of the stream, so it can be inflated without the bands above it.
+ */
+struct IdotBand {
+  uint32_t firstRow;
+  uint32_t rows;
+  uint32_t offset;
+};
+
+/* Decodes a non interlaced image split into iDOT bands on worker threads, at most one per hardware thread and kept
+   from one image to the next. Bands are handed to the workers in order and inflated as their IDAT data arrives,
+   each into its own rows of a buffer holding every filtered scanline of the image. The first row of a band may be
+   filtered against the last row of the band above, so a band waits for the one above to be reconstructed before
+   reconstructing its own rows and hands its last row down the same way. Rows go to the row sink once their band is
+   reconstructed, the sink is called from several threads at once but never twice for the same row.
+
+   A band layout that does not match the IDAT chunks or a band that does not inflate on its own falls back to
+   decoding the whole stream on the calling thread, which gives the same rows and errors a plain decode would.
+ */
+class BandDecoder {
+public:
+  typedef ScanlineDecoder::RowSink RowSink;
+
+  BandDecoder();
+  ~BandDecoder();
+  BandDecoder(const BandDecoder &) = delete;
+  BandDecoder &operator=(const BandDecoder &) = delete;
+
+  Status begin(const std::vector<IdotBand> &crBands, const size_t cRowBytes, const uint32_t cRows,
+               const uint8_t cBpp, const RowSink &crSink);
+  void startChunk(const uint64_t cOffset);
+  void feed(const uint8_t *cpData, const size_t cSize);
+  Status finish();
+  void abort();
+  void setInflateEngine(const InflateEngine cEngine);
+  void setCollectStats(const bool cCollect);
+  const DecodeStats &getStats() const;
+  bool finished() const;
+  uint32_t rowsDone() const;
+  uint32_t rows() const;
+  const std::string &getError() const;
+
+private:
+  enum BandState {
+    BAND_PENDING,
+    BAND_UNFILTERED,
+    BAND_FAILED
+  };
+
+  InflateBackend &getInflater(const size_t cIndex);
+  uint32_t unfilterRows(const uint32_t cFirstRow, const uint32_t cRows, DecodeStats &rStats);
+  void sinkRows(const uint32_t cFirstRow, const uint32_t cRows, DecodeStats &rStats);
+  void decodeBand(const size_t cIndex);
+  void setBandState(const size_t cIndex, const BandState cState);
+  bool waitForBand(const size_t cIndex);
+  Status decodeWhole();
+  void workerLoop();
+  void waitForWorkers();
+
+  InflateEngine mEngine;
+  std::vector<IdotBand> mBands;
+  size_t mRowBytes;
+  uint32_t mRows;
+  uint32_t mRowsDone;
+  UnfilterKernels mKernels;
+  RowSink mSink;
+  std::string mError;
+
+  // Bands holding rows above mRows, the band currently collecting IDAT data and whether the rest is unneeded
+  size_t mNeeded;
+  size_t mBand;
+  bool mComplete;
+
+  // Compressed data and an inflate backend per band, the size of every piece of data fed and every filtered
+  // scanline of the image plus one row of zeros in front of the first
+  std::vector<std::vector<uint8_t>> mData;
+  std::vector<size_t> mPieces;
+  std::vector<std::unique_ptr<InflateBackend>> mInflaters;
+  std::vector<uint8_t> mFiltered;
+
+  // Adler32 of the filtered scanlines of every band and the one that ends the stream, once the last band read it
+  std::vector<uLong> mAdlers;
+  bool mHaveAdler;
+  uLong mAdler;
+
+  // Worker threads, they take the bands below mReady from mNext on. The counts, the bands being decoded and the
+  // band states are guarded by mMutex.
+  std::vector<std::thread> mThreads;
+  size_t mReady;
+  size_t mNext;
+  size_t mRunning;
+  bool mStop;
+  std::vector<BandState> mStates;
+  std::mutex mMutex;
+  std::condition_variable mChanged;
+  std::condition_variable mWork;
+
+  // Every band counts into its own stats, they are added up once the workers are done
+  bool mCollectStats;
+  std::vector<DecodeStats> mBandStats;
+  DecodeStats mStats;
+};
+
+BandMode getBandMode();
+void setBandMode(const BandMode cMode);
+bool useBandThreads();
+Status parseIdot(const uint8_t *cpData, const uint32_t cLength, const uint32_t cHeight,
+                 std::vector<IdotBand> &rBands);
+
+#endif
@@ -0,0 +1,261 @@
+#include "batch.hpp"
+
+#include <algorithm>
+
+/* Function:    BatchDecoder
+   Description: Starts the thread pool and gives every worker its own scanline decoder
+   Parameters:  size_t - Number of worker threads, 0 to use one per hardware thread
+   Returns:     None
+ */
+BatchDecoder::BatchDecoder(const size_t cThreads) : mPool(cThreads)
+{
+  for (size_t i = 0; i < mPool.size(); i ++)
+  {
+    mScanlines.emplace_back(new ScanlineDecoder());
+  }
+}
+
+/* Function:    largestFirst
+   Description: Orders the items by pixel count, largest first, so the long decodes start early and the small ones
+                fill in the gaps at the end. Only the IHDR of each item is read for this.
+   Parameters:  std::vector<BatchItem> - Items to decode
+   Returns:     std::vector<size_t> - Item indices in decode order
+ */
+std::vector<size_t> BatchDecoder::largestFirst(const std::vector<BatchItem> &crItems)
+{
+  std::vector<size_t> order(crItems.size());
+  std::vector<uint64_t> pixels(crItems.size(), 0);
+  struct Png::IHDR ihdr;
+
+  for (size_t i = 0; i < crItems.size(); i ++)
+  {
+    const Status cProbed = crItems[i].path.empty() ? Png::probe(crItems[i].bytes, ihdr) :
+                                                     Png::probe(crItems[i].path, ihdr);
+
+    // Items that fail the probe are cheap to fail again, so they go last
+    pixels[i] = (cProbed == SUCCESS) ? static_cast<uint64_t>(ihdr.width) * ihdr.height : 0;
+    order[i] = i;
+  }
+
+  std::stable_sort(order.begin(), order.end(), [&pixels](const size_t cA, const size_t cB)
+  {
+    return pixels[cA] > pixels[cB];
+  });
+
+  return order;
+}
+
+/* Function:    decodeItem
+   Description: Decodes one item on a worker, catching any failure into the result
+   Parameters:  BatchItem - Item to decode
+                size_t - Worker running the decode
+   Returns:     BatchResult - Decoded image or the error that stopped it
+ */
+BatchResult BatchDecoder::decodeItem(const BatchItem &crItem, const size_t cWorker)
+{
+  BatchResult result;
+
+  result.status = FAIL;
+  result.ihdr = {};
+
+  try
+  {
+    std::unique_ptr<Png> pPng(crItem.path.empty() ? new Png(crItem.bytes, Png::DECODE_HEADER) :
+                                                    new Png(crItem.path, Png::FILE_MAP, Png::DECODE_HEADER));
+
+    pPng->setScanlineDecoder(mScanlines[cWorker].get());
+    result.status = pPng->decode();
+    result.ihdr = pPng->getIhdr();
+    result.imgData = pPng->takeImgData();
+  }
+  catch (const std::exception &crError)
+  {
+    result.status = FAIL;
+    result.error = crError.what();
+    result.imgData.clear();
+  }
+
+  return result;
+}
+
+/* Function:    decode
+   Description: Queues every item and returns a future per item, in the same order as the items
+   Parameters:  std::vector<BatchItem> - Items to decode, memory items have to stay alive until their future is ready
+   Returns:     std::vector<std::future<BatchResult>> - One future per item
+ */
+std::vector<std::future<BatchResult>> BatchDecoder::decode(const std::vector<BatchItem> &crItems)
+{
+  std::vector<std::shared_ptr<std::promise<BatchResult>>> promises;
+  std::vector<std::future<BatchResult>> futures;
+
+  for (size_t i = 0; i < crItems.size(); i ++)
+  {
+    promises.emplace_back(std::make_shared<std::promise<BatchResult>>());
+    futures.emplace_back(promises.back()->get_future());
+  }
+
+  for (const size_t cIndex : largestFirst(crItems))
+  {
+    const BatchItem cItem = crItems[cIndex];
+    const std::shared_ptr<std::promise<BatchResult>> cpPromise = promises[cIndex];
+
+    mPool.submit([this, cItem, cpPromise](const size_t cWorker)
+    {
+      cpPromise->set_value(decodeItem(cItem, cWorker));
+    });
+  }
+
+  return futures;
+}
+
+/* Function:    decode
+   Description: Queues every item and calls back as each one finishes. The callback runs on a worker thread, in
+                completion order, and may move the image data out of the result.
+   Parameters:  std::vector<BatchItem> - Items to decode, memory items have to stay alive until wait returns
+                Callback - Called with the item index and its result
+   Returns:     None
+ */
+void BatchDecoder::decode(const std::vector<BatchItem> &crItems, const Callback &crCallback)
+{
+  for (const size_t cIndex : largestFirst(crItems))
+  {
+    const BatchItem cItem = crItems[cIndex];
+
+    mPool.submit([this, cItem, cIndex, crCallback](const size_t cWorker)
+    {
+      BatchResult result = decodeItem(cItem, cWorker);
+      crCallback(cIndex, result);
+    });
+  }
+}
+
+/* Function:    decodeAtlasItem
+   Description: Decodes one image on a worker straight into its rectangle of the atlas. The png is checked against
+                the header the packing used, so a file that changed since can not write over its neighbours. A
+                failed image leaves its rectangle empty.
+   Parameters:  BatchItem - Item to decode
+                AtlasOptions - Format and orientation to decode with
+                Atlas - Atlas being built, its pixels are allocated
+                AtlasEntry - Entry of the item, already placed
+                size_t - Worker running the decode
+   Returns:     None
+ */
+void BatchDecoder::decodeAtlasItem(const BatchItem &crItem, const AtlasOptions &crOptions, Atlas &rAtlas,
+                                   AtlasEntry &rEntry, const size_t cWorker)
+{
+  const size_t cOffset = (static_cast<size_t>(rEntry.y) * rAtlas.stride) +
+                         (static_cast<size_t>(rEntry.x) * ATLAS_PIXEL_SIZE);
+  uint8_t *pDst = rAtlas.pixels.data() + cOffset;
+
+  try
+  {
+    std::unique_ptr<Png> pPng(crItem.path.empty() ? new Png(crItem.bytes, Png::DECODE_HEADER) :
+                                                    new Png(crItem.path, Png::FILE_MAP, Png::DECODE_HEADER));
+    const struct Png::IHDR cIhdr = pPng->getIhdr();
+
+    if (cIhdr.width != rEntry.ihdr.width || cIhdr.height != rEntry.ihdr.height)
+    {
+      throw PngException("Image changed size since it was packed");
+    }
+
+    pPng->setScanlineDecoder(mScanlines[cWorker].get());
+    pPng->setOutputFormat(crOptions.format, crOptions.alpha);
+    pPng->setOrientation(crOptions.orientation);
+
+    if (pPng->decodeInto(pDst, rAtlas.stride, rAtlas.pixels.size() - cOffset) == FAIL)
+    {
+      throw PngException("Image does not fit its rectangle");
+    }
+  }
+  catch (const std::exception &crError)
+  {
+    rEntry.status = FAIL;
+    rEntry.error = crError.what();
+
+    for (uint32_t y = 0; y < rEntry.height; y ++)
+    {
+      std::fill_n(pDst + (y * rAtlas.stride), static_cast<size_t>(rEntry.width) * ATLAS_PIXEL_SIZE, 0);
+    }
+  }
+}
+
+/* Function:    decodeAtlas
+   Description: Builds a texture atlas. Only the IHDR of every item is read to pack the atlas, then every image is
+                decoded in parallel straight into its rectangle, largest first, with no image ever held on its own.
+                Waits for the whole pool, so it should not be mixed with other decodes still in flight.
+   Parameters:  std::vector<BatchItem> - Items to put in the atlas
+                AtlasOptions - Format, orientation, padding and width, see getDefaultAtlasOptions
+                Atlas - Set to the atlas pixels and one entry per item in item order, an item that fails only fails
+                        its own entry
+   Returns:     Status - FAIL if the format is not a four byte one, the atlas would be over ATLAS_MAX_BYTES or no
+                         item could be placed
+ */
+Status BatchDecoder::decodeAtlas(const std::vector<BatchItem> &crItems, const AtlasOptions &crOptions, Atlas &rAtlas)
+{
+  std::vector<size_t> order;
+
+  rAtlas.pixels.clear();
+  rAtlas.entries.assign(crItems.size(), AtlasEntry());
+
+  for (size_t i = 0; i < crItems.size(); i ++)
+  {
+    AtlasEntry &rEntry = rAtlas.entries[i];
+    const Status cProbed = crItems[i].path.empty() ? Png::probe(crItems[i].bytes, rEntry.ihdr) :
+                                                     Png::probe(crItems[i].path, rEntry.ihdr);
+
+    rEntry.status = cProbed;
+
+    if (cProbed != SUCCESS)
+    {
+      rEntry.error = "Could not read the png header";
+    }
+  }
+
+  // packAtlas keeps the atlas under the limit, checked again here as this is where it gets allocated
+  if (packAtlas(crOptions, rAtlas) != SUCCESS || rAtlas.stride == 0 ||
+      rAtlas.height > (std::min<uint64_t>(ATLAS_MAX_BYTES, SIZE_MAX) / rAtlas.stride))
+  {
+    return FAIL;
+  }
+
+  rAtlas.pixels.assign(rAtlas.stride * rAtlas.height, 0);
+
+  for (size_t i = 0; i < rAtlas.entries.size(); i ++)
+  {
+    if (rAtlas.entries[i].status == SUCCESS)
+    {
+      order.push_back(i);
+    }
+  }
+
+  std::stable_sort(order.begin(), order.end(), [&rAtlas](const size_t cA, const size_t cB)
+  {
+    return (static_cast<uint64_t>(rAtlas.entries[cA].width) * rAtlas.entries[cA].height) >
+           (static_cast<uint64_t>(rAtlas.entries[cB].width) * rAtlas.entries[cB].height);
+  });
+
+  for (const size_t cIndex : order)
+  {
+    const BatchItem &crItem = crItems[cIndex];
+    AtlasEntry &rEntry = rAtlas.entries[cIndex];
+
+    mPool.submit([this, &crItem, &crOptions, &rAtlas, &rEntry](const size_t cWorker)
+    {
+      decodeAtlasItem(crItem, crOptions, rAtlas, rEntry, cWorker);
+    });
+  }
+
+  mPool.wait();
+
+  return SUCCESS;
+}
+
+/* Function:    wait
+   Description: Blocks until every queued item has been decoded
+   Parameters:  None
+   Returns:     None
+ */
+void BatchDecoder::wait()
+{
+  mPool.wait();
+}
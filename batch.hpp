@@ -0,0 +1,53 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <future>
+#include <memory>
+#include <functional>
+
+#include "png.hpp"
+#include "atlas.hpp"
+#include "threadPool.hpp"
+
+// One image to decode, from a file when path is set and from bytes in memory otherwise
+struct BatchItem {
+  std::string path;
+  ByteSpan bytes;
+};
+
+struct BatchResult {
+  Status status;
+  std::string error;
+  struct Png::IHDR ihdr;
+  std::vector<uint8_t> imgData;
+};
+
+/* Decodes many pngs at once on a work stealing thread pool. Each worker keeps its own scanline decoder, so zlib
+   streams and row buffers are reused across every image that worker decodes. A file that fails to decode only fails
+   its own result. Atlas builds read every IHDR first, pack the images and then decode each one straight into its
+   rectangle of the shared atlas pixels.
+ */
+class BatchDecoder {
+public:
+  typedef std::function<void(const size_t cIndex, BatchResult &rResult)> Callback;
+
+  explicit BatchDecoder(const size_t cThreads = 0);
+  std::vector<std::future<BatchResult>> decode(const std::vector<BatchItem> &crItems);
+  void decode(const std::vector<BatchItem> &crItems, const Callback &crCallback);
+  Status decodeAtlas(const std::vector<BatchItem> &crItems, const AtlasOptions &crOptions, Atlas &rAtlas);
+  void wait();
+
+private:
+  std::vector<size_t> largestFirst(const std::vector<BatchItem> &crItems);
+  BatchResult decodeItem(const BatchItem &crItem, const size_t cWorker);
+  void decodeAtlasItem(const BatchItem &crItem, const AtlasOptions &crOptions, Atlas &rAtlas, AtlasEntry &rEntry,
+                       const size_t cWorker);
+
+  ThreadPool mPool;
+  std::vector<std::unique_ptr<ScanlineDecoder>> mScanlines;
+};
+
+#endif
@@ -0,0 +1,654 @@
+#include "corpus.hpp"
+#include "decoder.hpp"
+#include "inflater.hpp"
+#include "unfilter.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <memory>
+
+#define BENCH_DEFAULT_ITERATIONS 5
+#define BENCH_DEFAULT_SEED 1
+
+// Output room past the end of an inflate corpus stream, so a stream that inflates to too much has room to show it
+#define BENCH_INFLATE_SLACK 65536
+
+enum BenchStage {
+  STAGE_INFLATE,
+  STAGE_UNFILTER,
+  STAGE_DECODE,
+  STAGE_RGBA8,
+  BENCH_STAGES
+};
+
+static const char *cStageNames[BENCH_STAGES] = {"inflate", "unfilter", "decode", "rgba8"};
+
+// Most input and output bytes handed to one call of the inflate comparison, 0 for all that is left
+static const size_t cInflateSplits[][2] = {{0, 0}, {7, 0}, {0, 7}, {97, 4096}, {4096, 97}};
+
+// Inflate backend, unfilter kernels and iDOT band decoding a run uses
+struct BenchConfig {
+  const char *name;
+  InflateEngine engine;
+  SimdLevel simd;
+  BandMode bands;
+};
+
+struct StageTimes {
+  std::vector<double> latencies;
+  double seconds;
+  uint64_t bytes;
+};
+
+struct BenchResult {
+  StageTimes stages[BENCH_STAGES];
+  std::map<std::string, StageTimes> groups;
+  DecodeStats decodeStats;
+
+  // Decoded pixels of every image, compared between configs
+  std::vector<std::vector<uint8_t>> pixels;
+  bool failed;
+};
+
+typedef std::chrono::steady_clock BenchClock;
+
+/* Function:    elapsed
+   Description: Seconds since a start time
+   Parameters:  time_point - Start time
+   Returns:     double - Seconds elapsed
+ */
+static double elapsed(const BenchClock::time_point &crStart)
+{
+  return std::chrono::duration<double>(BenchClock::now() - crStart).count();
+}
+
+/* Function:    record
+   Description: Adds one timed run to a stage
+   Parameters:  StageTimes - Stage to add to
+                double - Seconds the run took
+                uint64_t - Bytes the run produced
+   Returns:     None
+ */
+static void record(StageTimes &rTimes, const double cSeconds, const uint64_t cBytes)
+{
+  rTimes.latencies.push_back(cSeconds);
+  rTimes.seconds += cSeconds;
+  rTimes.bytes += cBytes;
+}
+
+/* Function:    inflateImage
+   Description: Inflates the joined IDAT stream of an image in one go
+   Parameters:  InflateBackend - Backend to inflate with
+                CorpusImage - Image to inflate
+                std::vector<uint8_t> - Receives the filtered scanlines
+   Returns:     Status - FAIL if the backend reports an error or stops before every scanline is out
+ */
+static Status inflateImage(InflateBackend &rInflater, const CorpusImage &crImage, std::vector<uint8_t> &rFiltered)
+{
+  const uint8_t *cpIn = crImage.idat.data();
+  size_t inSize = crImage.idat.size();
+  uint8_t *pOut = rFiltered.data();
+  size_t outSize = rFiltered.size();
+  InflateStatus status = INFLATE_OK;
+
+  if (rInflater.reset() == FAIL)
+  {
+    return FAIL;
+  }
+
+  // Like the scanline decoder, stop once every scanline byte is out, a backend does not have to see the checksum first
+  while (status == INFLATE_OK && outSize > 0)
+  {
+    const size_t cBefore = inSize + outSize;
+
+    status = rInflater.inflate(cpIn, inSize, pOut, outSize);
+
+    if (status == INFLATE_OK && inSize + outSize == cBefore)
+    {
+      return FAIL;
+    }
+  }
+
+  return (status != INFLATE_ERROR && outSize == 0) ? SUCCESS : FAIL;
+}
+
+/* Function:    unfilterImage
+   Description: Reconstructs every scanline of an inflated image in place, pass by pass
+   Parameters:  CorpusImage - Image the scanlines belong to
+                std::vector<uint8_t> - Filtered scanlines, reconstructed on return
+                std::vector<uint8_t> - Zeroed row at least as long as the longest row
+   Returns:     Status - FAIL for an invalid filter type
+ */
+static Status unfilterImage(const CorpusImage &crImage, std::vector<uint8_t> &rScanlines,
+                            const std::vector<uint8_t> &crZeros)
+{
+  const uint8_t cChannels = getSampleChannels(crImage.ihdr.colorType);
+  const uint8_t cBpp = static_cast<uint8_t>(std::max(1, (cChannels * crImage.ihdr.bitDepth) / 8));
+  const UnfilterKernels cKernels = getUnfilterKernels(cBpp);
+  uint8_t *pLine = rScanlines.data();
+
+  for (const ScanlinePass &crPass : crImage.passes)
+  {
+    const uint8_t *cpPrev = crZeros.data();
+
+    for (uint32_t r = 0; r < crPass.rows; r ++)
+    {
+      if (unfilterRow(cKernels, pLine[0], pLine + 1, cpPrev, crPass.rowBytes) == FAIL)
+      {
+        return FAIL;
+      }
+
+      cpPrev = pLine + 1;
+      pLine += crPass.rowBytes + 1;
+    }
+  }
+
+  return SUCCESS;
+}
+
+/* Function:    runConfig
+   Description: Times every stage of every image. Each image is run once untimed to warm caches and buffers, then
+                the given number of timed iterations are recorded. The decode stages reuse one PngDecoder, as an
+                application decoding many images would.
+   Parameters:  std::vector<CorpusImage> - Corpus
+                BenchConfig - Backend and kernels to use
+                uint32_t - Timed iterations per image
+                bool - True to collect decode stats on the native decodes
+   Returns:     BenchResult - Times per stage and group, and the decoded pixels
+ */
+static BenchResult runConfig(const std::vector<CorpusImage> &crCorpus, const BenchConfig &crConfig,
+                             const uint32_t cIterations, const bool cStats)
+{
+  BenchResult result = {};
+  std::unique_ptr<InflateBackend> pInflater(createInflater(crConfig.engine));
+  PngDecoder native;
+  PngDecoder rgba;
+  std::vector<uint8_t> filtered;
+  std::vector<uint8_t> scanlines;
+  std::vector<uint8_t> zeros;
+
+  setUnfilterSimdLevel(crConfig.simd);
+  setBandMode(crConfig.bands);
+  native.setInflateEngine(crConfig.engine);
+  native.setCollectStats(cStats);
+  rgba.setInflateEngine(crConfig.engine);
+  rgba.setOutputFormat(PIXEL_RGBA8);
+
+  for (const CorpusImage &crImage : crCorpus)
+  {
+    StageTimes &rGroup = result.groups[crImage.group];
+
+    filtered.resize(crImage.filteredSize);
+    zeros.clear();
+
+    for (const ScanlinePass &crPass : crImage.passes)
+    {
+      zeros.resize(std::max(zeros.size(), crPass.rowBytes), 0);
+    }
+
+    for (uint32_t i = 0; i <= cIterations; i ++)
+    {
+      const bool cTimed = (i > 0);
+      BenchClock::time_point start = BenchClock::now();
+      bool failed = (inflateImage(*pInflater, crImage, filtered) == FAIL);
+
+      if (cTimed)
+      {
+        record(result.stages[STAGE_INFLATE], elapsed(start), filtered.size());
+      }
+
+      scanlines = filtered;
+      start = BenchClock::now();
+      failed |= (unfilterImage(crImage, scanlines, zeros) == FAIL);
+
+      if (cTimed)
+      {
+        record(result.stages[STAGE_UNFILTER], elapsed(start), scanlines.size());
+      }
+
+      start = BenchClock::now();
+      failed |= (native.decode(ByteSpan{crImage.png.data(), crImage.png.size()}) == FAIL);
+
+      if (cTimed)
+      {
+        const double cSeconds = elapsed(start);
+
+        record(result.stages[STAGE_DECODE], cSeconds, native.getPixels().size);
+        record(rGroup, cSeconds, native.getPixels().size);
+      }
+
+      start = BenchClock::now();
+      failed |= (rgba.decode(ByteSpan{crImage.png.data(), crImage.png.size()}) == FAIL);
+
+      if (cTimed)
+      {
+        record(result.stages[STAGE_RGBA8], elapsed(start), rgba.getPixels().size);
+      }
+
+      if (failed)
+      {
+        fprintf(stderr, "%s: %s failed %s\n", crConfig.name, crImage.name.c_str(), native.getError().c_str());
+        result.failed = true;
+        break;
+      }
+    }
+
+    const ByteSpan cPixels = native.getPixels();
+
+    result.pixels.emplace_back(cPixels.data, cPixels.data + cPixels.size);
+  }
+
+  result.decodeStats = native.getTotalStats();
+
+  return result;
+}
+
+/* Function:    checkDamaged
+   Description: Decodes every corpus image with its adler32 damaged through both configs, each has to reject
+                every one of them. A backend that stops once the scanlines are out without reading the checksum
+                would decode them.
+   Parameters:  std::vector<CorpusImage> - Corpus
+                BenchConfig - Reference config
+                BenchConfig - Config compared against it
+   Returns:     size_t - Damaged images one of the configs decoded
+ */
+static size_t checkDamaged(const std::vector<CorpusImage> &crCorpus, const BenchConfig &crReference,
+                           const BenchConfig &crCompared)
+{
+  PngDecoder reference;
+  PngDecoder compared;
+  std::vector<uint8_t> damaged;
+  size_t accepted = 0;
+
+  reference.setInflateEngine(crReference.engine);
+  compared.setInflateEngine(crCompared.engine);
+
+  for (const CorpusImage &crImage : crCorpus)
+  {
+    if (damageCorpusAdler(crImage, damaged) == FAIL)
+    {
+      continue;
+    }
+
+    const ByteSpan cBytes = {damaged.data(), damaged.size()};
+
+    setBandMode(crReference.bands);
+
+    const bool cReferenceFailed = (reference.decode(cBytes) == FAIL);
+
+    setBandMode(crCompared.bands);
+
+    const bool cComparedFailed = (compared.decode(cBytes) == FAIL);
+
+    if (!cReferenceFailed || !cComparedFailed)
+    {
+      fprintf(stderr, "damaged adler32 decoded: %s by %s\n", crImage.name.c_str(),
+              cReferenceFailed ? crCompared.name : crReference.name);
+      accepted ++;
+    }
+  }
+
+  return accepted;
+}
+
+/* Function:    inflatePieces
+   Description: Inflates an inflate corpus stream handing the backend at most so many bytes of input and output a
+                call, the pieces vary in size from call to call so the splits land all over the stream
+   Parameters:  InflateBackend - Backend to inflate with
+                InflateCase - Stream to inflate
+                size_t - Most input bytes a call, 0 for all that is left
+                size_t - Most output bytes a call, 0 for all that is left
+                std::vector<uint8_t> - Receives what the backend put out
+   Returns:     InflateStatus - INFLATE_OK if the input or the output ran out before the stream ended
+ */
+static InflateStatus inflatePieces(InflateBackend &rInflater, const InflateCase &crCase, const size_t cInPiece,
+                                   const size_t cOutPiece, std::vector<uint8_t> &rOut)
+{
+  const uint8_t *cpIn = crCase.stream.data();
+  size_t inLeft = crCase.stream.size();
+  size_t produced = 0;
+  InflateStatus status = INFLATE_OK;
+
+  rOut.resize(crCase.dataSize + BENCH_INFLATE_SLACK);
+
+  if (rInflater.reset() == FAIL)
+  {
+    return INFLATE_ERROR;
+  }
+
+  for (size_t call = 0; status == INFLATE_OK; call ++)
+  {
+    const size_t cOutLeft = rOut.size() - produced;
+    const size_t cIn = (cInPiece == 0) ? inLeft : std::min(inLeft, 1 + ((call * 7919) % cInPiece));
+    const size_t cOut = (cOutPiece == 0) ? cOutLeft : std::min(cOutLeft, 1 + ((call * 104729) % cOutPiece));
+    uint8_t *pOut = rOut.data() + produced;
+    size_t inSize = cIn;
+    size_t outSize = cOut;
+
+    status = rInflater.inflate(cpIn, inSize, pOut, outSize);
+    inLeft -= cIn - inSize;
+    produced += cOut - outSize;
+
+    // A call that moves nothing has run out of input or output for good
+    if (status == INFLATE_OK && inSize == cIn && outSize == cOut)
+    {
+      break;
+    }
+  }
+
+  rOut.resize(produced);
+
+  return status;
+}
+
+/* Function:    checkInflaters
+   Description: Inflates every stream of the inflate corpus with zlib and the fast inflater, both handed the same
+                pieces for every split of cInflateSplits. They have to end the same way, at the end of the stream,
+                on an error or out of input, and an undamaged stream has to come out as the bytes it was deflated
+                from. A damaged stream may fail after a different amount of output from each, as long as one is
+                the start of the other, and one that fills the output can stop either way.
+   Parameters:  std::vector<InflateCase> - Inflate corpus
+   Returns:     size_t - Streams the backends do not agree on
+ */
+static size_t checkInflaters(const std::vector<InflateCase> &crCorpus)
+{
+  std::unique_ptr<InflateBackend> pReference(createInflater(INFLATE_ZLIB));
+  std::unique_ptr<InflateBackend> pFast(createInflater(INFLATE_FAST));
+  std::vector<uint8_t> referenceOut;
+  std::vector<uint8_t> fastOut;
+  size_t mismatches = 0;
+
+  for (const InflateCase &crCase : crCorpus)
+  {
+    const size_t cFull = crCase.dataSize + BENCH_INFLATE_SLACK;
+    bool agree = true;
+
+    for (const size_t *cpSplit : cInflateSplits)
+    {
+      const InflateStatus cReference = inflatePieces(*pReference, crCase, cpSplit[0], cpSplit[1], referenceOut);
+      const InflateStatus cFast = inflatePieces(*pFast, crCase, cpSplit[0], cpSplit[1], fastOut);
+      const size_t cCommon = std::min(referenceOut.size(), fastOut.size());
+
+      agree = agree && std::equal(referenceOut.begin(), referenceOut.begin() + cCommon, fastOut.begin());
+      agree = agree && ((cReference == cFast) || (referenceOut.size() == cFull) || (fastOut.size() == cFull));
+      agree = agree && ((cReference != INFLATE_STREAM_END) || (referenceOut.size() == fastOut.size()));
+
+      if (crCase.damage == INFLATE_DAMAGE_NONE)
+      {
+        agree = agree && (cReference == INFLATE_STREAM_END) && (referenceOut == crCase.data);
+      }
+    }
+
+    if (!agree)
+    {
+      fprintf(stderr, "inflaters differ: %s\n", crCase.name.c_str());
+      mismatches ++;
+    }
+  }
+
+  return mismatches;
+}
+
+/* Function:    percentile
+   Description: Nearest rank percentile
+   Parameters:  std::vector<double> - Sorted samples
+                double - Percentile, 0 to 100
+   Returns:     double - Sample at that rank, 0 for no samples
+ */
+static double percentile(const std::vector<double> &crSorted, const double cPercent)
+{
+  if (crSorted.empty())
+  {
+    return 0.0;
+  }
+
+  const size_t cRank = static_cast<size_t>((cPercent / 100.0) * static_cast<double>(crSorted.size()) + 0.5);
+
+  return crSorted[std::min(crSorted.size() - 1, (cRank == 0) ? 0 : cRank - 1)];
+}
+
+/* Function:    printTimes
+   Description: Prints throughput and latency percentiles of one stage or group
+   Parameters:  char* - Row label
+                StageTimes - Times to print
+   Returns:     None
+ */
+static void printTimes(const char *cpLabel, const StageTimes &crTimes)
+{
+  std::vector<double> sorted = crTimes.latencies;
+  const double cMbs = (crTimes.seconds > 0.0) ? (static_cast<double>(crTimes.bytes) / 1e6) / crTimes.seconds : 0.0;
+
+  std::sort(sorted.begin(), sorted.end());
+  printf("  %-10s %10.1f %10.1f %10.1f %10.1f %10.1f\n", cpLabel, cMbs, percentile(sorted, 50) * 1e6,
+         percentile(sorted, 90) * 1e6, percentile(sorted, 99) * 1e6, percentile(sorted, 100) * 1e6);
+}
+
+/* Function:    printStats
+   Description: Prints the decode stats a config collected, summed over every native decode including warm up
+   Parameters:  DecodeStats - Summed stats
+   Returns:     None
+ */
+static void printStats(const DecodeStats &crStats)
+{
+  static const char *cpStatsStages[STATS_STAGES] = {"read", "inflate", "unfilter", "store"};
+
+  if (!STATS_ENABLED)
+  {
+    printf("  decode stats are not built in, rebuild with STATS=1\n");
+    return;
+  }
+
+  printf("  decode stats over %u decodes, %.1f ms\n", crStats.decodes, static_cast<double>(crStats.totalNs) / 1e6);
+
+  for (uint8_t s = 0; s < STATS_STAGES; s ++)
+  {
+    printf("  %-10s %10.1f ms\n", cpStatsStages[s], static_cast<double>(crStats.stageNs[s]) / 1e6);
+  }
+
+  printf("  bytes in %llu, compressed %llu, filtered %llu, out %llu\n",
+         static_cast<unsigned long long>(crStats.bytesIn), static_cast<unsigned long long>(crStats.compressedBytes),
+         static_cast<unsigned long long>(crStats.filteredBytes), static_cast<unsigned long long>(crStats.bytesOut));
+  printf("  chunks %u, IDAT %u, allocations %u, peak scratch %zu bytes\n", crStats.chunks, crStats.idatChunks,
+         crStats.allocations, crStats.peakScratchBytes);
+  printf("  filters none %llu, sub %llu, up %llu, average %llu, paeth %llu\n",
+         static_cast<unsigned long long>(crStats.filterCounts[0]),
+         static_cast<unsigned long long>(crStats.filterCounts[1]),
+         static_cast<unsigned long long>(crStats.filterCounts[2]),
+         static_cast<unsigned long long>(crStats.filterCounts[3]),
+         static_cast<unsigned long long>(crStats.filterCounts[4]));
+}
+
+/* Function:    printResult
+   Description: Prints the stage and group tables of one config
+   Parameters:  BenchConfig - Config that was run
+                BenchResult - Its times
+                bool - True to print the decode stats too
+   Returns:     None
+ */
+static void printResult(const BenchConfig &crConfig, const BenchResult &crResult, const bool cStats)
+{
+  printf("\n%s\n  %-10s %10s %10s %10s %10s %10s\n", crConfig.name, "stage", "MB/s", "p50 us", "p90 us", "p99 us",
+         "max us");
+
+  for (uint8_t s = 0; s < BENCH_STAGES; s ++)
+  {
+    printTimes(cStageNames[s], crResult.stages[s]);
+  }
+
+  printf("  decode by group\n");
+
+  for (const std::pair<const std::string, StageTimes> &crGroup : crResult.groups)
+  {
+    printTimes(crGroup.first.c_str(), crGroup.second);
+  }
+
+  if (cStats)
+  {
+    printStats(crResult.decodeStats);
+  }
+}
+
+/* Function:    writeCorpus
+   Description: Writes every corpus image to a directory, so other decoders can be run over the same files
+   Parameters:  std::vector<CorpusImage> - Corpus
+                std::string - Existing directory
+   Returns:     Status - FAIL if a file could not be written
+ */
+static Status writeCorpus(const std::vector<CorpusImage> &crCorpus, const std::string &crDir)
+{
+  for (const CorpusImage &crImage : crCorpus)
+  {
+    std::ofstream file((crDir + "/" + crImage.name + ".png").c_str(), std::ios::binary);
+
+    file.write(reinterpret_cast<const char *>(crImage.png.data()), static_cast<std::streamsize>(crImage.png.size()));
+
+    if (!file.good())
+    {
+      return FAIL;
+    }
+  }
+
+  return SUCCESS;
+}
+
+/* Function:    usage
+   Description: Prints the command line options
+   Parameters:  char* - Program name
+   Returns:     int - Exit code
+ */
+static int usage(const char *cpProgram)
+{
+  printf("Usage: %s [options]\n", cpProgram);
+  printf("  --quick          Small images, runs in seconds\n");
+  printf("  --iterations N   Timed runs per image, default %d\n", BENCH_DEFAULT_ITERATIONS);
+  printf("  --seed N         Corpus seed, default %d\n", BENCH_DEFAULT_SEED);
+  printf("  --compare        Run reference zlib with scalar unfilter and no iDOT bands against the fast inflater\n");
+  printf("                   with SIMD unfilter and bands forced on, and check that both decode to the same pixels\n");
+  printf("                   and reject a damaged adler32, then check that both inflaters agree on zlib streams of\n");
+  printf("                   every level and strategy, whole, damaged and cut short, fed in pieces of many sizes\n");
+  printf("  --stats          Collect and print decode stats, needs a STATS=1 build\n");
+  printf("  --write DIR      Write the corpus to DIR and exit\n");
+
+  return 2;
+}
+
+int main(int argc, char **argv)
+{
+  CorpusScale scale = CORPUS_FULL;
+  uint32_t iterations = BENCH_DEFAULT_ITERATIONS;
+  uint32_t seed = BENCH_DEFAULT_SEED;
+  bool compare = false;
+  bool stats = false;
+  std::string writeDir;
+
+  for (int i = 1; i < argc; i ++)
+  {
+    const bool cHasValue = (i + 1 < argc);
+
+    if (strcmp(argv[i], "--quick") == 0)
+    {
+      scale = CORPUS_QUICK;
+    }
+    else if (strcmp(argv[i], "--compare") == 0)
+    {
+      compare = true;
+    }
+    else if (strcmp(argv[i], "--stats") == 0)
+    {
+      stats = true;
+    }
+    else if (strcmp(argv[i], "--iterations") == 0 && cHasValue)
+    {
+      iterations = static_cast<uint32_t>(std::max(1l, strtol(argv[++ i], nullptr, 10)));
+    }
+    else if (strcmp(argv[i], "--seed") == 0 && cHasValue)
+    {
+      seed = static_cast<uint32_t>(strtoul(argv[++ i], nullptr, 10));
+    }
+    else if (strcmp(argv[i], "--write") == 0 && cHasValue)
+    {
+      writeDir = argv[++ i];
+    }
+    else
+    {
+      return usage(argv[0]);
+    }
+  }
+
+  BenchClock::time_point start = BenchClock::now();
+  const std::vector<CorpusImage> cCorpus = generateCorpus(seed, scale);
+  uint64_t pngBytes = 0;
+
+  for (const CorpusImage &crImage : cCorpus)
+  {
+    pngBytes += crImage.png.size();
+  }
+
+  printf("corpus: %zu images, %.1f MB of png, seed %u, generated in %.2f s\n", cCorpus.size(),
+         static_cast<double>(pngBytes) / 1e6, seed, elapsed(start));
+
+  if (!writeDir.empty())
+  {
+    return (writeCorpus(cCorpus, writeDir) == SUCCESS) ? 0 : 1;
+  }
+
+  const SimdLevel cDetected = detectSimdLevel();
+  const BenchConfig cDefault = {"default (zlib, detected SIMD)", INFLATE_ZLIB, cDetected, BAND_MODE_AUTO};
+  const BenchConfig cReference = {"reference (zlib, scalar, no bands)", INFLATE_ZLIB, SIMD_SCALAR, BAND_MODE_OFF};
+  const BenchConfig cFast = {"fast (fast inflater, detected SIMD, bands)", INFLATE_FAST, cDetected, BAND_MODE_FORCE};
+
+  printf("iterations: %u, unfilter SIMD level %d\n", iterations, static_cast<int>(cDetected));
+
+  if (!compare)
+  {
+    const BenchResult cResult = runConfig(cCorpus, cDefault, iterations, stats);
+
+    printResult(cDefault, cResult, stats);
+
+    return cResult.failed ? 1 : 0;
+  }
+
+  const BenchResult cReferenceResult = runConfig(cCorpus, cReference, iterations, stats);
+  const BenchResult cFastResult = runConfig(cCorpus, cFast, iterations, stats);
+  size_t mismatches = 0;
+
+  printResult(cReference, cReferenceResult, stats);
+  printResult(cFast, cFastResult, stats);
+  printf("\nspeedup over reference\n");
+
+  for (uint8_t s = 0; s < BENCH_STAGES; s ++)
+  {
+    const double cSpeedup = (cFastResult.stages[s].seconds > 0.0) ?
+                            cReferenceResult.stages[s].seconds / cFastResult.stages[s].seconds : 0.0;
+
+    printf("  %-10s %9.2fx\n", cStageNames[s], cSpeedup);
+  }
+
+  for (size_t i = 0; i < cCorpus.size(); i ++)
+  {
+    if (cReferenceResult.pixels[i] != cFastResult.pixels[i])
+    {
+      fprintf(stderr, "pixels differ: %s\n", cCorpus[i].name.c_str());
+      mismatches ++;
+    }
+  }
+
+  printf("pixels: %zu of %zu images match\n", cCorpus.size() - mismatches, cCorpus.size());
+
+  const size_t cAccepted = checkDamaged(cCorpus, cReference, cFast);
+
+  printf("damaged adler32: %zu of %zu images rejected\n", cCorpus.size() - cAccepted, cCorpus.size());
+  setUnfilterSimdLevel(cDetected);
+  setBandMode(BAND_MODE_AUTO);
+
+  const std::vector<InflateCase> cInflateCorpus = generateInflateCorpus(seed, scale);
+  const size_t cDisagreed = checkInflaters(cInflateCorpus);
+
+  printf("inflaters: %zu of %zu streams agree\n", cInflateCorpus.size() - cDisagreed, cInflateCorpus.size());
+
+  return (cReferenceResult.failed || cFastResult.failed || mismatches > 0 || cAccepted > 0 || cDisagreed > 0) ? 1 : 0;
+}
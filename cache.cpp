@@ -0,0 +1,716 @@
+#include "cache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <sys/types.h>
+  #include <sys/stat.h>
+#endif
+
+// Multipliers of the content hash, odd 64 bit constants with well mixed bits
+#define HASH_PRIME_1 0x9E3779B185EBCA87ull
+#define HASH_PRIME_2 0xC2B2AE3D27D4EB4Full
+#define HASH_PRIME_3 0x165667B19E3779F9ull
+
+// Words of a file version, see getFileVersion
+#define CACHE_VERSION_WORDS 6
+
+// Keeps keys made from a path apart from keys made from file contents
+#define CACHE_KEY_PATH    1
+#define CACHE_KEY_CONTENT 2
+
+// Written in host order, so a file from a machine of the other byte order is never trusted
+#define CACHE_BYTE_ORDER 0x01020304u
+
+static const char cCacheMagic[8] = {'L', 'E', 'S', 'T', 'R', 'A', 'W', '\n'};
+
+// Header of a disk cache file, the pixels follow it tightly packed. Files never leave the machine so it is stored
+// in host byte order.
+struct CacheFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint64_t key;
+  uint64_t rowBytes;
+  uint64_t pixelBytes;
+  uint32_t width;
+  uint32_t height;
+  uint8_t bitDepth;
+  uint8_t colorType;
+  uint8_t interlace;
+  uint8_t format;
+  uint8_t alpha;
+  uint8_t reserved[11];
+};
+
+static_assert(sizeof(CacheFileHeader) == CACHE_HEADER_BYTES, "Disk cache header has to fill CACHE_HEADER_BYTES");
+
+/* Function:    rotateLeft
+   Description: Rotates a 64 bit value left
+   Parameters:  uint64_t - Value
+                int - Bits to rotate by, 1 to 63
+   Returns:     uint64_t - Rotated value
+ */
+static inline uint64_t rotateLeft(const uint64_t cValue, const int cBits)
+{
+  return (cValue << cBits) | (cValue >> (64 - cBits));
+}
+
+/* Function:    hashRound
+   Description: Mixes one 8 byte word into a lane of the content hash
+   Parameters:  uint64_t - Lane
+                uint8_t* - Word to mix in, any alignment
+   Returns:     uint64_t - New lane
+ */
+static inline uint64_t hashRound(const uint64_t cLane, const uint8_t *cpWord)
+{
+  uint64_t word = 0;
+
+  memcpy(&word, cpWord, sizeof(word));
+
+  return rotateLeft(cLane + (word * HASH_PRIME_2), 31) * HASH_PRIME_1;
+}
+
+/* Function:    hashBytes
+   Description: 64 bit hash of a byte range. Four independent lanes take 32 bytes per step so hashing a file costs a
+                small fraction of inflating it. Only ever compared on the machine that made it.
+   Parameters:  uint8_t* - Bytes to hash
+                size_t - Amount of bytes
+                uint64_t - Seed, different seeds give unrelated hashes
+   Returns:     uint64_t - Hash
+ */
+static uint64_t hashBytes(const uint8_t *cpData, const size_t cSize, const uint64_t cSeed)
+{
+  uint64_t lane0 = cSeed + HASH_PRIME_1 + HASH_PRIME_2;
+  uint64_t lane1 = cSeed + HASH_PRIME_2;
+  uint64_t lane2 = cSeed;
+  uint64_t lane3 = cSeed - HASH_PRIME_1;
+  size_t i = 0;
+
+  for (; i + 32 <= cSize; i += 32)
+  {
+    lane0 = hashRound(lane0, cpData + i);
+    lane1 = hashRound(lane1, cpData + i + 8);
+    lane2 = hashRound(lane2, cpData + i + 16);
+    lane3 = hashRound(lane3, cpData + i + 24);
+  }
+
+  uint64_t hash = rotateLeft(lane0, 1) + rotateLeft(lane1, 7) + rotateLeft(lane2, 12) + rotateLeft(lane3, 18) +
+                  static_cast<uint64_t>(cSize);
+
+  for (; i + 8 <= cSize; i += 8)
+  {
+    hash = (rotateLeft(hash ^ hashRound(0, cpData + i), 27) * HASH_PRIME_1) + HASH_PRIME_3;
+  }
+
+  for (; i < cSize; i++)
+  {
+    hash = rotateLeft(hash ^ (cpData[i] * HASH_PRIME_3), 11) * HASH_PRIME_1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= HASH_PRIME_2;
+  hash ^= hash >> 29;
+  hash *= HASH_PRIME_3;
+  hash ^= hash >> 32;
+
+  return hash;
+}
+
+/* Function:    getKeySeed
+   Description: Seeds the key hash with what else decides the cached pixels, so every output format gets its own key
+   Parameters:  uint8_t - CACHE_KEY_PATH or CACHE_KEY_CONTENT
+                PixelFormat - Output format
+                AlphaMode - Output alpha mode
+   Returns:     uint64_t - Seed
+ */
+static uint64_t getKeySeed(const uint8_t cKind, const PixelFormat cFormat, const AlphaMode cAlpha)
+{
+  return (static_cast<uint64_t>(cKind) << 16) | (static_cast<uint64_t>(cFormat) << 8) |
+         static_cast<uint64_t>(cAlpha);
+}
+
+/* Function:    getFileVersion
+   Description: Gets what identifies one version of a file, which together stands in for its contents. Times are
+                kept to the full resolution of the file system, so a file rewritten with the same size within a
+                second still gets a new version. POSIX adds the inode and status change time, which move when a file
+                is replaced or its modification time is set back.
+   Parameters:  std::string - Filepath
+                uint64_t* - Receives CACHE_VERSION_WORDS words, the size first
+   Returns:     bool - False if the file can not be found
+ */
+static bool getFileVersion(const std::string &crPath, uint64_t *pVersion)
+{
+#ifdef _WIN32
+  WIN32_FILE_ATTRIBUTE_DATA info;
+
+  if (GetFileAttributesExA(crPath.c_str(), GetFileExInfoStandard, &info) == 0)
+  {
+    return false;
+  }
+
+  pVersion[0] = (static_cast<uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+  pVersion[1] = (static_cast<uint64_t>(info.ftLastWriteTime.dwHighDateTime) << 32) |
+                info.ftLastWriteTime.dwLowDateTime;
+  pVersion[2] = (static_cast<uint64_t>(info.ftCreationTime.dwHighDateTime) << 32) | info.ftCreationTime.dwLowDateTime;
+  pVersion[3] = 0;
+  pVersion[4] = 0;
+  pVersion[5] = 0;
+#else
+  struct stat info;
+
+  if (stat(crPath.c_str(), &info) != 0)
+  {
+    return false;
+  }
+
+  pVersion[0] = static_cast<uint64_t>(info.st_size);
+  pVersion[1] = static_cast<uint64_t>(info.st_ino);
+#ifdef __APPLE__
+  pVersion[2] = static_cast<uint64_t>(info.st_mtimespec.tv_sec);
+  pVersion[3] = static_cast<uint64_t>(info.st_mtimespec.tv_nsec);
+  pVersion[4] = static_cast<uint64_t>(info.st_ctimespec.tv_sec);
+  pVersion[5] = static_cast<uint64_t>(info.st_ctimespec.tv_nsec);
+#else
+  pVersion[2] = static_cast<uint64_t>(info.st_mtim.tv_sec);
+  pVersion[3] = static_cast<uint64_t>(info.st_mtim.tv_nsec);
+  pVersion[4] = static_cast<uint64_t>(info.st_ctim.tv_sec);
+  pVersion[5] = static_cast<uint64_t>(info.st_ctim.tv_nsec);
+#endif
+#endif
+
+  return true;
+}
+
+/* Function:    setError
+   Description: Hands an error to the caller if it asked for one
+   Parameters:  std::string* - Where the caller wants the error, may be nullptr
+                std::string - Error
+   Returns:     None
+ */
+static void setError(std::string *pError, const std::string &crError)
+{
+  if (pError != nullptr)
+  {
+    *pError = crError;
+  }
+}
+
+/* Function:    CachedImage
+   Description: Constructs an image whose pixels live in memory
+   Parameters:  IHDR - Header of the png the pixels came from
+                PixelFormat - Layout of the pixels
+                AlphaMode - Whether color is premultiplied by alpha
+                size_t - Bytes per row
+                std::vector<uint8_t> - Pixels, moved from
+   Returns:     None
+ */
+CachedImage::CachedImage(const struct Png::IHDR &crIhdr, const PixelFormat cFormat, const AlphaMode cAlpha,
+                         const size_t cRowBytes, std::vector<uint8_t> &&rPixels) : mIhdr(crIhdr),
+                         mFormat(cFormat), mAlpha(cAlpha), mRowBytes(cRowBytes), mPixels(std::move(rPixels)),
+                         mView{mPixels.data(), mPixels.size()}
+{
+}
+
+/* Function:    CachedImage
+   Description: Constructs an image whose pixels are read straight from a mapped disk cache file
+   Parameters:  IHDR - Header of the png the pixels came from
+                PixelFormat - Layout of the pixels
+                AlphaMode - Whether color is premultiplied by alpha
+                size_t - Bytes per row
+                MappedFile - Mapping of a checked disk cache file, moved from
+   Returns:     None
+ */
+CachedImage::CachedImage(const struct Png::IHDR &crIhdr, const PixelFormat cFormat, const AlphaMode cAlpha,
+                         const size_t cRowBytes, std::unique_ptr<MappedFile> &&rpMapping) : mIhdr(crIhdr),
+                         mFormat(cFormat), mAlpha(cAlpha), mRowBytes(cRowBytes), mpMapping(std::move(rpMapping)),
+                         mView{mpMapping->getBytes().data + CACHE_HEADER_BYTES,
+                               mpMapping->getBytes().size - CACHE_HEADER_BYTES}
+{
+}
+
+/* Function:    getIhdr
+   Description: Getter function for the header of the png the pixels came from
+   Parameters:  None
+   Returns:     IHDR - Png header
+ */
+const struct Png::IHDR &CachedImage::getIhdr() const
+{
+  return mIhdr;
+}
+
+/* Function:    getFormat
+   Description: Getter function for the layout of the pixels
+   Parameters:  None
+   Returns:     PixelFormat - Pixel layout
+ */
+PixelFormat CachedImage::getFormat() const
+{
+  return mFormat;
+}
+
+/* Function:    getAlphaMode
+   Description: Getter function for whether color is premultiplied by alpha
+   Parameters:  None
+   Returns:     AlphaMode - Alpha mode
+ */
+AlphaMode CachedImage::getAlphaMode() const
+{
+  return mAlpha;
+}
+
+/* Function:    getRowBytes
+   Description: Getter function for the bytes in one row, rows are tightly packed
+   Parameters:  None
+   Returns:     size_t - Bytes per row
+ */
+size_t CachedImage::getRowBytes() const
+{
+  return mRowBytes;
+}
+
+/* Function:    getPixels
+   Description: Getter function for the pixels, valid for as long as the image is
+   Parameters:  None
+   Returns:     ByteSpan - Pixels
+ */
+ByteSpan CachedImage::getPixels() const
+{
+  return mView;
+}
+
+/* Function:    isMapped
+   Description: Checks if the pixels are read from a disk cache file rather than decoded in this process
+   Parameters:  None
+   Returns:     bool - True for a mapped disk cache file
+ */
+bool CachedImage::isMapped() const
+{
+  return mpMapping != nullptr;
+}
+
+/* Function:    ImageCache
+   Description: Constructs an empty cache
+   Parameters:  size_t - Most pixel bytes the in process part holds, mapped images count as well
+                std::string - Directory of the disk cache, which has to exist. Empty for no disk cache.
+   Returns:     None
+ */
+ImageCache::ImageCache(const size_t cBudget, const std::string &crDiskDir) : mDiskDir(crDiskDir),
+                                                                             mFormat(PIXEL_NATIVE),
+                                                                             mAlpha(ALPHA_STRAIGHT), mBudget(cBudget),
+                                                                             mUsed(0), mStats()
+{
+  if (!mDiskDir.empty() && mDiskDir.back() != '/' && mDiskDir.back() != '\\')
+  {
+    mDiskDir += '/';
+  }
+}
+
+/* Function:    setOutputFormat
+   Description: Selects the pixel layout later lookups hand out. Images of other layouts stay cached under their own
+                keys.
+   Parameters:  PixelFormat - Layout of the output pixels
+                AlphaMode - Whether color is premultiplied by alpha
+   Returns:     None
+ */
+void ImageCache::setOutputFormat(const PixelFormat cFormat, const AlphaMode cAlpha)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  mFormat = cFormat;
+  mAlpha = cAlpha;
+}
+
+/* Function:    get
+   Description: Gets a png file decoded, keyed by its path, size and modification time to the nanosecond. An
+                unchanged file found in the disk cache is neither opened nor decoded.
+   Parameters:  std::string - Filepath for png file to read from
+                std::string* - Receives the error if there is one, may be nullptr
+   Returns:     ImageRef - Decoded image, nullptr if the file can not be read or decoded
+ */
+ImageCache::ImageRef ImageCache::get(const std::string &crPngPath, std::string *pError)
+{
+  uint64_t version[CACHE_VERSION_WORDS] = {0};
+  PixelFormat format = PIXEL_NATIVE;
+  AlphaMode alpha = ALPHA_STRAIGHT;
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    format = mFormat;
+    alpha = mAlpha;
+  }
+
+  if (!getFileVersion(crPngPath, version))
+  {
+    setError(pError, "Could not find " + crPngPath);
+    return nullptr;
+  }
+
+  const uint64_t cPathHash = hashBytes(reinterpret_cast<const uint8_t *>(crPngPath.data()), crPngPath.size(),
+                                       getKeySeed(CACHE_KEY_PATH, format, alpha));
+  const uint64_t cKey = hashBytes(reinterpret_cast<const uint8_t *>(version), sizeof(version), cPathHash);
+  ImageRef image = find(cKey);
+
+  if (image != nullptr)
+  {
+    return image;
+  }
+
+  image = readDiskImage(cKey, format, alpha);
+
+  if (image == nullptr)
+  {
+    const MappedFile cFile(crPngPath);
+
+    if (!cFile.good())
+    {
+      setError(pError, "Could not map " + crPngPath);
+      return nullptr;
+    }
+
+    image = load(cKey, cFile.getBytes(), format, alpha, pError);
+  }
+
+  if (image != nullptr)
+  {
+    insert(cKey, image);
+  }
+
+  return image;
+}
+
+/* Function:    get
+   Description: Gets a png in memory decoded, keyed by a hash of its bytes so the same asset from anywhere hits
+   Parameters:  ByteSpan - Whole png file
+                std::string* - Receives the error if there is one, may be nullptr
+   Returns:     ImageRef - Decoded image, nullptr if the png can not be decoded
+ */
+ImageCache::ImageRef ImageCache::get(const ByteSpan &crPngBytes, std::string *pError)
+{
+  PixelFormat format = PIXEL_NATIVE;
+  AlphaMode alpha = ALPHA_STRAIGHT;
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    format = mFormat;
+    alpha = mAlpha;
+  }
+
+  const uint64_t cKey = hashBytes(crPngBytes.data, crPngBytes.size, getKeySeed(CACHE_KEY_CONTENT, format, alpha));
+  ImageRef image = find(cKey);
+
+  if (image != nullptr)
+  {
+    return image;
+  }
+
+  image = readDiskImage(cKey, format, alpha);
+
+  if (image == nullptr)
+  {
+    image = load(cKey, crPngBytes, format, alpha, pError);
+  }
+
+  if (image != nullptr)
+  {
+    insert(cKey, image);
+  }
+
+  return image;
+}
+
+/* Function:    find
+   Description: Looks an image up in the in process part and makes it the most recently used one
+   Parameters:  uint64_t - Key
+   Returns:     ImageRef - Cached image, nullptr if it is not cached
+ */
+ImageCache::ImageRef ImageCache::find(const uint64_t cKey)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  const auto cEntry = mIndex.find(cKey);
+
+  if (cEntry == mIndex.end())
+  {
+    return nullptr;
+  }
+
+  mEntries.splice(mEntries.begin(), mEntries, cEntry->second);
+  mStats.hits++;
+
+  return cEntry->second->image;
+}
+
+/* Function:    load
+   Description: Decodes a png and writes it to the disk cache if there is one
+   Parameters:  uint64_t - Key
+                ByteSpan - Whole png file
+                PixelFormat - Layout of the output pixels
+                AlphaMode - Whether color is premultiplied by alpha
+                std::string* - Receives the error if there is one, may be nullptr
+   Returns:     ImageRef - Decoded image, nullptr if the png can not be decoded
+ */
+ImageCache::ImageRef ImageCache::load(const uint64_t cKey, const ByteSpan &crPngBytes, const PixelFormat cFormat,
+                                      const AlphaMode cAlpha, std::string *pError)
+{
+  ImageRef image;
+
+  try
+  {
+    Png png(crPngBytes, Png::DECODE_HEADER);
+
+    png.setOutputFormat(cFormat, cAlpha);
+    png.decode();
+    image = std::make_shared<const CachedImage>(png.getIhdr(), cFormat, cAlpha, png.getRowBytes(),
+                                                png.takeImgData());
+  }
+  catch (const std::exception &crError)
+  {
+    setError(pError, crError.what());
+    return nullptr;
+  }
+
+  if (!mDiskDir.empty())
+  {
+    writeDiskImage(cKey, *image);
+  }
+
+  return image;
+}
+
+/* Function:    insert
+   Description: Adds an image to the in process part as the most recently used one, evicting the least recently
+                used images past the budget. An image larger than the whole budget is handed out but never held.
+   Parameters:  uint64_t - Key
+                ImageRef - Image that was read from disk or decoded
+   Returns:     None
+ */
+void ImageCache::insert(const uint64_t cKey, const ImageRef &crImage)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  const size_t cBytes = crImage->getPixels().size;
+
+  if (crImage->isMapped())
+  {
+    mStats.diskHits++;
+  }
+  else
+  {
+    mStats.misses++;
+  }
+
+  // Another thread loaded the same image meanwhile, the one already cached stays
+  if (mIndex.find(cKey) != mIndex.end() || cBytes > mBudget)
+  {
+    return;
+  }
+
+  evict(mBudget - cBytes);
+  mEntries.push_front({cKey, crImage});
+  mIndex[cKey] = mEntries.begin();
+  mUsed += cBytes;
+}
+
+/* Function:    evict
+   Description: Drops least recently used images until the rest fits a budget, the lock has to be held. Images
+                still referenced elsewhere stay alive until the last reference goes.
+   Parameters:  size_t - Bytes the remaining images may use
+   Returns:     None
+ */
+void ImageCache::evict(const size_t cBudget)
+{
+  while (mUsed > cBudget && !mEntries.empty())
+  {
+    const Entry &crOldest = mEntries.back();
+
+    mUsed -= crOldest.image->getPixels().size;
+    mIndex.erase(crOldest.key);
+    mEntries.pop_back();
+    mStats.evictions++;
+  }
+}
+
+/* Function:    getDiskPath
+   Description: Gets the disk cache file of a key
+   Parameters:  uint64_t - Key
+   Returns:     std::string - Filepath
+ */
+std::string ImageCache::getDiskPath(const uint64_t cKey) const
+{
+  char name[32];
+
+  snprintf(name, sizeof(name), "%016llx.raw", static_cast<unsigned long long>(cKey));
+
+  return mDiskDir + name;
+}
+
+/* Function:    readDiskImage
+   Description: Maps the disk cache file of a key. A file that is missing, of another version or byte order, for
+                another key or format, or whose size does not add up is ignored and decoded again.
+   Parameters:  uint64_t - Key
+                PixelFormat - Layout of the output pixels
+                AlphaMode - Whether color is premultiplied by alpha
+   Returns:     ImageRef - Mapped image, nullptr if there is no usable file
+ */
+ImageCache::ImageRef ImageCache::readDiskImage(const uint64_t cKey, const PixelFormat cFormat, const AlphaMode cAlpha)
+{
+  if (mDiskDir.empty())
+  {
+    return nullptr;
+  }
+
+  std::unique_ptr<MappedFile> pMapping(new MappedFile(getDiskPath(cKey)));
+  CacheFileHeader header;
+
+  if (!pMapping->good() || pMapping->getBytes().size < sizeof(header))
+  {
+    return nullptr;
+  }
+
+  memcpy(&header, pMapping->getBytes().data, sizeof(header));
+
+  const uint64_t cPixelBytes = pMapping->getBytes().size - sizeof(header);
+
+  if (memcmp(header.magic, cCacheMagic, sizeof(cCacheMagic)) != 0 || header.version != CACHE_FILE_VERSION ||
+      header.byteOrder != CACHE_BYTE_ORDER || header.key != cKey || header.format != cFormat ||
+      header.alpha != cAlpha || header.pixelBytes != cPixelBytes || header.height == 0 ||
+      header.pixelBytes % header.height != 0 || header.pixelBytes / header.height != header.rowBytes)
+  {
+    return nullptr;
+  }
+
+  struct Png::IHDR ihdr = {};
+
+  ihdr.width = header.width;
+  ihdr.height = header.height;
+  ihdr.bitDepth = header.bitDepth;
+  ihdr.colorType = header.colorType;
+  ihdr.interfaceMethod = header.interlace;
+
+  return std::make_shared<const CachedImage>(ihdr, cFormat, cAlpha, static_cast<size_t>(header.rowBytes),
+                                             std::move(pMapping));
+}
+
+/* Function:    writeDiskImage
+   Description: Writes a decoded image to the disk cache. The file is written under a temporary name and renamed
+                into place, so another process never maps half a file. Failing to write only loses the caching.
+   Parameters:  uint64_t - Key
+                CachedImage - Decoded image
+   Returns:     None
+ */
+void ImageCache::writeDiskImage(const uint64_t cKey, const CachedImage &crImage)
+{
+  const std::string cPath = getDiskPath(cKey);
+  const ByteSpan cPixels = crImage.getPixels();
+  const struct Png::IHDR &crIhdr = crImage.getIhdr();
+  CacheFileHeader header = {};
+  std::random_device device;
+  char suffix[32];
+
+  if (crIhdr.height == 0 || cPixels.size == 0)
+  {
+    return;
+  }
+
+  memcpy(header.magic, cCacheMagic, sizeof(cCacheMagic));
+  header.version = CACHE_FILE_VERSION;
+  header.byteOrder = CACHE_BYTE_ORDER;
+  header.key = cKey;
+  header.rowBytes = crImage.getRowBytes();
+  header.pixelBytes = cPixels.size;
+  header.width = crIhdr.width;
+  header.height = crIhdr.height;
+  header.bitDepth = crIhdr.bitDepth;
+  header.colorType = crIhdr.colorType;
+  header.interlace = crIhdr.interfaceMethod;
+  header.format = static_cast<uint8_t>(crImage.getFormat());
+  header.alpha = static_cast<uint8_t>(crImage.getAlphaMode());
+
+  snprintf(suffix, sizeof(suffix), ".%08x.tmp", static_cast<unsigned int>(device()));
+
+  const std::string cTempPath = cPath + suffix;
+  std::ofstream file(cTempPath, std::ios::binary | std::ios::trunc);
+
+  if (!file)
+  {
+    return;
+  }
+
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(cPixels.data), static_cast<std::streamsize>(cPixels.size));
+  file.close();
+
+  if (!file || std::rename(cTempPath.c_str(), cPath.c_str()) != 0)
+  {
+    std::remove(cTempPath.c_str());
+  }
+}
+
+/* Function:    setBudget
+   Description: Changes the byte budget, evicting right away if the cached images no longer fit
+   Parameters:  size_t - Most pixel bytes the in process part holds
+   Returns:     None
+ */
+void ImageCache::setBudget(const size_t cBudget)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  mBudget = cBudget;
+  evict(mBudget);
+}
+
+/* Function:    getBudget
+   Description: Getter function for the byte budget
+   Parameters:  None
+   Returns:     size_t - Most pixel bytes the in process part holds
+ */
+size_t ImageCache::getBudget() const
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  return mBudget;
+}
+
+/* Function:    getUsedBytes
+   Description: Getter function for the pixel bytes of every image the in process part holds
+   Parameters:  None
+   Returns:     size_t - Bytes in use
+ */
+size_t ImageCache::getUsedBytes() const
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  return mUsed;
+}
+
+/* Function:    getStats
+   Description: Getter function for the lookup counts, misses count every decode
+   Parameters:  None
+   Returns:     CacheStats - Hits, disk hits, misses and evictions so far
+ */
+CacheStats ImageCache::getStats() const
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  return mStats;
+}
+
+/* Function:    clear
+   Description: Drops every image from the in process part, the disk cache is left alone
+   Parameters:  None
+   Returns:     None
+ */
+void ImageCache::clear()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  mEntries.clear();
+  mIndex.clear();
+  mUsed = 0;
+}
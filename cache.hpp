@@ -0,0 +1,109 @@
+#ifndef CACHE_HPP
+#define CACHE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <list>
+#include <mutex>
+#include <memory>
+#include <unordered_map>
+
+#include "common.hpp"
+#include "png.hpp"
+#include "source.hpp"
+
+// Bytes in front of the pixels of a disk cache file, a multiple of 64 so mapped pixels start cache line aligned
+#define CACHE_HEADER_BYTES 64
+
+// Bumped whenever the layout of a disk cache file changes, files of another version are decoded again
+#define CACHE_FILE_VERSION 1
+
+struct CacheStats {
+  uint64_t hits;
+  uint64_t diskHits;
+  uint64_t misses;
+  uint64_t evictions;
+};
+
+/* Decoded image handed out by the cache, read only. The pixels either live in memory or in a mapped disk cache file
+   and stay valid for as long as a reference is held, even once the cache has evicted the image.
+ */
+class CachedImage {
+public:
+  CachedImage(const struct Png::IHDR &crIhdr, const PixelFormat cFormat, const AlphaMode cAlpha,
+              const size_t cRowBytes, std::vector<uint8_t> &&rPixels);
+  CachedImage(const struct Png::IHDR &crIhdr, const PixelFormat cFormat, const AlphaMode cAlpha,
+              const size_t cRowBytes, std::unique_ptr<MappedFile> &&rpMapping);
+  CachedImage(const CachedImage &) = delete;
+  CachedImage &operator=(const CachedImage &) = delete;
+  const struct Png::IHDR &getIhdr() const;
+  PixelFormat getFormat() const;
+  AlphaMode getAlphaMode() const;
+  size_t getRowBytes() const;
+  ByteSpan getPixels() const;
+  bool isMapped() const;
+
+private:
+  struct Png::IHDR mIhdr;
+  PixelFormat mFormat;
+  AlphaMode mAlpha;
+  size_t mRowBytes;
+  std::vector<uint8_t> mPixels;
+  std::unique_ptr<MappedFile> mpMapping;
+  ByteSpan mView;
+};
+
+/* Cache of decoded pngs so unchanged assets are inflated and unfiltered once. Images are keyed by path, size and
+   modification time or by a hash of the file contents, together with the output format. The in process part is an
+   LRU that keeps the images it holds under a byte budget and hands out shared read only references. With a
+   directory set, every decode is also written there as a header followed by the raw pixels, which later runs and
+   other processes map instead of decoding. A lookup locks only around the LRU, decodes and disk reads run unlocked
+   so any number of threads can use one cache.
+ */
+class ImageCache {
+public:
+  typedef std::shared_ptr<const CachedImage> ImageRef;
+
+  explicit ImageCache(const size_t cBudget, const std::string &crDiskDir = std::string());
+  ImageCache(const ImageCache &) = delete;
+  ImageCache &operator=(const ImageCache &) = delete;
+  void setOutputFormat(const PixelFormat cFormat, const AlphaMode cAlpha = ALPHA_STRAIGHT);
+  ImageRef get(const std::string &crPngPath, std::string *pError = nullptr);
+  ImageRef get(const ByteSpan &crPngBytes, std::string *pError = nullptr);
+  void setBudget(const size_t cBudget);
+  size_t getBudget() const;
+  size_t getUsedBytes() const;
+  CacheStats getStats() const;
+  void clear();
+
+private:
+  struct Entry {
+    uint64_t key;
+    ImageRef image;
+  };
+
+  ImageRef find(const uint64_t cKey);
+  ImageRef load(const uint64_t cKey, const ByteSpan &crPngBytes, const PixelFormat cFormat, const AlphaMode cAlpha,
+                std::string *pError);
+  void insert(const uint64_t cKey, const ImageRef &crImage);
+  void evict(const size_t cBudget);
+  std::string getDiskPath(const uint64_t cKey) const;
+  ImageRef readDiskImage(const uint64_t cKey, const PixelFormat cFormat, const AlphaMode cAlpha);
+  void writeDiskImage(const uint64_t cKey, const CachedImage &crImage);
+
+  std::string mDiskDir;
+
+  // Guards everything below. Most recently used image first, mUsed adds up the pixel bytes of every image in mEntries
+  mutable std::mutex mMutex;
+  PixelFormat mFormat;
+  AlphaMode mAlpha;
+  std::list<Entry> mEntries;
+  std::unordered_map<uint64_t, std::list<Entry>::iterator> mIndex;
+  size_t mBudget;
+  size_t mUsed;
+  CacheStats mStats;
+};
+
+#endif
@@ -0,0 +1,787 @@
+#include "color.hpp"
+
+#include <cstring>
+#include <cmath>
+#include <deque>
+#include <utility>
+
+// Chromaticities of sRGB, white first then red, green and blue, in the order of a cHRM chunk
+static const double cSrgbChromaticities[8] = {0.3127, 0.3290, 0.64, 0.33, 0.30, 0.60, 0.15, 0.06};
+
+// White of the ICC profile connection space
+static const double cD50White[3] = {0.9642, 1.0, 0.8249};
+
+// Cone response matrix of the Bradford chromatic adaptation
+static const double cBradford[9] = {
+  0.8951, 0.2664, -0.1614,
+  -0.7502, 1.7135, 0.0367,
+  0.0389, -0.0685, 1.0296
+};
+
+// Largest difference from the identity a gamut matrix may have and still be skipped
+#define COLOR_MATRIX_EPSILON 0.002
+
+/* Function:    readBig32
+   Description: Reads a 4 byte big endian value out of an ICC profile
+   Parameters:  uint8_t* - First byte of the value
+   Returns:     uint32_t - Value
+ */
+static uint32_t readBig32(const uint8_t *cpData)
+{
+  return (static_cast<uint32_t>(cpData[0]) << 24) | (static_cast<uint32_t>(cpData[1]) << 16) |
+         (static_cast<uint32_t>(cpData[2]) << 8) | cpData[3];
+}
+
+/* Function:    readFixed
+   Description: Reads an ICC s15Fixed16Number
+   Parameters:  uint8_t* - First byte of the value
+   Returns:     double - Value
+ */
+static double readFixed(const uint8_t *cpData)
+{
+  return static_cast<int32_t>(readBig32(cpData)) / 65536.0;
+}
+
+/* Function:    multiply3
+   Description: Multiplies two 3x3 row major matrices
+   Parameters:  double* - Left matrix
+                double* - Right matrix
+                double* - Set to the product, may not be either input
+   Returns:     None
+ */
+static void multiply3(const double *cpA, const double *cpB, double *pOut)
+{
+  for (int row = 0; row < 3; row ++)
+  {
+    for (int column = 0; column < 3; column ++)
+    {
+      pOut[(row * 3) + column] = (cpA[row * 3] * cpB[column]) + (cpA[(row * 3) + 1] * cpB[3 + column]) +
+                                 (cpA[(row * 3) + 2] * cpB[6 + column]);
+    }
+  }
+}
+
+/* Function:    invert3
+   Description: Inverts a 3x3 row major matrix
+   Parameters:  double* - Matrix
+                double* - Set to the inverse
+   Returns:     Status - FAIL if the matrix is singular
+ */
+static Status invert3(const double *cpM, double *pOut)
+{
+  const double cDet = (cpM[0] * ((cpM[4] * cpM[8]) - (cpM[5] * cpM[7]))) -
+                      (cpM[1] * ((cpM[3] * cpM[8]) - (cpM[5] * cpM[6]))) +
+                      (cpM[2] * ((cpM[3] * cpM[7]) - (cpM[4] * cpM[6])));
+
+  if (std::fabs(cDet) < 1e-12)
+  {
+    return FAIL;
+  }
+
+  pOut[0] = ((cpM[4] * cpM[8]) - (cpM[5] * cpM[7])) / cDet;
+  pOut[1] = ((cpM[2] * cpM[7]) - (cpM[1] * cpM[8])) / cDet;
+  pOut[2] = ((cpM[1] * cpM[5]) - (cpM[2] * cpM[4])) / cDet;
+  pOut[3] = ((cpM[5] * cpM[6]) - (cpM[3] * cpM[8])) / cDet;
+  pOut[4] = ((cpM[0] * cpM[8]) - (cpM[2] * cpM[6])) / cDet;
+  pOut[5] = ((cpM[2] * cpM[3]) - (cpM[0] * cpM[5])) / cDet;
+  pOut[6] = ((cpM[3] * cpM[7]) - (cpM[4] * cpM[6])) / cDet;
+  pOut[7] = ((cpM[1] * cpM[6]) - (cpM[0] * cpM[7])) / cDet;
+  pOut[8] = ((cpM[0] * cpM[4]) - (cpM[1] * cpM[3])) / cDet;
+
+  return SUCCESS;
+}
+
+/* Function:    chromaticitiesToXyz
+   Description: Builds the matrix from linear RGB to XYZ of a set of primaries, scaled so RGB white has Y of 1
+   Parameters:  double* - White, red, green and blue x and y
+                double* - Set to the matrix
+                double* - Set to the XYZ of white
+   Returns:     Status - FAIL if the chromaticities do not describe a usable color space
+ */
+static Status chromaticitiesToXyz(const double *cpXy, double *pToXyz, double *pWhite)
+{
+  double primaries[9];
+  double inverse[9];
+
+  for (int i = 0; i < 4; i ++)
+  {
+    if (cpXy[(i * 2) + 1] <= 0.0)
+    {
+      return FAIL;
+    }
+  }
+
+  // Columns are the XYZ of each primary with Y of 1
+  for (int i = 0; i < 3; i ++)
+  {
+    const double cX = cpXy[2 + (i * 2)];
+    const double cY = cpXy[3 + (i * 2)];
+
+    primaries[i] = cX / cY;
+    primaries[3 + i] = 1.0;
+    primaries[6 + i] = (1.0 - cX - cY) / cY;
+  }
+
+  pWhite[0] = cpXy[0] / cpXy[1];
+  pWhite[1] = 1.0;
+  pWhite[2] = (1.0 - cpXy[0] - cpXy[1]) / cpXy[1];
+
+  if (invert3(primaries, inverse) != SUCCESS)
+  {
+    return FAIL;
+  }
+
+  for (int i = 0; i < 3; i ++)
+  {
+    const double cScale = (inverse[i * 3] * pWhite[0]) + (inverse[(i * 3) + 1] * pWhite[1]) +
+                          (inverse[(i * 3) + 2] * pWhite[2]);
+
+    for (int row = 0; row < 3; row ++)
+    {
+      pToXyz[(row * 3) + i] = primaries[(row * 3) + i] * cScale;
+    }
+  }
+
+  return SUCCESS;
+}
+
+/* Function:    adaptWhite
+   Description: Builds the Bradford matrix that moves XYZ colors seen under one white to the same colors under another
+   Parameters:  double* - XYZ of the source white
+                double* - XYZ of the destination white
+                double* - Set to the matrix
+   Returns:     None
+ */
+static void adaptWhite(const double *cpFrom, const double *cpTo, double *pOut)
+{
+  double inverse[9];
+  double scale[9] = {0};
+  double step[9];
+
+  invert3(cBradford, inverse);
+
+  for (int i = 0; i < 3; i ++)
+  {
+    const double cFrom = (cBradford[i * 3] * cpFrom[0]) + (cBradford[(i * 3) + 1] * cpFrom[1]) +
+                         (cBradford[(i * 3) + 2] * cpFrom[2]);
+    const double cTo = (cBradford[i * 3] * cpTo[0]) + (cBradford[(i * 3) + 1] * cpTo[1]) +
+                       (cBradford[(i * 3) + 2] * cpTo[2]);
+
+    scale[i * 4] = cTo / cFrom;
+  }
+
+  multiply3(scale, cBradford, step);
+  multiply3(inverse, step, pOut);
+}
+
+/* Function:    evaluateCurve
+   Description: Converts a stored sample to linear light through a transfer curve
+   Parameters:  ColorCurve - Curve
+                double - Sample from 0 to 1
+   Returns:     double - Linear light from 0 to 1
+ */
+static double evaluateCurve(const ColorCurve &crCurve, const double cX)
+{
+  const double *cpP = crCurve.params;
+  double y = cX;
+
+  switch (crCurve.type)
+  {
+    case CURVE_GAMMA:
+      y = std::pow(cX, cpP[0]);
+      break;
+    case CURVE_SRGB:
+      y = (cX <= 0.04045) ? (cX / 12.92) : std::pow((cX + 0.055) / 1.055, 2.4);
+      break;
+    case CURVE_PARAMETRIC:
+      y = (cX >= cpP[4]) ? (std::pow(std::max(0.0, (cpP[1] * cX) + cpP[2]), cpP[0]) + cpP[5]) :
+          ((cpP[3] * cX) + cpP[6]);
+      break;
+    case CURVE_TABLE:
+    {
+      const double cPosition = cX * (crCurve.table.size() - 1);
+      const size_t cIndex = std::min(static_cast<size_t>(cPosition), crCurve.table.size() - 2);
+      const double cFraction = cPosition - cIndex;
+
+      y = ((crCurve.table[cIndex] * (1.0 - cFraction)) + (crCurve.table[cIndex + 1] * cFraction)) / 65535.0;
+      break;
+    }
+    default:
+      break;
+  }
+
+  return std::min(1.0, std::max(0.0, y));
+}
+
+/* Function:    encodeTarget
+   Description: Converts linear light to a sample of the target space
+   Parameters:  ColorTarget - Target space
+                double - Linear light from 0 to 1
+   Returns:     double - Sample from 0 to 1
+ */
+static double encodeTarget(const ColorTarget cTarget, const double cLinear)
+{
+  if (cTarget == COLOR_LINEAR)
+  {
+    return cLinear;
+  }
+
+  return (cLinear <= 0.0031308) ? (cLinear * 12.92) : ((1.055 * std::pow(cLinear, 1.0 / 2.4)) - 0.055);
+}
+
+/* Function:    readCurveTag
+   Description: Reads a curv or para tag of an ICC profile
+   Parameters:  uint8_t* - Tag data
+                size_t - Bytes of tag data
+                ColorCurve - Set to the curve
+   Returns:     Status - FAIL if the tag is of another type or cut short
+ */
+static Status readCurveTag(const uint8_t *cpTag, const size_t cSize, ColorCurve &rCurve)
+{
+  static const uint8_t cParamCounts[5] = {1, 3, 4, 5, 7};
+
+  if (cSize < 12)
+  {
+    return FAIL;
+  }
+
+  if (memcmp(cpTag, "curv", 4) == 0)
+  {
+    const uint32_t cCount = readBig32(cpTag + 8);
+
+    if (cCount > COLOR_CURVE_MAX || (12 + (static_cast<size_t>(cCount) * 2)) > cSize)
+    {
+      return FAIL;
+    }
+
+    if (cCount == 0)
+    {
+      rCurve.type = CURVE_LINEAR;
+    }
+    else if (cCount == 1)
+    {
+      rCurve.type = CURVE_GAMMA;
+      rCurve.params[0] = ((cpTag[12] << 8) | cpTag[13]) / 256.0;
+    }
+    else
+    {
+      rCurve.type = CURVE_TABLE;
+      rCurve.table.resize(cCount);
+
+      for (uint32_t i = 0; i < cCount; i ++)
+      {
+        rCurve.table[i] = static_cast<uint16_t>((cpTag[12 + (i * 2)] << 8) | cpTag[13 + (i * 2)]);
+      }
+    }
+
+    return SUCCESS;
+  }
+
+  if (memcmp(cpTag, "para", 4) == 0)
+  {
+    const uint16_t cFunction = static_cast<uint16_t>((cpTag[8] << 8) | cpTag[9]);
+    double p[7] = {0};
+
+    if (cFunction > 4 || (12 + (static_cast<size_t>(cParamCounts[cFunction]) * 4)) > cSize)
+    {
+      return FAIL;
+    }
+
+    for (uint8_t i = 0; i < cParamCounts[cFunction]; i ++)
+    {
+      p[i] = readFixed(cpTag + 12 + (i * 4));
+    }
+
+    // Every function type is the general one with some of its parameters fixed
+    rCurve.type = CURVE_PARAMETRIC;
+    rCurve.params[0] = p[0];
+    rCurve.params[1] = (cFunction == 0) ? 1.0 : p[1];
+    rCurve.params[2] = p[2];
+    rCurve.params[3] = (cFunction >= 3) ? p[3] : 0.0;
+    rCurve.params[4] = (cFunction >= 3) ? p[4] : ((cFunction == 0 || p[1] == 0.0) ? 0.0 : (-p[2] / p[1]));
+    rCurve.params[5] = (cFunction == 2) ? p[3] : ((cFunction == 4) ? p[5] : 0.0);
+    rCurve.params[6] = (cFunction == 2) ? p[3] : ((cFunction == 4) ? p[6] : 0.0);
+
+    return SUCCESS;
+  }
+
+  return FAIL;
+}
+
+/* Function:    ColorTransform
+   Description: Builds the conversion of an image's color chunks to a target space. An iCCP profile is used when it
+                is a matrix/TRC one, otherwise sRGB wins over gAMA and cHRM as the PNG spec asks, and an image without
+                any color chunk is taken to be sRGB.
+   Parameters:  ColorSource - Color chunks of the image
+                ColorTarget - Space to convert to
+   Returns:     None
+ */
+ColorTransform::ColorTransform(const ColorSource &crSource, const ColorTarget cTarget) : mTarget(cTarget),
+         mCurves(), mSharedCurve(true), mUseMatrix(false), mMatrix(), mIdentity(false), mTable8(), mLinear8()
+{
+  bool fromIcc = false;
+
+  if (!crSource.iccProfile.empty())
+  {
+    fromIcc = (parseIcc(crSource.iccProfile) == SUCCESS);
+  }
+
+  if (!fromIcc)
+  {
+    mUseMatrix = false;
+    mSharedCurve = true;
+    mCurves[0].type = CURVE_SRGB;
+
+    if (!crSource.srgb && crSource.gamma != 0)
+    {
+      mCurves[0].type = CURVE_GAMMA;
+      mCurves[0].params[0] = 100000.0 / crSource.gamma;
+    }
+
+    mCurves[1] = mCurves[0];
+    mCurves[2] = mCurves[0];
+
+    if (!crSource.srgb && crSource.hasChromaticities)
+    {
+      double xy[8];
+      double toXyz[9];
+      double white[3];
+
+      for (int i = 0; i < 8; i ++)
+      {
+        xy[i] = crSource.chromaticities[i] / 100000.0;
+      }
+
+      if (chromaticitiesToXyz(xy, toXyz, white) == SUCCESS)
+      {
+        setMatrix(toXyz, white);
+      }
+    }
+  }
+
+  build8();
+}
+
+/* Function:    parseIcc
+   Description: Reads the curves and primaries of a matrix/TRC ICC profile, gray profiles only have a curve
+   Parameters:  std::vector<uint8_t> - Inflated profile
+   Returns:     Status - FAIL for profiles that need a lookup table or are cut short, the caller then falls back
+ */
+Status ColorTransform::parseIcc(const std::vector<uint8_t> &crProfile)
+{
+  const uint8_t *cpProfile = crProfile.data();
+  const size_t cSize = crProfile.size();
+  const char *cpCurveTags[3] = {"rTRC", "gTRC", "bTRC"};
+  const char *cpMatrixTags[3] = {"rXYZ", "gXYZ", "bXYZ"};
+  double toXyz[9];
+  uint32_t tagCount = 0;
+
+  if (cSize < 132)
+  {
+    return FAIL;
+  }
+
+  tagCount = readBig32(cpProfile + 128);
+
+  if ((132 + (static_cast<uint64_t>(tagCount) * 12)) > cSize)
+  {
+    return FAIL;
+  }
+
+  // Finds a tag in the tag table and checks its data is inside the profile
+  auto findTag = [&](const char *cpSignature, const uint8_t *&rpTag, size_t &rTagSize) -> bool
+  {
+    for (uint32_t i = 0; i < tagCount; i ++)
+    {
+      const uint8_t *cpEntry = cpProfile + 132 + (i * 12);
+      const uint32_t cOffset = readBig32(cpEntry + 4);
+      const uint32_t cTagSize = readBig32(cpEntry + 8);
+
+      if (memcmp(cpEntry, cpSignature, 4) == 0 && cOffset <= cSize && cTagSize <= (cSize - cOffset))
+      {
+        rpTag = cpProfile + cOffset;
+        rTagSize = cTagSize;
+        return true;
+      }
+    }
+
+    return false;
+  };
+
+  const uint8_t *cpTag = nullptr;
+  size_t tagSize = 0;
+
+  if (memcmp(cpProfile + 16, "GRAY", 4) == 0)
+  {
+    if (!findTag("kTRC", cpTag, tagSize) || readCurveTag(cpTag, tagSize, mCurves[0]) != SUCCESS)
+    {
+      return FAIL;
+    }
+
+    mCurves[1] = mCurves[0];
+    mCurves[2] = mCurves[0];
+    mSharedCurve = true;
+    mUseMatrix = false;
+
+    return SUCCESS;
+  }
+
+  if (memcmp(cpProfile + 16, "RGB ", 4) != 0)
+  {
+    return FAIL;
+  }
+
+  for (int i = 0; i < 3; i ++)
+  {
+    if (!findTag(cpCurveTags[i], cpTag, tagSize) || readCurveTag(cpTag, tagSize, mCurves[i]) != SUCCESS)
+    {
+      return FAIL;
+    }
+
+    if (!findTag(cpMatrixTags[i], cpTag, tagSize) || tagSize < 20 || memcmp(cpTag, "XYZ ", 4) != 0)
+    {
+      return FAIL;
+    }
+
+    for (int row = 0; row < 3; row ++)
+    {
+      toXyz[(row * 3) + i] = readFixed(cpTag + 8 + (row * 4));
+    }
+  }
+
+  mSharedCurve = true;
+
+  for (int i = 1; i < 3; i ++)
+  {
+    mSharedCurve = mSharedCurve && mCurves[i].type == mCurves[0].type && mCurves[i].table == mCurves[0].table &&
+                   memcmp(mCurves[i].params, mCurves[0].params, sizeof(mCurves[0].params)) == 0;
+  }
+
+  setMatrix(toXyz, cD50White);
+
+  return SUCCESS;
+}
+
+/* Function:    setMatrix
+   Description: Works out the matrix from the linear RGB of the source to linear sRGB, adapting the source white to
+                the D65 white of sRGB. A matrix this close to the identity is left out.
+   Parameters:  double* - Source linear RGB to XYZ
+                double* - XYZ of the white the source matrix is relative to
+   Returns:     None
+ */
+void ColorTransform::setMatrix(const double *cpToXyz, const double *cpWhite)
+{
+  double srgbToXyz[9];
+  double xyzToSrgb[9];
+  double srgbWhite[3];
+  double adapt[9];
+  double step[9];
+  double matrix[9];
+
+  mUseMatrix = false;
+
+  if (chromaticitiesToXyz(cSrgbChromaticities, srgbToXyz, srgbWhite) != SUCCESS ||
+      invert3(srgbToXyz, xyzToSrgb) != SUCCESS)
+  {
+    return;
+  }
+
+  adaptWhite(cpWhite, srgbWhite, adapt);
+  multiply3(adapt, cpToXyz, step);
+  multiply3(xyzToSrgb, step, matrix);
+
+  for (int i = 0; i < 9; i ++)
+  {
+    mMatrix[i] = static_cast<float>(matrix[i]);
+    mUseMatrix = mUseMatrix || std::fabs(matrix[i] - (((i % 4) == 0) ? 1.0 : 0.0)) > COLOR_MATRIX_EPSILON;
+  }
+}
+
+/* Function:    build8
+   Description: Fills the tables for 8 bit samples, a direct lookup per channel and the linear light tables the
+                matrix path starts from
+   Parameters:  None
+   Returns:     None
+ */
+void ColorTransform::build8()
+{
+  const int cChannels = mSharedCurve ? 1 : 3;
+
+  mIdentity = !mUseMatrix;
+
+  for (int channel = 0; channel < cChannels; channel ++)
+  {
+    for (int value = 0; value < 256; value ++)
+    {
+      const double cLinear = evaluateCurve(mCurves[channel], value / 255.0);
+
+      mLinear8[channel][value] = static_cast<float>(cLinear);
+      mTable8[channel][value] = static_cast<uint8_t>(std::lround(encodeTarget(mTarget, cLinear) * 255.0));
+      mIdentity = mIdentity && (mTable8[channel][value] == value);
+    }
+  }
+
+  if (mUseMatrix)
+  {
+    mOut8.resize(COLOR_LINEAR_STEPS);
+
+    for (uint32_t i = 0; i < COLOR_LINEAR_STEPS; i ++)
+    {
+      mOut8[i] = static_cast<uint8_t>(std::lround(encodeTarget(mTarget, i / (COLOR_LINEAR_STEPS - 1.0)) * 255.0));
+    }
+  }
+}
+
+/* Function:    build16
+   Description: Fills the tables for 16 bit samples, called once by the first 16 bit image through the transform
+   Parameters:  None
+   Returns:     None
+ */
+void ColorTransform::build16() const
+{
+  const int cChannels = mSharedCurve ? 1 : 3;
+
+  for (int channel = 0; channel < cChannels; channel ++)
+  {
+    if (mUseMatrix)
+    {
+      mLinear16[channel].resize(65536);
+    }
+    else
+    {
+      mTable16[channel].resize(65536);
+    }
+
+    for (uint32_t value = 0; value < 65536; value ++)
+    {
+      const double cLinear = evaluateCurve(mCurves[channel], value / 65535.0);
+
+      if (mUseMatrix)
+      {
+        mLinear16[channel][value] = static_cast<float>(cLinear);
+      }
+      else
+      {
+        mTable16[channel][value] = static_cast<uint16_t>(std::lround(encodeTarget(mTarget, cLinear) * 65535.0));
+      }
+    }
+  }
+
+  if (mUseMatrix)
+  {
+    mOut16.resize(COLOR_LINEAR_STEPS);
+
+    for (uint32_t i = 0; i < COLOR_LINEAR_STEPS; i ++)
+    {
+      mOut16[i] = static_cast<uint16_t>(std::lround(encodeTarget(mTarget, i / (COLOR_LINEAR_STEPS - 1.0)) *
+                                                    65535.0));
+    }
+  }
+}
+
+/* Function:    isIdentity
+   Description: Checks if the transform leaves every sample as it is, such as sRGB images decoded for an sRGB target
+   Parameters:  None
+   Returns:     bool - True if the transform does nothing
+ */
+bool ColorTransform::isIdentity() const
+{
+  return mIdentity;
+}
+
+/* Function:    quantizeLinear
+   Description: Clamps linear light and turns it into an index of the output tables
+   Parameters:  float - Linear light
+   Returns:     uint32_t - Index from 0 to COLOR_LINEAR_STEPS - 1
+ */
+static inline uint32_t quantizeLinear(const float cLinear)
+{
+  const float cClamped = std::min(1.0f, std::max(0.0f, cLinear));
+
+  return static_cast<uint32_t>((cClamped * (COLOR_LINEAR_STEPS - 1)) + 0.5f);
+}
+
+/* Function:    premultiply
+   Description: Scales one 8 bit sample by alpha / 255 rounded to nearest, the same rounding the decode uses
+   Parameters:  uint8_t - Straight sample
+                uint8_t - Alpha
+   Returns:     uint8_t - Premultiplied sample
+ */
+static inline uint8_t premultiply(const uint8_t cColor, const uint8_t cAlpha)
+{
+  const uint32_t cProduct = (static_cast<uint32_t>(cColor) * cAlpha) + 128;
+
+  return static_cast<uint8_t>((cProduct + (cProduct >> 8)) >> 8);
+}
+
+/* Function:    apply8
+   Description: Converts pixels with 8 bit samples in place. A premultiplied layout takes straight pixels and
+                premultiplies them once they are converted.
+   Parameters:  uint8_t* - Pixels
+                uint32_t - Amount of pixels
+                ColorLayout - Layout of the pixels
+   Returns:     None
+ */
+void ColorTransform::apply8(uint8_t *pPixels, const uint32_t cCount, const ColorLayout &crLayout) const
+{
+  const bool cMatrix = mUseMatrix && crLayout.colorChannels == 3;
+  const int cRed = crLayout.bgr ? 2 : 0;
+  const int cBlue = crLayout.bgr ? 0 : 2;
+
+  for (uint32_t i = 0; i < cCount; i ++)
+  {
+    uint8_t *pPixel = pPixels + (static_cast<size_t>(i) * crLayout.pixelBytes);
+    const uint8_t cAlpha = (crLayout.alpha >= 0) ? pPixel[crLayout.alpha] : 0xFF;
+    const bool cScaled = crLayout.premultiplied && cAlpha != 0xFF;
+
+    if (cMatrix)
+    {
+      const float cR = mLinear8[0][pPixel[cRed]];
+      const float cG = mLinear8[mSharedCurve ? 0 : 1][pPixel[1]];
+      const float cB = mLinear8[mSharedCurve ? 0 : 2][pPixel[cBlue]];
+
+      pPixel[cRed] = mOut8[quantizeLinear((mMatrix[0] * cR) + (mMatrix[1] * cG) + (mMatrix[2] * cB))];
+      pPixel[1] = mOut8[quantizeLinear((mMatrix[3] * cR) + (mMatrix[4] * cG) + (mMatrix[5] * cB))];
+      pPixel[cBlue] = mOut8[quantizeLinear((mMatrix[6] * cR) + (mMatrix[7] * cG) + (mMatrix[8] * cB))];
+    }
+    else
+    {
+      for (uint8_t c = 0; c < crLayout.colorChannels; c ++)
+      {
+        const int cChannel = mSharedCurve ? 0 : ((crLayout.bgr && c != 1) ? (2 - c) : c);
+
+        pPixel[c] = mTable8[cChannel][pPixel[c]];
+      }
+    }
+
+    if (cScaled)
+    {
+      for (uint8_t c = 0; c < crLayout.colorChannels; c ++)
+      {
+        pPixel[c] = premultiply(pPixel[c], cAlpha);
+      }
+    }
+  }
+}
+
+/* Function:    apply16
+   Description: Converts pixels with host order 16 bit samples in place
+   Parameters:  uint8_t* - Pixels
+                uint32_t - Amount of pixels
+                ColorLayout - Layout of the pixels
+   Returns:     None
+ */
+void ColorTransform::apply16(uint8_t *pPixels, const uint32_t cCount, const ColorLayout &crLayout) const
+{
+  const bool cMatrix = mUseMatrix && crLayout.colorChannels == 3;
+
+  std::call_once(mBuilt16, [this]()
+  {
+    build16();
+  });
+
+  for (uint32_t i = 0; i < cCount; i ++)
+  {
+    uint8_t *pPixel = pPixels + (static_cast<size_t>(i) * crLayout.pixelBytes);
+    uint16_t samples[3];
+
+    memcpy(samples, pPixel, sizeof(uint16_t) * crLayout.colorChannels);
+
+    if (cMatrix)
+    {
+      const float cR = mLinear16[0][samples[0]];
+      const float cG = mLinear16[mSharedCurve ? 0 : 1][samples[1]];
+      const float cB = mLinear16[mSharedCurve ? 0 : 2][samples[2]];
+
+      samples[0] = mOut16[quantizeLinear((mMatrix[0] * cR) + (mMatrix[1] * cG) + (mMatrix[2] * cB))];
+      samples[1] = mOut16[quantizeLinear((mMatrix[3] * cR) + (mMatrix[4] * cG) + (mMatrix[5] * cB))];
+      samples[2] = mOut16[quantizeLinear((mMatrix[6] * cR) + (mMatrix[7] * cG) + (mMatrix[8] * cB))];
+    }
+    else if (mUseMatrix)
+    {
+      // Gray samples have no gamut, only the curves of the matrix path apply
+      samples[0] = mOut16[quantizeLinear(mLinear16[0][samples[0]])];
+    }
+    else
+    {
+      for (uint8_t c = 0; c < crLayout.colorChannels; c ++)
+      {
+        samples[c] = mTable16[mSharedCurve ? 0 : c][samples[c]];
+      }
+    }
+
+    memcpy(pPixel, samples, sizeof(uint16_t) * crLayout.colorChannels);
+  }
+}
+
+/* Function:    apply
+   Description: Converts decoded pixels in place, called on every row right after it is expanded while it is still
+                in cache
+   Parameters:  uint8_t* - Pixels
+                uint32_t - Amount of pixels
+                ColorLayout - Layout of the pixels
+   Returns:     None
+ */
+void ColorTransform::apply(uint8_t *pPixels, const uint32_t cCount, const ColorLayout &crLayout) const
+{
+  if (crLayout.sampleBytes == 2)
+  {
+    apply16(pPixels, cCount, crLayout);
+  }
+  else
+  {
+    apply8(pPixels, cCount, crLayout);
+  }
+}
+
+/* Function:    getColorTransform
+   Description: Gets the transform for an image's color chunks from the process wide cache, building it on a miss.
+                Two threads that miss on the same profile at once may both build it, only one is kept.
+   Parameters:  std::string - Raw bytes of the color chunks, images with the same bytes share one transform
+                ColorTarget - Space to convert to
+                std::function - Fills in the color chunks, only called on a miss
+   Returns:     ColorRef - Shared transform
+ */
+ColorRef getColorTransform(const std::string &crKey, const ColorTarget cTarget,
+                           const std::function<void(ColorSource &rSource)> &crLoad)
+{
+  static std::mutex sMutex;
+  static std::deque<std::pair<std::string, ColorRef>> sCache;
+  const std::string cKey = crKey + static_cast<char>(cTarget);
+
+  {
+    std::lock_guard<std::mutex> lock(sMutex);
+
+    for (const std::pair<std::string, ColorRef> &crEntry : sCache)
+    {
+      if (crEntry.first == cKey)
+      {
+        return crEntry.second;
+      }
+    }
+  }
+
+  ColorSource source = {false, 0, false, {0}, {}};
+
+  crLoad(source);
+
+  ColorRef transform = std::make_shared<const ColorTransform>(source, cTarget);
+  std::lock_guard<std::mutex> lock(sMutex);
+
+  for (const std::pair<std::string, ColorRef> &crEntry : sCache)
+  {
+    if (crEntry.first == cKey)
+    {
+      return crEntry.second;
+    }
+  }
+
+  if (sCache.size() == COLOR_CACHE_ENTRIES)
+  {
+    sCache.pop_front();
+  }
+
+  sCache.emplace_back(cKey, transform);
+
+  return transform;
+}
@@ -0,0 +1,116 @@
+#ifndef COLOR_HPP
+#define COLOR_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <functional>
+
+#include "common.hpp"
+
+// Color transforms kept for reuse, the oldest is dropped once another profile needs room
+#define COLOR_CACHE_ENTRIES 32
+
+// Linear light is quantized to this many steps between the matrix and the output curve
+#define COLOR_LINEAR_STEPS 65536
+
+// Largest table an ICC curv tag may hold
+#define COLOR_CURVE_MAX 65536
+
+/* Space decoded pixels are converted to. COLOR_AS_STORED leaves samples as the file has them, COLOR_SRGB and
+   COLOR_LINEAR convert to sRGB primaries and white, with the sRGB curve or linear light.
+ */
+enum ColorTarget {
+  COLOR_AS_STORED,
+  COLOR_SRGB,
+  COLOR_LINEAR
+};
+
+// Color chunks of an image, gamma and chromaticities times 100000 as stored and the inflated iCCP profile
+struct ColorSource {
+  bool srgb;
+  uint32_t gamma;
+  bool hasChromaticities;
+  uint32_t chromaticities[8];
+  std::vector<uint8_t> iccProfile;
+};
+
+/* Where samples sit in a decoded pixel, pixels are converted in place in whatever format the decode writes. Color
+   samples come first, alpha is the index of the alpha sample or -1 without one. A premultiplied layout is handed
+   straight pixels and premultiplies them after the conversion, so the curves never see rounded down samples.
+ */
+struct ColorLayout {
+  uint8_t pixelBytes;
+  uint8_t sampleBytes;
+  uint8_t colorChannels;
+  bool bgr;
+  bool premultiplied;
+  int8_t alpha;
+};
+
+enum CurveType {
+  CURVE_LINEAR,
+  CURVE_GAMMA,
+  CURVE_SRGB,
+  CURVE_PARAMETRIC,
+  CURVE_TABLE
+};
+
+/* Transfer curve of one channel, from stored sample to linear light. Gamma curves keep the exponent in params[0],
+   parametric ones all seven ICC parameters g, a, b, c, d, e and f of Y = (aX + b)^g + e above d and cX + f below.
+ */
+struct ColorCurve {
+  CurveType type;
+  double params[7];
+  std::vector<uint16_t> table;
+};
+
+/* Conversion of one source profile to one target, built once and shared read only by every decode of an image with
+   the same color chunks. Without a gamut change every channel is a direct lookup of the stored sample, 256 entries
+   for 8 bit samples and 65536 for 16 bit ones. A gamut change from cHRM or a matrix/TRC iCCP profile goes through
+   linear light, a curve table per channel, a 3x3 matrix and an output table indexed by quantized linear light. The
+   16 bit tables are only built the first time a 16 bit image needs them.
+ */
+class ColorTransform {
+public:
+  ColorTransform(const ColorSource &crSource, const ColorTarget cTarget);
+  ColorTransform(const ColorTransform &) = delete;
+  ColorTransform &operator=(const ColorTransform &) = delete;
+  bool isIdentity() const;
+  void apply(uint8_t *pPixels, const uint32_t cCount, const ColorLayout &crLayout) const;
+
+private:
+  Status parseIcc(const std::vector<uint8_t> &crProfile);
+  void setMatrix(const double *cpToXyz, const double *cpWhite);
+  void build8();
+  void build16() const;
+  void apply8(uint8_t *pPixels, const uint32_t cCount, const ColorLayout &crLayout) const;
+  void apply16(uint8_t *pPixels, const uint32_t cCount, const ColorLayout &crLayout) const;
+
+  ColorTarget mTarget;
+  ColorCurve mCurves[3];
+  bool mSharedCurve;
+  bool mUseMatrix;
+  float mMatrix[9];
+  bool mIdentity;
+
+  // Direct tables per channel, or curve tables to linear light when the matrix is used
+  uint8_t mTable8[3][256];
+  float mLinear8[3][256];
+  std::vector<uint8_t> mOut8;
+
+  mutable std::once_flag mBuilt16;
+  mutable std::vector<uint16_t> mTable16[3];
+  mutable std::vector<float> mLinear16[3];
+  mutable std::vector<uint16_t> mOut16;
+};
+
+typedef std::shared_ptr<const ColorTransform> ColorRef;
+
+ColorRef getColorTransform(const std::string &crKey, const ColorTarget cTarget,
+                           const std::function<void(ColorSource &rSource)> &crLoad);
+
+#endif
@@ -2,12 +2,37 @@
 #define COMMON_HPP
 
 #include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
 
 enum Status {
     FAIL,
     SUCCESS
 };
 
+// Non owning view of bytes that live somewhere else, such as a pak archive entry or a network buffer
+struct ByteSpan {
+  const uint8_t *data;
+  size_t size;
+};
+
+// Allocation hook for pooled memory, a null allocate means the default heap
+struct PngAllocator {
+  void *(*allocate)(void *pOpaque, const size_t cSize);
+  void (*release)(void *pOpaque, void *pData);
+  void *pOpaque;
+};
+
+// Thrown for png data that can not be decoded, so one bad file does not take the whole process down
+class PngException : public std::runtime_error {
+public:
+  explicit PngException(const std::string &crWhat) : std::runtime_error(crWhat) {}
+};
+
 template <typename T>
 static bool decimalCmp(T a, T b)
 {
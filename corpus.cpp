@@ -0,0 +1,787 @@
+#include "corpus.hpp"
+#include "filter.hpp"
+#include "expand.hpp"
+#include "crc.hpp"
+
+#include <cstring>
+#include <zlib.h>
+
+static const uint8_t cSignature[] = {0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A};
+
+// First column, first row, column step and row step of every Adam7 pass
+static const uint8_t cAdam7Passes[ADAM7_PASSES][4] = {
+  {0, 0, 8, 8}, {4, 0, 8, 8}, {0, 4, 4, 8}, {2, 0, 4, 4}, {0, 2, 2, 4}, {1, 0, 2, 2}, {0, 1, 1, 2}
+};
+
+static const uint8_t cWholeImage[4] = {0, 0, 1, 1};
+
+struct CorpusFormat {
+  uint8_t colorType;
+  uint8_t bitDepth;
+  const char *name;
+};
+
+static const CorpusFormat cFormats[] = {
+  {Png::GRAYSCALE, 1, "gray1"}, {Png::GRAYSCALE, 2, "gray2"}, {Png::GRAYSCALE, 4, "gray4"},
+  {Png::GRAYSCALE, 8, "gray8"}, {Png::GRAYSCALE, 16, "gray16"}, {Png::RGBTRIP, 8, "rgb8"},
+  {Png::RGBTRIP, 16, "rgb16"}, {Png::PLTE, 1, "plte1"}, {Png::PLTE, 2, "plte2"}, {Png::PLTE, 4, "plte4"},
+  {Png::PLTE, 8, "plte8"}, {Png::GRAYSCALEA, 8, "graya8"}, {Png::GRAYSCALEA, 16, "graya16"},
+  {Png::RGBTRIPA, 8, "rgba8"}, {Png::RGBTRIPA, 16, "rgba16"}
+};
+
+#define CORPUS_FORMATS (sizeof(cFormats) / sizeof(cFormats[0]))
+
+static const char *cFilterNames[FILTER_TYPES] = {"none", "sub", "up", "average", "paeth"};
+
+// Furthest back a repeat of the inflate corpus copies from, the whole deflate window
+#define INFLATE_HISTORY_BYTES 32768
+
+// Bytes the inflate corpus deflates
+enum InflatePayload {
+  PAYLOAD_NOISE,
+  PAYLOAD_RUNS,
+  PAYLOAD_SMOOTH,
+  PAYLOAD_REPEATS,
+  INFLATE_PAYLOADS
+};
+
+static const char *cPayloadNames[INFLATE_PAYLOADS] = {"noise", "runs", "smooth", "repeats"};
+
+// Level, strategy and window bits of every inflate corpus stream, level 0 gives stored blocks and Z_FIXED fixed ones
+struct InflateSetting {
+  const char *name;
+  int level;
+  int strategy;
+  int windowBits;
+};
+
+static const InflateSetting cInflateSettings[] = {
+  {"l0",          0, Z_DEFAULT_STRATEGY, 15},
+  {"l1",          1, Z_DEFAULT_STRATEGY, 15},
+  {"l6",          6, Z_DEFAULT_STRATEGY, 15},
+  {"l9",          9, Z_DEFAULT_STRATEGY, 15},
+  {"l6-filtered", 6, Z_FILTERED,         15},
+  {"l6-huffman",  6, Z_HUFFMAN_ONLY,     15},
+  {"l6-rle",      6, Z_RLE,              15},
+  {"l6-fixed",    6, Z_FIXED,            15},
+  {"l9-w9",       9, Z_DEFAULT_STRATEGY, 9},
+  {"l9-w12",      9, Z_DEFAULT_STRATEGY, 12}
+};
+
+/* Function:    nextRandom
+   Description: Steps a xorshift64* generator, small and the same on every platform
+   Parameters:  uint64_t - Generator state, never 0
+   Returns:     uint64_t - Next random value
+ */
+static inline uint64_t nextRandom(uint64_t &rState)
+{
+  rState ^= rState >> 12;
+  rState ^= rState << 25;
+  rState ^= rState >> 27;
+
+  return rState * 0x2545F4914F6CDD1Dull;
+}
+
+/* Function:    putBigEndian
+   Description: Appends a 32 bit value in network byte order
+   Parameters:  std::vector<uint8_t> - Buffer to append to
+                uint32_t - Value
+   Returns:     None
+ */
+static inline void putBigEndian(std::vector<uint8_t> &rOut, const uint32_t cValue)
+{
+  rOut.push_back(static_cast<uint8_t>(cValue >> 24));
+  rOut.push_back(static_cast<uint8_t>(cValue >> 16));
+  rOut.push_back(static_cast<uint8_t>(cValue >> 8));
+  rOut.push_back(static_cast<uint8_t>(cValue));
+}
+
+/* Function:    writeChunk
+   Description: Appends a chunk with its length, type, data and CRC
+   Parameters:  std::vector<uint8_t> - Png being built
+                char* - Four letter chunk type
+                uint8_t* - Chunk data
+                size_t - Bytes of chunk data
+   Returns:     None
+ */
+static void writeChunk(std::vector<uint8_t> &rPng, const char *cpType, const uint8_t *cpData, const size_t cSize)
+{
+  putBigEndian(rPng, static_cast<uint32_t>(cSize));
+
+  const size_t cTypeStart = rPng.size();
+
+  rPng.insert(rPng.end(), cpType, cpType + 4);
+  rPng.insert(rPng.end(), cpData, cpData + cSize);
+  putBigEndian(rPng, crc32Update(0, rPng.data() + cTypeStart, cSize + 4));
+}
+
+/* Function:    generateSamples
+   Description: Fills the image with a gradient per channel plus low amplitude noise. Samples are scaled to the bit
+                depth, so low bit depths get flat areas and 16 bit depths get a noisy low byte like real scans.
+   Parameters:  CorpusImage - Image whose IHDR gives the size and format
+                uint8_t - Samples per pixel
+                uint64_t - Generator state
+   Returns:     std::vector<uint16_t> - Samples, row by row
+ */
+static std::vector<uint16_t> generateSamples(const CorpusImage &crImage, const uint8_t cChannels, uint64_t &rState)
+{
+  const uint32_t cWidth = crImage.ihdr.width;
+  const uint32_t cHeight = crImage.ihdr.height;
+  const uint8_t cShift = 16 - crImage.ihdr.bitDepth;
+  std::vector<uint16_t> samples(static_cast<size_t>(cWidth) * cHeight * cChannels);
+  uint32_t stepX[4];
+  uint32_t stepY[4];
+
+  for (uint8_t c = 0; c < cChannels; c ++)
+  {
+    stepX[c] = 16 + static_cast<uint32_t>(nextRandom(rState) % 256);
+    stepY[c] = 16 + static_cast<uint32_t>(nextRandom(rState) % 256);
+  }
+
+  size_t i = 0;
+
+  for (uint32_t y = 0; y < cHeight; y ++)
+  {
+    for (uint32_t x = 0; x < cWidth; x ++)
+    {
+      const uint64_t cNoise = nextRandom(rState);
+
+      for (uint8_t c = 0; c < cChannels; c ++)
+      {
+        const uint32_t cLevel = (x * stepX[c]) + (y * stepY[c]) + static_cast<uint32_t>((cNoise >> (c * 10)) & 0x3FF);
+
+        samples[i ++] = static_cast<uint16_t>((cLevel & 0xFFFF) >> cShift);
+      }
+    }
+  }
+
+  return samples;
+}
+
+/* Function:    packRow
+   Description: Packs the samples of one row of a pass into png scanline bytes, sub byte samples go most
+                significant bits first and 16 bit samples big endian
+   Parameters:  CorpusImage - Image being encoded
+                std::vector<uint16_t> - Samples of the whole image
+                uint8_t - Samples per pixel
+                uint8_t* - Pass origin and steps
+                uint32_t - Row within the pass
+                uint32_t - Columns in the pass
+                uint8_t* - Receives the packed row
+   Returns:     None
+ */
+static void packRow(const CorpusImage &crImage, const std::vector<uint16_t> &crSamples, const uint8_t cChannels,
+                    const uint8_t *cpPass, const uint32_t cRow, const uint32_t cColumns, uint8_t *pRow)
+{
+  const uint8_t cBitDepth = crImage.ihdr.bitDepth;
+  const size_t cY = cpPass[1] + (static_cast<size_t>(cRow) * cpPass[3]);
+
+  for (uint32_t i = 0; i < cColumns; i ++)
+  {
+    const size_t cX = cpPass[0] + (static_cast<size_t>(i) * cpPass[2]);
+    const uint16_t *cpPixel = crSamples.data() + (((cY * crImage.ihdr.width) + cX) * cChannels);
+
+    for (uint8_t c = 0; c < cChannels; c ++)
+    {
+      const size_t cSample = (static_cast<size_t>(i) * cChannels) + c;
+
+      if (cBitDepth == 16)
+      {
+        pRow[cSample * 2] = static_cast<uint8_t>(cpPixel[c] >> 8);
+        pRow[(cSample * 2) + 1] = static_cast<uint8_t>(cpPixel[c]);
+      }
+      else if (cBitDepth == 8)
+      {
+        pRow[cSample] = static_cast<uint8_t>(cpPixel[c]);
+      }
+      else
+      {
+        const size_t cBit = cSample * cBitDepth;
+
+        pRow[cBit / 8] |= static_cast<uint8_t>(cpPixel[c] << (8 - cBitDepth - (cBit % 8)));
+      }
+    }
+  }
+}
+
+/* Function:    getBandRow
+   Description: Gets the first row of an iDOT band, bands split the rows of the image as evenly as they can
+   Parameters:  CorpusImage - Image split into bands
+                uint32_t - Band, the band count gives the row after the last band
+   Returns:     uint32_t - First row of the band
+ */
+static uint32_t getBandRow(const CorpusImage &crImage, const uint32_t cBand)
+{
+  return static_cast<uint32_t>((static_cast<uint64_t>(cBand) * crImage.ihdr.height) / crImage.bands);
+}
+
+/* Function:    deflateBands
+   Description: Deflates the scanlines of an image as one zlib stream with a full flush at every band edge, so every
+                band after the first is raw deflate data that inflates without the bands above it
+   Parameters:  CorpusImage - Image split into bands, receives the stream in idat
+                std::vector<uint8_t> - Filtered scanlines of the image
+                std::vector<size_t> - Receives where every band ends in the stream
+   Returns:     Status - FAIL if zlib fails
+ */
+static Status deflateBands(CorpusImage &rImage, const std::vector<uint8_t> &crFiltered,
+                           std::vector<size_t> &rBandEnds)
+{
+  const size_t cStride = crFiltered.size() / rImage.ihdr.height;
+  z_stream stream = {};
+  Status status = SUCCESS;
+
+  if (deflateInit(&stream, 6) != Z_OK)
+  {
+    return FAIL;
+  }
+
+  // Every flush adds an empty stored block on top of what the bound allows for
+  rImage.idat.resize(deflateBound(&stream, static_cast<uLong>(crFiltered.size())) + (rImage.bands * 16));
+  stream.next_out = rImage.idat.data();
+  stream.avail_out = static_cast<uInt>(rImage.idat.size());
+
+  for (uint32_t b = 0; b < rImage.bands && status == SUCCESS; b ++)
+  {
+    const bool cLast = (b + 1) == rImage.bands;
+    const size_t cStart = getBandRow(rImage, b) * cStride;
+
+    stream.next_in = const_cast<Bytef *>(crFiltered.data() + cStart);
+    stream.avail_in = static_cast<uInt>((getBandRow(rImage, b + 1) * cStride) - cStart);
+
+    if (deflate(&stream, cLast ? Z_FINISH : Z_FULL_FLUSH) != (cLast ? Z_STREAM_END : Z_OK) || stream.avail_in != 0)
+    {
+      status = FAIL;
+    }
+
+    rBandEnds.push_back(stream.total_out);
+  }
+
+  deflateEnd(&stream);
+  rImage.idat.resize(rBandEnds.back());
+
+  return status;
+}
+
+/* Function:    writeIdot
+   Description: Appends the iDOT chunk of an image split into bands, the IDAT chunks of the bands have to follow it
+                right away. The offset of a band counts from the start of the iDOT chunk to its first IDAT chunk.
+   Parameters:  CorpusImage - Image split into bands
+                std::vector<size_t> - Where every band ends in the stream
+                std::vector<uint8_t> - Png being built
+   Returns:     None
+ */
+static void writeIdot(const CorpusImage &crImage, const std::vector<size_t> &crBandEnds, std::vector<uint8_t> &rPng)
+{
+  std::vector<uint8_t> idot;
+  size_t offset = 12 + IDOT_HEADER_SIZE + (static_cast<size_t>(crImage.bands) * IDOT_BAND_SIZE);
+  size_t start = 0;
+
+  putBigEndian(idot, crImage.bands);
+
+  for (uint32_t b = 0; b < crImage.bands; b ++)
+  {
+    const size_t cSize = crBandEnds[b] - start;
+    const size_t cChunks = (cSize + crImage.chunkBytes - 1) / crImage.chunkBytes;
+
+    putBigEndian(idot, getBandRow(crImage, b));
+    putBigEndian(idot, getBandRow(crImage, b + 1) - getBandRow(crImage, b));
+    putBigEndian(idot, static_cast<uint32_t>(offset));
+    offset += cSize + (cChunks * 12);
+    start = crBandEnds[b];
+  }
+
+  writeChunk(rPng, "iDOT", idot.data(), idot.size());
+}
+
+/* Function:    encodeCorpusImage
+   Description: Generates the pixels of an image and encodes them. The filter of the image is used for every row, so
+                a fixed filter gives a stream where every scanline takes that unfilter path. Palette images get a
+                random palette with a partly transparent tRNS. An image with bands gets an iDOT chunk and a stream
+                flushed at every band edge.
+   Parameters:  CorpusImage - Image to encode, name, group, IHDR, filter, bands and chunk size have to be set
+                uint32_t - Seed for the pixels
+   Returns:     Status - FAIL for an invalid color type, bit depth, filter or band count
+ */
+Status encodeCorpusImage(CorpusImage &rImage, const uint32_t cSeed)
+{
+  const struct Png::IHDR &crIhdr = rImage.ihdr;
+  const uint8_t cChannels = getSampleChannels(crIhdr.colorType);
+  const size_t cSampleBits = static_cast<size_t>(cChannels) * crIhdr.bitDepth;
+  const uint8_t cBpp = static_cast<uint8_t>(std::max<size_t>(1, cSampleBits / 8));
+  uint64_t state = 0x9E3779B97F4A7C15ull ^ cSeed;
+  std::vector<uint8_t> filtered;
+
+  if (cChannels == 0 || crIhdr.width == 0 || crIhdr.height == 0 || rImage.chunkBytes == 0 ||
+      (rImage.filter >= FILTER_TYPES && rImage.filter != CORPUS_ADAPTIVE))
+  {
+    return FAIL;
+  }
+
+  const std::vector<uint16_t> cSamples = generateSamples(rImage, cChannels, state);
+  const uint8_t cPasses = (crIhdr.interfaceMethod == 1) ? ADAM7_PASSES : 1;
+
+  rImage.passes.clear();
+
+  for (uint8_t p = 0; p < cPasses; p ++)
+  {
+    const uint8_t *cpPass = (cPasses == 1) ? cWholeImage : cAdam7Passes[p];
+    const uint32_t cColumns = (crIhdr.width > cpPass[0]) ? ((crIhdr.width - cpPass[0] + cpPass[2] - 1) / cpPass[2]) : 0;
+    const uint32_t cRows = (crIhdr.height > cpPass[1]) ? ((crIhdr.height - cpPass[1] + cpPass[3] - 1) / cpPass[3]) : 0;
+
+    if (cColumns == 0 || cRows == 0)
+    {
+      continue;
+    }
+
+    const size_t cRowBytes = ((cColumns * cSampleBits) + 7) / 8;
+    std::vector<uint8_t> row(cRowBytes);
+    std::vector<uint8_t> prev(cRowBytes, 0);
+    std::vector<uint8_t> scratch(cRowBytes);
+
+    rImage.passes.push_back({cRowBytes, cRows});
+
+    for (uint32_t r = 0; r < cRows; r ++)
+    {
+      const size_t cStart = filtered.size();
+
+      std::fill(row.begin(), row.end(), 0);
+      packRow(rImage, cSamples, cChannels, cpPass, r, cColumns, row.data());
+      filtered.resize(cStart + cRowBytes + 1);
+
+      if (rImage.filter == CORPUS_ADAPTIVE)
+      {
+        filtered[cStart] = filterRowAdaptive(&filtered[cStart + 1], scratch.data(), row.data(), prev.data(),
+                                             cRowBytes, cBpp);
+      }
+      else
+      {
+        filtered[cStart] = rImage.filter;
+        filterRow(rImage.filter, &filtered[cStart + 1], row.data(), prev.data(), cRowBytes, cBpp);
+      }
+
+      row.swap(prev);
+    }
+  }
+
+  std::vector<size_t> bandEnds;
+
+  rImage.filteredSize = filtered.size();
+
+  if (rImage.bands > 0)
+  {
+    if (cPasses != 1 || rImage.bands < 2 || rImage.bands > std::min<uint32_t>(IDOT_MAX_BANDS, crIhdr.height) ||
+        deflateBands(rImage, filtered, bandEnds) == FAIL)
+    {
+      return FAIL;
+    }
+  }
+  else
+  {
+    uLongf deflatedSize = compressBound(static_cast<uLong>(filtered.size()));
+
+    rImage.idat.resize(deflatedSize);
+
+    if (compress2(rImage.idat.data(), &deflatedSize, filtered.data(), static_cast<uLong>(filtered.size()), 6) != Z_OK)
+    {
+      return FAIL;
+    }
+
+    rImage.idat.resize(deflatedSize);
+    bandEnds.push_back(rImage.idat.size());
+  }
+
+  uint8_t header[13];
+  std::vector<uint8_t> &rPng = rImage.png;
+
+  rPng.assign(cSignature, cSignature + sizeof(cSignature));
+  header[0] = static_cast<uint8_t>(crIhdr.width >> 24);
+  header[1] = static_cast<uint8_t>(crIhdr.width >> 16);
+  header[2] = static_cast<uint8_t>(crIhdr.width >> 8);
+  header[3] = static_cast<uint8_t>(crIhdr.width);
+  header[4] = static_cast<uint8_t>(crIhdr.height >> 24);
+  header[5] = static_cast<uint8_t>(crIhdr.height >> 16);
+  header[6] = static_cast<uint8_t>(crIhdr.height >> 8);
+  header[7] = static_cast<uint8_t>(crIhdr.height);
+  header[8] = crIhdr.bitDepth;
+  header[9] = crIhdr.colorType;
+  header[10] = 0;
+  header[11] = 0;
+  header[12] = crIhdr.interfaceMethod;
+  writeChunk(rPng, "IHDR", header, sizeof(header));
+
+  if (crIhdr.colorType == Png::PLTE)
+  {
+    const size_t cEntries = static_cast<size_t>(1) << crIhdr.bitDepth;
+    std::vector<uint8_t> palette(cEntries * 3);
+    std::vector<uint8_t> alpha(cEntries / 2 + 1);
+
+    for (uint8_t &rByte : palette)
+    {
+      rByte = static_cast<uint8_t>(nextRandom(state));
+    }
+
+    for (uint8_t &rByte : alpha)
+    {
+      rByte = static_cast<uint8_t>(nextRandom(state));
+    }
+
+    writeChunk(rPng, "PLTE", palette.data(), palette.size());
+    writeChunk(rPng, "tRNS", alpha.data(), alpha.size());
+  }
+
+  if (rImage.bands > 0)
+  {
+    writeIdot(rImage, bandEnds, rPng);
+  }
+
+  // Every band starts an IDAT chunk of its own, the way iDOT needs it
+  for (size_t b = 0; b < bandEnds.size(); b ++)
+  {
+    for (size_t i = (b == 0) ? 0 : bandEnds[b - 1]; i < bandEnds[b]; i += rImage.chunkBytes)
+    {
+      writeChunk(rPng, "IDAT", rImage.idat.data() + i, std::min<size_t>(rImage.chunkBytes, bandEnds[b] - i));
+    }
+  }
+
+  writeChunk(rPng, "IEND", nullptr, 0);
+
+  return SUCCESS;
+}
+
+/* Function:    damageCorpusAdler
+   Description: Copies the png of an image with the adler32 that ends its zlib stream flipped. The CRC of the last
+                IDAT chunk is computed over the damaged data and the chunk layout is kept, so only the inflate
+                backend can notice.
+   Parameters:  CorpusImage - Encoded image
+                std::vector<uint8_t> - Receives the damaged png
+   Returns:     Status - FAIL if the png has no IDAT chunk
+ */
+Status damageCorpusAdler(const CorpusImage &crImage, std::vector<uint8_t> &rPng)
+{
+  size_t offset = sizeof(cSignature);
+  size_t lastIdat = 0;
+  uint32_t length = 0;
+
+  rPng = crImage.png;
+
+  while (offset + 12 <= rPng.size())
+  {
+    const uint32_t cLength = (static_cast<uint32_t>(rPng[offset]) << 24) | (rPng[offset + 1] << 16) |
+                             (rPng[offset + 2] << 8) | rPng[offset + 3];
+
+    if (memcmp(&rPng[offset + 4], "IDAT", 4) == 0 && cLength > 0)
+    {
+      lastIdat = offset;
+      length = cLength;
+    }
+
+    offset += 12 + static_cast<size_t>(cLength);
+  }
+
+  if (lastIdat == 0)
+  {
+    return FAIL;
+  }
+
+  uint8_t *pCrc = &rPng[lastIdat + 8 + length];
+
+  pCrc[-1] ^= 0x01;
+
+  const uint32_t cCrc = crc32Update(0, &rPng[lastIdat + 4], static_cast<size_t>(length) + 4);
+
+  pCrc[0] = static_cast<uint8_t>(cCrc >> 24);
+  pCrc[1] = static_cast<uint8_t>(cCrc >> 16);
+  pCrc[2] = static_cast<uint8_t>(cCrc >> 8);
+  pCrc[3] = static_cast<uint8_t>(cCrc);
+
+  return SUCCESS;
+}
+
+/* Function:    addImage
+   Description: Names, generates and appends one image to the corpus
+   Parameters:  std::vector<CorpusImage> - Corpus being built
+                char* - Group the image is reported under
+                size_t - Index into cFormats
+                uint32_t - Width
+                uint32_t - Height
+                bool - True for Adam7 interlacing
+                uint8_t - Filter type for every row, or CORPUS_ADAPTIVE
+                uint32_t - Corpus seed
+                uint32_t - iDOT bands, 0 for one plain stream
+                size_t - Most bytes of an IDAT chunk
+   Returns:     None
+ */
+static void addImage(std::vector<CorpusImage> &rCorpus, const char *cpGroup, const size_t cFormat,
+                     const uint32_t cWidth, const uint32_t cHeight, const bool cInterlaced, const uint8_t cFilter,
+                     const uint32_t cSeed, const uint32_t cBands = 0, const size_t cChunkBytes = CORPUS_IDAT_BYTES)
+{
+  CorpusImage image;
+
+  image.group = cpGroup;
+  image.ihdr = {cWidth, cHeight, cFormats[cFormat].bitDepth, cFormats[cFormat].colorType, 0, 0,
+                static_cast<uint8_t>(cInterlaced ? 1 : 0)};
+  image.filter = cFilter;
+  image.bands = cBands;
+  image.chunkBytes = cChunkBytes;
+  image.name = image.group + "-" + cFormats[cFormat].name + "-" +
+               ((cFilter == CORPUS_ADAPTIVE) ? "adaptive" : cFilterNames[cFilter]) +
+               (cInterlaced ? "-adam7-" : "-") + std::to_string(cWidth) + "x" + std::to_string(cHeight);
+
+  if (cBands > 0)
+  {
+    image.name += "-" + std::to_string(cBands) + "bands-" + std::to_string(cChunkBytes);
+  }
+
+  // Every image gets its own pixels, but the same corpus seed always gives the same corpus
+  if (encodeCorpusImage(image, (cSeed * 0x01000193u) + static_cast<uint32_t>(rCorpus.size())) == SUCCESS)
+  {
+    rCorpus.push_back(std::move(image));
+  }
+}
+
+/* Function:    findFormat
+   Description: Looks up a format by name
+   Parameters:  char* - Format name such as rgba8
+   Returns:     size_t - Index into cFormats
+ */
+static size_t findFormat(const char *cpName)
+{
+  size_t i = 0;
+
+  while (i < CORPUS_FORMATS - 1 && strcmp(cFormats[i].name, cpName) != 0)
+  {
+    i ++;
+  }
+
+  return i;
+}
+
+/* Function:    generateCorpus
+   Description: Generates the benchmark corpus. Groups are matrix (every format, plain and interlaced), filters (one
+                filter type for every row, paeth being the worst case for unfilter), icons, odd sizes, large and idot
+                (split into bands that decode on their own).
+   Parameters:  uint32_t - Seed, the same seed always gives the same corpus
+                CorpusScale - CORPUS_QUICK for small images that generate and run in seconds
+   Returns:     std::vector<CorpusImage> - Generated images
+ */
+std::vector<CorpusImage> generateCorpus(const uint32_t cSeed, const CorpusScale cScale)
+{
+  const bool cFull = (cScale == CORPUS_FULL);
+  const uint32_t cMatrixSize = cFull ? 256 : 64;
+  const uint32_t cFilterSize = cFull ? 1024 : 256;
+  const uint32_t cLargeSize = cFull ? 2048 : 512;
+  const char *cpFilterFormats[] = {"rgba8", "rgb8", "gray8", "plte8"};
+  const char *cpLargeFormats[] = {"rgba8", "rgb8", "plte8", "gray16"};
+  std::vector<CorpusImage> corpus;
+
+  for (size_t f = 0; f < CORPUS_FORMATS; f ++)
+  {
+    addImage(corpus, "matrix", f, cMatrixSize, cMatrixSize, false, CORPUS_ADAPTIVE, cSeed);
+    addImage(corpus, "matrix", f, cMatrixSize, cMatrixSize, true, CORPUS_ADAPTIVE, cSeed);
+  }
+
+  for (const char *cpFormat : cpFilterFormats)
+  {
+    for (uint8_t filter = 0; filter < FILTER_TYPES; filter ++)
+    {
+      addImage(corpus, "filters", findFormat(cpFormat), cFilterSize, cFilterSize, false, filter, cSeed);
+    }
+  }
+
+  addImage(corpus, "filters", findFormat("rgba8"), cFilterSize, cFilterSize, true, Png::PAETH, cSeed);
+
+  addImage(corpus, "icons", findFormat("rgba8"), 32, 32, false, CORPUS_ADAPTIVE, cSeed);
+  addImage(corpus, "icons", findFormat("rgba8"), 32, 32, true, CORPUS_ADAPTIVE, cSeed);
+  addImage(corpus, "icons", findFormat("plte4"), 32, 32, false, CORPUS_ADAPTIVE, cSeed);
+  addImage(corpus, "icons", findFormat("graya8"), 16, 16, false, CORPUS_ADAPTIVE, cSeed);
+
+  addImage(corpus, "odd", findFormat("rgba16"), 1, 1, false, CORPUS_ADAPTIVE, cSeed);
+  addImage(corpus, "odd", findFormat("gray1"), 7, 3, true, CORPUS_ADAPTIVE, cSeed);
+  addImage(corpus, "odd", findFormat("rgb8"), 33, 65, true, Png::PAETH, cSeed);
+  addImage(corpus, "odd", findFormat("plte2"), 257, 1, false, Png::SUB, cSeed);
+
+  for (const char *cpFormat : cpLargeFormats)
+  {
+    addImage(corpus, "large", findFormat(cpFormat), cLargeSize, cLargeSize, false, CORPUS_ADAPTIVE, cSeed);
+  }
+
+  addImage(corpus, "large", findFormat("rgba8"), cLargeSize, cLargeSize, false, Png::PAETH, cSeed);
+
+  // Band edges fall anywhere in a chunk of the stream, tiny chunks give bands that span many of them
+  addImage(corpus, "idot", findFormat("rgba8"), cFilterSize, cFilterSize, false, CORPUS_ADAPTIVE, cSeed, 2,
+           CORPUS_IDAT_BYTES);
+  addImage(corpus, "idot", findFormat("rgb8"), cFilterSize, cFilterSize, false, Png::PAETH, cSeed, 4, 4096);
+  addImage(corpus, "idot", findFormat("gray8"), cFilterSize, cFilterSize, false, Png::UP, cSeed, 8, 1000);
+  addImage(corpus, "idot", findFormat("plte4"), cFilterSize, cFilterSize, false, CORPUS_ADAPTIVE, cSeed, 3, 512);
+  addImage(corpus, "idot", findFormat("rgba16"), cFilterSize, cFilterSize, false, Png::AVERAGE, cSeed,
+           IDOT_MAX_BANDS, 8192);
+  addImage(corpus, "idot", findFormat("gray1"), 33, 65, false, Png::SUB, cSeed, 5, 64);
+
+  return corpus;
+}
+
+/* Function:    generatePayload
+   Description: Generates bytes for the inflate corpus. Noise does not compress, runs give the longest matches at
+                distance one, smooth bytes are close to filtered scanlines and repeats copy from anywhere in the last
+                32 KiB.
+   Parameters:  InflatePayload - Kind of bytes
+                size_t - Bytes to generate
+                uint64_t - Generator state
+   Returns:     std::vector<uint8_t> - Generated bytes
+ */
+static std::vector<uint8_t> generatePayload(const InflatePayload cPayload, const size_t cSize, uint64_t &rState)
+{
+  std::vector<uint8_t> data;
+
+  // Repeats copy from the vector itself, which never reallocates with room for every byte reserved
+  data.reserve(cSize);
+
+  while (data.size() < cSize)
+  {
+    const uint64_t cRandom = nextRandom(rState);
+    const size_t cLeft = cSize - data.size();
+
+    switch (cPayload)
+    {
+      case PAYLOAD_NOISE:
+        data.push_back(static_cast<uint8_t>(cRandom >> 32));
+        break;
+      case PAYLOAD_RUNS:
+        data.insert(data.end(), std::min<size_t>(1 + ((cRandom >> 8) % 600), cLeft),
+                    static_cast<uint8_t>(cRandom >> 32));
+        break;
+      case PAYLOAD_SMOOTH:
+        data.push_back(static_cast<uint8_t>((data.size() / 7) + (((cRandom >> 32) & 7) == 0)));
+        break;
+      default:
+        if (data.size() < 3 || ((cRandom >> 32) & 3) == 0)
+        {
+          data.push_back(static_cast<uint8_t>((cRandom >> 40) & 0x3F));
+        }
+        else
+        {
+          const size_t cDistance = 1 + ((cRandom >> 8) % std::min<size_t>(data.size(), INFLATE_HISTORY_BYTES));
+          const size_t cLength = std::min<size_t>(3 + ((cRandom >> 40) % 256), cLeft);
+
+          for (size_t i = 0; i < cLength; i ++)
+          {
+            data.push_back(data[data.size() - cDistance]);
+          }
+        }
+        break;
+    }
+  }
+
+  return data;
+}
+
+/* Function:    deflatePayload
+   Description: Deflates bytes into one zlib stream
+   Parameters:  std::vector<uint8_t> - Bytes to deflate
+                InflateSetting - Level, strategy and window bits
+                std::vector<uint8_t> - Receives the stream
+   Returns:     Status - FAIL if zlib fails
+ */
+static Status deflatePayload(const std::vector<uint8_t> &crData, const InflateSetting &crSetting,
+                             std::vector<uint8_t> &rStream)
+{
+  z_stream stream = {};
+  int result = Z_OK;
+
+  if (deflateInit2(&stream, crSetting.level, Z_DEFLATED, crSetting.windowBits, 8, crSetting.strategy) != Z_OK)
+  {
+    return FAIL;
+  }
+
+  rStream.resize(deflateBound(&stream, static_cast<uLong>(crData.size())));
+  stream.next_in = const_cast<Bytef *>(crData.data());
+  stream.avail_in = static_cast<uInt>(crData.size());
+  stream.next_out = rStream.data();
+  stream.avail_out = static_cast<uInt>(rStream.size());
+  result = deflate(&stream, Z_FINISH);
+  rStream.resize(stream.total_out);
+  deflateEnd(&stream);
+
+  return (result == Z_STREAM_END) ? SUCCESS : FAIL;
+}
+
+/* Function:    addInflateCases
+   Description: Appends a stream to the inflate corpus along with a copy with one bit flipped anywhere, one cut
+                short anywhere and one with the last byte of its adler32 flipped
+   Parameters:  std::vector<InflateCase> - Inflate corpus being built
+                std::string - Name of the stream
+                std::vector<uint8_t> - Bytes the stream was deflated from
+                std::vector<uint8_t> - Stream
+                uint64_t - Generator state, picks where the damage goes
+   Returns:     None
+ */
+static void addInflateCases(std::vector<InflateCase> &rCorpus, const std::string &crName,
+                            const std::vector<uint8_t> &crData, const std::vector<uint8_t> &crStream,
+                            uint64_t &rState)
+{
+  const char *cpDamageNames[] = {"", "-flip", "-cut", "-adler"};
+
+  for (uint8_t d = INFLATE_DAMAGE_NONE; d <= INFLATE_DAMAGE_ADLER; d ++)
+  {
+    const uint64_t cRandom = nextRandom(rState);
+    InflateCase inflateCase;
+
+    inflateCase.name = crName + cpDamageNames[d];
+    inflateCase.damage = static_cast<InflateDamage>(d);
+    inflateCase.stream = crStream;
+    inflateCase.dataSize = crData.size();
+
+    switch (inflateCase.damage)
+    {
+      case INFLATE_DAMAGE_NONE:
+        inflateCase.data = crData;
+        break;
+      case INFLATE_DAMAGE_FLIP:
+        inflateCase.stream[(cRandom >> 8) % crStream.size()] ^= static_cast<uint8_t>(1u << (cRandom >> 61));
+        break;
+      case INFLATE_DAMAGE_CUT:
+        inflateCase.stream.resize((cRandom >> 8) % crStream.size());
+        break;
+      default:
+        inflateCase.stream.back() ^= 0x01;
+        break;
+    }
+
+    rCorpus.push_back(std::move(inflateCase));
+  }
+}
+
+/* Function:    generateInflateCorpus
+   Description: Generates the zlib streams the inflate backends are compared on, every payload at a small size and
+                one larger than the output window of the fast inflater, through every setting of cInflateSettings
+   Parameters:  uint32_t - Seed, the same seed always gives the same streams
+                CorpusScale - CORPUS_QUICK for a smaller large size
+   Returns:     std::vector<InflateCase> - Generated streams
+ */
+std::vector<InflateCase> generateInflateCorpus(const uint32_t cSeed, const CorpusScale cScale)
+{
+  const size_t cLargeSize = (cScale == CORPUS_FULL) ? (320 * 1024) : (48 * 1024);
+  const size_t cSizes[] = {4096, cLargeSize};
+  uint64_t state = 0x9E3779B97F4A7C15ull ^ (cSeed * 0x01000193ull);
+  std::vector<InflateCase> corpus;
+  std::vector<uint8_t> stream;
+
+  for (uint8_t p = 0; p < INFLATE_PAYLOADS; p ++)
+  {
+    for (const size_t cSize : cSizes)
+    {
+      const std::vector<uint8_t> cData = generatePayload(static_cast<InflatePayload>(p), cSize, state);
+
+      for (const InflateSetting &crSetting : cInflateSettings)
+      {
+        if (deflatePayload(cData, crSetting, stream) == SUCCESS)
+        {
+          addInflateCases(corpus, std::string(cPayloadNames[p]) + "-" + std::to_string(cSize) + "-" +
+                          crSetting.name, cData, stream, state);
+        }
+      }
+    }
+  }
+
+  return corpus;
+}
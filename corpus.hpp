@@ -0,0 +1,75 @@
+#ifndef CORPUS_HPP
+#define CORPUS_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+#include "png.hpp"
+#include "scanline.hpp"
+
+// Filter value that picks the filter of every row with filterRowAdaptive instead of using one filter for all rows
+#define CORPUS_ADAPTIVE 0xFF
+
+#define CORPUS_IDAT_BYTES 65536
+
+enum CorpusScale {
+  CORPUS_QUICK,
+  CORPUS_FULL
+};
+
+struct CorpusImage {
+  std::string name;
+  std::string group;
+  struct Png::IHDR ihdr;
+  uint8_t filter;
+
+  // iDOT bands the stream is split into with a full flush at every band edge, 0 for one plain stream, and the most
+  // bytes of an IDAT chunk
+  uint32_t bands;
+  size_t chunkBytes;
+
+  // Whole png file, and the zlib stream of its IDAT chunks joined together
+  std::vector<uint8_t> png;
+  std::vector<uint8_t> idat;
+
+  // Scanline layout of the inflated stream, one entry per non empty Adam7 pass
+  std::vector<ScanlinePass> passes;
+  size_t filteredSize;
+};
+
+// Damage an inflate corpus stream can carry, the backends have to agree on how each one ends
+enum InflateDamage {
+  INFLATE_DAMAGE_NONE,
+  INFLATE_DAMAGE_FLIP,
+  INFLATE_DAMAGE_CUT,
+  INFLATE_DAMAGE_ADLER
+};
+
+// One zlib stream of the inflate corpus, with the bytes it inflates to only kept for an undamaged stream
+struct InflateCase {
+  std::string name;
+  InflateDamage damage;
+  std::vector<uint8_t> stream;
+  std::vector<uint8_t> data;
+  size_t dataSize;
+};
+
+/* Synthetic benchmark corpus. Every image is generated from the seed alone, so the same seed gives the same bytes on
+   every machine and runs can be compared. Pixels are smooth gradients with a little noise, close to the mix of
+   runs and matches real images give deflate. The corpus covers every color type and bit depth with and without
+   interlacing, every filter type on its own including all Paeth worst cases, tiny icons, large images and images
+   split into iDOT bands.
+ */
+std::vector<CorpusImage> generateCorpus(const uint32_t cSeed, const CorpusScale cScale);
+Status encodeCorpusImage(CorpusImage &rImage, const uint32_t cSeed);
+Status damageCorpusAdler(const CorpusImage &crImage, std::vector<uint8_t> &rPng);
+
+/* Zlib streams the inflate backends are compared on. Payloads of noise, runs, smooth gradients and far repeats are
+   deflated at several levels, strategies and window sizes, which gives stored, fixed and dynamic blocks and every
+   match length and distance, and every stream is also damaged with a flipped bit, cut short and with a wrong adler32.
+ */
+std::vector<InflateCase> generateInflateCorpus(const uint32_t cSeed, const CorpusScale cScale);
+
+#endif
@@ -0,0 +1,214 @@
+#include "crc.hpp"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+  #define CRC_X86 1
+  #include <immintrin.h>
+#endif
+
+// Reflected form of the png/zlib CRC polynomial
+#define CRC_POLY 0xEDB88320u
+
+// Folding needs 64 bytes to start with, shorter inputs are not worth the setup
+#define CRC_FOLD_MIN 64
+
+/* Slice-by-8 tables, mTable[0] is the classic byte at a time table and mTable[k] advances a byte through k more
+   zero bytes, so eight bytes are folded in with eight independent lookups
+ */
+struct CrcTables {
+  uint32_t mTable[8][256];
+
+  CrcTables()
+  {
+    for (uint32_t i = 0; i < 256; i ++)
+    {
+      uint32_t crc = i;
+
+      for (uint32_t bit = 0; bit < 8; bit ++)
+      {
+        crc = (crc & 1) ? ((crc >> 1) ^ CRC_POLY) : (crc >> 1);
+      }
+
+      mTable[0][i] = crc;
+    }
+
+    for (uint32_t i = 0; i < 256; i ++)
+    {
+      for (uint32_t k = 1; k < 8; k ++)
+      {
+        mTable[k][i] = (mTable[k - 1][i] >> 8) ^ mTable[0][mTable[k - 1][i] & 0xFF];
+      }
+    }
+  }
+};
+
+static const CrcTables cCrcTables;
+
+/* Function:    crc32Slice8
+   Description: Table driven CRC over the bit inverted running value
+   Parameters:  uint32_t - Inverted CRC so far
+                uint8_t* - Data
+                size_t - Bytes of data
+   Returns:     uint32_t - Inverted CRC including the data
+ */
+static uint32_t crc32Slice8(uint32_t crc, const uint8_t *cpData, size_t size)
+{
+  const uint32_t (*cpTable)[256] = cCrcTables.mTable;
+
+  while (size >= 8)
+  {
+    uint32_t low = 0;
+    uint32_t high = 0;
+
+    memcpy(&low, cpData, sizeof(low));
+    memcpy(&high, cpData + 4, sizeof(high));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    low = __builtin_bswap32(low);
+    high = __builtin_bswap32(high);
+#endif
+    low ^= crc;
+    crc = cpTable[7][low & 0xFF] ^ cpTable[6][(low >> 8) & 0xFF] ^ cpTable[5][(low >> 16) & 0xFF] ^
+          cpTable[4][low >> 24] ^ cpTable[3][high & 0xFF] ^ cpTable[2][(high >> 8) & 0xFF] ^
+          cpTable[1][(high >> 16) & 0xFF] ^ cpTable[0][high >> 24];
+    cpData += 8;
+    size -= 8;
+  }
+
+  while (size > 0)
+  {
+    crc = (crc >> 8) ^ cpTable[0][(crc ^ *cpData) & 0xFF];
+    cpData ++;
+    size --;
+  }
+
+  return crc;
+}
+
+#ifdef CRC_X86
+/* Function:    crc32Fold
+   Description: CRC by folding 4 x 128 bits at a time with carry-less multiplies and a Barrett reduction at the end,
+                after Intel's "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction"
+   Parameters:  uint32_t - Inverted CRC so far
+                uint8_t* - Data
+                size_t - Bytes of data, at least CRC_FOLD_MIN and a multiple of 16
+   Returns:     uint32_t - Inverted CRC including the data
+ */
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t crc32Fold(const uint32_t cCrc, const uint8_t *cpData, size_t size)
+{
+  // Bit reflected folding constants x^(4*128+32), x^(4*128-32), x^(128+32), x^(128-32), x^64 mod P and Barrett's
+  const __m128i cK1K2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+  const __m128i cK3K4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+  const __m128i cK5 = _mm_set_epi64x(0, 0x0163cd6124);
+  const __m128i cPoly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+  const __m128i cLow32 = _mm_setr_epi32(~0, 0, ~0, 0);
+  __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cpData));
+  __m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cpData + 16));
+  __m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cpData + 32));
+  __m128i x4 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cpData + 48));
+  __m128i x5;
+
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(cCrc)));
+  cpData += 64;
+  size -= 64;
+
+  while (size >= 64)
+  {
+    const __m128i cLo1 = _mm_clmulepi64_si128(x1, cK1K2, 0x00);
+    const __m128i cLo2 = _mm_clmulepi64_si128(x2, cK1K2, 0x00);
+    const __m128i cLo3 = _mm_clmulepi64_si128(x3, cK1K2, 0x00);
+    const __m128i cLo4 = _mm_clmulepi64_si128(x4, cK1K2, 0x00);
+
+    x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, cK1K2, 0x11), cLo1);
+    x2 = _mm_xor_si128(_mm_clmulepi64_si128(x2, cK1K2, 0x11), cLo2);
+    x3 = _mm_xor_si128(_mm_clmulepi64_si128(x3, cK1K2, 0x11), cLo3);
+    x4 = _mm_xor_si128(_mm_clmulepi64_si128(x4, cK1K2, 0x11), cLo4);
+    x1 = _mm_xor_si128(x1, _mm_loadu_si128(reinterpret_cast<const __m128i *>(cpData)));
+    x2 = _mm_xor_si128(x2, _mm_loadu_si128(reinterpret_cast<const __m128i *>(cpData + 16)));
+    x3 = _mm_xor_si128(x3, _mm_loadu_si128(reinterpret_cast<const __m128i *>(cpData + 32)));
+    x4 = _mm_xor_si128(x4, _mm_loadu_si128(reinterpret_cast<const __m128i *>(cpData + 48)));
+    cpData += 64;
+    size -= 64;
+  }
+
+  // Fold the four lanes into one, then whatever 16 byte blocks are left
+  x5 = _mm_clmulepi64_si128(x1, cK3K4, 0x00);
+  x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, cK3K4, 0x11), x2), x5);
+  x5 = _mm_clmulepi64_si128(x1, cK3K4, 0x00);
+  x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, cK3K4, 0x11), x3), x5);
+  x5 = _mm_clmulepi64_si128(x1, cK3K4, 0x00);
+  x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, cK3K4, 0x11), x4), x5);
+
+  while (size >= 16)
+  {
+    x5 = _mm_clmulepi64_si128(x1, cK3K4, 0x00);
+    x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, cK3K4, 0x11),
+                       _mm_loadu_si128(reinterpret_cast<const __m128i *>(cpData)));
+    x1 = _mm_xor_si128(x1, x5);
+    cpData += 16;
+    size -= 16;
+  }
+
+  // 128 bits down to 64, then Barrett reduction down to 32
+  x2 = _mm_clmulepi64_si128(x1, cK3K4, 0x10);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_and_si128(x1, cLow32);
+  x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, cK5, 0x00), x2);
+
+  x2 = _mm_and_si128(x1, cLow32);
+  x2 = _mm_clmulepi64_si128(x2, cPoly, 0x10);
+  x2 = _mm_and_si128(x2, cLow32);
+  x2 = _mm_clmulepi64_si128(x2, cPoly, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  return static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+}
+#endif
+
+/* Function:    crc32Accelerated
+   Description: Checks if the CRC runs on the carry-less multiply path
+   Parameters:  None
+   Returns:     bool - True if PCLMULQDQ and SSE4.1 are available
+ */
+bool crc32Accelerated()
+{
+#ifdef CRC_X86
+  static const bool cSupported = []()
+  {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+  }();
+
+  return cSupported;
+#else
+  return false;
+#endif
+}
+
+/* Function:    crc32Update
+   Description: Continues a CRC-32 over more data
+   Parameters:  uint32_t - CRC so far, 0 to start
+                uint8_t* - Data
+                size_t - Bytes of data
+   Returns:     uint32_t - CRC including the data
+ */
+uint32_t crc32Update(const uint32_t cCrc, const uint8_t *cpData, const size_t cSize)
+{
+  uint32_t crc = ~cCrc;
+  size_t size = cSize;
+
+#ifdef CRC_X86
+  if (size >= CRC_FOLD_MIN && crc32Accelerated())
+  {
+    const size_t cFolded = size & ~static_cast<size_t>(15);
+
+    crc = crc32Fold(crc, cpData, cFolded);
+    cpData += cFolded;
+    size -= cFolded;
+  }
+#endif
+
+  return ~crc32Slice8(crc, cpData, size);
+}
@@ -0,0 +1,13 @@
+#ifndef CRC_HPP
+#define CRC_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+/* CRC-32 as used by png chunks, same convention as zlib's crc32: start with 0 and pass the previous result back in
+   to continue over more data. Uses carry-less multiply folding when the CPU has PCLMULQDQ and slice-by-8 otherwise.
+ */
+uint32_t crc32Update(const uint32_t cCrc, const uint8_t *cpData, const size_t cSize);
+bool crc32Accelerated();
+
+#endif
@@ -0,0 +1,347 @@
+#include "decoder.hpp"
+
+#include <cstdlib>
+
+/* Function:    PngDecoder
+   Description: Constructs a decoder context that allocates from the default heap
+   Parameters:  None
+   Returns:     None
+ */
+PngDecoder::PngDecoder() : PngDecoder(PngAllocator())
+{
+}
+
+/* Function:    PngDecoder
+   Description: Constructs a decoder context whose zlib state and output pixels come from an allocator hook
+   Parameters:  PngAllocator - Hook to allocate from, a null allocate means the default heap. The hook has to outlive
+                               the decoder.
+   Returns:     None
+ */
+PngDecoder::PngDecoder(const PngAllocator &crAllocator) : mAllocator(crAllocator), mInflateEngine(INFLATE_ZLIB),
+                                                          mCrcMode(Png::CRC_VERIFY_ALL), mPixelFormat(PIXEL_NATIVE),
+                                                          mAlphaMode(ALPHA_STRAIGHT), mOrientation(Png::ORIENT_NONE),
+                                                          mCollectStats(false), mpPixels(nullptr), mCapacity(0),
+                                                          mSize(0), mRowBytes(0), mIhdr(), mStats(), mTotalStats()
+{
+  mScanlines.setAllocator(mAllocator);
+}
+
+/* Function:    ~PngDecoder
+   Description: Releases the output pixels, the png object has to go first as it points at the scanline decoder
+   Parameters:  None
+   Returns:     None
+ */
+PngDecoder::~PngDecoder()
+{
+  mpPng.reset();
+
+  if (mpPixels == nullptr)
+  {
+    return;
+  }
+
+  if (mAllocator.allocate != nullptr)
+  {
+    mAllocator.release(mAllocator.pOpaque, mpPixels);
+  }
+  else
+  {
+    free(mpPixels);
+  }
+}
+
+/* Function:    setInflateEngine
+   Description: Selects the inflate backend for the next decodes
+   Parameters:  InflateEngine - Backend to inflate with
+   Returns:     None
+ */
+void PngDecoder::setInflateEngine(const InflateEngine cEngine)
+{
+  mInflateEngine = cEngine;
+}
+
+/* Function:    setCrcMode
+   Description: Selects which chunk CRCs the next decodes check
+   Parameters:  CrcMode - Chunks to check
+   Returns:     None
+ */
+void PngDecoder::setCrcMode(const Png::CrcMode cMode)
+{
+  mCrcMode = cMode;
+}
+
+/* Function:    setOutputFormat
+   Description: Selects the pixel layout the next decodes write
+   Parameters:  PixelFormat - Layout of the output pixels
+                AlphaMode - Whether color is premultiplied by alpha
+   Returns:     None
+ */
+void PngDecoder::setOutputFormat(const PixelFormat cFormat, const AlphaMode cAlpha)
+{
+  mPixelFormat = cFormat;
+  mAlphaMode = cAlpha;
+}
+
+/* Function:    setOrientation
+   Description: Selects the flip or rotation the next decodes apply
+   Parameters:  Orientation - Flip or rotation to apply
+   Returns:     None
+ */
+void PngDecoder::setOrientation(const Png::Orientation cOrientation)
+{
+  mOrientation = cOrientation;
+}
+
+/* Function:    setCollectStats
+   Description: Turns stats collection on or off for the next decodes, only has an effect when built with
+                LESTPNG_STATS
+   Parameters:  bool - True to collect stats
+   Returns:     None
+ */
+void PngDecoder::setCollectStats(const bool cCollect)
+{
+  mCollectStats = cCollect;
+}
+
+/* Function:    startPng
+   Description: Reads the IHDR of the next png into the retained png object, creating it on first use, and hands
+                it the current settings
+   Parameters:  ByteSpan - Whole png file
+   Returns:     Png - Png object ready to decode
+ */
+Png &PngDecoder::startPng(const ByteSpan &crPngBytes)
+{
+  if (mpPng == nullptr)
+  {
+    mpPng.reset(new Png(crPngBytes, Png::DECODE_HEADER));
+    mpPng->setScanlineDecoder(&mScanlines);
+    mpPng->setCollectStats(mCollectStats);
+  }
+  else
+  {
+    mpPng->setCollectStats(mCollectStats);
+    mpPng->reset(crPngBytes, Png::DECODE_HEADER);
+  }
+
+  mpPng->setInflateEngine(mInflateEngine);
+  mpPng->setCrcMode(mCrcMode);
+  mpPng->setOutputFormat(mPixelFormat, mAlphaMode);
+  mpPng->setOrientation(mOrientation);
+  mIhdr = mpPng->getIhdr();
+  mRowBytes = mpPng->getRowBytes();
+
+  return *mpPng;
+}
+
+/* Function:    reserve
+   Description: Grows the output pixels to hold at least the given size. The old contents are not kept.
+   Parameters:  size_t - Bytes needed
+   Returns:     uint8_t* - Output pixels, nullptr if the allocation failed
+ */
+uint8_t *PngDecoder::reserve(const size_t cSize)
+{
+  if (cSize <= mCapacity)
+  {
+    return mpPixels;
+  }
+
+  if (mAllocator.allocate != nullptr)
+  {
+    if (mpPixels != nullptr)
+    {
+      mAllocator.release(mAllocator.pOpaque, mpPixels);
+    }
+
+    mpPixels = static_cast<uint8_t *>(mAllocator.allocate(mAllocator.pOpaque, cSize));
+  }
+  else
+  {
+    free(mpPixels);
+    mpPixels = static_cast<uint8_t *>(malloc(cSize));
+  }
+
+  mCapacity = (mpPixels == nullptr) ? 0 : cSize;
+
+  return mpPixels;
+}
+
+/* Function:    recordStats
+   Description: Takes the stats of the decode that just ended and adds them to the totals of the context
+   Parameters:  None
+   Returns:     None
+ */
+void PngDecoder::recordStats()
+{
+  if (!STATS_ENABLED || !mCollectStats || mpPng == nullptr)
+  {
+    return;
+  }
+
+  mStats = mpPng->getStats();
+  mStats.decodes = 1;
+  addDecodeStats(mTotalStats, mStats);
+}
+
+/* Function:    decode
+   Description: Decodes a png in memory into the retained output pixels, which getPixels returns until the next
+                decode
+   Parameters:  ByteSpan - Whole png file
+   Returns:     Status - FAIL if the png can not be decoded, see getError
+ */
+Status PngDecoder::decode(const ByteSpan &crPngBytes)
+{
+  mSize = 0;
+
+  try
+  {
+    Png &rPng = startPng(crPngBytes);
+    const size_t cRequired = rPng.getRequiredSize();
+
+    if (reserve(cRequired) == nullptr)
+    {
+      mError = "Could not allocate output pixels";
+      return FAIL;
+    }
+
+    if (rPng.decodeInto(mpPixels, 0, mCapacity) == FAIL)
+    {
+      mError = "Could not decode into output pixels";
+      return FAIL;
+    }
+
+    mSize = cRequired;
+  }
+  catch (const std::exception &crError)
+  {
+    mError = crError.what();
+    recordStats();
+    return FAIL;
+  }
+
+  mError.clear();
+  recordStats();
+
+  return SUCCESS;
+}
+
+/* Function:    decode
+   Description: Maps a png file and decodes it into the retained output pixels
+   Parameters:  std::string - Filepath for png file to read from
+   Returns:     Status - FAIL if the file can not be mapped or decoded, see getError
+ */
+Status PngDecoder::decode(const std::string &crPngPath)
+{
+  const MappedFile cFile(crPngPath);
+
+  if (!cFile.good())
+  {
+    mSize = 0;
+    mError = "Could not map " + crPngPath;
+    return FAIL;
+  }
+
+  return decode(cFile.getBytes());
+}
+
+/* Function:    decodeInto
+   Description: Decodes a png in memory into a caller's buffer, only the png object and zlib stream are reused
+   Parameters:  ByteSpan - Whole png file
+                uint8_t* - Destination buffer
+                size_t - Bytes between the start of two rows, 0 for tightly packed rows
+                size_t - Size of the destination buffer
+   Returns:     Status - FAIL if the png can not be decoded or does not fit the buffer, see getError
+ */
+Status PngDecoder::decodeInto(const ByteSpan &crPngBytes, uint8_t *pDst, const size_t cStride, const size_t cSize)
+{
+  try
+  {
+    if (startPng(crPngBytes).decodeInto(pDst, cStride, cSize) == FAIL)
+    {
+      mError = "Destination buffer is too small";
+      return FAIL;
+    }
+  }
+  catch (const std::exception &crError)
+  {
+    mError = crError.what();
+    recordStats();
+    return FAIL;
+  }
+
+  mError.clear();
+  recordStats();
+
+  return SUCCESS;
+}
+
+/* Function:    getPixels
+   Description: Returns the pixels of the last decode, valid until the next decode or the decoder is destroyed
+   Parameters:  None
+   Returns:     ByteSpan - Output pixels, empty if the last decode failed
+ */
+ByteSpan PngDecoder::getPixels() const
+{
+  return {mpPixels, mSize};
+}
+
+/* Function:    getIhdr
+   Description: Returns the IHDR of the last png decoded
+   Parameters:  None
+   Returns:     IHDR - Header of the last png
+ */
+const struct Png::IHDR &PngDecoder::getIhdr() const
+{
+  return mIhdr;
+}
+
+/* Function:    getRowBytes
+   Description: Returns the bytes in one row of the last decode's output, after format and orientation
+   Parameters:  None
+   Returns:     size_t - Bytes in one output row
+ */
+size_t PngDecoder::getRowBytes() const
+{
+  return mRowBytes;
+}
+
+/* Function:    getError
+   Description: Returns why the last decode failed
+   Parameters:  None
+   Returns:     std::string - Error message, empty after a successful decode
+ */
+const std::string &PngDecoder::getError() const
+{
+  return mError;
+}
+
+/* Function:    getStats
+   Description: Returns the stats of the last decode, including one that failed part way
+   Parameters:  None
+   Returns:     DecodeStats - Stats of the last decode, all zero unless stats are built in and turned on
+ */
+const DecodeStats &PngDecoder::getStats() const
+{
+  return mStats;
+}
+
+/* Function:    getTotalStats
+   Description: Returns the stats of every decode since construction or the last resetStats added up, ready to be
+                exported to a metrics system
+   Parameters:  None
+   Returns:     DecodeStats - Summed stats, decodes counts the decodes that went into them
+ */
+const DecodeStats &PngDecoder::getTotalStats() const
+{
+  return mTotalStats;
+}
+
+/* Function:    resetStats
+   Description: Clears the stats of the last decode and the totals
+   Parameters:  None
+   Returns:     None
+ */
+void PngDecoder::resetStats()
+{
+  mStats = DecodeStats();
+  mTotalStats = DecodeStats();
+}
@@ -0,0 +1,67 @@
+#ifndef DECODER_HPP
+#define DECODER_HPP
+
+#include <cstdint>
+#include <string>
+#include <memory>
+
+#include "common.hpp"
+#include "png.hpp"
+#include "scanline.hpp"
+
+/* Decoder context for decoding many pngs one after another on the same thread. The png object, its scanline decoder,
+   the zlib stream (reset rather than rebuilt), row buffers and the output pixels all stay alive between decodes and
+   only ever grow, so once they fit the largest image seen a decode from memory does not touch the heap. An optional
+   allocator hook takes over the zlib state and the output pixels, for example to put them in an arena. With stats
+   built in and turned on, the stats of every decode are also added up for the whole context.
+ */
+class PngDecoder {
+public:
+  PngDecoder();
+  explicit PngDecoder(const PngAllocator &crAllocator);
+  ~PngDecoder();
+  PngDecoder(const PngDecoder &) = delete;
+  PngDecoder &operator=(const PngDecoder &) = delete;
+  void setInflateEngine(const InflateEngine cEngine);
+  void setCrcMode(const Png::CrcMode cMode);
+  void setOutputFormat(const PixelFormat cFormat, const AlphaMode cAlpha = ALPHA_STRAIGHT);
+  void setOrientation(const Png::Orientation cOrientation);
+  void setCollectStats(const bool cCollect);
+  Status decode(const ByteSpan &crPngBytes);
+  Status decode(const std::string &crPngPath);
+  Status decodeInto(const ByteSpan &crPngBytes, uint8_t *pDst, const size_t cStride, const size_t cSize);
+  ByteSpan getPixels() const;
+  const struct Png::IHDR &getIhdr() const;
+  size_t getRowBytes() const;
+  const std::string &getError() const;
+  const DecodeStats &getStats() const;
+  const DecodeStats &getTotalStats() const;
+  void resetStats();
+
+private:
+  Png &startPng(const ByteSpan &crPngBytes);
+  uint8_t *reserve(const size_t cSize);
+  void recordStats();
+
+  PngAllocator mAllocator;
+  ScanlineDecoder mScanlines;
+  std::unique_ptr<Png> mpPng;
+  InflateEngine mInflateEngine;
+  Png::CrcMode mCrcMode;
+  PixelFormat mPixelFormat;
+  AlphaMode mAlphaMode;
+  Png::Orientation mOrientation;
+  bool mCollectStats;
+
+  // Output of the last decode, mCapacity bytes are allocated and the first mSize hold the image
+  uint8_t *mpPixels;
+  size_t mCapacity;
+  size_t mSize;
+  size_t mRowBytes;
+  struct Png::IHDR mIhdr;
+  std::string mError;
+  DecodeStats mStats;
+  DecodeStats mTotalStats;
+};
+
+#endif
@@ -0,0 +1,699 @@
+#include "expand.hpp"
+#include "unfilter.hpp"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+  #define EXPAND_X86 1
+  #include <immintrin.h>
+#endif
+
+#define COLOR_GRAY       0
+#define COLOR_RGB        2
+#define COLOR_PALETTE    3
+#define COLOR_GRAY_ALPHA 4
+#define COLOR_RGBA       6
+
+/* Function:    packedSample
+   Description: Reads one sample of a scanline packed below 8 bits, the leftmost pixel sits in the high bits
+   Parameters:  uint8_t* - Scanline
+                uint32_t - Column
+   Returns:     uint8_t - Sample value
+ */
+template <uint8_t DEPTH>
+static inline uint8_t packedSample(const uint8_t *cpSrc, const uint32_t cColumn)
+{
+  const size_t cBit = static_cast<size_t>(cColumn) * DEPTH;
+
+  return static_cast<uint8_t>((cpSrc[cBit >> 3] >> (8 - DEPTH - (cBit & 7))) & ((1u << DEPTH) - 1));
+}
+
+template <uint8_t CHANNELS>
+static void copy8(const uint8_t *cpSrc, uint8_t *pDst, const uint32_t cX, const uint32_t cWidth, const uint8_t *)
+{
+  memcpy(pDst, cpSrc + (static_cast<size_t>(cX) * CHANNELS), static_cast<size_t>(cWidth) * CHANNELS);
+}
+
+// Samples are big endian in the file
+template <uint8_t CHANNELS>
+static void copy16(const uint8_t *cpSrc, uint8_t *pDst, const uint32_t cX, const uint32_t cWidth, const uint8_t *)
+{
+  const uint8_t *cpIn = cpSrc + (static_cast<size_t>(cX) * CHANNELS * 2);
+  const size_t cSamples = static_cast<size_t>(cWidth) * CHANNELS;
+
+  for (size_t i = 0; i < cSamples; i ++)
+  {
+    const uint16_t cValue = static_cast<uint16_t>((cpIn[2 * i] << 8) | cpIn[(2 * i) + 1]);
+    memcpy(pDst + (2 * i), &cValue, sizeof(cValue));
+  }
+}
+
+template <uint8_t DEPTH>
+static void expandGray(const uint8_t *cpSrc, uint8_t *pDst, const uint32_t cX, const uint32_t cWidth,
+                       const uint8_t *)
+{
+  // 0xFF, 0x55 and 0x11 repeat the sample bits across the byte for 1, 2 and 4 bit samples
+  const uint8_t cScale = static_cast<uint8_t>(255 / ((1u << DEPTH) - 1));
+
+  for (uint32_t i = 0; i < cWidth; i ++)
+  {
+    pDst[i] = static_cast<uint8_t>(packedSample<DEPTH>(cpSrc, cX + i) * cScale);
+  }
+}
+
+template <uint8_t DEPTH>
+static void expandPalette(const uint8_t *cpSrc, uint8_t *pDst, const uint32_t cX, const uint32_t cWidth,
+                          const uint8_t *cpPalette)
+{
+  for (uint32_t i = 0; i < cWidth; i ++)
+  {
+    const uint8_t cIndex = (DEPTH == 8) ? cpSrc[cX + i] : packedSample<DEPTH>(cpSrc, cX + i);
+    memcpy(pDst + (4 * static_cast<size_t>(i)), cpPalette + (4 * static_cast<size_t>(cIndex)), 4);
+  }
+}
+
+/* Function:    premultiply
+   Description: Scales a color sample by alpha / 255 rounded to nearest without a division
+   Parameters:  uint8_t - Color sample
+                uint8_t - Alpha
+   Returns:     uint8_t - Premultiplied sample
+ */
+static inline uint8_t premultiply(const uint8_t cColor, const uint8_t cAlpha)
+{
+  const uint32_t cProduct = (static_cast<uint32_t>(cColor) * cAlpha) + 128;
+
+  return static_cast<uint8_t>((cProduct + (cProduct >> 8)) >> 8);
+}
+
+/* Function:    sample8
+   Description: Reads one sample as 8 bits, samples below 8 bits are scaled up and 16 bit samples keep their high byte
+   Parameters:  uint8_t* - Scanline
+                size_t - Sample index
+   Returns:     uint8_t - Sample value
+ */
+template <uint8_t DEPTH>
+static inline uint8_t sample8(const uint8_t *cpSrc, const size_t cIndex)
+{
+  if (DEPTH < 8)
+  {
+    // 0xFF, 0x55 and 0x11 repeat the sample bits across the byte for 1, 2 and 4 bit samples
+    const uint8_t cScale = static_cast<uint8_t>(255 / ((1u << DEPTH) - 1));
+
+    return static_cast<uint8_t>(packedSample<DEPTH>(cpSrc, static_cast<uint32_t>(cIndex)) * cScale);
+  }
+
+  return (DEPTH == 16) ? cpSrc[2 * cIndex] : cpSrc[cIndex];
+}
+
+/* Function:    convertPixels
+   Description: Expansion kernel that also converts to a pixel format, gray is replicated over the color channels
+                and missing alpha is opaque. Handles every format, the SIMD kernels cover the common 8 bit cases.
+ */
+template <uint8_t CHANNELS, uint8_t DEPTH, PixelFormat FORMAT, bool PREMULTIPLY>
+static void convertPixels(const uint8_t *cpSrc, uint8_t *pDst, const uint32_t cX, const uint32_t cWidth,
+                          const uint8_t *)
+{
+  const uint8_t cOutChannels = (FORMAT == PIXEL_NATIVE8) ? CHANNELS : 4;
+
+  for (uint32_t i = 0; i < cWidth; i ++)
+  {
+    const size_t cFirst = static_cast<size_t>(cX + i) * CHANNELS;
+    uint8_t *pOut = pDst + (static_cast<size_t>(i) * cOutChannels);
+    uint8_t red = sample8<DEPTH>(cpSrc, cFirst);
+    uint8_t green = (CHANNELS >= 3) ? sample8<DEPTH>(cpSrc, cFirst + 1) : red;
+    uint8_t blue = (CHANNELS >= 3) ? sample8<DEPTH>(cpSrc, cFirst + 2) : red;
+    const uint8_t cAlpha = ((CHANNELS % 2) == 0) ? sample8<DEPTH>(cpSrc, cFirst + CHANNELS - 1) : 0xFF;
+
+    if (PREMULTIPLY)
+    {
+      red = premultiply(red, cAlpha);
+      green = premultiply(green, cAlpha);
+      blue = premultiply(blue, cAlpha);
+    }
+
+    if (FORMAT == PIXEL_NATIVE8)
+    {
+      pOut[0] = red;
+
+      if (CHANNELS >= 3)
+      {
+        pOut[1] = green;
+        pOut[2] = blue;
+      }
+
+      if ((CHANNELS % 2) == 0)
+      {
+        pOut[CHANNELS - 1] = cAlpha;
+      }
+    }
+    else
+    {
+      pOut[0] = (FORMAT == PIXEL_BGRA8) ? blue : red;
+      pOut[1] = green;
+      pOut[2] = (FORMAT == PIXEL_BGRA8) ? red : blue;
+      pOut[3] = (FORMAT == PIXEL_RGBX8) ? 0xFF : cAlpha;
+    }
+  }
+}
+
+#ifdef EXPAND_X86
+/* Function:    premultiplySse2
+   Description: Premultiplies 4 pixels whose alpha is the last byte of every 4, alpha itself is kept
+ */
+static inline __m128i premultiplySse2(const __m128i cPixels)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i round = _mm_set1_epi16(128);
+  const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000));
+  __m128i lo = _mm_unpacklo_epi8(cPixels, zero);
+  __m128i hi = _mm_unpackhi_epi8(cPixels, zero);
+  const __m128i cAlphaLo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, 0xFF), 0xFF);
+  const __m128i cAlphaHi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, 0xFF), 0xFF);
+
+  lo = _mm_add_epi16(_mm_mullo_epi16(lo, cAlphaLo), round);
+  hi = _mm_add_epi16(_mm_mullo_epi16(hi, cAlphaHi), round);
+  lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+  hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+
+  return _mm_or_si128(_mm_and_si128(cPixels, alphaMask), _mm_andnot_si128(alphaMask, _mm_packus_epi16(lo, hi)));
+}
+
+/* Function:    shuffleMask
+   Description: Builds the pshufb mask that turns 4 source pixels of 8 bit samples into 4 bytes per pixel. Bytes with
+                the high bit set come out as zero, which is where opaque alpha gets or'ed in.
+ */
+template <uint8_t CHANNELS, PixelFormat FORMAT>
+static inline __m128i shuffleMask()
+{
+  alignas(16) uint8_t mask[16];
+
+  for (uint8_t pixel = 0; pixel < 4; pixel ++)
+  {
+    const uint8_t cBase = static_cast<uint8_t>(pixel * CHANNELS);
+    const uint8_t cRed = cBase;
+    const uint8_t cBlue = static_cast<uint8_t>((CHANNELS >= 3) ? cBase + 2 : cBase);
+
+    mask[(pixel * 4)] = (FORMAT == PIXEL_BGRA8) ? cBlue : cRed;
+    mask[(pixel * 4) + 1] = static_cast<uint8_t>((CHANNELS >= 3) ? cBase + 1 : cBase);
+    mask[(pixel * 4) + 2] = (FORMAT == PIXEL_BGRA8) ? cRed : cBlue;
+    mask[(pixel * 4) + 3] = (((CHANNELS % 2) == 0) && (FORMAT != PIXEL_RGBX8)) ?
+                            static_cast<uint8_t>(cBase + CHANNELS - 1) : 0x80;
+  }
+
+  return _mm_load_si128(reinterpret_cast<const __m128i *>(mask));
+}
+
+/* Function:    convertSsse3
+   Description: 8 bit samples to 4 bytes per pixel, 4 pixels per shuffle. The scalar kernel finishes the last pixels
+                so no load reads past the scanline.
+ */
+template <uint8_t CHANNELS, PixelFormat FORMAT, bool PREMULTIPLY>
+__attribute__((target("ssse3")))
+static void convertSsse3(const uint8_t *cpSrc, uint8_t *pDst, const uint32_t cX, const uint32_t cWidth,
+                         const uint8_t *cpPalette)
+{
+  const uint8_t *cpIn = cpSrc + (static_cast<size_t>(cX) * CHANNELS);
+  const __m128i cMask = shuffleMask<CHANNELS, FORMAT>();
+  const __m128i cOpaque = (((CHANNELS % 2) == 0) && (FORMAT != PIXEL_RGBX8)) ? _mm_setzero_si128() :
+                          _mm_set1_epi32(static_cast<int>(0xFF000000));
+  uint32_t i = 0;
+
+  for (; (static_cast<size_t>(i) * CHANNELS) + 16 <= static_cast<size_t>(cWidth) * CHANNELS; i += 4)
+  {
+    const uint8_t *cpPixels = cpIn + (static_cast<size_t>(i) * CHANNELS);
+    __m128i pixels = _mm_or_si128(_mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(cpPixels)), cMask),
+                                  cOpaque);
+
+    if (PREMULTIPLY)
+    {
+      pixels = premultiplySse2(pixels);
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(pDst + (4 * static_cast<size_t>(i))), pixels);
+  }
+
+  convertPixels<CHANNELS, 8, FORMAT, PREMULTIPLY>(cpSrc, pDst + (4 * static_cast<size_t>(i)), cX + i, cWidth - i,
+                                                  cpPalette);
+}
+
+/* Function:    truncate16Sse2
+   Description: Keeps the high byte of every 16 bit sample, the first byte of each since samples are big endian
+ */
+template <uint8_t CHANNELS>
+static void truncate16Sse2(const uint8_t *cpSrc, uint8_t *pDst, const uint32_t cX, const uint32_t cWidth,
+                           const uint8_t *)
+{
+  const uint8_t *cpIn = cpSrc + (static_cast<size_t>(cX) * CHANNELS * 2);
+  const size_t cSamples = static_cast<size_t>(cWidth) * CHANNELS;
+  const __m128i cLowBytes = _mm_set1_epi16(0x00FF);
+  size_t i = 0;
+
+  for (; i + 16 <= cSamples; i += 16)
+  {
+    const __m128i cFirst = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(cpIn + (2 * i))), cLowBytes);
+    const __m128i cSecond = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(cpIn + (2 * i) + 16)),
+                                          cLowBytes);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(pDst + i), _mm_packus_epi16(cFirst, cSecond));
+  }
+
+  for (; i < cSamples; i ++)
+  {
+    pDst[i] = cpIn[2 * i];
+  }
+}
+#endif
+
+template <uint8_t PIXEL>
+static void scatterPixels(const uint8_t *cpSrc, const ptrdiff_t cSrcStep, uint8_t *pDst, const ptrdiff_t cDstStep,
+                          const uint32_t cCount)
+{
+  for (uint32_t i = 0; i < cCount; i ++)
+  {
+    memcpy(pDst + (static_cast<ptrdiff_t>(i) * cDstStep), cpSrc + (static_cast<ptrdiff_t>(i) * cSrcStep), PIXEL);
+  }
+}
+
+/* Function:    getScatterKernel
+   Description: Picks the scatter kernel for a decoded pixel size
+   Parameters:  uint8_t - Bytes per decoded pixel
+   Returns:     ScatterFn - Kernel, nullptr for a size no color type decodes to
+ */
+ScatterFn getScatterKernel(const uint8_t cPixelBytes)
+{
+  switch (cPixelBytes)
+  {
+    case 1:
+      return scatterPixels<1>;
+    case 2:
+      return scatterPixels<2>;
+    case 3:
+      return scatterPixels<3>;
+    case 4:
+      return scatterPixels<4>;
+    case 6:
+      return scatterPixels<6>;
+    case 8:
+      return scatterPixels<8>;
+    default:
+      return nullptr;
+  }
+}
+
+/* Function:    blendPixel
+   Description: Draws one straight alpha pixel over another with the integer formula of the APNG spec
+   Parameters:  uint8_t* - Source pixel
+                uint8_t* - Destination pixel, overwritten
+   Returns:     None
+ */
+static inline void blendPixel(const uint8_t *cpSrc, uint8_t *pDst)
+{
+  const uint32_t cAlpha = cpSrc[3];
+
+  if (cAlpha == 0)
+  {
+    return;
+  }
+
+  if (cAlpha == 0xFF || pDst[3] == 0)
+  {
+    memcpy(pDst, cpSrc, 4);
+    return;
+  }
+
+  // Weights of source and destination times 255, they add up to the output alpha times 255
+  const uint32_t cSrcWeight = cAlpha * 255;
+  const uint32_t cDstWeight = (255 - cAlpha) * pDst[3];
+  const uint32_t cTotal = cSrcWeight + cDstWeight;
+
+  for (uint8_t i = 0; i < 3; i ++)
+  {
+    pDst[i] = static_cast<uint8_t>(((cpSrc[i] * cSrcWeight) + (pDst[i] * cDstWeight)) / cTotal);
+  }
+
+  pDst[3] = static_cast<uint8_t>(cTotal / 255);
+}
+
+/* Function:    blendStraight
+   Description: Draws straight alpha pixels over others one at a time
+   Parameters:  uint8_t* - Source pixels
+                uint8_t* - Destination pixels, overwritten
+                uint32_t - Amount of pixels
+   Returns:     None
+ */
+static void blendStraight(const uint8_t *cpSrc, uint8_t *pDst, const uint32_t cCount)
+{
+  for (uint32_t i = 0; i < cCount; i ++)
+  {
+    blendPixel(cpSrc + (4 * static_cast<size_t>(i)), pDst + (4 * static_cast<size_t>(i)));
+  }
+}
+
+/* Function:    blendPremultiplied
+   Description: Draws premultiplied pixels over others one at a time
+   Parameters:  uint8_t* - Source pixels
+                uint8_t* - Destination pixels, overwritten
+                uint32_t - Amount of pixels
+   Returns:     None
+ */
+static void blendPremultiplied(const uint8_t *cpSrc, uint8_t *pDst, const uint32_t cCount)
+{
+  for (size_t i = 0; i < (4 * static_cast<size_t>(cCount)); i += 4)
+  {
+    const uint8_t cInverse = static_cast<uint8_t>(255 - cpSrc[i + 3]);
+
+    for (size_t j = 0; j < 4; j ++)
+    {
+      pDst[i + j] = static_cast<uint8_t>(std::min(255, cpSrc[i + j] + premultiply(pDst[i + j], cInverse)));
+    }
+  }
+}
+
+#ifdef EXPAND_X86
+/* Function:    blendStraightSse2
+   Description: Draws straight alpha pixels over others 4 at a time. Groups whose pixels are each fully opaque or
+                fully transparent, which is nearly all of a typical frame, are a masked select. Only groups with
+                partial alpha go through the exact formula pixel by pixel.
+ */
+static void blendStraightSse2(const uint8_t *cpSrc, uint8_t *pDst, const uint32_t cCount)
+{
+  const __m128i cAlphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000));
+  const __m128i cZero = _mm_setzero_si128();
+  uint32_t i = 0;
+
+  for (; i + 4 <= cCount; i += 4)
+  {
+    const __m128i cSrc = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cpSrc + (4 * static_cast<size_t>(i))));
+    const __m128i cAlpha = _mm_and_si128(cSrc, cAlphaMask);
+    const __m128i cOpaque = _mm_cmpeq_epi32(cAlpha, cAlphaMask);
+    const __m128i cClear = _mm_cmpeq_epi32(cAlpha, cZero);
+    uint8_t *pOut = pDst + (4 * static_cast<size_t>(i));
+
+    if (_mm_movemask_epi8(_mm_or_si128(cOpaque, cClear)) != 0xFFFF)
+    {
+      blendStraight(cpSrc + (4 * static_cast<size_t>(i)), pOut, 4);
+      continue;
+    }
+
+    const __m128i cDst = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pOut));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(pOut),
+                     _mm_or_si128(_mm_and_si128(cOpaque, cSrc), _mm_andnot_si128(cOpaque, cDst)));
+  }
+
+  blendStraight(cpSrc + (4 * static_cast<size_t>(i)), pDst + (4 * static_cast<size_t>(i)), cCount - i);
+}
+
+/* Function:    blendPremultipliedSse2
+   Description: Draws premultiplied pixels over others 4 at a time, the destination is scaled by one minus source
+                alpha in 16 bit lanes with the same rounding as premultiply
+ */
+static void blendPremultipliedSse2(const uint8_t *cpSrc, uint8_t *pDst, const uint32_t cCount)
+{
+  const __m128i cZero = _mm_setzero_si128();
+  const __m128i cRound = _mm_set1_epi16(128);
+  const __m128i cFull = _mm_set1_epi16(255);
+  uint32_t i = 0;
+
+  for (; i + 4 <= cCount; i += 4)
+  {
+    const __m128i cSrc = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cpSrc + (4 * static_cast<size_t>(i))));
+    uint8_t *pOut = pDst + (4 * static_cast<size_t>(i));
+    const __m128i cDst = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pOut));
+    const __m128i cSrcLo = _mm_unpacklo_epi8(cSrc, cZero);
+    const __m128i cSrcHi = _mm_unpackhi_epi8(cSrc, cZero);
+    const __m128i cInverseLo = _mm_sub_epi16(cFull, _mm_shufflehi_epi16(_mm_shufflelo_epi16(cSrcLo, 0xFF), 0xFF));
+    const __m128i cInverseHi = _mm_sub_epi16(cFull, _mm_shufflehi_epi16(_mm_shufflelo_epi16(cSrcHi, 0xFF), 0xFF));
+    __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(cDst, cZero), cInverseLo), cRound);
+    __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(cDst, cZero), cInverseHi), cRound);
+
+    lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+    hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(pOut), _mm_adds_epu8(cSrc, _mm_packus_epi16(lo, hi)));
+  }
+
+  blendPremultiplied(cpSrc + (4 * static_cast<size_t>(i)), pDst + (4 * static_cast<size_t>(i)), cCount - i);
+}
+#endif
+
+/* Function:    getBlendKernel
+   Description: Picks the kernel that draws pixels over others, preferring the SIMD kernels
+   Parameters:  AlphaMode - Whether the pixels are premultiplied
+   Returns:     BlendFn - Kernel
+ */
+BlendFn getBlendKernel(const AlphaMode cAlpha)
+{
+#ifdef EXPAND_X86
+  if (getUnfilterSimdLevel() >= SIMD_SSE2)
+  {
+    return (cAlpha == ALPHA_PREMULTIPLIED) ? blendPremultipliedSse2 : blendStraightSse2;
+  }
+#endif
+
+  return (cAlpha == ALPHA_PREMULTIPLIED) ? blendPremultiplied : blendStraight;
+}
+
+/* Function:    getExpandKernel
+   Description: Picks the expansion kernel for a color type and bit depth, done once per image
+   Parameters:  uint8_t - Color type from IHDR
+                uint8_t - Bit depth from IHDR
+   Returns:     ExpandFn - Kernel, nullptr if the pair is not allowed by the PNG spec
+ */
+ExpandFn getExpandKernel(const uint8_t cColorType, const uint8_t cBitDepth)
+{
+  switch ((cColorType << 8) | cBitDepth)
+  {
+    case (COLOR_GRAY << 8) | 1:
+      return expandGray<1>;
+    case (COLOR_GRAY << 8) | 2:
+      return expandGray<2>;
+    case (COLOR_GRAY << 8) | 4:
+      return expandGray<4>;
+    case (COLOR_GRAY << 8) | 8:
+      return copy8<1>;
+    case (COLOR_GRAY << 8) | 16:
+      return copy16<1>;
+    case (COLOR_RGB << 8) | 8:
+      return copy8<3>;
+    case (COLOR_RGB << 8) | 16:
+      return copy16<3>;
+    case (COLOR_PALETTE << 8) | 1:
+      return expandPalette<1>;
+    case (COLOR_PALETTE << 8) | 2:
+      return expandPalette<2>;
+    case (COLOR_PALETTE << 8) | 4:
+      return expandPalette<4>;
+    case (COLOR_PALETTE << 8) | 8:
+      return expandPalette<8>;
+    case (COLOR_GRAY_ALPHA << 8) | 8:
+      return copy8<2>;
+    case (COLOR_GRAY_ALPHA << 8) | 16:
+      return copy16<2>;
+    case (COLOR_RGBA << 8) | 8:
+      return copy8<4>;
+    case (COLOR_RGBA << 8) | 16:
+      return copy16<4>;
+    default:
+      return nullptr;
+  }
+}
+
+/* Function:    getSampleChannels
+   Description: Gets the samples per pixel stored in the file for a color type
+   Parameters:  uint8_t - Color type from IHDR
+   Returns:     uint8_t - Samples per pixel, 0 for an unknown color type
+ */
+uint8_t getSampleChannels(const uint8_t cColorType)
+{
+  switch (cColorType)
+  {
+    case COLOR_GRAY:
+    case COLOR_PALETTE:
+      return 1;
+    case COLOR_GRAY_ALPHA:
+      return 2;
+    case COLOR_RGB:
+      return 3;
+    case COLOR_RGBA:
+      return 4;
+    default:
+      return 0;
+  }
+}
+
+/* Function:    getOutputPixelBytes
+   Description: Gets the bytes of one pixel as the expansion kernel writes it
+   Parameters:  uint8_t - Color type from IHDR
+                uint8_t - Bit depth from IHDR
+   Returns:     uint8_t - Bytes per output pixel
+ */
+uint8_t getOutputPixelBytes(const uint8_t cColorType, const uint8_t cBitDepth)
+{
+  if (cColorType == COLOR_PALETTE)
+  {
+    return 4;
+  }
+
+  return static_cast<uint8_t>(getSampleChannels(cColorType) * ((cBitDepth == 16) ? 2 : 1));
+}
+
+/* Function:    pickConvert
+   Description: Picks the conversion kernel for one source layout and format, preferring the SIMD kernels
+   Parameters:  AlphaMode - Straight or premultiplied alpha
+   Returns:     ExpandFn - Kernel
+ */
+template <uint8_t CHANNELS, uint8_t DEPTH, PixelFormat FORMAT>
+static ExpandFn pickConvert(const AlphaMode cAlpha)
+{
+  // Premultiplying only does something when there is an alpha channel that ends up in the output
+  const bool cPremultiply = (cAlpha == ALPHA_PREMULTIPLIED) && ((CHANNELS % 2) == 0) && (FORMAT != PIXEL_RGBX8);
+
+#ifdef EXPAND_X86
+  const SimdLevel cLevel = getUnfilterSimdLevel();
+
+  if ((DEPTH == 8) && (FORMAT != PIXEL_NATIVE8) && (cLevel >= SIMD_SSSE3))
+  {
+    return cPremultiply ? convertSsse3<CHANNELS, FORMAT, true> : convertSsse3<CHANNELS, FORMAT, false>;
+  }
+
+  // Premultiplied RGBA keeps its layout, so it is the same conversion as RGBA8
+  if ((DEPTH == 8) && (CHANNELS == 4) && cPremultiply && (cLevel >= SIMD_SSSE3))
+  {
+    return convertSsse3<CHANNELS, PIXEL_RGBA8, true>;
+  }
+
+  if ((DEPTH == 16) && (FORMAT == PIXEL_NATIVE8) && !cPremultiply && (cLevel >= SIMD_SSE2))
+  {
+    return truncate16Sse2<CHANNELS>;
+  }
+#endif
+
+  if ((DEPTH == 8) && (FORMAT == PIXEL_NATIVE8) && !cPremultiply)
+  {
+    return copy8<CHANNELS>;
+  }
+
+  return cPremultiply ? convertPixels<CHANNELS, DEPTH, FORMAT, true> : convertPixels<CHANNELS, DEPTH, FORMAT, false>;
+}
+
+/* Function:    pickFormat
+   Description: Instantiates the conversion kernels of one source layout for the requested format
+   Parameters:  PixelFormat - Output format, anything but PIXEL_NATIVE
+                AlphaMode - Straight or premultiplied alpha
+   Returns:     ExpandFn - Kernel
+ */
+template <uint8_t CHANNELS, uint8_t DEPTH>
+static ExpandFn pickFormat(const PixelFormat cFormat, const AlphaMode cAlpha)
+{
+  switch (cFormat)
+  {
+    case PIXEL_RGBA8:
+      return pickConvert<CHANNELS, DEPTH, PIXEL_RGBA8>(cAlpha);
+    case PIXEL_BGRA8:
+      return pickConvert<CHANNELS, DEPTH, PIXEL_BGRA8>(cAlpha);
+    case PIXEL_RGBX8:
+      return pickConvert<CHANNELS, DEPTH, PIXEL_RGBX8>(cAlpha);
+    default:
+      return pickConvert<CHANNELS, DEPTH, PIXEL_NATIVE8>(cAlpha);
+  }
+}
+
+/* Function:    getConvertKernel
+   Description: Picks the kernel that expands a scanline straight into the requested pixel format, so the image is
+                written exactly once. Palette images use the plain palette kernel, their palette is converted instead.
+   Parameters:  uint8_t - Color type from IHDR
+                uint8_t - Bit depth from IHDR
+                PixelFormat - Output format
+                AlphaMode - Straight or premultiplied alpha
+   Returns:     ExpandFn - Kernel, nullptr if the pair is not allowed by the PNG spec
+ */
+ExpandFn getConvertKernel(const uint8_t cColorType, const uint8_t cBitDepth, const PixelFormat cFormat,
+                          const AlphaMode cAlpha)
+{
+  if ((cFormat == PIXEL_NATIVE) || (cColorType == COLOR_PALETTE) || (getExpandKernel(cColorType, cBitDepth) == nullptr))
+  {
+    return getExpandKernel(cColorType, cBitDepth);
+  }
+
+  switch ((cColorType << 8) | cBitDepth)
+  {
+    case (COLOR_GRAY << 8) | 1:
+      return pickFormat<1, 1>(cFormat, cAlpha);
+    case (COLOR_GRAY << 8) | 2:
+      return pickFormat<1, 2>(cFormat, cAlpha);
+    case (COLOR_GRAY << 8) | 4:
+      return pickFormat<1, 4>(cFormat, cAlpha);
+    case (COLOR_GRAY << 8) | 8:
+      return pickFormat<1, 8>(cFormat, cAlpha);
+    case (COLOR_GRAY << 8) | 16:
+      return pickFormat<1, 16>(cFormat, cAlpha);
+    case (COLOR_RGB << 8) | 8:
+      return pickFormat<3, 8>(cFormat, cAlpha);
+    case (COLOR_RGB << 8) | 16:
+      return pickFormat<3, 16>(cFormat, cAlpha);
+    case (COLOR_GRAY_ALPHA << 8) | 8:
+      return pickFormat<2, 8>(cFormat, cAlpha);
+    case (COLOR_GRAY_ALPHA << 8) | 16:
+      return pickFormat<2, 16>(cFormat, cAlpha);
+    case (COLOR_RGBA << 8) | 8:
+      return pickFormat<4, 8>(cFormat, cAlpha);
+    default:
+      return pickFormat<4, 16>(cFormat, cAlpha);
+  }
+}
+
+/* Function:    convertPalette
+   Description: Converts an RGBA palette in place to the output format, done once per image instead of per pixel
+   Parameters:  uint8_t* - PALETTE_ENTRIES RGBA entries
+                PixelFormat - Output format
+                AlphaMode - Straight or premultiplied alpha
+   Returns:     None
+ */
+void convertPalette(uint8_t *pPalette, const PixelFormat cFormat, const AlphaMode cAlpha)
+{
+  if (cFormat == PIXEL_NATIVE)
+  {
+    return;
+  }
+
+  for (uint32_t i = 0; i < PALETTE_ENTRIES; i ++)
+  {
+    uint8_t *pEntry = pPalette + (4 * i);
+
+    if (cFormat == PIXEL_RGBX8)
+    {
+      pEntry[3] = 0xFF;
+    }
+    else if (cAlpha == ALPHA_PREMULTIPLIED)
+    {
+      pEntry[0] = premultiply(pEntry[0], pEntry[3]);
+      pEntry[1] = premultiply(pEntry[1], pEntry[3]);
+      pEntry[2] = premultiply(pEntry[2], pEntry[3]);
+    }
+
+    if (cFormat == PIXEL_BGRA8)
+    {
+      std::swap(pEntry[0], pEntry[2]);
+    }
+  }
+}
+
+/* Function:    getOutputPixelBytes
+   Description: Gets the bytes of one pixel as the conversion kernel for a format writes it
+   Parameters:  uint8_t - Color type from IHDR
+                uint8_t - Bit depth from IHDR
+                PixelFormat - Output format
+   Returns:     uint8_t - Bytes per output pixel
+ */
+uint8_t getOutputPixelBytes(const uint8_t cColorType, const uint8_t cBitDepth, const PixelFormat cFormat)
+{
+  switch (cFormat)
+  {
+    case PIXEL_NATIVE:
+      return getOutputPixelBytes(cColorType, cBitDepth);
+    case PIXEL_NATIVE8:
+      return getOutputPixelBytes(cColorType, 8);
+    default:
+      return 4;
+  }
+}
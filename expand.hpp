@@ -0,0 +1,61 @@
+#ifndef EXPAND_HPP
+#define EXPAND_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+#include "common.hpp"
+
+// Palette entries are expanded to 4 bytes, RGBA with alpha from tRNS
+#define PALETTE_ENTRIES 256
+#define PALETTE_SIZE    (PALETTE_ENTRIES * 4)
+
+/* Layout the decoder writes pixels in. PIXEL_NATIVE keeps the samples of the file as described below, PIXEL_NATIVE8
+   does the same with 16 bit samples truncated to 8 bits and the rest always write 4 bytes per pixel. RGBX8 is RGBA8
+   with the alpha byte set to 0xFF.
+ */
+enum PixelFormat {
+  PIXEL_NATIVE,
+  PIXEL_NATIVE8,
+  PIXEL_RGBA8,
+  PIXEL_BGRA8,
+  PIXEL_RGBX8
+};
+
+// Premultiplied color channels are scaled by alpha / 255 rounded to nearest, formats without alpha ignore the mode
+enum AlphaMode {
+  ALPHA_STRAIGHT,
+  ALPHA_PREMULTIPLIED
+};
+
+/* Writes columns [cX, cX + cWidth) of one reconstructed scanline as output pixels. Every legal color type and bit
+   depth has its own instantiation, so the pixel size is a constant and the loops carry no format checks:
+   samples below 8 bits are unpacked and gray is scaled to the full 0-255 range, palette indices are looked up as
+   RGBA and 16 bit samples are stored as host order uint16_t.
+ */
+typedef void (*ExpandFn)(const uint8_t *cpSrc, uint8_t *pDst, const uint32_t cX, const uint32_t cWidth,
+                         const uint8_t *cpPalette);
+
+/* Copies cCount pixels cSrcStep bytes apart in cpSrc to pixels cDstStep bytes apart in pDst. Used to spread the
+   columns of an Adam7 pass over the image and to write rows of a rotated image, so either step can be negative.
+ */
+typedef void (*ScatterFn)(const uint8_t *cpSrc, const ptrdiff_t cSrcStep, uint8_t *pDst, const ptrdiff_t cDstStep,
+                          const uint32_t cCount);
+
+/* Draws cCount 4 byte pixels over pixels of the same format with the alpha in their last byte, the
+   APNG_BLEND_OP_OVER compositing. Straight alpha follows the exact integer formula of the APNG spec, premultiplied
+   alpha is source plus destination scaled by one minus source alpha.
+ */
+typedef void (*BlendFn)(const uint8_t *cpSrc, uint8_t *pDst, const uint32_t cCount);
+
+ScatterFn getScatterKernel(const uint8_t cPixelBytes);
+BlendFn getBlendKernel(const AlphaMode cAlpha);
+ExpandFn getExpandKernel(const uint8_t cColorType, const uint8_t cBitDepth);
+ExpandFn getConvertKernel(const uint8_t cColorType, const uint8_t cBitDepth, const PixelFormat cFormat,
+                          const AlphaMode cAlpha);
+void convertPalette(uint8_t *pPalette, const PixelFormat cFormat, const AlphaMode cAlpha);
+uint8_t getSampleChannels(const uint8_t cColorType);
+uint8_t getOutputPixelBytes(const uint8_t cColorType, const uint8_t cBitDepth);
+uint8_t getOutputPixelBytes(const uint8_t cColorType, const uint8_t cBitDepth, const PixelFormat cFormat);
+
+#endif
@@ -0,0 +1,153 @@
+#include "feed.hpp"
+
+#ifdef LESTPNG_COROUTINES
+
+/* Function:    Awaiter
+   Description: Constructs the awaiter next hands out
+   Parameters:  PngFeed* - Feed to wait on
+   Returns:     None
+ */
+PngFeed::Awaiter::Awaiter(PngFeed *pFeed) : mpFeed(pFeed)
+{
+}
+
+/* Function:    await_ready
+   Description: Parses whatever was queued or kept from earlier feeds, the coroutine only suspends if that is not
+                enough for a result
+   Parameters:  None
+   Returns:     bool - True if a result or an error is ready
+ */
+bool PngFeed::Awaiter::await_ready()
+{
+  const bool cReady = mpFeed->run(mpFeed->mQueued.data(), mpFeed->mQueued.size());
+
+  mpFeed->mQueued.clear();
+
+  if (!cReady && mpFeed->mClosed)
+  {
+    mpFeed->mError = std::make_exception_ptr(PngException("Error! Png data ended unexpectedly."));
+    return true;
+  }
+
+  return cReady;
+}
+
+/* Function:    await_suspend
+   Description: Parks the coroutine until push or close has something for it
+   Parameters:  coroutine_handle - Awaiting coroutine
+   Returns:     None
+ */
+void PngFeed::Awaiter::await_suspend(const std::coroutine_handle<> cHandle)
+{
+  mpFeed->mWaiter = cHandle;
+}
+
+/* Function:    await_resume
+   Description: Hands the result to the coroutine, an error the decode threw is rethrown in the coroutine
+   Parameters:  None
+   Returns:     Png::PushResult - Next result that is not Png::PUSH_NEED_DATA
+ */
+Png::PushResult PngFeed::Awaiter::await_resume()
+{
+  if (mpFeed->mError)
+  {
+    std::exception_ptr error = mpFeed->mError;
+
+    mpFeed->mError = nullptr;
+    std::rethrow_exception(error);
+  }
+
+  return mpFeed->mResult;
+}
+
+/* Function:    PngFeed
+   Description: Constructs a feed for a png object made for push decoding
+   Parameters:  Png* - Png object to feed, has to outlive the feed
+   Returns:     None
+ */
+PngFeed::PngFeed(Png *pPng) : mpPng(pPng), mResult{Png::PUSH_NEED_DATA, 0, 0}, mClosed(false)
+{
+}
+
+/* Function:    run
+   Description: Feeds bytes to the png object, catching what it throws so it can be rethrown in the coroutine
+   Parameters:  uint8_t* - Bytes to feed
+                size_t - Amount of bytes
+   Returns:     bool - True if there is a result or an error for the coroutine
+ */
+bool PngFeed::run(const uint8_t *cpData, const size_t cSize)
+{
+  try
+  {
+    mResult = mpPng->feed(cpData, cSize);
+  }
+  catch (...)
+  {
+    mError = std::current_exception();
+    return true;
+  }
+
+  return mResult.status != Png::PUSH_NEED_DATA;
+}
+
+/* Function:    wake
+   Description: Resumes the waiting coroutine, which may destroy the feed before it returns
+   Parameters:  None
+   Returns:     None
+ */
+void PngFeed::wake()
+{
+  const std::coroutine_handle<> cWaiter = mWaiter;
+
+  mWaiter = nullptr;
+  cWaiter.resume();
+}
+
+/* Function:    push
+   Description: Hands the next piece of the file to the decode. With a coroutine waiting it is parsed right away and
+                the coroutine resumed if that gave a result, otherwise it is queued for the next await.
+   Parameters:  uint8_t* - Bytes that arrived, only read during the call
+                size_t - Amount of bytes
+   Returns:     None
+ */
+void PngFeed::push(const uint8_t *cpData, const size_t cSize)
+{
+  if (!mWaiter)
+  {
+    mQueued.insert(mQueued.end(), cpData, cpData + cSize);
+    return;
+  }
+
+  if (run(cpData, cSize))
+  {
+    wake();
+  }
+}
+
+/* Function:    close
+   Description: Marks the end of the input, a coroutine waiting for more gets a PngException
+   Parameters:  None
+   Returns:     None
+ */
+void PngFeed::close()
+{
+  mClosed = true;
+
+  if (mWaiter)
+  {
+    mError = std::make_exception_ptr(PngException("Error! Png data ended unexpectedly."));
+    wake();
+  }
+}
+
+/* Function:    next
+   Description: Gets the awaitable for the next result of the decode
+   Parameters:  None
+   Returns:     Awaiter - co_await it for a Png::PushResult
+ */
+PngFeed::Awaiter PngFeed::next()
+{
+  return Awaiter(this);
+}
+
+#endif
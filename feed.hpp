@@ -0,0 +1,58 @@
+#ifndef FEED_HPP
+#define FEED_HPP
+
+// Only built by compilers with C++20 coroutines, make CORO=1 turns them on
+#if defined(__cpp_impl_coroutine) && (__cpp_impl_coroutine >= 201902L)
+#define LESTPNG_COROUTINES 1
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <exception>
+#include <coroutine>
+
+#include "png.hpp"
+
+/* Awaitable front end of a push decode for event loops. The I/O side hands every piece of the file to push as it
+   arrives and the decoding coroutine awaits next, which resumes it with the next feed result that is not
+   Png::PUSH_NEED_DATA. Bytes are parsed in place when the coroutine is already waiting for them and only copied while
+   it is busy, so thousands of decodes can be in flight on a few threads at the cost of one suspended frame each.
+   push, close and the awaiting coroutine have to run on the same thread, as they do on one event loop.
+ */
+class PngFeed {
+public:
+  class Awaiter {
+  public:
+    explicit Awaiter(PngFeed *pFeed);
+    bool await_ready();
+    void await_suspend(const std::coroutine_handle<> cHandle);
+    Png::PushResult await_resume();
+
+  private:
+    PngFeed *mpFeed;
+  };
+
+  explicit PngFeed(Png *pPng);
+  PngFeed(const PngFeed &) = delete;
+  PngFeed &operator=(const PngFeed &) = delete;
+  void push(const uint8_t *cpData, const size_t cSize);
+  void close();
+  Awaiter next();
+
+private:
+  bool run(const uint8_t *cpData, const size_t cSize);
+  void wake();
+
+  Png *mpPng;
+
+  // Bytes pushed while the coroutine was busy, parsed when it next awaits
+  std::vector<uint8_t> mQueued;
+  std::coroutine_handle<> mWaiter;
+  Png::PushResult mResult;
+  std::exception_ptr mError;
+  bool mClosed;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,385 @@
+#include "filter.hpp"
+#include "unfilter.hpp"
+#include "png.hpp"
+
+#include <cstring>
+#include <cstdlib>
+
+#if defined(__x86_64__) || defined(__i386__)
+  #define FILTER_X86 1
+  #include <immintrin.h>
+#endif
+
+/* Function:    paethByte
+   Description: Paeth predictor for a single byte, ties favor a over b over c
+   Parameters:  uint8_t - Byte to the left
+                uint8_t - Byte above
+                uint8_t - Byte to the upper left
+   Returns:     uint8_t - Predicted byte
+ */
+static inline uint8_t paethByte(const uint8_t cA, const uint8_t cB, const uint8_t cC)
+{
+  const int32_t cPa = abs(static_cast<int32_t>(cB) - static_cast<int32_t>(cC));
+  const int32_t cPb = abs(static_cast<int32_t>(cA) - static_cast<int32_t>(cC));
+  const int32_t cPc = abs(static_cast<int32_t>(cA) + static_cast<int32_t>(cB) - 2 * static_cast<int32_t>(cC));
+
+  if ((cPa <= cPb) && (cPa <= cPc))
+  {
+    return cA;
+  }
+  else if (cPb <= cPc)
+  {
+    return cB;
+  }
+
+  return cC;
+}
+
+/* Function:    filterHead
+   Description: Filters the first pixel of a row, where the left and upper left neighbours are zero
+   Parameters:  uint8_t - Filter type
+                uint8_t* - Filtered bytes
+                uint8_t* - Raw row
+                uint8_t* - Raw row above
+                size_t - Bytes to filter, never more than the row
+   Returns:     None
+ */
+static inline void filterHead(const uint8_t cFilter, uint8_t *pDst, const uint8_t *cpRow, const uint8_t *cpPrev,
+                              const size_t cCount)
+{
+  for (size_t i = 0; i < cCount; i ++)
+  {
+    switch (cFilter)
+    {
+      case Png::SUB:
+        pDst[i] = cpRow[i];
+        break;
+      case Png::AVERAGE:
+        pDst[i] = static_cast<uint8_t>(cpRow[i] - (cpPrev[i] >> 1));
+        break;
+      default:
+        // Up and Paeth both predict from the byte above
+        pDst[i] = static_cast<uint8_t>(cpRow[i] - cpPrev[i]);
+        break;
+    }
+  }
+}
+
+static void subScalar(uint8_t *pDst, const uint8_t *cpRow, const uint8_t *, const size_t cRowBytes,
+                      const uint8_t cBpp)
+{
+  const size_t cHead = std::min(static_cast<size_t>(cBpp), cRowBytes);
+
+  filterHead(Png::SUB, pDst, cpRow, nullptr, cHead);
+
+  for (size_t i = cHead; i < cRowBytes; i ++)
+  {
+    pDst[i] = static_cast<uint8_t>(cpRow[i] - cpRow[i - cBpp]);
+  }
+}
+
+static void upScalar(uint8_t *pDst, const uint8_t *cpRow, const uint8_t *cpPrev, const size_t cRowBytes,
+                     const uint8_t)
+{
+  for (size_t i = 0; i < cRowBytes; i ++)
+  {
+    pDst[i] = static_cast<uint8_t>(cpRow[i] - cpPrev[i]);
+  }
+}
+
+static void averageScalar(uint8_t *pDst, const uint8_t *cpRow, const uint8_t *cpPrev, const size_t cRowBytes,
+                          const uint8_t cBpp)
+{
+  const size_t cHead = std::min(static_cast<size_t>(cBpp), cRowBytes);
+
+  filterHead(Png::AVERAGE, pDst, cpRow, cpPrev, cHead);
+
+  for (size_t i = cHead; i < cRowBytes; i ++)
+  {
+    pDst[i] = static_cast<uint8_t>(cpRow[i] - ((static_cast<uint32_t>(cpRow[i - cBpp]) + cpPrev[i]) >> 1));
+  }
+}
+
+static void paethScalar(uint8_t *pDst, const uint8_t *cpRow, const uint8_t *cpPrev, const size_t cRowBytes,
+                        const uint8_t cBpp)
+{
+  const size_t cHead = std::min(static_cast<size_t>(cBpp), cRowBytes);
+
+  filterHead(Png::PAETH, pDst, cpRow, cpPrev, cHead);
+
+  for (size_t i = cHead; i < cRowBytes; i ++)
+  {
+    pDst[i] = static_cast<uint8_t>(cpRow[i] - paethByte(cpRow[i - cBpp], cpPrev[i], cpPrev[i - cBpp]));
+  }
+}
+
+static uint64_t costScalar(const uint8_t *cpFiltered, const size_t cSize)
+{
+  uint64_t cost = 0;
+
+  for (size_t i = 0; i < cSize; i ++)
+  {
+    cost += static_cast<uint64_t>(abs(static_cast<int8_t>(cpFiltered[i])));
+  }
+
+  return cost;
+}
+
+#ifdef FILTER_X86
+/* Encoding has no dependency between neighbouring outputs, every predictor reads raw bytes only, so these kernels
+   handle any pixel size with plain unaligned loads at an offset of bpp. The first pixel is done by filterHead.
+ */
+
+static void subSse2(uint8_t *pDst, const uint8_t *cpRow, const uint8_t *, const size_t cRowBytes,
+                    const uint8_t cBpp)
+{
+  size_t i = std::min(static_cast<size_t>(cBpp), cRowBytes);
+
+  filterHead(Png::SUB, pDst, cpRow, nullptr, i);
+
+  for (; i + 16 <= cRowBytes; i += 16)
+  {
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cpRow + i));
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cpRow + i - cBpp));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(pDst + i), _mm_sub_epi8(x, a));
+  }
+
+  for (; i < cRowBytes; i ++)
+  {
+    pDst[i] = static_cast<uint8_t>(cpRow[i] - cpRow[i - cBpp]);
+  }
+}
+
+static void upSse2(uint8_t *pDst, const uint8_t *cpRow, const uint8_t *cpPrev, const size_t cRowBytes,
+                   const uint8_t)
+{
+  size_t i = 0;
+
+  for (; i + 16 <= cRowBytes; i += 16)
+  {
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cpRow + i));
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cpPrev + i));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(pDst + i), _mm_sub_epi8(x, b));
+  }
+
+  for (; i < cRowBytes; i ++)
+  {
+    pDst[i] = static_cast<uint8_t>(cpRow[i] - cpPrev[i]);
+  }
+}
+
+static void averageSse2(uint8_t *pDst, const uint8_t *cpRow, const uint8_t *cpPrev, const size_t cRowBytes,
+                        const uint8_t cBpp)
+{
+  const __m128i one = _mm_set1_epi8(1);
+  size_t i = std::min(static_cast<size_t>(cBpp), cRowBytes);
+
+  filterHead(Png::AVERAGE, pDst, cpRow, cpPrev, i);
+
+  for (; i + 16 <= cRowBytes; i += 16)
+  {
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cpRow + i));
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cpRow + i - cBpp));
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cpPrev + i));
+
+    // pavgb rounds up, taking off the low bit of a ^ b turns it into the floor the filter needs
+    const __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(pDst + i), _mm_sub_epi8(x, avg));
+  }
+
+  for (; i < cRowBytes; i ++)
+  {
+    pDst[i] = static_cast<uint8_t>(cpRow[i] - ((static_cast<uint32_t>(cpRow[i - cBpp]) + cpPrev[i]) >> 1));
+  }
+}
+
+/* Function:    paethHalf
+   Description: Paeth predictor for 8 bytes widened to 16 bit lanes
+ */
+static inline __m128i paethHalf(const __m128i cA, const __m128i cB, const __m128i cC)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i cPaSigned = _mm_sub_epi16(cB, cC);
+  const __m128i cPbSigned = _mm_sub_epi16(cA, cC);
+  const __m128i cPcSigned = _mm_add_epi16(cPaSigned, cPbSigned);
+  const __m128i cPa = _mm_max_epi16(cPaSigned, _mm_sub_epi16(zero, cPaSigned));
+  const __m128i cPb = _mm_max_epi16(cPbSigned, _mm_sub_epi16(zero, cPbSigned));
+  const __m128i cPc = _mm_max_epi16(cPcSigned, _mm_sub_epi16(zero, cPcSigned));
+  const __m128i cSmallest = _mm_min_epi16(cPc, _mm_min_epi16(cPa, cPb));
+  const __m128i cUseA = _mm_cmpeq_epi16(cSmallest, cPa);
+  const __m128i cUseB = _mm_cmpeq_epi16(cSmallest, cPb);
+  const __m128i cBOrC = _mm_or_si128(_mm_and_si128(cUseB, cB), _mm_andnot_si128(cUseB, cC));
+
+  return _mm_or_si128(_mm_and_si128(cUseA, cA), _mm_andnot_si128(cUseA, cBOrC));
+}
+
+static void paethSse2(uint8_t *pDst, const uint8_t *cpRow, const uint8_t *cpPrev, const size_t cRowBytes,
+                      const uint8_t cBpp)
+{
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = std::min(static_cast<size_t>(cBpp), cRowBytes);
+
+  filterHead(Png::PAETH, pDst, cpRow, cpPrev, i);
+
+  for (; i + 16 <= cRowBytes; i += 16)
+  {
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cpRow + i));
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cpRow + i - cBpp));
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cpPrev + i));
+    const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cpPrev + i - cBpp));
+    const __m128i lo = paethHalf(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero),
+                                 _mm_unpacklo_epi8(c, zero));
+    const __m128i hi = paethHalf(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero),
+                                 _mm_unpackhi_epi8(c, zero));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(pDst + i), _mm_sub_epi8(x, _mm_packus_epi16(lo, hi)));
+  }
+
+  for (; i < cRowBytes; i ++)
+  {
+    pDst[i] = static_cast<uint8_t>(cpRow[i] - paethByte(cpRow[i - cBpp], cpPrev[i], cpPrev[i - cBpp]));
+  }
+}
+
+/* Function:    costSse2
+   Description: Sum of absolute values of the filtered bytes read as signed. min(x, -x) taken unsigned is |x| for
+                every signed byte, psadbw against zero then sums 8 of those at a time.
+ */
+static uint64_t costSse2(const uint8_t *cpFiltered, const size_t cSize)
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i sum = zero;
+  size_t i = 0;
+
+  for (; i + 16 <= cSize; i += 16)
+  {
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cpFiltered + i));
+
+    sum = _mm_add_epi64(sum, _mm_sad_epu8(_mm_min_epu8(x, _mm_sub_epi8(zero, x)), zero));
+  }
+
+  const uint64_t cVector = static_cast<uint64_t>(_mm_cvtsi128_si32(sum)) +
+                           static_cast<uint64_t>(_mm_cvtsi128_si32(_mm_srli_si128(sum, 8)));
+
+  return cVector + costScalar(cpFiltered + i, cSize - i);
+}
+#endif
+
+static const FilterFn cScalarFilters[FILTER_TYPES] = {nullptr, subScalar, upScalar, averageScalar, paethScalar};
+
+#ifdef FILTER_X86
+static const FilterFn cSse2Filters[FILTER_TYPES] = {nullptr, subSse2, upSse2, averageSse2, paethSse2};
+#endif
+
+/* Function:    filtersFor
+   Description: Picks the filter kernels for the instruction set level the unfilter kernels are restricted to, so
+                one setting controls both directions
+   Parameters:  None
+   Returns:     FilterFn* - One kernel per filter type, None has no kernel
+ */
+static const FilterFn *filtersFor()
+{
+#ifdef FILTER_X86
+  if (getUnfilterSimdLevel() >= SIMD_SSE2)
+    return cSse2Filters;
+#endif
+
+  return cScalarFilters;
+}
+
+/* Function:    filterCost
+   Description: Minimum sum of absolute differences heuristic, the filtered bytes are read as signed values and the
+                row with the smallest sum usually compresses best
+   Parameters:  uint8_t* - Filtered bytes
+                size_t - Number of bytes
+   Returns:     uint64_t - Sum of the absolute values
+ */
+uint64_t filterCost(const uint8_t *cpFiltered, const size_t cSize)
+{
+#ifdef FILTER_X86
+  if (getUnfilterSimdLevel() >= SIMD_SSE2)
+    return costSse2(cpFiltered, cSize);
+#endif
+
+  return costScalar(cpFiltered, cSize);
+}
+
+/* Function:    filterRow
+   Description: Applies one filter type to a raw scanline
+   Parameters:  uint8_t - Filter type
+                uint8_t* - Receives the filtered bytes
+                uint8_t* - Raw row
+                uint8_t* - Raw row above, all zeros for the first row
+                size_t - Bytes in the row
+                uint8_t - Bytes per complete pixel, rounded up to 1 for bit depths below 8
+   Returns:     Status - FAIL for an unknown filter type
+ */
+Status filterRow(const uint8_t cFilter, uint8_t *pDst, const uint8_t *cpRow, const uint8_t *cpPrev,
+                 const size_t cRowBytes, const uint8_t cBpp)
+{
+  if (cFilter >= FILTER_TYPES)
+  {
+    return FAIL;
+  }
+
+  if (cFilter == Png::NONE)
+  {
+    memcpy(pDst, cpRow, cRowBytes);
+    return SUCCESS;
+  }
+
+  filtersFor()[cFilter](pDst, cpRow, cpPrev, cRowBytes, cBpp);
+
+  return SUCCESS;
+}
+
+/* Function:    filterRowAdaptive
+   Description: Tries every filter type on a scanline and keeps the one with the lowest filterCost, the same
+                heuristic libpng uses by default. Stops early on a row that filters to all zeros.
+   Parameters:  uint8_t* - Receives the filtered bytes of the chosen filter
+                uint8_t* - Scratch space of one row
+                uint8_t* - Raw row
+                uint8_t* - Raw row above, all zeros for the first row
+                size_t - Bytes in the row
+                uint8_t - Bytes per complete pixel, rounded up to 1 for bit depths below 8
+   Returns:     uint8_t - Chosen filter type
+ */
+uint8_t filterRowAdaptive(uint8_t *pDst, uint8_t *pScratch, const uint8_t *cpRow, const uint8_t *cpPrev,
+                          const size_t cRowBytes, const uint8_t cBpp)
+{
+  const FilterFn *cpFilters = filtersFor();
+  uint8_t *pBest = nullptr;
+  uint8_t *pTry = pDst;
+  uint8_t bestFilter = Png::NONE;
+  uint64_t bestCost = filterCost(cpRow, cRowBytes);
+
+  for (uint8_t filter = Png::SUB; (filter < FILTER_TYPES) && (bestCost > 0); filter ++)
+  {
+    cpFilters[filter](pTry, cpRow, cpPrev, cRowBytes, cBpp);
+
+    const uint64_t cCost = filterCost(pTry, cRowBytes);
+
+    if (cCost < bestCost)
+    {
+      // The winner stays where it is and the next filter goes into the other buffer
+      bestCost = cCost;
+      bestFilter = filter;
+      pBest = pTry;
+      pTry = (pTry == pDst) ? pScratch : pDst;
+    }
+  }
+
+  if (pBest == nullptr)
+  {
+    memcpy(pDst, cpRow, cRowBytes);
+  }
+  else if (pBest != pDst)
+  {
+    memcpy(pDst, pBest, cRowBytes);
+  }
+
+  return bestFilter;
+}
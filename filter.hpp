@@ -0,0 +1,21 @@
+#ifndef FILTER_HPP
+#define FILTER_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+#include "common.hpp"
+
+/* Forward filters for encoding, the inverse of the unfilter kernels. cpRow holds the raw scanline, cpPrev the raw
+   scanline above it (all zeros for the first row) and pDst receives the filtered bytes without the filter type byte.
+ */
+typedef void (*FilterFn)(uint8_t *pDst, const uint8_t *cpRow, const uint8_t *cpPrev, const size_t cRowBytes,
+                         const uint8_t cBpp);
+
+Status filterRow(const uint8_t cFilter, uint8_t *pDst, const uint8_t *cpRow, const uint8_t *cpPrev,
+                 const size_t cRowBytes, const uint8_t cBpp);
+uint8_t filterRowAdaptive(uint8_t *pDst, uint8_t *pScratch, const uint8_t *cpRow, const uint8_t *cpPrev,
+                          const size_t cRowBytes, const uint8_t cBpp);
+uint64_t filterCost(const uint8_t *cpFiltered, const size_t cSize);
+
+#endif
@@ -0,0 +1,1320 @@
+#include "inflater.hpp"
+
+#include <cstring>
+#include <algorithm>
+
+/* WINDOW_BITS = 47 since this tells zlib to automatically check if
+   gzip or zlib header exists in decompressed data
+*/
+#define WINDOW_BITS 47
+
+// Negative window bits make zlib read raw deflate data
+#define RAW_WINDOW_BITS -15
+
+#define LITLEN_BITS   11
+#define DIST_BITS     8
+#define CODELEN_BITS  7
+#define MAX_CODE_BITS 15
+#define MAX_MATCH     258
+#define HISTORY_SIZE  32768
+
+// Largest tables a code can need, the primary table plus a subtable of the longest code for every long symbol.
+// Reserved up front so decoding dynamic blocks never allocates.
+#define LITLEN_TABLE_MAX  ((1u << LITLEN_BITS) + (286u << (MAX_CODE_BITS - LITLEN_BITS)))
+#define DIST_TABLE_MAX    ((1u << DIST_BITS) + (30u << (MAX_CODE_BITS - DIST_BITS)))
+#define CODELEN_TABLE_MAX (1u << CODELEN_BITS)
+
+// Output window, decoding stops MAX_MATCH short of the end and wide match copies may run WINDOW_SLACK past it
+#define WINDOW_SIZE   (256 * 1024)
+#define WINDOW_SLACK  32
+
+// Bytes of a new call appended behind the left over bytes of the previous call at a time
+#define TAIL_APPEND   4096
+
+/* Table entries are packed as kind (4 bits), bits consumed (4 bits) and a 24 bit payload:
+   literal  - the byte
+   double   - first byte, second byte
+   length   - extra bit count (4 bits), base length or distance
+   link     - subtable index bits (4 bits), subtable offset
+ */
+#define ENTRY_LITERAL 0
+#define ENTRY_DOUBLE  1
+#define ENTRY_LENGTH  2
+#define ENTRY_END     3
+#define ENTRY_LINK    4
+#define ENTRY_INVALID 5
+
+static const uint16_t cLengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67,
+                                         83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t cLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5,
+                                         5, 5, 0};
+static const uint16_t cDistBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+                                       1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t cDistExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11,
+                                       12, 12, 13, 13};
+static const uint8_t cCodeLengthOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+/* Function:    makeEntry
+   Description: Packs a table entry
+   Parameters:  uint32_t - Kind, one of the ENTRY_ values
+                uint32_t - Bits the code of the entry takes
+                uint32_t - Payload of the kind
+   Returns:     uint32_t - Entry
+ */
+static inline uint32_t makeEntry(const uint32_t cKind, const uint32_t cBits, const uint32_t cPayload)
+{
+  return cKind | (cBits << 4) | (cPayload << 8);
+}
+
+/* Function:    entryKind
+   Description: Gets the kind of a table entry
+   Parameters:  uint32_t - Entry
+   Returns:     uint32_t - One of the ENTRY_ values
+ */
+static inline uint32_t entryKind(const uint32_t cEntry)
+{
+  return cEntry & 0xF;
+}
+
+/* Function:    entryBits
+   Description: Gets the bits the code of a table entry takes, for a link the primary index bits
+   Parameters:  uint32_t - Entry
+   Returns:     uint32_t - Bit count
+ */
+static inline uint32_t entryBits(const uint32_t cEntry)
+{
+  return (cEntry >> 4) & 0xF;
+}
+
+/* Function:    entryPayload
+   Description: Gets the payload of a table entry, its layout depends on the kind
+   Parameters:  uint32_t - Entry
+   Returns:     uint32_t - 24 bit payload
+ */
+static inline uint32_t entryPayload(const uint32_t cEntry)
+{
+  return cEntry >> 8;
+}
+
+/* Function:    lowBits
+   Description: Masks the lowest bits of the bit buffer, deflate packs values starting at the least significant bit
+   Parameters:  uint64_t - Bit buffer
+                uint32_t - Bits to keep, below 64
+   Returns:     uint64_t - Lowest bits
+ */
+static inline uint64_t lowBits(const uint64_t cBits, const uint32_t cCount)
+{
+  return cBits & ((static_cast<uint64_t>(1) << cCount) - 1);
+}
+
+/* Function:    litlenEntry
+   Description: Gets the table entry for a literal/length symbol, without the bit count
+   Parameters:  uint32_t - Symbol
+   Returns:     uint32_t - Entry
+ */
+static uint32_t litlenEntry(const uint32_t cSymbol)
+{
+  if (cSymbol < 256)
+  {
+    return makeEntry(ENTRY_LITERAL, 0, cSymbol);
+  }
+
+  if (cSymbol == 256)
+  {
+    return makeEntry(ENTRY_END, 0, 0);
+  }
+
+  if (cSymbol < 286)
+  {
+    return makeEntry(ENTRY_LENGTH, 0, cLengthExtra[cSymbol - 257] | (cLengthBase[cSymbol - 257] << 4));
+  }
+
+  return makeEntry(ENTRY_INVALID, 0, 0);
+}
+
+/* Function:    distEntry
+   Description: Gets the table entry for a distance symbol, without the bit count
+   Parameters:  uint32_t - Symbol
+   Returns:     uint32_t - Entry
+ */
+static uint32_t distEntry(const uint32_t cSymbol)
+{
+  if (cSymbol < 30)
+  {
+    return makeEntry(ENTRY_LENGTH, 0, cDistExtra[cSymbol] | (cDistBase[cSymbol] << 4));
+  }
+
+  return makeEntry(ENTRY_INVALID, 0, 0);
+}
+
+/* Function:    codeLengthEntry
+   Description: Gets the table entry for a code length code symbol, without the bit count
+   Parameters:  uint32_t - Symbol
+   Returns:     uint32_t - Entry
+ */
+static uint32_t codeLengthEntry(const uint32_t cSymbol)
+{
+  return makeEntry(ENTRY_LITERAL, 0, cSymbol);
+}
+
+/* Function:    buildTable
+   Description: Builds a lookup table for a canonical Huffman code. Codes up to cTableBits long are replicated over
+                the primary table, longer ones go into subtables linked from the primary entry of their prefix.
+                Deflate sends codes most significant bit first, so table indices are the bit reversed codes.
+   Parameters:  uint8_t* - Code length of every symbol
+                uint32_t - Number of symbols
+                uint32_t - Primary table index bits
+                function - Maps a symbol to its entry
+                std::vector<uint32_t> - Filled with the table
+   Returns:     bool - False if the code lengths are over subscribed
+ */
+static bool buildTable(const uint8_t *cpLengths, const uint32_t cCount, const uint32_t cTableBits,
+                       uint32_t (*pEntryFor)(const uint32_t), std::vector<uint32_t> &rTable)
+{
+  uint32_t count[MAX_CODE_BITS + 1] = {0};
+  uint32_t nextCode[MAX_CODE_BITS + 1] = {0};
+  uint16_t reversed[288];
+  const uint32_t cSize = 1u << cTableBits;
+  uint8_t subBits[1u << LITLEN_BITS];
+  int32_t left = 1;
+  uint32_t code = 0;
+
+  for (uint32_t sym = 0; sym < cCount; sym ++)
+  {
+    count[cpLengths[sym]] ++;
+  }
+
+  count[0] = 0;
+
+  for (uint32_t len = 1; len <= MAX_CODE_BITS; len ++)
+  {
+    left = (left << 1) - static_cast<int32_t>(count[len]);
+
+    if (left < 0)
+    {
+      return false;
+    }
+  }
+
+  for (uint32_t len = 1; len <= MAX_CODE_BITS; len ++)
+  {
+    code = (code + count[len - 1]) << 1;
+    nextCode[len] = code;
+  }
+
+  memset(subBits, 0, cSize);
+  rTable.assign(cSize, makeEntry(ENTRY_INVALID, 0, 0));
+
+  for (uint32_t sym = 0; sym < cCount; sym ++)
+  {
+    const uint32_t cLen = cpLengths[sym];
+    uint32_t rev = 0;
+
+    if (cLen == 0)
+    {
+      continue;
+    }
+
+    code = nextCode[cLen] ++;
+
+    for (uint32_t bit = 0; bit < cLen; bit ++)
+    {
+      rev |= ((code >> bit) & 1) << (cLen - 1 - bit);
+    }
+
+    reversed[sym] = static_cast<uint16_t>(rev);
+
+    if (cLen <= cTableBits)
+    {
+      for (uint32_t i = rev; i < cSize; i += (1u << cLen))
+      {
+        rTable[i] = pEntryFor(sym) | (cLen << 4);
+      }
+    }
+    else
+    {
+      const uint32_t cPrefix = rev & (cSize - 1);
+      subBits[cPrefix] = std::max<uint8_t>(subBits[cPrefix], static_cast<uint8_t>(cLen - cTableBits));
+    }
+  }
+
+  for (uint32_t prefix = 0; prefix < cSize; prefix ++)
+  {
+    if (subBits[prefix] != 0)
+    {
+      const uint32_t cOffset = static_cast<uint32_t>(rTable.size());
+
+      rTable.resize(cOffset + (1u << subBits[prefix]), makeEntry(ENTRY_INVALID, 0, 0));
+      rTable[prefix] = makeEntry(ENTRY_LINK, cTableBits, subBits[prefix] | (cOffset << 4));
+    }
+  }
+
+  for (uint32_t sym = 0; sym < cCount; sym ++)
+  {
+    const uint32_t cLen = cpLengths[sym];
+
+    if (cLen <= cTableBits)
+    {
+      continue;
+    }
+
+    const uint32_t cLink = rTable[reversed[sym] & (cSize - 1)];
+    const uint32_t cSubBits = entryPayload(cLink) & 0xF;
+    const uint32_t cOffset = entryPayload(cLink) >> 4;
+    const uint32_t cRest = cLen - cTableBits;
+
+    for (uint32_t i = reversed[sym] >> cTableBits; i < (1u << cSubBits); i += (1u << cRest))
+    {
+      rTable[cOffset + i] = pEntryFor(sym) | (cRest << 4);
+    }
+  }
+
+  return true;
+}
+
+/* Function:    pairLiterals
+   Description: Turns primary literal entries whose code leaves room for a second literal code into double entries,
+                so runs of literals decode two bytes per lookup. The second code of entry i sits at an index below i,
+                so going down the table only ever reads entries that are still single.
+   Parameters:  std::vector<uint32_t> - Literal/length table built by buildTable
+   Returns:     None
+ */
+static void pairLiterals(std::vector<uint32_t> &rTable)
+{
+  for (uint32_t i = 1u << LITLEN_BITS; i -- > 0; )
+  {
+    const uint32_t cFirst = rTable[i];
+    const uint32_t cFirstBits = entryBits(cFirst);
+
+    if (entryKind(cFirst) != ENTRY_LITERAL || cFirstBits >= LITLEN_BITS)
+    {
+      continue;
+    }
+
+    const uint32_t cSecond = rTable[i >> cFirstBits];
+    const uint32_t cTotal = cFirstBits + entryBits(cSecond);
+
+    if (entryKind(cSecond) == ENTRY_LITERAL && cTotal <= LITLEN_BITS)
+    {
+      rTable[i] = makeEntry(ENTRY_DOUBLE, cTotal, entryPayload(cFirst) | (entryPayload(cSecond) << 8));
+    }
+  }
+}
+
+/* Function:    zlibAllocate
+   Description: zlib allocation callback that forwards to the allocator hook
+   Parameters:  voidpf - PngAllocator of the backend
+                uInt - Number of items
+                uInt - Size of one item
+   Returns:     voidpf - Allocated memory, Z_NULL on failure
+ */
+static voidpf zlibAllocate(voidpf pOpaque, uInt cItems, uInt cSize)
+{
+  const PngAllocator *cpAllocator = static_cast<const PngAllocator *>(pOpaque);
+
+  return cpAllocator->allocate(cpAllocator->pOpaque, static_cast<size_t>(cItems) * cSize);
+}
+
+/* Function:    zlibRelease
+   Description: zlib free callback that forwards to the allocator hook
+   Parameters:  voidpf - PngAllocator of the backend
+                voidpf - Memory to free
+   Returns:     None
+ */
+static void zlibRelease(voidpf pOpaque, voidpf pData)
+{
+  const PngAllocator *cpAllocator = static_cast<const PngAllocator *>(pOpaque);
+
+  cpAllocator->release(cpAllocator->pOpaque, pData);
+}
+
+/* Function:    ZlibInflater
+   Description: Constructs zlib backend, the stream is set up on reset
+   Parameters:  None
+   Returns:     None
+ */
+ZlibInflater::ZlibInflater() : mStreamInit(false)
+{
+  memset(&mStream, 0, sizeof(mStream));
+}
+
+/* Function:    ~ZlibInflater
+   Description: Destroys zlib backend, freeing the stream if it was set up
+   Parameters:  None
+   Returns:     None
+ */
+ZlibInflater::~ZlibInflater()
+{
+  if (mStreamInit)
+  {
+    inflateEnd(&mStream);
+  }
+}
+
+/* Function:    reset
+   Description: Starts a new zlib or raw deflate stream, reusing the allocations of the previous one
+   Parameters:  None
+   Returns:     Status - FAIL if zlib could not be initialized
+ */
+Status ZlibInflater::reset()
+{
+  int error = Z_OK;
+
+  if (mStreamInit)
+  {
+    error = inflateReset2(&mStream, mRaw ? RAW_WINDOW_BITS : WINDOW_BITS);
+  }
+  else
+  {
+    mStream.zalloc = (mAllocator.allocate != nullptr) ? zlibAllocate : Z_NULL;
+    mStream.zfree = (mAllocator.allocate != nullptr) ? zlibRelease : Z_NULL;
+    mStream.opaque = (mAllocator.allocate != nullptr) ? &mAllocator : Z_NULL;
+    mStream.avail_in = 0;
+    mStream.next_in = Z_NULL;
+    error = inflateInit2(&mStream, mRaw ? RAW_WINDOW_BITS : WINDOW_BITS);
+    mStreamInit = (error == Z_OK);
+  }
+
+  if (error != Z_OK)
+  {
+    mError = "ZLIB initialization returned error: " + std::to_string(error);
+    return FAIL;
+  }
+
+  return SUCCESS;
+}
+
+/* Function:    inflate
+   Description: Runs zlib's inflate over as much input and output as it can use
+   Parameters:  uint8_t* - Compressed input, advanced past what was consumed
+                size_t - Bytes of input, reduced by what was consumed
+                uint8_t* - Output, advanced past what was produced
+                size_t - Space in the output, reduced by what was produced
+   Returns:     InflateStatus - INFLATE_STREAM_END after the last byte of the stream
+ */
+InflateStatus ZlibInflater::inflate(const uint8_t *&rpIn, size_t &rInSize, uint8_t *&rpOut, size_t &rOutSize)
+{
+  const uInt cInSize = static_cast<uInt>(std::min<size_t>(rInSize, UINT32_MAX));
+  const uInt cOutSize = static_cast<uInt>(std::min<size_t>(rOutSize, UINT32_MAX));
+  int error = Z_OK;
+
+  mStream.next_in = const_cast<Bytef *>(rpIn);
+  mStream.avail_in = cInSize;
+  mStream.next_out = rpOut;
+  mStream.avail_out = cOutSize;
+  error = ::inflate(&mStream, Z_NO_FLUSH);
+
+  rpIn += cInSize - mStream.avail_in;
+  rInSize -= cInSize - mStream.avail_in;
+  rpOut += cOutSize - mStream.avail_out;
+  rOutSize -= cOutSize - mStream.avail_out;
+
+  if (error == Z_NEED_DICT || error == Z_DATA_ERROR || error == Z_MEM_ERROR || error == Z_STREAM_ERROR)
+  {
+    mError = "ZLIB decompression returned error: " + std::to_string(error);
+    return INFLATE_ERROR;
+  }
+
+  return (error == Z_STREAM_END) ? INFLATE_STREAM_END : INFLATE_OK;
+}
+
+/* Function:    name
+   Description: Getter function for the name of the backend
+   Parameters:  None
+   Returns:     char* - Name used in benchmark and stats output
+ */
+const char *ZlibInflater::name() const
+{
+  return "zlib";
+}
+
+/* Function:    FastInflater
+   Description: Constructs the in tree inflater and builds the fixed Huffman tables once
+   Parameters:  None
+   Returns:     None
+ */
+FastInflater::FastInflater() : mWindow(WINDOW_SIZE + WINDOW_SLACK, 0)
+{
+  uint8_t lengths[288];
+
+  mLitlen.reserve(LITLEN_TABLE_MAX);
+  mDist.reserve(DIST_TABLE_MAX);
+  mCodeLengthTable.reserve(CODELEN_TABLE_MAX);
+  memset(lengths, 8, 144);
+  memset(lengths + 144, 9, 112);
+  memset(lengths + 256, 7, 24);
+  memset(lengths + 280, 8, 8);
+  buildTable(lengths, 288, LITLEN_BITS, litlenEntry, mFixedLitlen);
+  pairLiterals(mFixedLitlen);
+
+  memset(lengths, 5, 32);
+  buildTable(lengths, 32, DIST_BITS, distEntry, mFixedDist);
+
+  reset();
+}
+
+/* Function:    reset
+   Description: Starts a new zlib stream, or a raw deflate stream that begins with a block header
+   Parameters:  None
+   Returns:     Status - Always SUCCESS
+ */
+Status FastInflater::reset()
+{
+  mpIn = nullptr;
+  mpInEnd = nullptr;
+  mBits = 0;
+  mBitCount = 0;
+  mTail.clear();
+  mTailOwn = 0;
+  mCallerAppended = 0;
+  mpCallerIn = nullptr;
+  mCallerSize = 0;
+  mInTail = false;
+  mState = mRaw ? STATE_BLOCK_HEADER : STATE_ZLIB_HEADER;
+  mFinalBlock = false;
+  mStoredLeft = 0;
+  mAdler = adler32(0, Z_NULL, 0);
+  mExpectedAdler = 0;
+  mpLitlen = &mFixedLitlen;
+  mpDist = &mFixedDist;
+  mOutRead = 0;
+  mOutEnd = 0;
+  mError.clear();
+
+  return SUCCESS;
+}
+
+/* Function:    name
+   Description: Getter function for the name of the backend
+   Parameters:  None
+   Returns:     char* - Name used in benchmark and stats output
+ */
+const char *FastInflater::name() const
+{
+  return "fast";
+}
+
+/* Function:    error
+   Description: Records an error, the stream can not be used again until reset
+   Parameters:  std::string - Error message
+   Returns:     Progress - Always PROGRESS_ERROR
+ */
+FastInflater::Progress FastInflater::error(const std::string &crError)
+{
+  mError = crError;
+  mState = STATE_ERROR;
+  return PROGRESS_ERROR;
+}
+
+/* Function:    needBits
+   Description: Fills the bit buffer for the careful bit reader used outside of the fast loop. Bytes are pulled in
+                one at a time, so it never reads past the end of the input and a decode step can be rolled back
+                when the input runs out part way through it.
+   Parameters:  uint32_t - Bits needed in the bit buffer
+   Returns:     bool - False if the input ran out first
+ */
+bool FastInflater::needBits(const uint32_t cCount)
+{
+  while (mBitCount < cCount)
+  {
+    if (mpIn == mpInEnd)
+    {
+      return false;
+    }
+
+    mBits |= static_cast<uint64_t>(*mpIn ++) << mBitCount;
+    mBitCount += 8;
+  }
+
+  return true;
+}
+
+/* Function:    takeBits
+   Description: Takes bits out of the bit buffer, needBits has to have made sure they are there
+   Parameters:  uint32_t - Bits to take
+   Returns:     uint32_t - Value of the bits
+ */
+uint32_t FastInflater::takeBits(const uint32_t cCount)
+{
+  const uint32_t cValue = static_cast<uint32_t>(lowBits(mBits, cCount));
+
+  mBits >>= cCount;
+  mBitCount -= cCount;
+
+  return cValue;
+}
+
+/* Function:    rollBack
+   Description: Puts the bit reader back to where a step started once the input ran out part way through it
+   Parameters:  BitState - Bit reader at the start of the step
+   Returns:     Progress - Always PROGRESS_NEED_INPUT
+ */
+FastInflater::Progress FastInflater::rollBack(const BitState &crSaved)
+{
+  mpIn = crSaved.cpIn;
+  mBits = crSaved.bits;
+  mBitCount = crSaved.bitCount;
+  return PROGRESS_NEED_INPUT;
+}
+
+/* Function:    readZlibHeader
+   Description: Checks the two byte zlib header, png streams never use a preset dictionary
+   Parameters:  None
+   Returns:     Progress - PROGRESS_NEED_INPUT if fewer than two bytes are available
+ */
+FastInflater::Progress FastInflater::readZlibHeader()
+{
+  uint32_t cmf = 0;
+  uint32_t flg = 0;
+
+  if (!needBits(16))
+  {
+    return PROGRESS_NEED_INPUT;
+  }
+
+  cmf = takeBits(8);
+  flg = takeBits(8);
+
+  if ((cmf & 0x0F) != 8 || (cmf >> 4) > 7 || (((cmf << 8) | flg) % 31) != 0 || (flg & 0x20) != 0)
+  {
+    return error("Invalid zlib header");
+  }
+
+  mState = STATE_BLOCK_HEADER;
+  return PROGRESS_MORE;
+}
+
+/* Function:    readBlockHeader
+   Description: Reads a deflate block header, including the code length tables of a dynamic block. If the input
+                runs out part way through, everything is rolled back to the start of the header.
+   Parameters:  None
+   Returns:     Progress - PROGRESS_NEED_INPUT if the header is not complete yet
+ */
+FastInflater::Progress FastInflater::readBlockHeader()
+{
+  const BitState cSaved = {mpIn, mBits, mBitCount};
+  Progress progress = PROGRESS_MORE;
+  uint32_t header = 0;
+  uint32_t len = 0;
+  uint32_t nlen = 0;
+
+  if (!needBits(3))
+  {
+    return rollBack(cSaved);
+  }
+
+  header = takeBits(3);
+  mFinalBlock = (header & 1) != 0;
+
+  switch (header >> 1)
+  {
+    case 0:
+      takeBits(mBitCount & 7);
+
+      if (!needBits(32))
+      {
+        return rollBack(cSaved);
+      }
+
+      len = takeBits(16);
+      nlen = takeBits(16);
+
+      if ((len ^ 0xFFFF) != nlen)
+      {
+        return error("Invalid stored block lengths");
+      }
+
+      mStoredLeft = len;
+      mState = STATE_STORED;
+      return PROGRESS_MORE;
+    case 1:
+      mpLitlen = &mFixedLitlen;
+      mpDist = &mFixedDist;
+      mState = STATE_HUFFMAN;
+      return PROGRESS_MORE;
+    case 2:
+      progress = readDynamicTables();
+
+      if (progress == PROGRESS_NEED_INPUT)
+      {
+        return rollBack(cSaved);
+      }
+
+      return progress;
+    default:
+      return error("Invalid block type");
+  }
+}
+
+/* Function:    readDynamicTables
+   Description: Reads the code length code and the literal/length and distance code lengths of a dynamic block and
+                builds their tables
+   Parameters:  None
+   Returns:     Progress - PROGRESS_NEED_INPUT if the tables are not complete yet, the caller rolls back
+ */
+FastInflater::Progress FastInflater::readDynamicTables()
+{
+  uint8_t lengths[320] = {0};
+  uint8_t codeLengths[19] = {0};
+  uint32_t hlit = 0;
+  uint32_t hdist = 0;
+  uint32_t hclen = 0;
+  uint32_t count = 0;
+
+  if (!needBits(14))
+  {
+    return PROGRESS_NEED_INPUT;
+  }
+
+  hlit = takeBits(5) + 257;
+  hdist = takeBits(5) + 1;
+  hclen = takeBits(4) + 4;
+
+  if (hlit > 286 || hdist > 30)
+  {
+    return error("Invalid dynamic block code counts");
+  }
+
+  for (uint32_t i = 0; i < hclen; i ++)
+  {
+    if (!needBits(3))
+    {
+      return PROGRESS_NEED_INPUT;
+    }
+
+    codeLengths[cCodeLengthOrder[i]] = static_cast<uint8_t>(takeBits(3));
+  }
+
+  if (!buildTable(codeLengths, 19, CODELEN_BITS, codeLengthEntry, mCodeLengthTable))
+  {
+    return error("Invalid code length code");
+  }
+
+  while (count < hlit + hdist)
+  {
+    uint32_t entry = 0;
+    uint32_t symbol = 0;
+    uint32_t repeat = 0;
+    uint32_t repeatBits = 7;
+    uint8_t value = 0;
+
+    // The code may be shorter than the table index, only fail if the bits it needs are missing
+    while (mBitCount < CODELEN_BITS && mpIn != mpInEnd)
+    {
+      mBits |= static_cast<uint64_t>(*mpIn ++) << mBitCount;
+      mBitCount += 8;
+    }
+
+    entry = mCodeLengthTable[lowBits(mBits, CODELEN_BITS)];
+
+    if (entryKind(entry) == ENTRY_INVALID)
+    {
+      return error("Invalid code length symbol");
+    }
+
+    if (entryBits(entry) > mBitCount)
+    {
+      return PROGRESS_NEED_INPUT;
+    }
+
+    takeBits(entryBits(entry));
+    symbol = entryPayload(entry);
+
+    if (symbol < 16)
+    {
+      lengths[count ++] = static_cast<uint8_t>(symbol);
+      continue;
+    }
+
+    if (symbol == 16)
+    {
+      if (count == 0)
+      {
+        return error("Repeated code length without a previous length");
+      }
+
+      repeatBits = 2;
+      value = lengths[count - 1];
+    }
+    else if (symbol == 17)
+    {
+      repeatBits = 3;
+    }
+
+    if (!needBits(repeatBits))
+    {
+      return PROGRESS_NEED_INPUT;
+    }
+
+    // 16 and 17 repeat 3 or more times, 18 repeats 11 or more zeros
+    repeat = takeBits(repeatBits) + ((symbol == 18) ? 11 : 3);
+
+    if (count + repeat > hlit + hdist)
+    {
+      return error("Code lengths run past the end of the tables");
+    }
+
+    memset(lengths + count, value, repeat);
+    count += repeat;
+  }
+
+  if (lengths[256] == 0)
+  {
+    return error("Dynamic block has no end of block code");
+  }
+
+  if (!buildTable(lengths, hlit, LITLEN_BITS, litlenEntry, mLitlen) ||
+      !buildTable(lengths + hlit, hdist, DIST_BITS, distEntry, mDist))
+  {
+    return error("Invalid literal/length or distance code");
+  }
+
+  pairLiterals(mLitlen);
+  mpLitlen = &mLitlen;
+  mpDist = &mDist;
+  mState = STATE_HUFFMAN;
+  return PROGRESS_MORE;
+}
+
+/* Function:    copyStored
+   Description: Copies the bytes of a stored block into the window, as many as the input and window allow
+   Parameters:  None
+   Returns:     Progress - PROGRESS_NEED_INPUT once the input is used up
+ */
+FastInflater::Progress FastInflater::copyStored()
+{
+  while (mStoredLeft > 0)
+  {
+    const size_t cSpace = WINDOW_SIZE - mOutEnd;
+    size_t count = 0;
+
+    if (cSpace == 0)
+    {
+      return PROGRESS_MORE;
+    }
+
+    // The header was byte aligned, so whole bytes may still be waiting in the bit buffer
+    if (mBitCount >= 8)
+    {
+      mWindow[mOutEnd ++] = static_cast<uint8_t>(mBits);
+      mBits >>= 8;
+      mBitCount -= 8;
+      mStoredLeft --;
+      continue;
+    }
+
+    if (mpIn == mpInEnd)
+    {
+      return PROGRESS_NEED_INPUT;
+    }
+
+    // Bits above the count may be read ahead copies of the bytes about to be copied, they must not come back
+    mBits = 0;
+    count = std::min<size_t>(std::min<size_t>(cSpace, mStoredLeft), static_cast<size_t>(mpInEnd - mpIn));
+    memcpy(mWindow.data() + mOutEnd, mpIn, count);
+    mpIn += count;
+    mOutEnd += count;
+    mStoredLeft -= static_cast<uint32_t>(count);
+  }
+
+  mState = mFinalBlock ? STATE_CHECKSUM : STATE_BLOCK_HEADER;
+  return PROGRESS_MORE;
+}
+
+/* Function:    decodeHuffman
+   Description: Decodes literal/length and distance symbols of a Huffman block into the window. The fast variant
+                refills 8 bytes at once and needs at least 8 bytes of input left, which guarantees the 48 bits of
+                the longest symbol after every refill. The safe variant checks every bit and rolls a symbol back
+                when the input ends inside it.
+   Parameters:  None
+   Returns:     Progress - PROGRESS_MORE when the window is full, the block ended or the fast variant ran short of
+                input, PROGRESS_NEED_INPUT when the safe variant ran out of input
+ */
+template <bool SAFE>
+FastInflater::Progress FastInflater::decodeHuffman()
+{
+  const uint32_t *cpLitlen = mpLitlen->data();
+  const uint32_t *cpDist = mpDist->data();
+  uint8_t *const pWindow = mWindow.data();
+  const size_t cOutLimit = WINDOW_SIZE - MAX_MATCH;
+  const uint8_t *pIn = mpIn;
+  const uint8_t *const cpInEnd = mpInEnd;
+  uint64_t bits = mBits;
+  uint32_t bitCount = mBitCount;
+  size_t out = mOutEnd;
+  Progress progress = PROGRESS_MORE;
+  BitState saved = {pIn, bits, bitCount};
+
+  while (out <= cOutLimit)
+  {
+    uint32_t entry = 0;
+    uint32_t length = 0;
+    uint32_t distance = 0;
+    uint32_t extra = 0;
+
+    if (SAFE)
+    {
+      saved = {pIn, bits, bitCount};
+
+      while (bitCount <= 56 && pIn != cpInEnd)
+      {
+        bits |= static_cast<uint64_t>(*pIn ++) << bitCount;
+        bitCount += 8;
+      }
+    }
+    else
+    {
+      uint64_t word;
+
+      if ((cpInEnd - pIn) < 8)
+      {
+        break;
+      }
+
+      memcpy(&word, pIn, sizeof(word));
+      bits |= word << bitCount;
+      pIn += (63 - bitCount) >> 3;
+      bitCount |= 56;
+    }
+
+    entry = cpLitlen[lowBits(bits, LITLEN_BITS)];
+
+    if (entryKind(entry) == ENTRY_LINK)
+    {
+      if (SAFE && bitCount < LITLEN_BITS)
+      {
+        progress = PROGRESS_NEED_INPUT;
+        break;
+      }
+
+      bits >>= LITLEN_BITS;
+      bitCount -= LITLEN_BITS;
+      entry = cpLitlen[(entryPayload(entry) >> 4) + lowBits(bits, entryPayload(entry) & 0xF)];
+    }
+
+    if (SAFE && entryBits(entry) > bitCount)
+    {
+      progress = PROGRESS_NEED_INPUT;
+      break;
+    }
+
+    bits >>= entryBits(entry);
+    bitCount -= entryBits(entry);
+
+    switch (entryKind(entry))
+    {
+      case ENTRY_LITERAL:
+        pWindow[out ++] = static_cast<uint8_t>(entryPayload(entry));
+        continue;
+      case ENTRY_DOUBLE:
+        pWindow[out] = static_cast<uint8_t>(entryPayload(entry));
+        pWindow[out + 1] = static_cast<uint8_t>(entryPayload(entry) >> 8);
+        out += 2;
+        continue;
+      case ENTRY_END:
+        mState = mFinalBlock ? STATE_CHECKSUM : STATE_BLOCK_HEADER;
+        break;
+      case ENTRY_LENGTH:
+        break;
+      default:
+        progress = error("Invalid literal/length code");
+        break;
+    }
+
+    // The block ended or the code was invalid
+    if (entryKind(entry) != ENTRY_LENGTH)
+    {
+      break;
+    }
+
+    extra = entryPayload(entry) & 0xF;
+
+    if (SAFE && extra > bitCount)
+    {
+      progress = PROGRESS_NEED_INPUT;
+      break;
+    }
+
+    length = (entryPayload(entry) >> 4) + static_cast<uint32_t>(lowBits(bits, extra));
+    bits >>= extra;
+    bitCount -= extra;
+
+    entry = cpDist[lowBits(bits, DIST_BITS)];
+
+    if (entryKind(entry) == ENTRY_LINK)
+    {
+      if (SAFE && bitCount < DIST_BITS)
+      {
+        progress = PROGRESS_NEED_INPUT;
+        break;
+      }
+
+      bits >>= DIST_BITS;
+      bitCount -= DIST_BITS;
+      entry = cpDist[(entryPayload(entry) >> 4) + lowBits(bits, entryPayload(entry) & 0xF)];
+    }
+
+    if (SAFE && entryBits(entry) > bitCount)
+    {
+      progress = PROGRESS_NEED_INPUT;
+      break;
+    }
+
+    if (entryKind(entry) != ENTRY_LENGTH)
+    {
+      progress = error("Invalid distance code");
+      break;
+    }
+
+    bits >>= entryBits(entry);
+    bitCount -= entryBits(entry);
+    extra = entryPayload(entry) & 0xF;
+
+    if (SAFE && extra > bitCount)
+    {
+      progress = PROGRESS_NEED_INPUT;
+      break;
+    }
+
+    distance = (entryPayload(entry) >> 4) + static_cast<uint32_t>(lowBits(bits, extra));
+    bits >>= extra;
+    bitCount -= extra;
+
+    if (distance > out)
+    {
+      progress = error("Invalid distance too far back");
+      break;
+    }
+
+    {
+      uint8_t *pDst = pWindow + out;
+      const uint8_t *cpSrc = pDst - distance;
+
+      // Wide copies may write up to 15 bytes past the match, the window slack absorbs that
+      if (distance >= 16)
+      {
+        for (uint32_t i = 0; i < length; i += 16)
+        {
+          memcpy(pDst + i, cpSrc + i, 16);
+        }
+      }
+      else if (distance >= 8)
+      {
+        for (uint32_t i = 0; i < length; i += 8)
+        {
+          memcpy(pDst + i, cpSrc + i, 8);
+        }
+      }
+      else if (distance == 1)
+      {
+        memset(pDst, *cpSrc, length);
+      }
+      else
+      {
+        for (uint32_t i = 0; i < length; i ++)
+        {
+          pDst[i] = cpSrc[i];
+        }
+      }
+
+      out += length;
+    }
+  }
+
+  // The symbol the input ran out in is decoded again once more input comes
+  if (progress == PROGRESS_NEED_INPUT)
+  {
+    pIn = saved.cpIn;
+    bits = saved.bits;
+    bitCount = saved.bitCount;
+  }
+
+  mpIn = pIn;
+  mBits = bits;
+  mBitCount = bitCount;
+  mOutEnd = out;
+  return progress;
+}
+
+/* Function:    readChecksum
+   Description: Reads the adler32 that ends the zlib stream. It is compared once every byte has been handed out,
+                raw streams end without one.
+   Parameters:  None
+   Returns:     Progress - PROGRESS_NEED_INPUT if the checksum is not complete yet
+ */
+FastInflater::Progress FastInflater::readChecksum()
+{
+  uint32_t expected = 0;
+
+  if (mRaw)
+  {
+    mState = STATE_DONE;
+    return PROGRESS_MORE;
+  }
+
+  takeBits(mBitCount & 7);
+
+  if (!needBits(32))
+  {
+    return PROGRESS_NEED_INPUT;
+  }
+
+  for (uint32_t i = 0; i < 4; i ++)
+  {
+    expected = (expected << 8) | takeBits(8);
+  }
+
+  mExpectedAdler = expected;
+  mState = STATE_DONE;
+  return PROGRESS_MORE;
+}
+
+/* Function:    decodeSome
+   Description: Advances the stream until the window is full, the input runs out or the stream ends
+   Parameters:  None
+   Returns:     Progress - Why decoding stopped
+ */
+FastInflater::Progress FastInflater::decodeSome()
+{
+  Progress progress = PROGRESS_MORE;
+
+  while (mOutEnd <= WINDOW_SIZE - MAX_MATCH && progress == PROGRESS_MORE)
+  {
+    switch (mState)
+    {
+      case STATE_ZLIB_HEADER:
+        progress = readZlibHeader();
+        break;
+      case STATE_BLOCK_HEADER:
+        progress = readBlockHeader();
+        break;
+      case STATE_STORED:
+        progress = copyStored();
+        break;
+      case STATE_HUFFMAN:
+        progress = decodeHuffman<false>();
+
+        if (progress == PROGRESS_MORE && mState == STATE_HUFFMAN && mOutEnd <= WINDOW_SIZE - MAX_MATCH)
+        {
+          progress = decodeHuffman<true>();
+        }
+        break;
+      case STATE_CHECKSUM:
+        progress = readChecksum();
+        break;
+      case STATE_DONE:
+        return PROGRESS_MORE;
+      default:
+        return PROGRESS_ERROR;
+    }
+  }
+
+  return progress;
+}
+
+/* Function:    nextSegment
+   Description: Moves on to more input once the current input segment has run out. Left over bytes from the
+                previous call are decoded with the first bytes of this call appended, once they are used up decoding
+                carries on in the caller's buffer directly.
+   Parameters:  None
+   Returns:     bool - False if all of the caller's input has been used
+ */
+bool FastInflater::nextSegment()
+{
+  size_t used = 0;
+  size_t append = 0;
+
+  if (!mInTail || mCallerAppended == mCallerSize)
+  {
+    return false;
+  }
+
+  if (mpIn >= mTail.data() + mTailOwn)
+  {
+    mpIn = mpCallerIn + (mpIn - (mTail.data() + mTailOwn));
+    mpInEnd = mpCallerIn + mCallerSize;
+    mInTail = false;
+    mTail.clear();
+    mTailOwn = 0;
+    return true;
+  }
+
+  // Still inside the left over bytes, drop what was used and append more of the caller's input
+  used = static_cast<size_t>(mpIn - mTail.data());
+  append = std::min<size_t>(TAIL_APPEND, mCallerSize - mCallerAppended);
+  mTail.erase(mTail.begin(), mTail.begin() + used);
+  mTailOwn -= used;
+  mTail.insert(mTail.end(), mpCallerIn + mCallerAppended, mpCallerIn + mCallerAppended + append);
+  mCallerAppended += append;
+  mpIn = mTail.data();
+  mpInEnd = mTail.data() + mTail.size();
+
+  return true;
+}
+
+/* Function:    saveTail
+   Description: Works out how much of the caller's input was used when an inflate call returns. When the input ran
+                out, the bytes of an unfinished header or symbol are kept for the next call.
+   Parameters:  bool - True if decoding stopped because the input ran out
+                size_t - Set to the bytes of caller input consumed
+   Returns:     None
+ */
+void FastInflater::saveTail(const bool cNeedInput, size_t &rConsumed)
+{
+  if (cNeedInput)
+  {
+    // Every byte of the caller has been seen, keep the ones a rolled back step still needs
+    if (mInTail)
+    {
+      mTail.erase(mTail.begin(), mTail.begin() + (mpIn - mTail.data()));
+    }
+    else
+    {
+      mTail.assign(mpIn, mpInEnd);
+    }
+
+    rConsumed = mCallerSize;
+  }
+  else if (!mInTail)
+  {
+    rConsumed = static_cast<size_t>(mpIn - mpCallerIn);
+  }
+  else if (mpIn >= mTail.data() + mTailOwn)
+  {
+    rConsumed = static_cast<size_t>(mpIn - (mTail.data() + mTailOwn));
+    mTail.clear();
+  }
+  else
+  {
+    // Stopped inside the left over bytes, the caller hands the appended bytes in again
+    mTail.erase(mTail.begin() + mTailOwn, mTail.end());
+    mTail.erase(mTail.begin(), mTail.begin() + (mpIn - mTail.data()));
+    rConsumed = 0;
+  }
+
+  mTailOwn = mTail.size();
+}
+
+/* Function:    inflate
+   Description: Decodes into the window and hands the decoded bytes out until the output is full or the input is
+                used up
+   Parameters:  uint8_t* - Compressed input, advanced past what was consumed
+                size_t - Bytes of input, reduced by what was consumed
+                uint8_t* - Output, advanced past what was produced
+                size_t - Space in the output, reduced by what was produced
+   Returns:     InflateStatus - INFLATE_STREAM_END after the last byte of the stream
+ */
+InflateStatus FastInflater::inflate(const uint8_t *&rpIn, size_t &rInSize, uint8_t *&rpOut, size_t &rOutSize)
+{
+  InflateStatus status = INFLATE_OK;
+  size_t consumed = 0;
+  bool needInput = false;
+
+  if (mState == STATE_ERROR)
+  {
+    return INFLATE_ERROR;
+  }
+
+  mpCallerIn = rpIn;
+  mCallerSize = rInSize;
+  mCallerAppended = 0;
+  mInTail = !mTail.empty();
+
+  if (mInTail)
+  {
+    mCallerAppended = std::min<size_t>(TAIL_APPEND, rInSize);
+    mTailOwn = mTail.size();
+    mTail.insert(mTail.end(), rpIn, rpIn + mCallerAppended);
+    mpIn = mTail.data();
+    mpInEnd = mTail.data() + mTail.size();
+  }
+  else
+  {
+    mpIn = rpIn;
+    mpInEnd = rpIn + rInSize;
+  }
+
+  while (true)
+  {
+    const size_t cCount = std::min(mOutEnd - mOutRead, rOutSize);
+    Progress progress = PROGRESS_MORE;
+
+    if (cCount > 0)
+    {
+      memcpy(rpOut, mWindow.data() + mOutRead, cCount);
+      mAdler = adler32(mAdler, rpOut, static_cast<uInt>(cCount));
+      mOutRead += cCount;
+      rpOut += cCount;
+      rOutSize -= cCount;
+    }
+
+    // A full output with nothing left to hand out still decodes on, so the end of the stream and its adler32 are
+    // checked by the call that hands out the last byte, like zlib does
+    if (mOutRead < mOutEnd)
+    {
+      break;
+    }
+
+    if (mState == STATE_DONE)
+    {
+      if (!mRaw && mAdler != mExpectedAdler)
+      {
+        error("Incorrect data check");
+        status = INFLATE_ERROR;
+      }
+      else
+      {
+        status = INFLATE_STREAM_END;
+      }
+
+      break;
+    }
+
+    if (needInput)
+    {
+      break;
+    }
+
+    // Everything has been handed out, keep only the history matches can still reach
+    if (mOutEnd > WINDOW_SIZE / 2)
+    {
+      memmove(mWindow.data(), mWindow.data() + mOutEnd - HISTORY_SIZE, HISTORY_SIZE);
+      mOutRead = HISTORY_SIZE;
+      mOutEnd = HISTORY_SIZE;
+    }
+
+    progress = decodeSome();
+
+    if (progress == PROGRESS_ERROR)
+    {
+      status = INFLATE_ERROR;
+      break;
+    }
+
+    // Out of input, the loop hands out what was decoded before returning
+    needInput = (progress == PROGRESS_NEED_INPUT) && !nextSegment();
+  }
+
+  saveTail(needInput, consumed);
+  rpIn += consumed;
+  rInSize -= consumed;
+  mpIn = nullptr;
+  mpInEnd = nullptr;
+
+  return status;
+}
+
+/* Function:    createInflater
+   Description: Creates a decompression backend
+   Parameters:  InflateEngine - Backend to create
+   Returns:     InflateBackend* - New backend, owned by the caller
+ */
+InflateBackend *createInflater(const InflateEngine cEngine)
+{
+  if (cEngine == INFLATE_FAST)
+  {
+    return new FastInflater();
+  }
+
+  return new ZlibInflater();
+}
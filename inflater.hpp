@@ -0,0 +1,145 @@
+#ifndef INFLATER_HPP
+#define INFLATER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+#include "common.hpp"
+
+enum InflateEngine {
+  INFLATE_ZLIB,
+  INFLATE_FAST
+};
+
+enum InflateStatus {
+  INFLATE_OK,
+  INFLATE_STREAM_END,
+  INFLATE_ERROR
+};
+
+/* Decompression backend for the zlib stream spread over the IDAT chunks. inflate works like zlib's, it consumes
+   input and produces output until either runs out and advances both, so the stream can arrive in any pieces.
+ */
+class InflateBackend {
+public:
+  InflateBackend() : mAllocator(), mRaw(false) {}
+  virtual ~InflateBackend() {}
+  virtual Status reset() = 0;
+  virtual InflateStatus inflate(const uint8_t *&rpIn, size_t &rInSize, uint8_t *&rpOut, size_t &rOutSize) = 0;
+  virtual const char *name() const = 0;
+  const std::string &getError() const { return mError; }
+
+  // Has to be set before the first reset, which is when the backend sets up its state
+  void setAllocator(const PngAllocator &crAllocator) { mAllocator = crAllocator; }
+
+  // Raw deflate data without the zlib header and adler32, such as a band of a flushed stream, from the next reset
+  void setRaw(const bool cRaw) { mRaw = cRaw; }
+
+protected:
+  std::string mError;
+  PngAllocator mAllocator;
+  bool mRaw;
+};
+
+/* Reference backend on top of zlib */
+class ZlibInflater : public InflateBackend {
+public:
+  ZlibInflater();
+  ~ZlibInflater();
+  Status reset() override;
+  InflateStatus inflate(const uint8_t *&rpIn, size_t &rInSize, uint8_t *&rpOut, size_t &rOutSize) override;
+  const char *name() const override;
+
+private:
+  z_stream mStream;
+  bool mStreamInit;
+};
+
+/* PNG oriented inflater. Literal/length codes are looked up in an 11 bit table whose entries can hold two literals
+   at once, the bit buffer is refilled 8 bytes at a time and matches are copied 8 or 16 bytes at a time. Output is
+   decoded into an internal window and copied out, so the fast loop never has to stop for a small output buffer.
+ */
+class FastInflater : public InflateBackend {
+public:
+  FastInflater();
+  Status reset() override;
+  InflateStatus inflate(const uint8_t *&rpIn, size_t &rInSize, uint8_t *&rpOut, size_t &rOutSize) override;
+  const char *name() const override;
+
+private:
+  enum State {
+    STATE_ZLIB_HEADER,
+    STATE_BLOCK_HEADER,
+    STATE_STORED,
+    STATE_HUFFMAN,
+    STATE_CHECKSUM,
+    STATE_DONE,
+    STATE_ERROR
+  };
+
+  enum Progress {
+    PROGRESS_MORE,
+    PROGRESS_NEED_INPUT,
+    PROGRESS_ERROR
+  };
+
+  struct BitState {
+    const uint8_t *cpIn;
+    uint64_t bits;
+    uint32_t bitCount;
+  };
+
+  Progress error(const std::string &crError);
+  bool nextSegment();
+  void saveTail(const bool cNeedInput, size_t &rConsumed);
+  bool needBits(const uint32_t cCount);
+  uint32_t takeBits(const uint32_t cCount);
+  Progress rollBack(const BitState &crSaved);
+  Progress decodeSome();
+  Progress readZlibHeader();
+  Progress readBlockHeader();
+  Progress readDynamicTables();
+  Progress copyStored();
+  template <bool SAFE> Progress decodeHuffman();
+  Progress readChecksum();
+
+  // Bit buffer, valid only for the duration of one inflate call
+  const uint8_t *mpIn;
+  const uint8_t *mpInEnd;
+  uint64_t mBits;
+  uint32_t mBitCount;
+
+  // Bytes of a previous call that could not be decoded yet, followed by the first bytes of the current call
+  std::vector<uint8_t> mTail;
+  size_t mTailOwn;
+  size_t mCallerAppended;
+  const uint8_t *mpCallerIn;
+  size_t mCallerSize;
+  bool mInTail;
+
+  State mState;
+  bool mFinalBlock;
+  uint32_t mStoredLeft;
+  uint32_t mAdler;
+  uint32_t mExpectedAdler;
+
+  // Tables of the current dynamic block, reserved at their largest so a block never allocates
+  std::vector<uint32_t> mLitlen;
+  std::vector<uint32_t> mDist;
+  std::vector<uint32_t> mCodeLengthTable;
+  std::vector<uint32_t> mFixedLitlen;
+  std::vector<uint32_t> mFixedDist;
+  const std::vector<uint32_t> *mpLitlen;
+  const std::vector<uint32_t> *mpDist;
+
+  std::vector<uint8_t> mWindow;
+  size_t mOutRead;
+  size_t mOutEnd;
+};
+
+InflateBackend *createInflater(const InflateEngine cEngine);
+
+#endif
@@ -1,8 +1,10 @@
 #include "png.hpp"
+#include "crc.hpp"
 
 #include <cstring>
-#include <zlib.h>
 #include <cmath>
+#include <algorithm>
+#include <fstream>
 
 #ifdef __linux__
   #include <arpa/inet.h>
@@ -10,489 +12,3069 @@
   #include <winsock2.h>
 #endif
 
-#define WINDOW_BITS 47
-
 const std::vector<uint8_t> pngSignature = {0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A, '\0'};
 
-/* Function:    parsemI
+// First column, first row, column step and row step of every Adam7 pass
+struct Adam7Pass {
+  uint8_t x;
+  uint8_t y;
+  uint8_t dx;
+  uint8_t dy;
+};
+
+static const Adam7Pass cAdam7[ADAM7_PASSES] = {
+  {0, 0, 8, 8}, {4, 0, 8, 8}, {0, 4, 4, 8}, {2, 0, 4, 4}, {0, 2, 2, 4}, {1, 0, 2, 2}, {0, 1, 1, 2}
+};
+
+/* Function:    adam7Count
+   Description: Counts the columns or rows of the image that fall into a pass
+   Parameters:  uint32_t - Image width or height
+                uint8_t - First column or row of the pass
+                uint8_t - Column or row step of the pass
+   Returns:     uint32_t - Columns or rows in the pass
+ */
+static uint32_t adam7Count(const uint32_t cSize, const uint8_t cStart, const uint8_t cStep)
+{
+  return (cSize > cStart) ? ((cSize - cStart + cStep - 1) / cStep) : 0;
+}
+
+/* Function:    readBytes
+   Description: Reads an exact amount of bytes from the png source
+   Parameters:  size_t - Amount of bytes to read
+   Returns:     uint8_t* - Bytes read, valid until the next read from the source
+ */
+const uint8_t *Png::readBytes(const size_t cSize)
+{
+  const uint8_t *cpData = mpSource->read(cSize);
+
+  if (cpData == nullptr)
+  {
+    throw PngException("Error! Png data ended unexpectedly.");
+  }
+
+  return cpData;
+}
+
+/* Function:    readChunkData
+   Description: Reads an exact amount of chunk data, adding it to the running CRC of the chunk
+   Parameters:  size_t - Amount of bytes to read
+   Returns:     uint8_t* - Bytes read, valid until the next read from the source
+ */
+const uint8_t *Png::readChunkData(const size_t cSize)
+{
+  const uint8_t *cpData = readBytes(cSize);
+
+  if (mCheckCrc)
+  {
+    mChunkCrc = crc32Update(mChunkCrc, cpData, cSize);
+  }
+
+  return cpData;
+}
+
+/* Function:    skipChunkData
+   Description: Skips chunk data the decoder has no use for. Data that is covered by a CRC check still has to be
+                read, otherwise it is skipped without being touched.
+   Parameters:  size_t - Amount of bytes to skip
+   Returns:     None
+ */
+void Png::skipChunkData(const size_t cSize)
+{
+  size_t remaining = cSize;
+  const uint8_t *cpData = nullptr;
+
+  if (!mCheckCrc)
+  {
+    mpSource->skip(cSize);
+    return;
+  }
+
+  while (remaining > 0)
+  {
+    const size_t cRead = mpSource->readSome(remaining, &cpData);
+
+    if (cRead == 0)
+    {
+      break;
+    }
+
+    mChunkCrc = crc32Update(mChunkCrc, cpData, cRead);
+    remaining -= cRead;
+  }
+}
+
+/* Function:    checkChunkCrc
+   Description: Reads the CRC that ends every chunk and compares it with the one computed over the chunk
+   Parameters:  char* - Chunk type, for the error message
+   Returns:     None
+ */
+void Png::checkChunkCrc(const char *cpChunkType)
+{
+  uint32_t expected = 0;
+
+  memcpy(&expected, readBytes(sizeof(uint32_t)), sizeof(uint32_t));
+  expected = htonl(expected);
+
+  if (mCheckCrc && (expected != mChunkCrc))
+  {
+    throw PngException("Error! CRC mismatch in " + std::string(cpChunkType) + " chunk.");
+  }
+}
+
+/* Function:    parseIHDR
    Description: Parses IHDR from png file
-   Parameters:  ifstream - file descriptor for file we are reading
-                uint32_t - The amount of bytes to read
-                struct IHDR - IHDR struct to store values from parsed IHDR
+   Parameters:  uint32_t - The amount of bytes to read
    Returns:     None
  */
 void Png::parseIHDR(const uint32_t cChunkLength)
 {
-  mPngFile.read((char *) &mIhdr, cChunkLength);
+  // Width, height and the five single byte fields are packed together without padding in the file
+  const size_t cIhdrSize = 13;
+
+  if (cChunkLength != cIhdrSize)
+  {
+    throw PngException("Error! Invalid IHDR length.");
+  }
+
+  memcpy(&mIhdr, readChunkData(cChunkLength), cIhdrSize);
   /* There is no endian issues for 1 byte values which is why only width and height needs to be rearranged */
   mIhdr.width = htonl(mIhdr.width);
   mIhdr.height = htonl(mIhdr.height);
 
-  if ((mIhdr.width == 0) || (mIhdr.height == 0))
+  if ((mIhdr.width == 0) || (mIhdr.height == 0))
+  {
+    throw PngException("Error! Invalid image dimensions.");
+  }
+
+  if (mIhdr.interfaceMethod > 1)
+  {
+    throw PngException("Error! Invalid interlace method.");
+  }
+}
+
+/* Function:    getDecodeFormat
+   Description: Gets the pixel format a decode writes, scaled decodes only write 8 bit samples so PIXEL_NATIVE
+                becomes PIXEL_NATIVE8 for them
+   Parameters:  bool - True for a scaled decode
+   Returns:     PixelFormat - Format to expand rows to
+ */
+PixelFormat Png::getDecodeFormat(const bool cScaled)
+{
+  return (cScaled && mPixelFormat == PIXEL_NATIVE) ? PIXEL_NATIVE8 : mPixelFormat;
+}
+
+/* Function:    handlePngColorType
+   Description: Checks the color type and bit depth are a pair the PNG spec allows
+   Parameters:  bool - True for the pixel size of a scaled decode
+   Returns:     uint8_t - Bytes per pixel in the output format, palette images decode to RGBA natively
+ */
+uint8_t Png::handlePngColorType(const bool cScaled)
+{
+  if (getExpandKernel(mIhdr.colorType, mIhdr.bitDepth) == nullptr)
+  {
+    throw PngException("Error! Invalid bit depth " + std::to_string(mIhdr.bitDepth) + " for color type " +
+                       std::to_string(mIhdr.colorType) + ".");
+  }
+
+  return getOutputPixelBytes(mIhdr.colorType, mIhdr.bitDepth, getDecodeFormat(cScaled));
+}
+
+/* Function:    finishStats
+   Description: Completes the stats of a decode. Read time is everything outside the scanline decoder, whose own
+                inflate, unfilter and store times are added in along with the buffers it grew.
+   Parameters:  uint64_t - Time the chunk loop started
+   Returns:     None
+ */
+void Png::finishStats(const uint64_t cStart)
+{
+  const uint64_t cTotal = statsStart(true) - cStart;
+  size_t scratch = mPassPixels.capacity() + mRotateRows.capacity();
+
+  mStats.totalNs += cTotal;
+  mStats.stageNs[STATS_READ] += cTotal - std::min(cTotal, mScanlineNs);
+  mStats.allocations += (mImgData.capacity() > mStatsCapacity[0]) + (mPassPixels.capacity() > mStatsCapacity[1]) +
+                        (mRotateRows.capacity() > mStatsCapacity[2]);
+
+  if ((mValidPngMask & IDAT_MASK) != 0 && !mMetadataOnly)
+  {
+    const DecodeStats &crScanline = mBanded ? mpBands->getStats() : mpScanlines->getStats();
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    if (mScaled)
+    {
+      width = mScale.width;
+      height = mScale.height;
+      scratch += mScaler.getScratchBytes();
+    }
+    else
+    {
+      getOrientedSize(mRegion, width, height);
+    }
+
+    mStats.bytesOut += static_cast<uint64_t>(width) * height * mPixelSize;
+    mStats.stageNs[STATS_INFLATE] += crScanline.stageNs[STATS_INFLATE];
+    mStats.stageNs[STATS_UNFILTER] += crScanline.stageNs[STATS_UNFILTER];
+    mStats.stageNs[STATS_STORE] += crScanline.stageNs[STATS_STORE];
+    mStats.filteredBytes += crScanline.filteredBytes;
+    mStats.allocations += crScanline.allocations;
+    scratch += crScanline.peakScratchBytes;
+
+    for (uint8_t i = 0; i < FILTER_TYPES; i ++)
+    {
+      mStats.filterCounts[i] += crScanline.filterCounts[i];
+    }
+  }
+
+  mStats.peakScratchBytes = std::max(mStats.peakScratchBytes, scratch);
+}
+
+/* Function:    parsePLTE
+   Description: Parses the palette, entries without a tRNS alpha are opaque and missing entries are opaque black
+   Parameters:  uint32_t - Amount of bytes to read
+   Returns:     None
+ */
+void Png::parsePLTE(const uint32_t cChunkLength)
+{
+  const uint8_t *cpEntries = nullptr;
+
+  if ((cChunkLength % RGBSIZE) != 0 || cChunkLength == 0 || (cChunkLength / RGBSIZE) > PALETTE_ENTRIES ||
+      (mIhdr.colorType == PLTE && (cChunkLength / RGBSIZE) > (1u << mIhdr.bitDepth)))
+  {
+    throw PngException("Error! Invalid PLTE length.");
+  }
+
+  cpEntries = readChunkData(cChunkLength);
+  mPaletteEntries = static_cast<uint16_t>(cChunkLength / RGBSIZE);
+  mPalette.assign(PALETTE_SIZE, 0);
+
+  for (uint32_t i = 0; i < PALETTE_ENTRIES; i ++)
+  {
+    if (i < mPaletteEntries)
+    {
+      memcpy(&mPalette[i * RGBASIZE], cpEntries + (i * RGBSIZE), RGBSIZE);
+    }
+
+    mPalette[(i * RGBASIZE) + 3] = 0xFF;
+  }
+}
+
+/* Function:    parseTRNS
+   Description: Parses the alpha of palette entries. The color key of gray and truecolor images is not applied, the
+                chunk is skipped for them.
+   Parameters:  uint32_t - Amount of bytes to read
+   Returns:     None
+ */
+void Png::parseTRNS(const uint32_t cChunkLength)
+{
+  const uint8_t *cpAlpha = nullptr;
+
+  if (mIhdr.colorType != PLTE)
+  {
+    skipChunkData(cChunkLength);
+    return;
+  }
+
+  if (mPaletteEntries == 0 || cChunkLength > mPaletteEntries)
+  {
+    throw PngException("Error! tRNS chunk must follow PLTE and hold at most one alpha per entry.");
+  }
+
+  cpAlpha = readChunkData(cChunkLength);
+
+  for (uint32_t i = 0; i < cChunkLength; i ++)
+  {
+    mPalette[(i * RGBASIZE) + 3] = cpAlpha[i];
+  }
+}
+
+/* Function:    startIDAT
+   Description: Sizes the image buffer and prepares the scanline decoder when the first IDAT chunk is found. The
+                expansion kernel for the color type and bit depth is picked here once for the whole image.
+   Parameters:  None
+   Returns:     None
+ */
+void Png::startIDAT()
+{
+  const uint8_t cPixelSize = handlePngColorType(mScaled);
+  const PixelFormat cFormat = getDecodeFormat(mScaled);
+  const size_t cSampleBits = static_cast<size_t>(getSampleChannels(mIhdr.colorType)) * mIhdr.bitDepth;
+  const size_t cScanlineSize = ((static_cast<size_t>(mIhdr.width) * cSampleBits) + 7) / 8;
+  const uint8_t cBpp = static_cast<uint8_t>(std::max<size_t>(1, cSampleBits / 8));
+
+  if (mIhdr.colorType == PLTE && mPaletteEntries == 0)
+  {
+    throw PngException("Error! Palette image has no PLTE chunk before IDAT.");
+  }
+
+  setupColor(cFormat);
+
+  const ExpandFn cExpand = getConvertKernel(mIhdr.colorType, mIhdr.bitDepth, cFormat, getExpandAlpha());
+
+  // Palette pixels are table lookups, so converting the 256 entries converts the image
+  if (mIhdr.colorType == PLTE)
+  {
+    convertPalette(mPalette.data(), cFormat, mAlphaMode);
+  }
+
+  // Without a caller buffer the image is decoded into mImgData
+  if (mpOut == nullptr)
+  {
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    getOrientedSize(mRegion, width, height);
+    mImgData.resize(static_cast<size_t>(width) * cPixelSize * height);
+    mpOut = mImgData.data();
+    mOutStride = static_cast<size_t>(width) * cPixelSize;
+    mImgWidth = width;
+    mImgHeight = height;
+    mImgPixelSize = cPixelSize;
+  }
+
+  if (mpScanlines == nullptr)
+  {
+    mpOwnScanlines.reset(new ScanlineDecoder());
+    mpScanlines = mpOwnScanlines.get();
+  }
+
+  mpScanlines->setInflateEngine(mInflateEngine);
+  mpScanlines->setCollectStats(mCollectStats);
+  mExpand = cExpand;
+  mScatter = getScatterKernel(cPixelSize);
+  mPixelSize = cPixelSize;
+  mRowsWritten = 0;
+  mPassesDone = 0;
+
+  if (mScaled)
+  {
+    setupOrientation(mScale.width, mScale.height);
+    mPassPixels.resize(static_cast<size_t>(mIhdr.width) * cPixelSize);
+
+    if (mScaler.begin(mIhdr.width, mIhdr.height, mScale.width, mScale.height, cPixelSize, mScale.filter,
+                      mIhdr.interfaceMethod == 0, [this](const uint32_t cRow, const uint8_t *cpRow)
+        {
+          writeScaledRow(cRow, cpRow);
+        }) != SUCCESS)
+    {
+      throw PngException("Error! Can not scale to " + std::to_string(mScale.width) + "x" +
+                         std::to_string(mScale.height) + ".");
+    }
+  }
+  else
+  {
+    setupOrientation(mRegion.width, mRegion.height);
+  }
+
+  if (mIhdr.interfaceMethod == 1)
+  {
+    startInterlaced(cSampleBits, cBpp, cPixelSize);
+    return;
+  }
+
+  if (startBands(cScanlineSize, cBpp))
+  {
+    return;
+  }
+
+  // Rows below the region are never inflated, rows above it are only reconstructed for the rows that follow
+  if (mpScanlines->begin(cScanlineSize, mRegion.y + mRegion.height, cBpp, [this](const uint32_t cRow,
+                         const uint8_t *cpRow)
+      {
+        if (mScaled)
+        {
+          mExpand(cpRow, mPassPixels.data(), 0, mIhdr.width, mPalette.data());
+          applyColor(mPassPixels.data(), mIhdr.width);
+          mScaler.addRow(cRow, mPassPixels.data(), 0, 1, mIhdr.width);
+        }
+        else if (cRow >= mRegion.y)
+        {
+          storeRow(cRow - mRegion.y, cpRow);
+        }
+      }, mPipelined && mpPush == nullptr && (cScanlineSize * mIhdr.height) >= PIPELINE_MIN_BYTES) != SUCCESS)
+  {
+    throw PngException(mpScanlines->getError());
+  }
+}
+
+/* Function:    startBands
+   Description: Starts a banded decode when an iDOT chunk before IDAT splits the image into bands and the first
+                band starts at this IDAT chunk. Rows are expanded straight into place from the band workers, so
+                scaled decodes, rotations and push decodes always take the sequential path.
+   Parameters:  size_t - Bytes in one scanline, not counting the filter type byte
+                uint8_t - Bytes per complete pixel, rounded up to 1
+   Returns:     bool - True if the bands are decoded on mpBands
+ */
+bool Png::startBands(const size_t cScanlineSize, const uint8_t cBpp)
+{
+  const Chunk *cpIdot = findChunk("iDOT");
+  std::vector<IdotBand> bands;
+
+  mBanded = false;
+
+  if (!mUseBands || cpIdot == nullptr || mpPush != nullptr || mScaled || !useBandThreads() ||
+      mColumnStep != static_cast<ptrdiff_t>(mPixelSize) ||
+      parseIdot(getChunkData(*cpIdot), cpIdot->length, mIhdr.height, bands) != SUCCESS ||
+      (mChunks.back().offset - cpIdot->offset) != bands[0].offset)
+  {
+    return false;
+  }
+
+  if (!mpBands)
+  {
+    mpBands.reset(new BandDecoder());
+  }
+
+  mpBands->setInflateEngine(mInflateEngine);
+  mpBands->setCollectStats(mCollectStats);
+
+  if (mpBands->begin(bands, cScanlineSize, mRegion.y + mRegion.height, cBpp, [this](const uint32_t cRow,
+                     const uint8_t *cpRow)
+      {
+        if (cRow >= mRegion.y)
+        {
+          uint8_t *pDst = mpOrigin + (static_cast<ptrdiff_t>(cRow - mRegion.y) * mRowStep);
+
+          mExpand(cpRow, pDst, mRegion.x, mRegion.width, mPalette.data());
+          applyColor(pDst, mRegion.width);
+        }
+      }) != SUCCESS)
+  {
+    throw PngException(mpBands->getError());
+  }
+
+  mIdotOffset = cpIdot->offset;
+  mBanded = true;
+  return true;
+}
+
+/* Function:    setupColor
+   Description: Looks up the color transform for the color chunks read so far and works out where the samples sit
+                in the pixels the decode writes. The raw chunk bytes are the cache key, so the iCCP profile is only
+                inflated and the tables only built for a profile not seen before. Palette images convert their 256
+                entries here instead of every pixel.
+   Parameters:  PixelFormat - Format the decode writes
+   Returns:     None
+ */
+void Png::setupColor(const PixelFormat cFormat)
+{
+  const bool cNative = (cFormat == PIXEL_NATIVE) || (cFormat == PIXEL_NATIVE8);
+  const bool cGray = (mIhdr.colorType == GRAYSCALE) || (mIhdr.colorType == GRAYSCALEA);
+  const bool cAlpha = (mIhdr.colorType == GRAYSCALEA) || (mIhdr.colorType == RGBTRIPA) || (mIhdr.colorType == PLTE);
+  std::string key;
+
+  mpColor.reset();
+
+  // Push decodes can not read a chunk again once it is gone, their samples are kept as stored
+  if (mColorTarget == COLOR_AS_STORED || mpPush != nullptr)
+  {
+    return;
+  }
+
+  for (const char *cpType : {"iCCP", "sRGB", "gAMA", "cHRM"})
+  {
+    const Chunk *cpChunk = findChunk(cpType);
+    const uint8_t *cpData = (cpChunk != nullptr) ? getChunkData(*cpChunk) : nullptr;
+
+    if (cpData != nullptr)
+    {
+      key.append(cpType, 4);
+      key.append(std::to_string(cpChunk->length));
+      key.append(reinterpret_cast<const char *>(cpData), cpChunk->length);
+    }
+  }
+
+  mpColor = getColorTransform(key, mColorTarget, [this](ColorSource &rSource)
+  {
+    struct Chromaticities chromaticities = {};
+    std::string name;
+    uint8_t intent = 0;
+
+    rSource.srgb = (getSrgbIntent(intent) == SUCCESS);
+    rSource.hasChromaticities = (getChromaticities(chromaticities) == SUCCESS);
+    memcpy(rSource.chromaticities, &chromaticities, sizeof(rSource.chromaticities));
+
+    if (getGamma(rSource.gamma) != SUCCESS)
+    {
+      rSource.gamma = 0;
+    }
+
+    if (getIccProfile(name, rSource.iccProfile) != SUCCESS)
+    {
+      rSource.iccProfile.clear();
+    }
+  });
+
+  if (mpColor->isIdentity())
+  {
+    mpColor.reset();
+    return;
+  }
+
+  if (mIhdr.colorType == PLTE)
+  {
+    mColorLayout = {RGBASIZE, 1, 3, false, false, 3};
+    mpColor->apply(mPalette.data(), PALETTE_ENTRIES, mColorLayout);
+    mpColor.reset();
+    return;
+  }
+
+  mColorLayout.pixelBytes = getOutputPixelBytes(mIhdr.colorType, mIhdr.bitDepth, cFormat);
+  mColorLayout.sampleBytes = (cFormat == PIXEL_NATIVE && mIhdr.bitDepth == 16) ? 2 : 1;
+  mColorLayout.colorChannels = (cNative && cGray) ? 1 : 3;
+  mColorLayout.bgr = (cFormat == PIXEL_BGRA8);
+  mColorLayout.premultiplied = (mAlphaMode == ALPHA_PREMULTIPLIED) && cAlpha && cFormat != PIXEL_NATIVE &&
+                               cFormat != PIXEL_RGBX8;
+
+  if (!cNative)
+  {
+    mColorLayout.alpha = (cFormat == PIXEL_RGBX8) ? -1 : 3;
+  }
+  else
+  {
+    mColorLayout.alpha = cAlpha ? (cGray ? 1 : 3) : -1;
+  }
+}
+
+/* Function:    getExpandAlpha
+   Description: Gets the alpha mode rows are expanded with. Pixels the color transform premultiplies are expanded
+                straight, so the transform sees every color sample at full precision.
+   Parameters:  None
+   Returns:     AlphaMode - Alpha mode of the expand kernel
+ */
+AlphaMode Png::getExpandAlpha() const
+{
+  return (mpColor && mColorLayout.premultiplied) ? ALPHA_STRAIGHT : mAlphaMode;
+}
+
+/* Function:    applyColor
+   Description: Converts freshly expanded pixels to the color target, nothing happens without a transform
+   Parameters:  uint8_t* - Pixels
+                uint32_t - Amount of pixels
+   Returns:     None
+ */
+void Png::applyColor(uint8_t *pPixels, const uint32_t cCount)
+{
+  if (mpColor)
+  {
+    mpColor->apply(pPixels, cCount, mColorLayout);
+  }
+}
+
+/* Function:    getOrientedSize
+   Description: Gets the size of a region once the orientation is applied, rotating by 90 or 270 degrees swaps
+                width and height
+   Parameters:  Region - Columns and rows to decode
+                uint32_t - Set to the output width
+                uint32_t - Set to the output height
+   Returns:     None
+ */
+void Png::getOrientedSize(const Region &crRegion, uint32_t &rWidth, uint32_t &rHeight)
+{
+  const bool cTransposed = (mOrientation == ORIENT_ROTATE_90) || (mOrientation == ORIENT_ROTATE_270);
+
+  rWidth = cTransposed ? crRegion.height : crRegion.width;
+  rHeight = cTransposed ? crRegion.width : crRegion.height;
+}
+
+/* Function:    setupOrientation
+   Description: Works out where the first pixel of the region goes and how far apart its columns and rows land in
+                the output buffer, so every orientation is the same walk with different signed steps
+   Parameters:  uint32_t - Width of the image written, before orientation
+                uint32_t - Height of the image written, before orientation
+   Returns:     None
+ */
+void Png::setupOrientation(const uint32_t cWidth, const uint32_t cHeight)
+{
+  const ptrdiff_t cPixel = mPixelSize;
+  const ptrdiff_t cStride = static_cast<ptrdiff_t>(mOutStride);
+  const ptrdiff_t cLastColumn = static_cast<ptrdiff_t>(cWidth) - 1;
+  const ptrdiff_t cLastRow = static_cast<ptrdiff_t>(cHeight) - 1;
+
+  switch (mOrientation)
+  {
+    case ORIENT_FLIP_VERTICAL:
+      mpOrigin = mpOut + (cLastRow * cStride);
+      mColumnStep = cPixel;
+      mRowStep = -cStride;
+      break;
+    case ORIENT_ROTATE_90:
+      mpOrigin = mpOut + (cLastRow * cPixel);
+      mColumnStep = cStride;
+      mRowStep = -cPixel;
+      break;
+    case ORIENT_ROTATE_180:
+      mpOrigin = mpOut + (cLastRow * cStride) + (cLastColumn * cPixel);
+      mColumnStep = -cPixel;
+      mRowStep = -cStride;
+      break;
+    case ORIENT_ROTATE_270:
+      mpOrigin = mpOut + (cLastColumn * cStride);
+      mColumnStep = -cStride;
+      mRowStep = cPixel;
+      break;
+    default:
+      mpOrigin = mpOut;
+      mColumnStep = cPixel;
+      mRowStep = cStride;
+      break;
+  }
+
+  mRotateCount = 0;
+
+  // Scaled rows are few and small, they are scattered straight into place
+  if (mScaled || mIhdr.interfaceMethod != 0)
+  {
+    return;
+  }
+
+  if (mOrientation == ORIENT_ROTATE_90 || mOrientation == ORIENT_ROTATE_270)
+  {
+    mRotateRows.resize(static_cast<size_t>(ROTATE_BLOCK_ROWS) * cWidth * mPixelSize);
+  }
+  else if (mOrientation == ORIENT_ROTATE_180)
+  {
+    mPassPixels.resize(static_cast<size_t>(cWidth) * mPixelSize);
+  }
+}
+
+/* Function:    storeRow
+   Description: Writes one reconstructed scanline of the region to the output. Unrotated and flipped rows are
+                expanded straight into place, a 180 degree rotation goes through one row of scratch and 90 or 270
+                degree rotations collect ROTATE_BLOCK_ROWS rows so every output row gets a contiguous run of pixels.
+   Parameters:  uint32_t - Row within the region
+                uint8_t* - Reconstructed scanline
+   Returns:     None
+ */
+void Png::storeRow(const uint32_t cY, const uint8_t *cpRow)
+{
+  const size_t cRegionBytes = static_cast<size_t>(mRegion.width) * mPixelSize;
+
+  if (mColumnStep == static_cast<ptrdiff_t>(mPixelSize))
+  {
+    mExpand(cpRow, mpOrigin + (static_cast<ptrdiff_t>(cY) * mRowStep), mRegion.x, mRegion.width, mPalette.data());
+    applyColor(mpOrigin + (static_cast<ptrdiff_t>(cY) * mRowStep), mRegion.width);
+    mRowsWritten = cY + 1;
+  }
+  else if (mOrientation == ORIENT_ROTATE_180)
+  {
+    mExpand(cpRow, mPassPixels.data(), mRegion.x, mRegion.width, mPalette.data());
+    applyColor(mPassPixels.data(), mRegion.width);
+    mScatter(mPassPixels.data(), mPixelSize, mpOrigin + (static_cast<ptrdiff_t>(cY) * mRowStep), mColumnStep,
+             mRegion.width);
+    mRowsWritten = cY + 1;
+  }
+  else
+  {
+    mExpand(cpRow, mRotateRows.data() + (mRotateCount * cRegionBytes), mRegion.x, mRegion.width, mPalette.data());
+    applyColor(mRotateRows.data() + (mRotateCount * cRegionBytes), mRegion.width);
+    mRotateCount ++;
+
+    if (mRotateCount == ROTATE_BLOCK_ROWS || (cY + 1) == mRegion.height)
+    {
+      flushRotatedRows(cY);
+    }
+  }
+}
+
+/* Function:    flushRotatedRows
+   Description: Writes the collected rows of a 90 or 270 degree rotation, every column of them becomes a run of
+                adjacent pixels in one output row
+   Parameters:  uint32_t - Row within the region of the last collected row
+   Returns:     None
+ */
+void Png::flushRotatedRows(const uint32_t cLastY)
+{
+  const ptrdiff_t cRegionBytes = static_cast<ptrdiff_t>(mRegion.width) * mPixelSize;
+  uint8_t *pFirst = mpOrigin + (static_cast<ptrdiff_t>(cLastY + 1 - mRotateCount) * mRowStep);
+
+  for (uint32_t x = 0; x < mRegion.width; x ++)
+  {
+    mScatter(mRotateRows.data() + (static_cast<size_t>(x) * mPixelSize), cRegionBytes,
+             pFirst + (static_cast<ptrdiff_t>(x) * mColumnStep), mRowStep, mRotateCount);
+  }
+
+  mRotateCount = 0;
+  mRowsWritten = cLastY + 1;
+}
+
+/* Function:    writeScaledRow
+   Description: Writes one finished row of a scaled decode to its place in the output, columns are scattered when
+                the orientation turns them into a column or reverses them
+   Parameters:  uint32_t - Row of the scaled image
+                uint8_t* - Scaled pixels
+   Returns:     None
+ */
+void Png::writeScaledRow(const uint32_t cY, const uint8_t *cpRow)
+{
+  uint8_t *pRow = mpOrigin + (static_cast<ptrdiff_t>(cY) * mRowStep);
+
+  if (mColumnStep == static_cast<ptrdiff_t>(mPixelSize))
+  {
+    memcpy(pRow, cpRow, static_cast<size_t>(mScale.width) * mPixelSize);
+  }
+  else
+  {
+    mScatter(cpRow, mPixelSize, pRow, mColumnStep, mScale.width);
+  }
+}
+
+/* Function:    startInterlaced
+   Description: Prepares the scanline decoder for the seven Adam7 sub-images. Every pass is decoded in full and its
+                rows are scattered over the region as they arrive, so no sub-image is ever held in memory.
+   Parameters:  size_t - Bits per pixel in the file
+                uint8_t - Bytes per complete pixel, rounded up to 1
+                uint8_t - Bytes per decoded pixel
+   Returns:     None
+ */
+void Png::startInterlaced(const size_t cSampleBits, const uint8_t cBpp, const uint8_t cPixelSize)
+{
+  // Passes without columns or rows have no scanlines at all in the stream
+  mPassLayout.clear();
+
+  for (uint8_t pass = 0; pass < ADAM7_PASSES; pass ++)
+  {
+    const uint32_t cColumns = adam7Count(mIhdr.width, cAdam7[pass].x, cAdam7[pass].dx);
+    const uint32_t cRows = adam7Count(mIhdr.height, cAdam7[pass].y, cAdam7[pass].dy);
+
+    if (cColumns != 0 && cRows != 0)
+    {
+      mPassLayout.push_back({((static_cast<size_t>(cColumns) * cSampleBits) + 7) / 8, cRows});
+    }
+  }
+
+  mPass = 0;
+  mPassFirstRow = 0;
+  mPassPixels.resize(static_cast<size_t>(mIhdr.width) * cPixelSize);
+
+  if (mpScanlines->begin(mPassLayout, cBpp, [this](const uint32_t cRow, const uint8_t *cpRow)
+      {
+        storeInterlacedRow(cRow, cpRow);
+      }) != SUCCESS)
+  {
+    throw PngException(mpScanlines->getError());
+  }
+}
+
+/* Function:    storeInterlacedRow
+   Description: Expands the region's columns of one pass scanline and scatters them to their place in the image
+   Parameters:  uint32_t - Row number across all passes
+                uint8_t* - Reconstructed pass scanline
+   Returns:     None
+ */
+void Png::storeInterlacedRow(const uint32_t cRow, const uint8_t *cpRow)
+{
+  uint32_t rows = adam7Count(mIhdr.height, cAdam7[mPass].y, cAdam7[mPass].dy);
+  uint32_t columns = adam7Count(mIhdr.width, cAdam7[mPass].x, cAdam7[mPass].dx);
+
+  // Rows arrive in order, skip ahead over passes that are finished or empty
+  while (rows == 0 || columns == 0 || cRow >= (mPassFirstRow + rows))
+  {
+    mPassFirstRow += (columns != 0) ? rows : 0;
+    mPass ++;
+    rows = adam7Count(mIhdr.height, cAdam7[mPass].y, cAdam7[mPass].dy);
+    columns = adam7Count(mIhdr.width, cAdam7[mPass].x, cAdam7[mPass].dx);
+  }
+
+  const Adam7Pass &crPass = cAdam7[mPass];
+  const uint32_t cY = crPass.y + ((cRow - mPassFirstRow) * crPass.dy);
+  const uint32_t cRegionEnd = mRegion.x + mRegion.width;
+
+  if (mScaled)
+  {
+    mExpand(cpRow, mPassPixels.data(), 0, columns, mPalette.data());
+    applyColor(mPassPixels.data(), columns);
+    mScaler.addRow(cY, mPassPixels.data(), crPass.x, crPass.dx, columns);
+  }
+  else if (cY >= mRegion.y && cY < (mRegion.y + mRegion.height))
+  {
+    // Pass columns that land inside the region
+    const uint32_t cFirst = (mRegion.x > crPass.x) ? ((mRegion.x - crPass.x + crPass.dx - 1) / crPass.dx) : 0;
+    const uint32_t cLast = std::min(columns, adam7Count(cRegionEnd, crPass.x, crPass.dx));
+
+    if (cLast > cFirst)
+    {
+      const size_t cX = crPass.x + (static_cast<size_t>(cFirst) * crPass.dx) - mRegion.x;
+      uint8_t *pFirst = mpOrigin + (static_cast<ptrdiff_t>(cX) * mColumnStep) +
+                        (static_cast<ptrdiff_t>(cY - mRegion.y) * mRowStep);
+
+      mExpand(cpRow, mPassPixels.data(), cFirst, cLast - cFirst, mPalette.data());
+      applyColor(mPassPixels.data(), cLast - cFirst);
+      mScatter(mPassPixels.data(), mPixelSize, pFirst, static_cast<ptrdiff_t>(crPass.dx) * mColumnStep, cLast - cFirst);
+    }
+  }
+
+  if (cRow + 1 != mPassFirstRow + rows)
+  {
+    return;
+  }
+
+  mPassesDone ++;
+
+  // Scaled passes only reach the output once the last one is in
+  if (mPassCallback && !mScaled)
+  {
+    mPassCallback(static_cast<uint8_t>(mPass + 1));
+  }
+}
+
+/* Function:    uncompressIDAT
+   Description: Streams one IDAT chunk into the scanline decoder. Memory backed sources hand zlib the chunk payload
+                in place, file streams go through one CHUNK_SIZE buffer that is reused for every chunk. The CRC is
+                taken over each piece right before it is inflated, while it is still in cache. A banded decode
+                collects the chunk for the band it belongs to instead.
+   Parameters:  uint32_t - Amount of bytes in the IDAT chunk
+   Returns:     None
+ */
+void Png::uncompressIDAT(const uint32_t cChunkLength)
+{
+  size_t remaining = cChunkLength;
+  const uint8_t *cpData = nullptr;
+
+  if (mBanded)
+  {
+    mpBands->startChunk(mChunks.back().offset - mIdotOffset);
+  }
+
+  while (remaining > 0)
+  {
+    if (mBanded && mpBands->finished())
+    {
+      skipChunkData(remaining);
+      break;
+    }
+
+    const size_t cRead = mpSource->readSome(remaining, &cpData);
+
+    if (cRead == 0)
+    {
+      break;
+    }
+
+    if (mCheckCrc)
+    {
+      mChunkCrc = crc32Update(mChunkCrc, cpData, cRead);
+    }
+
+    if (mBanded)
+    {
+      mpBands->feed(cpData, cRead);
+      remaining -= cRead;
+      continue;
+    }
+
+    const uint64_t cStart = statsStart(mCollectStats);
+
+    if (mpScanlines->feed(cpData, cRead) != SUCCESS)
+    {
+      throw PngException(mpScanlines->getError());
+    }
+
+    statsStop(mScanlineNs, cStart, mCollectStats);
+
+    if (mpScanlines->finished())
+    {
+      skipChunkData(remaining - cRead);
+      break;
+    }
+
+    remaining -= cRead;
+  }
+}
+
+/* Function:    endIDAT
+   Description: Waits for the scanline decoder to reconstruct every row once the IDAT chain is broken and checks the
+                chain held all of the rows that were asked for
+   Parameters:  None
+   Returns:     None
+ */
+void Png::endIDAT()
+{
+  const uint64_t cStart = statsStart(mCollectStats);
+
+  if (mBanded && mpBands->finish() != SUCCESS)
+  {
+    throw PngException(mpBands->getError());
+  }
+
+  if (!mBanded && mpScanlines->finish() != SUCCESS)
+  {
+    throw PngException(mpScanlines->getError());
+  }
+
+  statsStop(mScanlineNs, cStart, mCollectStats);
+
+  const uint32_t cRowsDone = mBanded ? mpBands->rowsDone() : mpScanlines->rowsDone();
+  const uint32_t cRows = mBanded ? mpBands->rows() : mpScanlines->rows();
+
+  if (cRowsDone < cRows)
+  {
+    throw PngException("Error! IDAT data ended after " + std::to_string(cRowsDone) + " of " +
+                       std::to_string(cRows) + " scanlines.");
+  }
+
+  if (mScaled)
+  {
+    mScaler.finish();
+  }
+}
+
+/* Function:    readBigEndian32
+   Description: Reads a 4 byte big endian value out of chunk data
+   Parameters:  uint8_t* - First byte of the value
+   Returns:     uint32_t - Value in host byte order
+ */
+static uint32_t readBigEndian32(const uint8_t *cpData)
+{
+  uint32_t value = 0;
+
+  memcpy(&value, cpData, sizeof(uint32_t));
+
+  return htonl(value);
+}
+
+/* Function:    getCanvasFormat
+   Description: Gets the format animation frames are drawn in, the canvas always holds four byte pixels with alpha
+   Parameters:  PixelFormat - Output format set on the png object
+   Returns:     PixelFormat - PIXEL_BGRA8 when asked for, PIXEL_RGBA8 otherwise
+ */
+static PixelFormat getCanvasFormat(const PixelFormat cFormat)
+{
+  return (cFormat == PIXEL_BGRA8) ? PIXEL_BGRA8 : PIXEL_RGBA8;
+}
+
+/* Function:    checkSequence
+   Description: Checks the sequence number that starts every fcTL and fdAT chunk, they count up from 0 across both
+   Parameters:  uint8_t* - Sequence number of the chunk
+   Returns:     None
+ */
+void Png::checkSequence(const uint8_t *cpSequence)
+{
+  if (readBigEndian32(cpSequence) != mSequence)
+  {
+    throw PngException("Error! APNG chunk " + std::to_string(readBigEndian32(cpSequence)) + " is out of sequence.");
+  }
+
+  mSequence ++;
+}
+
+/* Function:    parseACTL
+   Description: Parses the acTL chunk that marks the png as animated
+   Parameters:  uint32_t - Amount of bytes to read
+   Returns:     None
+ */
+void Png::parseACTL(const uint32_t cChunkLength)
+{
+  const uint8_t *cpData = nullptr;
+
+  if (cChunkLength != 2 * sizeof(uint32_t))
+  {
+    throw PngException("Error! Invalid acTL length.");
+  }
+
+  if ((mValidPngMask & IDAT_MASK) != 0 || mAnimated)
+  {
+    throw PngException("Error! acTL chunk must appear once before first IDAT chunk");
+  }
+
+  cpData = readChunkData(cChunkLength);
+  mFrameCount = readBigEndian32(cpData);
+
+  if (mFrameCount == 0)
+  {
+    throw PngException("Error! acTL chunk has no frames.");
+  }
+
+  mAnimated = true;
+}
+
+/* Function:    parseFCTL
+   Description: Parses the fcTL chunk of the next frame, it is drawn once its IDAT or fdAT chunks are read
+   Parameters:  uint32_t - Amount of bytes to read
+   Returns:     None
+ */
+void Png::parseFCTL(const uint32_t cChunkLength)
+{
+  const uint8_t *cpData = nullptr;
+  struct Frame frame;
+
+  if (cChunkLength != 26)
+  {
+    throw PngException("Error! Invalid fcTL length.");
+  }
+
+  if (mHaveNextFrame)
+  {
+    throw PngException("Error! fcTL chunk is not followed by frame data.");
+  }
+
+  if (mAnimated && mFramesDone >= mFrameCount)
+  {
+    throw PngException("Error! APNG has more frames than its acTL chunk.");
+  }
+
+  cpData = readChunkData(cChunkLength);
+  checkSequence(cpData);
+  frame.index = mFramesDone;
+  frame.width = readBigEndian32(cpData + 4);
+  frame.height = readBigEndian32(cpData + 8);
+  frame.x = readBigEndian32(cpData + 12);
+  frame.y = readBigEndian32(cpData + 16);
+  frame.delayNum = static_cast<uint16_t>((cpData[20] << 8) | cpData[21]);
+  frame.delayDen = static_cast<uint16_t>((cpData[22] << 8) | cpData[23]);
+
+  if (frame.width == 0 || frame.height == 0 || frame.width > mIhdr.width || frame.height > mIhdr.height ||
+      frame.x > (mIhdr.width - frame.width) || frame.y > (mIhdr.height - frame.height))
+  {
+    throw PngException("Error! fcTL frame does not fit on the canvas.");
+  }
+
+  if (cpData[24] > DISPOSE_PREVIOUS || cpData[25] > BLEND_OVER)
+  {
+    throw PngException("Error! Invalid fcTL dispose or blend op.");
+  }
+
+  frame.dispose = static_cast<DisposeOp>(cpData[24]);
+  frame.blend = static_cast<BlendOp>(cpData[25]);
+  mNextFrame = frame;
+  mHaveNextFrame = true;
+}
+
+/* Function:    startAnimation
+   Description: Prepares the canvas and the kernels every frame is drawn with. The canvas is the size of the image
+                and starts out transparent black, orientation and scaling do not apply to animations.
+   Parameters:  None
+   Returns:     None
+ */
+void Png::startAnimation()
+{
+  const PixelFormat cFormat = getCanvasFormat(mPixelFormat);
+
+  mImgData.assign(static_cast<size_t>(mIhdr.width) * RGBASIZE * mIhdr.height, 0);
+  mImgWidth = mIhdr.width;
+  mImgHeight = mIhdr.height;
+  mImgPixelSize = RGBASIZE;
+  mPassPixels.resize(static_cast<size_t>(mIhdr.width) * RGBASIZE);
+
+  if (mpScanlines == nullptr)
+  {
+    mpOwnScanlines.reset(new ScanlineDecoder());
+    mpScanlines = mpOwnScanlines.get();
+  }
+
+  mpScanlines->setInflateEngine(mInflateEngine);
+  mpScanlines->setCollectStats(mCollectStats);
+  mBanded = false;
+  mExpand = getConvertKernel(mIhdr.colorType, mIhdr.bitDepth, cFormat, mAlphaMode);
+  mScatter = getScatterKernel(RGBASIZE);
+  mBlend = getBlendKernel(mAlphaMode);
+  mPixelSize = RGBASIZE;
+  mAnimState = ANIM_FRAMES;
+}
+
+/* Function:    startFrame
+   Description: Makes the frame read ahead the current one and starts its zlib stream. Every frame reuses the
+                scanline decoder and its row buffers, rows of a progressive frame are gathered in mFramePixels and
+                only drawn once the frame is complete.
+   Parameters:  None
+   Returns:     None
+ */
+void Png::startFrame()
+{
+  const size_t cSampleBits = static_cast<size_t>(getSampleChannels(mIhdr.colorType)) * mIhdr.bitDepth;
+  const uint8_t cBpp = static_cast<uint8_t>(std::max<size_t>(1, cSampleBits / 8));
+  const size_t cCanvasStride = static_cast<size_t>(mIhdr.width) * RGBASIZE;
+
+  mFrame = mNextFrame;
+  mHaveNextFrame = false;
+
+  if (mFramesDone == 0)
+  {
+    if (mIhdr.colorType == PLTE && mPaletteEntries == 0)
+    {
+      throw PngException("Error! Palette image has no PLTE chunk before IDAT.");
+    }
+
+    setupColor(getCanvasFormat(mPixelFormat));
+    mExpand = getConvertKernel(mIhdr.colorType, mIhdr.bitDepth, getCanvasFormat(mPixelFormat), getExpandAlpha());
+
+    if (mIhdr.colorType == PLTE)
+    {
+      convertPalette(mPalette.data(), getCanvasFormat(mPixelFormat), mAlphaMode);
+    }
+
+    // There is nothing before the first frame to go back to
+    if (mFrame.dispose == DISPOSE_PREVIOUS)
+    {
+      mFrame.dispose = DISPOSE_BACKGROUND;
+    }
+  }
+
+  if (mFrame.dispose == DISPOSE_PREVIOUS)
+  {
+    const size_t cRectBytes = static_cast<size_t>(mFrame.width) * RGBASIZE;
+
+    mSavedRect.resize(cRectBytes * mFrame.height);
+
+    for (uint32_t y = 0; y < mFrame.height; y ++)
+    {
+      memcpy(mSavedRect.data() + (y * cRectBytes),
+             mImgData.data() + ((mFrame.y + y) * cCanvasStride) + (static_cast<size_t>(mFrame.x) * RGBASIZE),
+             cRectBytes);
+    }
+  }
+
+  mPass = 0;
+  mPassFirstRow = 0;
+
+  if (mIhdr.interfaceMethod == 1)
+  {
+    mPassLayout.clear();
+
+    for (uint8_t pass = 0; pass < ADAM7_PASSES; pass ++)
+    {
+      const uint32_t cColumns = adam7Count(mFrame.width, cAdam7[pass].x, cAdam7[pass].dx);
+      const uint32_t cRows = adam7Count(mFrame.height, cAdam7[pass].y, cAdam7[pass].dy);
+
+      if (cColumns != 0 && cRows != 0)
+      {
+        mPassLayout.push_back({((static_cast<size_t>(cColumns) * cSampleBits) + 7) / 8, cRows});
+      }
+    }
+
+    mFramePixels.resize(static_cast<size_t>(mFrame.width) * RGBASIZE * mFrame.height);
+
+    if (mpScanlines->begin(mPassLayout, cBpp, [this](const uint32_t cRow, const uint8_t *cpRow)
+        {
+          storeFramePassRow(cRow, cpRow);
+        }) != SUCCESS)
+    {
+      throw PngException(mpScanlines->getError());
+    }
+
+    return;
+  }
+
+  if (mpScanlines->begin(((static_cast<size_t>(mFrame.width) * cSampleBits) + 7) / 8, mFrame.height, cBpp,
+                         [this](const uint32_t cRow, const uint8_t *cpRow)
+      {
+        storeFrameRow(cRow, cpRow);
+      }, false) != SUCCESS)
+  {
+    throw PngException(mpScanlines->getError());
+  }
+}
+
+/* Function:    storeFrameRow
+   Description: Draws one reconstructed scanline of a frame onto the canvas. BLEND_SOURCE rows are expanded straight
+                into place, BLEND_OVER rows are expanded into one row of scratch and blended from there.
+   Parameters:  uint32_t - Row within the frame
+                uint8_t* - Reconstructed scanline
+   Returns:     None
+ */
+void Png::storeFrameRow(const uint32_t cRow, const uint8_t *cpRow)
+{
+  uint8_t *pDst = mImgData.data() + (((static_cast<size_t>(mFrame.y) + cRow) * mIhdr.width) + mFrame.x) * RGBASIZE;
+
+  if (mFrame.blend == BLEND_SOURCE)
+  {
+    mExpand(cpRow, pDst, 0, mFrame.width, mPalette.data());
+    applyColor(pDst, mFrame.width);
+  }
+  else
+  {
+    mExpand(cpRow, mPassPixels.data(), 0, mFrame.width, mPalette.data());
+    applyColor(mPassPixels.data(), mFrame.width);
+    mBlend(mPassPixels.data(), pDst, mFrame.width);
+  }
+}
+
+/* Function:    storeFramePassRow
+   Description: Expands one pass scanline of a progressive frame and scatters it over the frame pixels
+   Parameters:  uint32_t - Row number across all passes
+                uint8_t* - Reconstructed pass scanline
+   Returns:     None
+ */
+void Png::storeFramePassRow(const uint32_t cRow, const uint8_t *cpRow)
+{
+  uint32_t rows = adam7Count(mFrame.height, cAdam7[mPass].y, cAdam7[mPass].dy);
+  uint32_t columns = adam7Count(mFrame.width, cAdam7[mPass].x, cAdam7[mPass].dx);
+
+  while (rows == 0 || columns == 0 || cRow >= (mPassFirstRow + rows))
+  {
+    mPassFirstRow += (columns != 0) ? rows : 0;
+    mPass ++;
+    rows = adam7Count(mFrame.height, cAdam7[mPass].y, cAdam7[mPass].dy);
+    columns = adam7Count(mFrame.width, cAdam7[mPass].x, cAdam7[mPass].dx);
+  }
+
+  const Adam7Pass &crPass = cAdam7[mPass];
+  const size_t cY = crPass.y + (static_cast<size_t>(cRow - mPassFirstRow) * crPass.dy);
+
+  mExpand(cpRow, mPassPixels.data(), 0, columns, mPalette.data());
+  applyColor(mPassPixels.data(), columns);
+  mScatter(mPassPixels.data(), RGBASIZE, mFramePixels.data() + (((cY * mFrame.width) + crPass.x) * RGBASIZE),
+           static_cast<ptrdiff_t>(crPass.dx) * RGBASIZE, columns);
+}
+
+/* Function:    endFrame
+   Description: Finishes the zlib stream of a frame once its chain of IDAT or fdAT chunks is broken, a progressive
+                frame is drawn onto the canvas here
+   Parameters:  None
+   Returns:     None
+ */
+void Png::endFrame()
+{
+  const size_t cRectBytes = static_cast<size_t>(mFrame.width) * RGBASIZE;
+
+  endIDAT();
+
+  if (mIhdr.interfaceMethod == 1)
+  {
+    for (uint32_t y = 0; y < mFrame.height; y ++)
+    {
+      const uint8_t *cpSrc = mFramePixels.data() + (y * cRectBytes);
+      uint8_t *pDst = mImgData.data() + (((static_cast<size_t>(mFrame.y) + y) * mIhdr.width) + mFrame.x) * RGBASIZE;
+
+      if (mFrame.blend == BLEND_SOURCE)
+      {
+        memcpy(pDst, cpSrc, cRectBytes);
+      }
+      else
+      {
+        mBlend(cpSrc, pDst, mFrame.width);
+      }
+    }
+  }
+
+  mFramesDone ++;
+}
+
+/* Function:    disposeFrame
+   Description: Applies the dispose op of the last frame drawn to its rectangle, the rest of the canvas is untouched
+   Parameters:  None
+   Returns:     None
+ */
+void Png::disposeFrame()
+{
+  const size_t cRectBytes = static_cast<size_t>(mFrame.width) * RGBASIZE;
+
+  if (mFrame.dispose == DISPOSE_NONE)
+  {
+    return;
+  }
+
+  for (uint32_t y = 0; y < mFrame.height; y ++)
+  {
+    uint8_t *pDst = mImgData.data() + (((static_cast<size_t>(mFrame.y) + y) * mIhdr.width) + mFrame.x) * RGBASIZE;
+
+    if (mFrame.dispose == DISPOSE_BACKGROUND)
+    {
+      memset(pDst, 0, cRectBytes);
+    }
+    else
+    {
+      memcpy(pDst, mSavedRect.data() + (y * cRectBytes), cRectBytes);
+    }
+  }
+}
+
+/* Function:    inflateMetadata
+   Description: Inflates the zlib stream of an iCCP, zTXt or iTXt chunk
+   Parameters:  uint8_t* - Compressed data
+                size_t - Bytes of compressed data
+                std::vector<uint8_t> - Receives the inflated bytes
+   Returns:     Status - FAIL on corrupt data or more than METADATA_MAX_BYTES of output
+ */
+static Status inflateMetadata(const uint8_t *cpData, const size_t cSize, std::vector<uint8_t> &rOut)
+{
+  z_stream stream = {};
+  int result = Z_OK;
+
+  rOut.clear();
+
+  if (inflateInit(&stream) != Z_OK)
+  {
+    return FAIL;
+  }
+
+  stream.next_in = const_cast<Bytef *>(cpData);
+  stream.avail_in = static_cast<uInt>(cSize);
+
+  while (result == Z_OK && rOut.size() < METADATA_MAX_BYTES)
+  {
+    const size_t cUsed = rOut.size();
+
+    rOut.resize(std::min<size_t>(std::max<size_t>(cUsed * 2, 4096), METADATA_MAX_BYTES));
+    stream.next_out = rOut.data() + cUsed;
+    stream.avail_out = static_cast<uInt>(rOut.size() - cUsed);
+    result = inflate(&stream, Z_NO_FLUSH);
+    rOut.resize(stream.total_out);
+  }
+
+  inflateEnd(&stream);
+
+  return (result == Z_STREAM_END) ? SUCCESS : FAIL;
+}
+
+/* Function:    getChunks
+   Description: Gets the index of every chunk read so far, in file order
+   Parameters:  None
+   Returns:     std::vector<Chunk> - Type, data offset and length of each chunk
+ */
+const std::vector<Png::Chunk> &Png::getChunks() const
+{
+  return mChunks;
+}
+
+/* Function:    findChunk
+   Description: Looks up a chunk in the index
+   Parameters:  char* - Four letter chunk type
+                size_t - Which one of the chunks of that type, 0 for the first
+   Returns:     Chunk* - Index entry, nullptr if there is no such chunk
+ */
+const Png::Chunk *Png::findChunk(const char *cpType, const size_t cIndex) const
+{
+  size_t seen = 0;
+
+  for (const Chunk &crChunk : mChunks)
+  {
+    if (memcmp(crChunk.type, cpType, 4) == 0 && (seen ++) == cIndex)
+    {
+      return &crChunk;
+    }
+  }
+
+  return nullptr;
+}
+
+/* Function:    getChunkData
+   Description: Reads the data of an indexed chunk. Memory backed pngs hand out a pointer in place, file streams
+                read into a buffer that the next read reuses. The CRC is not checked again.
+   Parameters:  Chunk - Index entry
+   Returns:     uint8_t* - Chunk data, nullptr if the chunk is not inside the file
+ */
+const uint8_t *Png::getChunkData(const Chunk &crChunk)
+{
+  return mpSource->readAt(crChunk.offset, crChunk.length);
+}
+
+/* Function:    getGamma
+   Description: Reads the gAMA chunk
+   Parameters:  uint32_t - Set to the file gamma times 100000
+   Returns:     Status - FAIL if there is no valid gAMA chunk
+ */
+Status Png::getGamma(uint32_t &rGamma)
+{
+  const Chunk *cpChunk = findChunk("gAMA");
+  const uint8_t *cpData = (cpChunk != nullptr && cpChunk->length == 4) ? getChunkData(*cpChunk) : nullptr;
+
+  if (cpData == nullptr)
+  {
+    return FAIL;
+  }
+
+  memcpy(&rGamma, cpData, sizeof(uint32_t));
+  rGamma = htonl(rGamma);
+
+  return SUCCESS;
+}
+
+/* Function:    getSrgbIntent
+   Description: Reads the sRGB chunk
+   Parameters:  uint8_t - Set to the rendering intent, 0 perceptual to 3 absolute colorimetric
+   Returns:     Status - FAIL if there is no valid sRGB chunk
+ */
+Status Png::getSrgbIntent(uint8_t &rIntent)
+{
+  const Chunk *cpChunk = findChunk("sRGB");
+  const uint8_t *cpData = (cpChunk != nullptr && cpChunk->length == 1) ? getChunkData(*cpChunk) : nullptr;
+
+  if (cpData == nullptr || cpData[0] > 3)
+  {
+    return FAIL;
+  }
+
+  rIntent = cpData[0];
+
+  return SUCCESS;
+}
+
+/* Function:    getPhysicalSize
+   Description: Reads the pHYs chunk
+   Parameters:  PhysicalSize - Set to the pixels per unit and the unit
+   Returns:     Status - FAIL if there is no valid pHYs chunk
+ */
+Status Png::getPhysicalSize(struct PhysicalSize &rSize)
+{
+  const Chunk *cpChunk = findChunk("pHYs");
+  const uint8_t *cpData = (cpChunk != nullptr && cpChunk->length == 9) ? getChunkData(*cpChunk) : nullptr;
+
+  if (cpData == nullptr)
+  {
+    return FAIL;
+  }
+
+  memcpy(&rSize.x, cpData, sizeof(uint32_t));
+  memcpy(&rSize.y, cpData + 4, sizeof(uint32_t));
+  rSize.x = htonl(rSize.x);
+  rSize.y = htonl(rSize.y);
+  rSize.unit = cpData[8];
+
+  return SUCCESS;
+}
+
+/* Function:    getChromaticities
+   Description: Reads the cHRM chunk
+   Parameters:  Chromaticities - Set to the white point and primaries
+   Returns:     Status - FAIL if there is no valid cHRM chunk
+ */
+Status Png::getChromaticities(struct Chromaticities &rChromaticities)
+{
+  const Chunk *cpChunk = findChunk("cHRM");
+  const uint8_t *cpData = (cpChunk != nullptr && cpChunk->length == 32) ? getChunkData(*cpChunk) : nullptr;
+  uint32_t values[8];
+
+  if (cpData == nullptr)
+  {
+    return FAIL;
+  }
+
+  for (uint32_t i = 0; i < 8; i ++)
+  {
+    memcpy(&values[i], cpData + (i * sizeof(uint32_t)), sizeof(uint32_t));
+    values[i] = htonl(values[i]);
+  }
+
+  rChromaticities = {values[0], values[1], values[2], values[3], values[4], values[5], values[6], values[7]};
+
+  return SUCCESS;
+}
+
+/* Function:    getIccProfile
+   Description: Reads and inflates the iCCP chunk, nothing is inflated until this is called
+   Parameters:  std::string - Set to the profile name
+                std::vector<uint8_t> - Set to the ICC profile
+   Returns:     Status - FAIL if there is no iCCP chunk or it is corrupt
+ */
+Status Png::getIccProfile(std::string &rName, std::vector<uint8_t> &rProfile)
+{
+  const Chunk *cpChunk = findChunk("iCCP");
+  const uint8_t *cpData = (cpChunk != nullptr) ? getChunkData(*cpChunk) : nullptr;
+
+  if (cpData == nullptr)
+  {
+    return FAIL;
+  }
+
+  // Name of 1 to 79 bytes, its terminator and the compression method, which has to be deflate
+  const uint8_t *cpEnd = static_cast<const uint8_t *>(memchr(cpData, 0, std::min<size_t>(cpChunk->length, 80)));
+
+  if (cpEnd == nullptr || cpEnd == cpData || static_cast<size_t>(cpEnd - cpData) + 2 > cpChunk->length ||
+      cpEnd[1] != 0)
+  {
+    return FAIL;
+  }
+
+  rName.assign(reinterpret_cast<const char *>(cpData), cpEnd - cpData);
+
+  return inflateMetadata(cpEnd + 2, cpChunk->length - (cpEnd + 2 - cpData), rProfile);
+}
+
+/* Function:    parseText
+   Description: Splits a tEXt, zTXt or iTXt chunk into its fields
+   Parameters:  Chunk - Index entry of the text chunk
+                Text - Set to the fields of the chunk
+                bool - False to stop after the keyword, so a lookup by keyword inflates nothing it does not return
+   Returns:     Status - FAIL if the chunk is corrupt
+ */
+Status Png::parseText(const Chunk &crChunk, struct Text &rText, const bool cInflate)
+{
+  const uint8_t *cpData = getChunkData(crChunk);
+  const uint8_t *cpEnd = (cpData != nullptr) ? cpData + crChunk.length : nullptr;
+  const uint8_t *cpKeyEnd = (cpData != nullptr) ?
+                            static_cast<const uint8_t *>(memchr(cpData, 0, std::min<size_t>(crChunk.length, 80))) :
+                            nullptr;
+  const uint8_t *cpText = nullptr;
+  std::vector<uint8_t> inflated;
+
+  if (cpKeyEnd == nullptr || cpKeyEnd == cpData)
+  {
+    return FAIL;
+  }
+
+  rText.keyword.assign(reinterpret_cast<const char *>(cpData), cpKeyEnd - cpData);
+  rText.text.clear();
+  rText.language.clear();
+  rText.translatedKeyword.clear();
+  rText.compressed = (memcmp(crChunk.type, "zTXt", 4) == 0);
+  cpText = cpKeyEnd + 1;
+
+  if (memcmp(crChunk.type, "zTXt", 4) == 0)
+  {
+    // Compression method byte, always deflate
+    cpText ++;
+  }
+  else if (memcmp(crChunk.type, "iTXt", 4) == 0)
+  {
+    const uint8_t *cpLanguageEnd = nullptr;
+    const uint8_t *cpTranslatedEnd = nullptr;
+
+    if (cpEnd - cpText < 2)
+    {
+      return FAIL;
+    }
+
+    rText.compressed = (cpText[0] != 0);
+    cpText += 2;
+    cpLanguageEnd = static_cast<const uint8_t *>(memchr(cpText, 0, cpEnd - cpText));
+    cpTranslatedEnd = (cpLanguageEnd != nullptr) ?
+                      static_cast<const uint8_t *>(memchr(cpLanguageEnd + 1, 0, cpEnd - cpLanguageEnd - 1)) : nullptr;
+
+    if (cpTranslatedEnd == nullptr)
+    {
+      return FAIL;
+    }
+
+    rText.language.assign(reinterpret_cast<const char *>(cpText), cpLanguageEnd - cpText);
+    rText.translatedKeyword.assign(reinterpret_cast<const char *>(cpLanguageEnd + 1),
+                                   cpTranslatedEnd - cpLanguageEnd - 1);
+    cpText = cpTranslatedEnd + 1;
+  }
+
+  if (cpText > cpEnd)
+  {
+    return FAIL;
+  }
+
+  if (!cInflate)
+  {
+    return SUCCESS;
+  }
+
+  if (!rText.compressed)
+  {
+    rText.text.assign(reinterpret_cast<const char *>(cpText), cpEnd - cpText);
+    return SUCCESS;
+  }
+
+  if (inflateMetadata(cpText, cpEnd - cpText, inflated) == FAIL)
+  {
+    return FAIL;
+  }
+
+  rText.text.assign(inflated.begin(), inflated.end());
+
+  return SUCCESS;
+}
+
+/* Function:    getText
+   Description: Reads every tEXt, zTXt and iTXt chunk, inflating compressed text
+   Parameters:  std::vector<Text> - Set to the text chunks in file order
+   Returns:     Status - FAIL if a text chunk is corrupt, the chunks before it are still returned
+ */
+Status Png::getText(std::vector<struct Text> &rText)
+{
+  struct Text text;
+
+  rText.clear();
+
+  for (const Chunk &crChunk : mChunks)
+  {
+    if (memcmp(crChunk.type, "tEXt", 4) != 0 && memcmp(crChunk.type, "zTXt", 4) != 0 &&
+        memcmp(crChunk.type, "iTXt", 4) != 0)
+    {
+      continue;
+    }
+
+    if (parseText(crChunk, text, true) == FAIL)
+    {
+      return FAIL;
+    }
+
+    rText.push_back(text);
+  }
+
+  return SUCCESS;
+}
+
+/* Function:    getText
+   Description: Finds the first text chunk with a keyword, only that chunk is inflated
+   Parameters:  std::string - Keyword such as Title or Author
+                std::string - Set to the text
+   Returns:     Status - FAIL if no text chunk has the keyword or it is corrupt
+ */
+Status Png::getText(const std::string &crKeyword, std::string &rText)
+{
+  struct Text text;
+
+  for (const Chunk &crChunk : mChunks)
+  {
+    if (memcmp(crChunk.type, "tEXt", 4) != 0 && memcmp(crChunk.type, "zTXt", 4) != 0 &&
+        memcmp(crChunk.type, "iTXt", 4) != 0)
+    {
+      continue;
+    }
+
+    if (parseText(crChunk, text, false) == SUCCESS && text.keyword == crKeyword)
+    {
+      if (parseText(crChunk, text, true) == FAIL)
+      {
+        return FAIL;
+      }
+
+      rText = text.text;
+      return SUCCESS;
+    }
+  }
+
+  return FAIL;
+}
+
+/* Function:    readChunkHeader
+   Description: Reads the length and type that start every chunk
+   Parameters:  uint32_t - Set to the chunk data length
+                char* - Set to the NUL terminated chunk type, needs room for 5 bytes
+   Returns:     bool - False if the png data ended
+ */
+bool Png::readChunkHeader(uint32_t &rChunkLength, char *pChunkType)
+{
+  // Format for data is 4 bytes to give length of chunk buffer
+  // 4 bytes for chunk type
+  // X bytes of chunk data
+  // Topped off with 4 bytes of crc
+  const uint8_t *cpHeader = mpSource->read(2 * sizeof(uint32_t));
+  Chunk chunk;
+
+  if (cpHeader == nullptr)
+  {
+    return false;
+  }
+
+  memcpy(&rChunkLength, cpHeader, sizeof(uint32_t));
+  rChunkLength = htonl(rChunkLength);
+  memcpy(pChunkType, cpHeader + sizeof(uint32_t), sizeof(uint32_t));
+  pChunkType[4] = '\0';
+
+  // Only the position of the data goes in the index, it is read again when someone asks for it
+  memcpy(chunk.type, pChunkType, sizeof(chunk.type));
+  chunk.offset = mChunkOffset + (2 * sizeof(uint32_t));
+  chunk.length = rChunkLength;
+  mChunks.push_back(chunk);
+  mChunkOffset = chunk.offset + rChunkLength + sizeof(uint32_t);
+
+  // Bit 5 of the first type byte is clear for critical chunks, the CRC covers the type and the data
+  mCheckCrc = (mCrcMode == CRC_VERIFY_ALL) || ((mCrcMode == CRC_CRITICAL) && ((pChunkType[0] & 0x20) == 0));
+  mChunkCrc = mCheckCrc ? crc32Update(0, cpHeader + sizeof(uint32_t), sizeof(uint32_t)) : 0;
+
+  if (STATS_ENABLED && mCollectStats)
+  {
+    mStats.chunks ++;
+    mStats.bytesIn += (3 * sizeof(uint32_t)) + rChunkLength;
+  }
+
+  return true;
+}
+
+/* Function:    readSignature
+   Description: Checks the 8 byte signature every png starts with
+   Parameters:  None
+   Returns:     None
+ */
+void Png::readSignature()
+{
+  // Header is 8 bytes long, every png has this, use to confirm file format is png
+  const uint8_t *cpSignature = mpSource->read(sizeof(uint64_t));
+
+  if(cpSignature == nullptr || memcmp(cpSignature, pngSignature.data(), sizeof(uint64_t)) != 0)
+  {
+    throw PngException("Not a PNG format");
+  }
+
+  mChunkOffset = sizeof(uint64_t);
+
+  if (STATS_ENABLED && mCollectStats)
+  {
+    mStats.bytesIn += sizeof(uint64_t);
+  }
+}
+
+/* Function:    readHeader
+   Description: Checks the png signature and parses the IHDR that has to follow it, nothing after IHDR is read
+   Parameters:  None
+   Returns:     None
+ */
+void Png::readHeader()
+{
+  uint32_t chunkLength;
+  char chunkType[5] = {0};
+
+// TODO: Move check
+  if(!mpSource->good())
+  {
+    throw PngException("Png file descriptor is not good.");
+  }
+
+  readSignature();
+
+  if (!readChunkHeader(chunkLength, chunkType) || strcmp(chunkType, "IHDR\0") != 0)
+  {
+    throw PngException("Error! Invalid PNG file, IHDR chunk did not follow PNG signature.");
+  }
+
+  mValidPngMask |= IHDR_MASK;
+  parseIHDR(chunkLength);
+  mRegion = {0, 0, mIhdr.width, mIhdr.height};
+  checkChunkCrc(chunkType);
+}
+
+/* Function:    readChunks
+   Description: Parses every chunk after IHDR. IDAT chunks are inflated and unfiltered as they are read, so the
+                compressed and filtered data are never held in full.
+   Parameters:  None
+   Returns:     None
+ */
+void Png::readChunks()
+{
+  uint32_t chunkLength;
+  char chunkType[5] = {0};
+  const uint64_t cStart = statsStart(mCollectStats);
+
+  if (STATS_ENABLED && mCollectStats)
+  {
+    mScanlineNs = 0;
+    mStatsCapacity[0] = mImgData.capacity();
+    mStatsCapacity[1] = mPassPixels.capacity();
+    mStatsCapacity[2] = mRotateRows.capacity();
+  }
+
+  while (strcmp(chunkType, "IEND\0") != 0 && mpSource->good())
+  {
+    if (!readChunkHeader(chunkLength, chunkType))
+    {
+      break;
+    }
+
+    // IDAT chain is broken so every scanline should have been decoded by now
+    if((((mValidPngMask & IDAT_CHAIN) >> 3) == 1) && (strcmp(chunkType, "IDAT\0") != 0))
+    {
+      mValidPngMask &= 0xF7;
+      endIDAT();
+    }
+
+    if (strcmp(chunkType, "IDAT\0") == 0 && mMetadataOnly)
+    {
+      // Pixel data is only indexed, its CRC can not be checked without reading it
+      mValidPngMask |= IDAT_MASK;
+      mCheckCrc = false;
+      skipChunkData(chunkLength);
+    }
+    else if (strcmp(chunkType, "IDAT\0") == 0)
+    {
+      if ((mValidPngMask & IDAT_MASK) == 0)
+      {
+        mValidPngMask |= IDAT_MASK;
+        startIDAT();
+      }
+      else if ((mValidPngMask & IDAT_CHAIN) == 0)
+      {
+        throw PngException("Error! IDAT chunks must be consecutive");
+      }
+
+      // Start of the IDAT chain, every following IDAT continues the same zlib stream
+      if ((mValidPngMask & IDAT_CHAIN) == 0)
+      {
+        mValidPngMask |= IDAT_CHAIN;
+      }
+
+      if (STATS_ENABLED && mCollectStats)
+      {
+        mStats.idatChunks ++;
+        mStats.compressedBytes += chunkLength;
+      }
+
+      uncompressIDAT(chunkLength);
+
+      // A region that ends above the last row is done, nothing after it needs to be read
+      if ((mBanded ? mpBands->finished() : mpScanlines->finished()) && (mRegion.y + mRegion.height) < mIhdr.height)
+      {
+        mValidPngMask &= 0xF7;
+        endIDAT();
+        checkChunkCrc(chunkType);
+        break;
+      }
+    }
+    else if (strcmp(chunkType, "PLTE\0") == 0)
+    {
+      if ((mValidPngMask & IDAT_MASK) != 0)
+      {
+        throw PngException("Error! PLTE chunk must appear before first IDAT chunk");
+      }
+
+      parsePLTE(chunkLength);
+    }
+    else if (strcmp(chunkType, "tRNS\0") == 0)
+    {
+      if ((mValidPngMask & IDAT_MASK) != 0)
+      {
+        throw PngException("Error! tRNS chunk must appear before first IDAT chunk");
+      }
+
+      parseTRNS(chunkLength);
+    }
+    else if (strcmp(chunkType, "iCCP\0") == 0)
+    {
+      if ((mValidPngMask & IDAT_MASK) != 0)
+      {
+        throw PngException("Error! iCCP chunk must appear before first IDAT chunk");
+      }
+
+      skipChunkData(chunkLength);
+    }
+    else
+    {
+      // Ancillary chunks are only indexed, the metadata accessors read them when asked
+      skipChunkData(chunkLength);
+    }
+
+    checkChunkCrc(chunkType);
+  }
+
+  // File ended in the middle of the IDAT chain
+  if ((mValidPngMask & IDAT_CHAIN) != 0)
+  {
+    mValidPngMask &= 0xF7;
+    endIDAT();
+  }
+
+  if (strcmp(chunkType, "IEND\0") == 0)
+  {
+    mValidPngMask |= IEND_MASK;
+  }
+
+  if (STATS_ENABLED && mCollectStats)
+  {
+    finishStats(cStart);
+  }
+
+  // Never hold on to a caller's buffer past the decode
+  mpOut = nullptr;
+  mOutStride = 0;
+  mScaled = false;
+}
+
+/* Function:    readPng
+   Description: Parses an entire png file and stores rgb values to recreate img
+   Parameters:  DecodeMode - DECODE_HEADER stops right after IHDR, DECODE_METADATA reads every chunk but IDAT
+   Returns:     None
+ */
+void Png::readPng(const DecodeMode cMode)
+{
+  const uint64_t cStart = statsStart(mCollectStats);
+
+  if (STATS_ENABLED && mCollectStats)
+  {
+    mStats = DecodeStats();
+  }
+
+  mChunks.clear();
+  mChunkOffset = 0;
+  mMetadataOnly = (cMode == DECODE_METADATA);
+  mScaled = false;
+  readHeader();
+  statsStop(mStats.stageNs[STATS_READ], cStart, mCollectStats);
+
+  if (cMode != DECODE_HEADER)
+  {
+    readChunks();
+  }
+}
+
+/* Function:    Png
+   Description: Constructs png object reading from a source, every other constructor starts here so each member
+                is initialised in one place
+   Parameters:  PngSource* - Source the png object takes ownership of, nullptr to set one up later
+   Returns:     None
+ */
+Png::Png(PngSource *pSource) : mIhdr(), mValidPngMask(0), mChunkOffset(0), mMetadataOnly(false), mpOut(nullptr),
+                               mOutStride(0), mImgWidth(0), mImgHeight(0), mImgPixelSize(0), mpSource(pSource),
+                               mpScanlines(nullptr), mPipelined(false), mpBands(), mUseBands(true), mBanded(false),
+                               mIdotOffset(0), mInflateEngine(INFLATE_ZLIB), mCrcMode(CRC_VERIFY_ALL),
+                               mCheckCrc(false), mChunkCrc(0), mPaletteEntries(0),
+                               mExpand(nullptr), mScatter(nullptr), mPixelSize(0), mPass(0), mPassFirstRow(0),
+                               mPixelFormat(PIXEL_NATIVE), mAlphaMode(ALPHA_STRAIGHT), mColorTarget(COLOR_AS_STORED),
+                               mpColor(), mColorLayout(), mOrientation(ORIENT_NONE), mpOrigin(nullptr),
+                               mColumnStep(0), mRowStep(0), mRotateCount(0), mpPush(nullptr),
+                               mPushState(PUSH_STATE_SIGNATURE), mPushType(), mPushRemaining(0), mRowsWritten(0),
+                               mPassesDone(0), mScaled(false), mScale(), mAnimState(ANIM_START), mAnimated(false),
+                               mHaveNextFrame(false), mFrameCount(0), mSequence(0), mFramesDone(0), mFrame(),
+                               mNextFrame(), mBlend(nullptr), mCollectStats(false), mStats(), mScanlineNs(0),
+                               mStatsCapacity()
+{
+}
+
+/* Function:    Png
+   Description: Constructs png object
+   Parameters:  std::string - Filepath for png file to read from
+   Returns:     None
+ */
+Png::Png(const std::string &crPngPath) : Png(new StreamSource(crPngPath))
+{
+  readPng(DECODE_FULL);
+}
+
+/* Function:    Png
+   Description: Constructs png object, optionally memory mapping the file so no chunk is ever copied
+   Parameters:  std::string - Filepath for png file to read from
+                FileAccess - FILE_STREAM to read through a stream, FILE_MAP to map the whole file
+                DecodeMode - DECODE_HEADER to stop after IHDR and decode later
+   Returns:     None
+ */
+Png::Png(const std::string &crPngPath, const FileAccess cAccess, const DecodeMode cMode) : Png(nullptr)
+{
+  if (cAccess == FILE_MAP)
+  {
+    mpMappedFile.reset(new MappedFile(crPngPath));
+    mpSource.reset(new MemorySource(mpMappedFile->good() ? mpMappedFile->getBytes() : ByteSpan{nullptr, 0}));
+  }
+  else
+  {
+    mpSource.reset(new StreamSource(crPngPath));
+  }
+
+  readPng(cMode);
+}
+
+/* Function:    Png
+   Description: Constructs png object from a png file already in memory. The bytes are read in place and only
+                need to stay alive for the duration of the constructor.
+   Parameters:  ByteSpan - Whole png file
+                DecodeMode - DECODE_HEADER to stop after IHDR, the bytes then have to stay alive until decode
+   Returns:     None
+ */
+Png::Png(const ByteSpan &crPngBytes, const DecodeMode cMode) : Png(new MemorySource(crPngBytes))
+{
+  readPng(cMode);
+}
+
+/* Function:    reset
+   Description: Points the png object at another png file in memory, so one object keeps its settings, scanline
+                decoder and buffers over any number of images. Buffers keep their capacity, once they have grown to
+                fit the largest image a reset and decode of a memory backed file allocate nothing.
+   Parameters:  ByteSpan - Whole png file
+                DecodeMode - DECODE_HEADER to stop after IHDR, the bytes then have to stay alive until decode
+   Returns:     None
+ */
+void Png::reset(const ByteSpan &crPngBytes, const DecodeMode cMode)
+{
+  MemorySource *pMemory = dynamic_cast<MemorySource *>(mpSource.get());
+
+  // A decode that threw may have left a pipeline or band workers running
+  if (mpScanlines != nullptr)
+  {
+    mpScanlines->abort();
+  }
+
+  if (mpBands)
+  {
+    mpBands->abort();
+  }
+
+  mpMappedFile.reset();
+
+  if (pMemory != nullptr)
+  {
+    pMemory->reset(crPngBytes);
+  }
+  else
+  {
+    mpPush = nullptr;
+    mpSource.reset(new MemorySource(crPngBytes));
+  }
+
+  mValidPngMask = 0;
+  mImgData.clear();
+  mpOut = nullptr;
+  mOutStride = 0;
+  mCheckCrc = false;
+  mChunkCrc = 0;
+  mPaletteEntries = 0;
+  mPass = 0;
+  mPassFirstRow = 0;
+  mRotateCount = 0;
+  mBanded = false;
+  mAnimState = ANIM_START;
+  mAnimated = false;
+  mHaveNextFrame = false;
+  mFrameCount = 0;
+  mSequence = 0;
+  mFramesDone = 0;
+
+  readPng(cMode);
+}
+
+/* Function:    Png
+   Description: Constructs png object for a push decode, the file is handed to feed piece by piece as it arrives
+   Parameters:  None
+   Returns:     None
+ */
+Png::Png() : Png(nullptr)
+{
+  resetPush();
+}
+
+/* Function:    resetPush
+   Description: Starts a new push decode, keeping the settings, scanline decoder and buffers of the png object like
+                reset does. Bytes of the previous file that were never parsed are dropped.
+   Parameters:  None
+   Returns:     None
+ */
+void Png::resetPush()
+{
+  if (mpScanlines != nullptr)
+  {
+    mpScanlines->abort();
+  }
+
+  if (mpBands)
+  {
+    mpBands->abort();
+  }
+
+  mpMappedFile.reset();
+
+  if (mpPush != nullptr)
+  {
+    mpPush->reset();
+  }
+  else
+  {
+    mpPush = new PushSource();
+    mpSource.reset(mpPush);
+  }
+
+  mIhdr = IHDR();
+  mValidPngMask = 0;
+  mImgData.clear();
+  mpOut = nullptr;
+  mOutStride = 0;
+  mCheckCrc = false;
+  mChunkCrc = 0;
+  mPaletteEntries = 0;
+  mPass = 0;
+  mPassFirstRow = 0;
+  mRotateCount = 0;
+  mBanded = false;
+  mAnimState = ANIM_START;
+  mAnimated = false;
+  mHaveNextFrame = false;
+  mFrameCount = 0;
+  mSequence = 0;
+  mFramesDone = 0;
+  mChunks.clear();
+  mChunkOffset = 0;
+  mMetadataOnly = false;
+  mScaled = false;
+  mPushState = PUSH_STATE_SIGNATURE;
+  mPushRemaining = 0;
+  mRowsWritten = 0;
+  mPassesDone = 0;
+
+  if (STATS_ENABLED && mCollectStats)
+  {
+    mStats = DecodeStats();
+  }
+}
+
+/* Function:    feed
+   Description: Parses the next piece of a file arriving in pieces and decodes every row it completes, without ever
+                waiting for more. A feed stops right after IHDR with PUSH_HEADER so the output can be set up before
+                any row is decoded, the bytes after it are kept and parsed by the next feed, which can be empty.
+                Push decodes never pipeline, interlaced images report the whole image once per finished pass.
+   Parameters:  uint8_t* - Bytes that arrived, only read during the call
+                size_t - Amount of bytes, 0 to carry on with bytes kept from earlier feeds
+   Returns:     PushResult - PUSH_HEADER once IHDR is parsed, PUSH_ROWS if rows were written, PUSH_DONE at IEND
+                and PUSH_NEED_DATA otherwise. Corrupt data throws a PngException like a pull decode.
+ */
+Png::PushResult Png::feed(const uint8_t *cpData, const size_t cSize)
+{
+  const uint32_t cRowsBefore = mRowsWritten;
+  const uint8_t cPassesBefore = mPassesDone;
+  PushResult result = {PUSH_NEED_DATA, 0, 0};
+
+  if (mpPush == nullptr)
+  {
+    throw PngException("Error! Png object was not constructed for feed.");
+  }
+
+  mpPush->append(cpData, cSize);
+  result.status = runPush();
+  mpPush->keep();
+
+  if (mIhdr.interfaceMethod == 1 && mPassesDone != cPassesBefore)
+  {
+    result.rowCount = mRegion.height;
+  }
+  else if (mIhdr.interfaceMethod == 0)
+  {
+    result.firstRow = cRowsBefore;
+    result.rowCount = mRowsWritten - cRowsBefore;
+  }
+
+  if (result.status == PUSH_NEED_DATA && result.rowCount != 0)
+  {
+    result.status = PUSH_ROWS;
+  }
+
+  return result;
+}
+
+/* Function:    setPushOutput
+   Description: Has a push decode write its rows straight into a caller owned buffer instead of the png object, only
+                possible between PUSH_HEADER and the first IDAT chunk
+   Parameters:  uint8_t* - Destination buffer, has to stay alive until PUSH_DONE
+                size_t - Bytes between the start of two rows, 0 for tightly packed rows
+                size_t - Size of the destination buffer
+   Returns:     Status - FAIL if the png object is not between IHDR and IDAT of a push decode, the buffer is too
+                small or the stride is smaller than a row
+ */
+Status Png::setPushOutput(uint8_t *pDst, const size_t cStride, const size_t cSize)
+{
+  if (mpPush == nullptr || (mValidPngMask & IHDR_MASK) == 0 || (mValidPngMask & IDAT_MASK) != 0)
+  {
+    return FAIL;
+  }
+
+  const size_t cRequired = getRequiredSize(cStride);
+
+  if (pDst == nullptr || cRequired == 0 || cSize < cRequired)
+  {
+    return FAIL;
+  }
+
+  mpOut = pDst;
+  mOutStride = (cStride == 0) ? getRowBytes() : cStride;
+
+  return SUCCESS;
+}
+
+/* Function:    runPush
+   Description: Runs the chunk walk of a push decode for as long as the bytes that arrived allow. Every step only
+                starts once its bytes are all there, except chunk data that is not parsed as a whole, so a step that
+                has to wait has consumed nothing and simply runs again on the next feed.
+   Parameters:  None
+   Returns:     PushStatus - PUSH_HEADER right after IHDR, PUSH_DONE after IEND and PUSH_NEED_DATA otherwise
+ */
+Png::PushStatus Png::runPush()
+{
+  uint32_t chunkLength = 0;
+
+  while (true)
+  {
+    switch (mPushState)
+    {
+      case PUSH_STATE_SIGNATURE:
+        if (mpPush->available() < sizeof(uint64_t))
+        {
+          return PUSH_NEED_DATA;
+        }
+
+        readSignature();
+        mPushState = PUSH_STATE_HEADER;
+        break;
+      case PUSH_STATE_HEADER:
+        if (!readChunkHeader(chunkLength, mPushType))
+        {
+          return PUSH_NEED_DATA;
+        }
+
+        startPushChunk(chunkLength);
+        mPushState = PUSH_STATE_DATA;
+        break;
+      case PUSH_STATE_DATA:
+        if (!readPushData())
+        {
+          return PUSH_NEED_DATA;
+        }
+
+        mPushState = PUSH_STATE_CRC;
+        break;
+      case PUSH_STATE_CRC:
+        if (mpPush->available() < sizeof(uint32_t))
+        {
+          return PUSH_NEED_DATA;
+        }
+
+        checkChunkCrc(mPushType);
+        mPushState = PUSH_STATE_HEADER;
+
+        if (strcmp(mPushType, "IHDR\0") == 0)
+        {
+          return PUSH_HEADER;
+        }
+
+        if (strcmp(mPushType, "IEND\0") == 0)
+        {
+          mPushState = PUSH_STATE_END;
+          mValidPngMask |= IEND_MASK;
+          mpOut = nullptr;
+          mOutStride = 0;
+          return PUSH_DONE;
+        }
+
+        break;
+      default:
+        return PUSH_DONE;
+    }
+  }
+}
+
+/* Function:    startPushChunk
+   Description: Checks a chunk of a push decode may come where it does and gets the decoder ready for its data, the
+                same rules readChunks applies
+   Parameters:  uint32_t - Length of the chunk data
+   Returns:     None
+ */
+void Png::startPushChunk(const uint32_t cChunkLength)
+{
+  const bool cIdat = (strcmp(mPushType, "IDAT\0") == 0);
+
+  if ((mValidPngMask & IHDR_MASK) == 0 && strcmp(mPushType, "IHDR\0") != 0)
+  {
+    throw PngException("Error! Invalid PNG file, IHDR chunk did not follow PNG signature.");
+  }
+
+  // IDAT chain is broken so every scanline should have been decoded by now
+  if ((mValidPngMask & IDAT_CHAIN) != 0 && !cIdat)
+  {
+    mValidPngMask &= 0xF7;
+    endIDAT();
+  }
+
+  if (cIdat && (mValidPngMask & IDAT_MASK) == 0)
+  {
+    mValidPngMask |= IDAT_MASK | IDAT_CHAIN;
+    startIDAT();
+  }
+  else if (cIdat && (mValidPngMask & IDAT_CHAIN) == 0)
+  {
+    throw PngException("Error! IDAT chunks must be consecutive");
+  }
+  else if ((strcmp(mPushType, "PLTE\0") == 0 || strcmp(mPushType, "tRNS\0") == 0) &&
+           (mValidPngMask & IDAT_MASK) != 0)
+  {
+    throw PngException("Error! " + std::string(mPushType) + " chunk must appear before first IDAT chunk");
+  }
+  else if (strcmp(mPushType, "IEND\0") == 0 && (mValidPngMask & IDAT_MASK) == 0)
+  {
+    throw PngException("Error! Png has no IDAT chunk.");
+  }
+
+  mPushRemaining = cChunkLength;
+}
+
+/* Function:    readPushData
+   Description: Reads the data of the current chunk of a push decode. IHDR, PLTE and tRNS are parsed once all of
+                their data is there, IDAT data goes to the scanline decoder as it arrives and everything else is
+                only taken into the CRC.
+   Parameters:  None
+   Returns:     bool - False if the chunk needs more data
+ */
+bool Png::readPushData()
+{
+  const bool cIhdr = (strcmp(mPushType, "IHDR\0") == 0) && (mValidPngMask & IHDR_MASK) == 0;
+  const bool cIdat = (strcmp(mPushType, "IDAT\0") == 0);
+  const uint8_t *cpData = nullptr;
+
+  if (cIhdr || strcmp(mPushType, "PLTE\0") == 0 || strcmp(mPushType, "tRNS\0") == 0)
+  {
+    if (mPushRemaining > PUSH_CHUNK_MAX)
+    {
+      throw PngException("Error! " + std::string(mPushType) + " chunk is too long.");
+    }
+
+    if (mpPush->available() < mPushRemaining)
+    {
+      return false;
+    }
+
+    if (cIhdr)
+    {
+      mValidPngMask |= IHDR_MASK;
+      parseIHDR(mPushRemaining);
+      mRegion = {0, 0, mIhdr.width, mIhdr.height};
+    }
+    else if (mPushType[0] == 'P')
+    {
+      parsePLTE(mPushRemaining);
+    }
+    else
+    {
+      parseTRNS(mPushRemaining);
+    }
+
+    mPushRemaining = 0;
+    return true;
+  }
+
+  while (mPushRemaining > 0)
+  {
+    const size_t cRead = mpPush->readSome(mPushRemaining, &cpData);
+
+    if (cRead == 0)
+    {
+      return false;
+    }
+
+    if (mCheckCrc)
+    {
+      mChunkCrc = crc32Update(mChunkCrc, cpData, cRead);
+    }
+
+    if (cIdat && !mpScanlines->finished() && mpScanlines->feed(cpData, cRead) != SUCCESS)
+    {
+      throw PngException(mpScanlines->getError());
+    }
+
+    mPushRemaining -= static_cast<uint32_t>(cRead);
+  }
+
+  return true;
+}
+
+/* Function:    compareSize
+   Description: Compares if png size matches given arguments
+   Parameters:  uint32_t - Width limit
+                uint32_t Height limit
+   Returns:     Status failure/success status of function
+ */
+Status Png::compareSize(const uint32_t cWidth, const uint32_t cHeight)
+{
+  if(mIhdr.width != cWidth || mIhdr.height != cHeight)
+    return FAIL;
+
+  return SUCCESS;
+}
+
+/* Function:    ~Png
+   Description: Destroys png object
+   Parameters:  None
+   Returns:     None
+ */
+Png::~Png()
+{
+  // A decode that threw may have left the unfilter thread of a pipeline or band workers writing into this object
+  if (mpScanlines != nullptr)
+  {
+    mpScanlines->abort();
+  }
+
+  if (mpBands)
+  {
+    mpBands->abort();
+  }
+
+  mImgData.clear();
+}
+
+/* Function:    getImgData
+   Description: Getter function for imgData
+   Parameters:  None
+   Returns:     std::vector<uint8_t> - Decoded pixels, palette images as RGBA and 16 bit samples in host byte order
+ */
+std::vector<uint8_t> Png::getImgData()
+{
+  return mImgData;
+}
+
+/* Function:    takeImgData
+   Description: Moves the image data out of the png object without copying it
+   Parameters:  None
+   Returns:     std::vector<uint8_t> - Unfiltered image data, the png object is left without any
+ */
+std::vector<uint8_t> Png::takeImgData()
+{
+  return std::move(mImgData);
+}
+
+/* Function:    getRowBytes
+   Description: Gets the bytes in one decoded row of the image, without any padding. Rotating by 90 or 270 degrees
+                makes the rows as long as the image is high.
+   Parameters:  None
+   Returns:     size_t - Bytes per row
+ */
+size_t Png::getRowBytes()
+{
+  uint32_t width = 0;
+  uint32_t height = 0;
+
+  getOrientedSize({0, 0, mIhdr.width, mIhdr.height}, width, height);
+
+  return static_cast<size_t>(width) * handlePngColorType();
+}
+
+/* Function:    getRequiredSize
+   Description: Gets the buffer size decodeInto needs, known as soon as IHDR has been parsed. The last row does not
+                need the padding of the stride.
+   Parameters:  size_t - Bytes between the start of two rows, 0 for tightly packed rows
+   Returns:     size_t - Buffer size in bytes, 0 if the stride is smaller than a row
+ */
+size_t Png::getRequiredSize(const size_t cStride)
+{
+  return getRequiredSize({0, 0, mIhdr.width, mIhdr.height}, cStride);
+}
+
+/* Function:    getRequiredSize
+   Description: Gets the buffer size decodeRegionInto needs for a region of the image
+   Parameters:  Region - Columns and rows to decode
+                size_t - Bytes between the start of two rows, 0 for tightly packed rows
+   Returns:     size_t - Buffer size in bytes, 0 if the region is not inside the image or the stride is smaller
+                than a row of the region
+ */
+size_t Png::getRequiredSize(const Region &crRegion, const size_t cStride)
+{
+  uint32_t width = 0;
+  uint32_t height = 0;
+
+  getOrientedSize(crRegion, width, height);
+
+  const size_t cRowBytes = static_cast<size_t>(width) * handlePngColorType();
+  const size_t cStrideBytes = (cStride == 0) ? cRowBytes : cStride;
+
+  if (checkRegion(crRegion) != SUCCESS || cStrideBytes < cRowBytes)
+  {
+    return 0;
+  }
+
+  return (cStrideBytes * (height - 1)) + cRowBytes;
+}
+
+/* Function:    checkRegion
+   Description: Checks a region is non empty and inside the image
+   Parameters:  Region - Columns and rows to decode
+   Returns:     Status - FAIL if the region is empty or reaches outside the image
+ */
+Status Png::checkRegion(const Region &crRegion)
+{
+  if (crRegion.width == 0 || crRegion.height == 0 || crRegion.x >= mIhdr.width || crRegion.y >= mIhdr.height ||
+      crRegion.width > (mIhdr.width - crRegion.x) || crRegion.height > (mIhdr.height - crRegion.y))
   {
-    std::cout << "Error! Invalid image dimensions." << std::endl;
-    exit(-1);
+    return FAIL;
   }
+
+  return SUCCESS;
+}
+
+/* Function:    decode
+   Description: Decodes the image into the png object after a DECODE_HEADER construction
+   Parameters:  None
+   Returns:     Status - FAIL if the image has already been decoded
+ */
+Status Png::decode()
+{
+  return decodeRegion({0, 0, mIhdr.width, mIhdr.height});
 }
 
-/* Function:    subPixelRGB
-   Description: subtracts the RGB vals from two Pixels
-   Parameters:  struct RGB - Pixel 1 RGB values
-                struct RGB - Pixel 2 RGB values
-   Returns:     struct RGB - New pixel RGB values
+/* Function:    decodeRegion
+   Description: Decodes only part of the image into the png object after a DECODE_HEADER construction. Inflating
+                stops once the last row of the region has been reconstructed.
+   Parameters:  Region - Columns and rows to decode
+   Returns:     Status - FAIL if the region is not inside the image or the image has already been decoded
  */
-struct Png::RGB Png::subPixelRGB(const struct RGB cPixel1, const struct RGB cPixel2)
+Status Png::decodeRegion(const Region &crRegion)
 {
-  return {(uint8_t)((cPixel1.Red - cPixel2.Red)), (uint8_t)((cPixel1.Green - cPixel2.Green)),
-          (uint8_t)((cPixel1.Blue - cPixel2.Blue)), 0};
+  if (checkRegion(crRegion) != SUCCESS || (mValidPngMask & IDAT_MASK) != 0 || (mValidPngMask & IEND_MASK) != 0)
+  {
+    return FAIL;
+  }
+
+  mRegion = crRegion;
+  readChunks();
+
+  return SUCCESS;
 }
 
-/* Function:    addPixelRGB
-   Description: Adds the RGB vals from two Pixels
-   Parameters:  struct RGB - Pixel 1 RGB values
-                struct RGB - Pixel 2 RGB values
-   Returns:     struct RGB - New pixel RGB values
+/* Function:    decodeInto
+   Description: Decodes the image straight into a caller owned buffer after a DECODE_HEADER construction. Every row
+                is written once to its final place and the png object keeps no copy of the image.
+   Parameters:  uint8_t* - Destination buffer
+                size_t - Bytes between the start of two rows, 0 for tightly packed rows
+                size_t - Size of the destination buffer
+   Returns:     Status - FAIL if the buffer is too small, the stride is smaller than a row or the image has
+                already been decoded
  */
-struct Png::RGB Png::addPixelRGB(const struct RGB cPixel1, const struct RGB cPixel2)
+Status Png::decodeInto(uint8_t *pDst, const size_t cStride, const size_t cSize)
 {
-  return {(uint8_t)((cPixel1.Red + cPixel2.Red)), (uint8_t)((cPixel1.Green + cPixel2.Green)),
-          (uint8_t)((cPixel1.Blue + cPixel2.Blue)), 0};
+  return decodeRegionInto({0, 0, mIhdr.width, mIhdr.height}, pDst, cStride, cSize);
 }
 
-/* Function:    calcPaethByte
-   Description: Paeth Algorightm requires it to be run on each RGB byte
-   Parameters:  uint8_t - A pixel RGB byte
-                uint8_t - B pixel RGB byte
-                uint8_t - C pixel RGB byte
-   Returns:     uint8_t - Correct predictor pixel
+/* Function:    decodeRegionInto
+   Description: Decodes part of the image straight into a caller owned buffer after a DECODE_HEADER construction.
+                Only the columns of the region are copied out and inflating stops after its last row.
+   Parameters:  Region - Columns and rows to decode
+                uint8_t* - Destination buffer
+                size_t - Bytes between the start of two rows, 0 for tightly packed rows
+                size_t - Size of the destination buffer
+   Returns:     Status - FAIL if the region is not inside the image, the buffer is too small, the stride is smaller
+                than a row of the region or the image has already been decoded
  */
-uint8_t Png::calcPaethByte(const uint8_t cA, const uint8_t cB, const uint8_t cC)
+Status Png::decodeRegionInto(const Region &crRegion, uint8_t *pDst, const size_t cStride, const size_t cSize)
 {
-  int32_t p, pa, pb, pc;
-  // int32_t type cast needed because values can be negative
-  p = static_cast<int32_t>(cA) + static_cast<int32_t>(cB) - static_cast<int32_t>(cC);
-  pa = abs(p - static_cast<int32_t>(cA));
-  pb = abs(p - static_cast<int32_t>(cB));
-  pc = abs(p - static_cast<int32_t>(cC)); 
+  const size_t cRequired = getRequiredSize(crRegion, cStride);
 
-  if ((pa <= pb) && (pa <= pc))
+  if (pDst == nullptr || cRequired == 0 || cSize < cRequired)
   {
-    return cA;
+    return FAIL;
   }
-  else if (pb <= pc)
+
+  if ((mValidPngMask & IDAT_MASK) != 0 || (mValidPngMask & IEND_MASK) != 0)
   {
-    return cB;
+    return FAIL;
   }
-  else
-  {
-    return cC;
-  }
-}
-
-/* Function:    paethRGBBitDepth8
-   Description: Paeth Algorightm requires it to be run on each RGB byte
-   Parameters:  std::vector<uint8_t> - Structure containing unfiltered img data
-                uint32_t - Size of scanline row
-                uint8_t  - Number of bytes per pixel
-                uint32_t - Current index in mI vector
-   Returns:     struct RGB - Unfiltered Pixel Color
- */
-struct Png::RGB Png::paethRGBBitDepth8(const uint32_t cScanlineSize, const uint8_t cRgbSize, const uint32_t cCurrByte)
-{
-  /*
-  Calculates the PAETH algorithm.
-  The PAETH algorithm works on bytes, which means that one byte values will not work.
-  For example you need to add two rgb values and compare that with another value.
-  Assume 1 byte values 255 and 1. 255 + 1 overflows a uint8_t and results in 0.
-  The above would mean that 255 + 1 <= 255 which is wrong in the paeth algorithm.
-  
-  To Overcome this I converted the rgbs into an integer as 0x0000RRRRGGGGBBBB
-  This allows us to add integers without worrying about overflows.
-*/
-  struct RGB a, b, c, pr;
-  const uint32_t ULPix = cCurrByte - (cScanlineSize + cRgbSize);
-  const uint32_t leftBound = cCurrByte % cScanlineSize;
-  const int32_t upperBound = cCurrByte - cScanlineSize;
-
-  /* The below blocks gathers the pixel RGB to the left of the current index, the Pixel RGB to the upper left
-     of the current index, and the Pixel RGB above the current index
-  */
-  a.Red   = (leftBound != 0) ? mImgData[cCurrByte - cRgbSize] : 0;
-  a.Green = (leftBound != 0) ? mImgData[cCurrByte - (cRgbSize - 1)] : 0;
-  a.Blue  = (leftBound != 0) ? mImgData[cCurrByte - (cRgbSize - 2)] : 0;
-
-  if (mIhdr.colorType == RGBTRIPA)
-    a.Alpha  = (leftBound != 0) ? mImgData[cCurrByte - (cRgbSize - 3)] : 0;
-
-  b.Red   = (upperBound >= 0) ? mImgData[upperBound] : 0;
-  b.Green = (upperBound >= 0) ? mImgData[upperBound + 1] : 0;
-  b.Blue  = (upperBound >= 0) ? mImgData[upperBound + 2] : 0;
-
-  if (mIhdr.colorType == RGBTRIPA)
-    b.Alpha = (upperBound >= 0) ? mImgData[upperBound + 3] : 0;
-
-  c.Red   = (leftBound != 0) && (upperBound >= 0) ? mImgData[ULPix] : 0;
-  c.Green = (leftBound != 0) && (upperBound >= 0) ? mImgData[ULPix + 1] : 0;
-  c.Blue  = (leftBound != 0) && (upperBound >= 0) ? mImgData[ULPix + 2] : 0;
-
-  if (mIhdr.colorType == RGBTRIPA)
-    c.Alpha = (leftBound != 0) && (upperBound >= 0) ? mImgData[ULPix + 3] : 0;
-
-  pr.Red   = calcPaethByte(a.Red, b.Red, c.Red);
-  pr.Green = calcPaethByte(a.Green, b.Green, c.Green);
-  pr.Blue  = calcPaethByte(a.Blue, b.Blue, c.Blue);
-
-  if (mIhdr.colorType == RGBTRIPA)
-    pr.Alpha  = calcPaethByte(a.Alpha, b.Alpha, c.Alpha);
-    
-  return pr;
-}
-
-/* Function:    rgbBitDepth8
-   Description: Iterates through buffer data applying the correct filter on decompressed IDAT chunk data
-   Parameters:  std::vector<uint8_t> - Concatenated decompressed IDAT data
-   Returns:     None
- */
-void Png::rgbBitDepth8(const std::vector<uint8_t> &crRgbData)
-{
-  /*
-    index i will always be either the filter method or a pixel starting on the Red color value_comp
-    index i will never be Blue nor Green, to extract the blue and green for the current pixel do i + 1 for Green and
-    i + 2 for red
-  
-    Here is an example below:
-    We have a uint8_t array with 1 byte values represented as F (filter method), R (Red color value), G
-    (Green Color Value), B (Blue Color Value) If our index i lands on F, we will add 1 to our index and that will put
-    our index on R. Each time our index i is on R we will add 3 to our index i. We add 3 because each pixel contains an
-    RGB value, so adding 3 to our index i essentially puts us on the next pixel
-  
-    F RGB RGB RGB RGB
-    F RGB RGB RGB RGB
-    F RGB RGB RGB RGB
-    Filter UP adds the pixel RGB to the current pixel RGB 
-  */
-  RGB filterPix;
-  filterPix.Red = 0;
-  filterPix.Blue = 0;
-  filterPix.Green = 0;
-  filterPix.Alpha = 0;
-  uint8_t filterValue = 0;
-  uint8_t rgbSize = (mIhdr.colorType == RGBTRIP) ? RGBSIZE : RGBASIZE;
-  uint32_t scanlineSize = (mIhdr.width * rgbSize);
-  uint16_t mod = 256;
-  uint32_t currByte = 0;
-  uint32_t leftBound = 0;
-  int32_t upperBound = 0;
-  mImgData.reserve(mIhdr.width * mIhdr.height * rgbSize);
-
- for (int i = 0; i < (int) crRgbData.size();)
- {
-    leftBound   = currByte % scanlineSize;
-    upperBound  = currByte - scanlineSize;
-
-    if (i % (scanlineSize + 1) == 0)
-    {
-      filterValue = crRgbData[i];
-      i ++;
-    }
-    else
-    {
-      switch(filterValue)
-      {
-        case NONE:
-          // No filter do nothing but set filter pixels as to avoid any junk memory
-          filterPix.Red   = 0;
-          filterPix.Green = 0;
-          filterPix.Blue  = 0;
-          filterPix.Alpha  = 0;
-          break;
-        case SUB:
-          filterPix.Red   = (leftBound != 0) ? mImgData[currByte - rgbSize] : 0;
-          filterPix.Green = (leftBound != 0) ? mImgData[currByte - (rgbSize - 1)] : 0;
-          filterPix.Blue  = (leftBound != 0) ? mImgData[currByte - (rgbSize - 2)] : 0;
-
-          if (mIhdr.colorType == RGBTRIPA)
-            filterPix.Alpha = (leftBound != 0) ? mImgData[currByte - (rgbSize - 3)] : 0;
-          break;
-        case UP:
-          filterPix.Red   = (upperBound >= 0) ? mImgData[upperBound] : 0;
-          filterPix.Green = (upperBound >= 0) ? mImgData[upperBound + 1] : 0;
-          filterPix.Blue  = (upperBound >= 0) ? mImgData[upperBound + 2] : 0;
-
-          if (mIhdr.colorType == RGBTRIPA)
-            filterPix.Alpha = (upperBound >= 0) ? mImgData[upperBound + 3] : 0;
-          break;
-        case AVERAGE:
-          filterPix.Red   = (uint32_t) floor((((upperBound >= 0) ? mImgData[upperBound] : 0)     + ((leftBound != 0) ?
-                            mImgData[currByte - rgbSize] : 0)) / 2) % mod;
-          filterPix.Green = (uint32_t) floor((((upperBound >= 0) ? mImgData[upperBound + 1] : 0) + ((leftBound != 0) ?
-                            mImgData[currByte - (rgbSize - 1)] : 0)) / 2) % mod;
-          filterPix.Blue  = (uint32_t) floor((((upperBound >= 0) ? mImgData[upperBound + 2] : 0) + ((leftBound != 0) ?
-                            mImgData[currByte - (rgbSize - 2)] : 0)) / 2) % mod;
-
-          if (mIhdr.colorType == RGBTRIPA)
-            filterPix.Alpha = (uint32_t) floor((((upperBound >= 0) ? mImgData[upperBound + 3] : 0) + ((leftBound != 0) ?
-                              mImgData[currByte - (rgbSize - 3)] : 0)) / 2) % mod;
-          break;
-        case PAETH:
-            filterPix = paethRGBBitDepth8(scanlineSize, rgbSize, currByte);
-          break;
-        default:
-          break;
-      }
 
-      mImgData.push_back((crRgbData[i] + filterPix.Red) % mod);
-      mImgData.push_back((crRgbData[i + 1] + filterPix.Green) % mod);
-      mImgData.push_back((crRgbData[i + 2] + filterPix.Blue) % mod);
+  uint32_t width = 0;
+  uint32_t height = 0;
 
-      if (mIhdr.colorType == RGBTRIPA)
-        mImgData.push_back(crRgbData[i + 3] + filterPix.Alpha);
- 
-      i += rgbSize;
-      currByte += rgbSize;
-    }
-  }
+  getOrientedSize(crRegion, width, height);
+  mRegion = crRegion;
+  mpOut = pDst;
+  mOutStride = (cStride == 0) ? static_cast<size_t>(width) * handlePngColorType() : cStride;
+  readChunks();
+
+  return SUCCESS;
 }
 
-/* Function:    handlePngColorType
-   Description: Handles different colortype PNG configurations
-   Parameters:  std::vector<uint8_t> - Concatenated decompressed IDAT data
-   Returns:     None
+/* Function:    resolveScale
+   Description: Works out the output size of a scaled decode before orientation
+   Parameters:  Scale - Output size or factor
+                uint32_t - Set to the output width
+                uint32_t - Set to the output height
+   Returns:     Status - FAIL if a side would be 0 or larger than the image
  */
-void Png::handlePngColorType(const std::vector<uint8_t> &crRgbData)
+Status Png::resolveScale(const Scale &crScale, uint32_t &rWidth, uint32_t &rHeight)
 {
-  switch (mIhdr.colorType)
+  if (crScale.factor != 0)
   {
-    case 2:
-    case 6:
-    // fall through due to rgbBitDepth8 function being generic enough to capture
-      if (mIhdr.bitDepth == 8)
-        rgbBitDepth8(crRgbData);
-      else
-      {
-          std::cout << "BitDepth not implemented" << std::endl;
-          exit(-1);
-      }
-      break;
-    default:
-      std::cout << "ColorType not implemented" << std::endl;
-      exit(-1);
+    rWidth = static_cast<uint32_t>((static_cast<uint64_t>(mIhdr.width) + crScale.factor - 1) / crScale.factor);
+    rHeight = static_cast<uint32_t>((static_cast<uint64_t>(mIhdr.height) + crScale.factor - 1) / crScale.factor);
+  }
+  else
+  {
+    rWidth = crScale.width;
+    rHeight = crScale.height;
+  }
+
+  if (rWidth == 0 || rHeight == 0 || rWidth > mIhdr.width || rHeight > mIhdr.height)
+  {
+    return FAIL;
   }
+
+  return SUCCESS;
 }
 
-/* Function:    uncompressIDAT
-   Description: Decompresses IDAT chunk data and fills a buffer with the data
-   Parameters:  std::vector<uint8_t> - Concatenated uncompressed IDAT data
-                std::vector<uint8_t> - Concatenated decompressed IDAT data
-   Returns:     None
+/* Function:    getScaledSize
+   Description: Gets the size of a scaled decode once the orientation is applied and the buffer decodeScaledInto
+                needs for it. Scaled decodes write 8 bit samples, PIXEL_NATIVE is taken as PIXEL_NATIVE8.
+   Parameters:  Scale - Output size or factor
+                uint32_t - Set to the output width, 0 if the scale is invalid
+                uint32_t - Set to the output height, 0 if the scale is invalid
+                size_t - Bytes between the start of two rows, 0 for tightly packed rows
+   Returns:     size_t - Buffer size in bytes, 0 if the scale is invalid or the stride is smaller than a row
  */
-void Png::uncompressIDAT(const std::vector<uint8_t> &crBuffer, std::vector<uint8_t> &rDecompressedData)
+size_t Png::getScaledSize(const Scale &crScale, uint32_t &rWidth, uint32_t &rHeight, const size_t cStride)
 {
-  // Decompression works, note that if png size IDAT chunk has more than 16384 bytes uncompressed, then while loop will keep running til empty
-  // as well as subsequent IDAT chunks can occur, these two things are still not handled properly
-  // When multiple IDAT chunks, you need to concatenate data all together then inflate
-  std::vector<uint8_t> decompressedChunk(CHUNK_SIZE);
-  int8_t error = 0;
-  uint32_t numInflates = 1;
+  uint32_t width = 0;
+  uint32_t height = 0;
+
+  rWidth = 0;
+  rHeight = 0;
 
-  //zlib struct needed for decompression (inflate is decompression, deflate is compression)
+  if (resolveScale(crScale, width, height) != SUCCESS)
+  {
+    return 0;
+  }
 
-  z_stream infstream;
-  infstream.zalloc = Z_NULL;
-  infstream.zfree = Z_NULL;
-  infstream.opaque = Z_NULL;
-  infstream.avail_in = (uInt)crBuffer.size(); // size of input
-  infstream.next_in = (Bytef *)crBuffer.data(); // input char array
+  getOrientedSize({0, 0, width, height}, rWidth, rHeight);
 
-  /* WINDOW_BITS = 47 since this tells zlib to automatically check if 
-     gzip or zlib header exists in decompressed data
-  */ 
-  inflateInit2(&infstream, WINDOW_BITS);
+  const size_t cRowBytes = static_cast<size_t>(rWidth) * handlePngColorType(true);
+  const size_t cStrideBytes = (cStride == 0) ? cRowBytes : cStride;
 
-  do
+  if (cStrideBytes < cRowBytes)
   {
-    infstream.avail_out = (uInt)decompressedChunk.size(); // size of output
-    infstream.next_out = (Bytef *)decompressedChunk.data(); // output char array
-    error = inflate(&infstream, Z_NO_FLUSH);
+    return 0;
+  }
 
-    if(error == Z_DATA_ERROR || error == Z_MEM_ERROR)
-    {
-      std::cout << "ZLIB decompression returned error: " << error << std::endl;
-      exit(-1);
-    }
+  return (cStrideBytes * (rHeight - 1)) + cRowBytes;
+}
 
-    // We only sub from decompressedChunk.end() when an inflate does not use up all 16384 bytes. Otherwise our decompressedData size will be wrong
-    rDecompressedData.insert(rDecompressedData.end(), decompressedChunk.begin(), decompressedChunk.end() - abs((int)(infstream.total_out - (CHUNK_SIZE * numInflates))));
-    numInflates ++;
-  } while(infstream.avail_in != 0);
+/* Function:    decodeScaled
+   Description: Decodes a downscaled image into the png object after a DECODE_HEADER construction, only the scaled
+                image is ever held in memory
+   Parameters:  Scale - Output size or factor
+   Returns:     Status - FAIL if the scale is invalid or the image has already been decoded
+ */
+Status Png::decodeScaled(const Scale &crScale)
+{
+  uint32_t width = 0;
+  uint32_t height = 0;
+  const size_t cRequired = getScaledSize(crScale, width, height);
+
+  if (cRequired == 0 || (mValidPngMask & IDAT_MASK) != 0 || (mValidPngMask & IEND_MASK) != 0)
+  {
+    return FAIL;
+  }
 
-  inflateEnd(&infstream);
+  mImgData.resize(cRequired);
+  mImgWidth = width;
+  mImgHeight = height;
+  mImgPixelSize = handlePngColorType(true);
+
+  return decodeScaledInto(crScale, mImgData.data(), 0, cRequired);
 }
 
-/* Function:    parseICCP
-   Description: Parses ICCP chunk, but currently doesn't do that, just used to parse items
-                that are not IHDR and IDAT from png
-   Parameters:  uint32_t - Amount of bytes to read
-   Returns:     None
+/* Function:    decodeScaledInto
+   Description: Decodes a downscaled image straight into a caller owned buffer after a DECODE_HEADER construction.
+                Every scanline is filtered into the output as soon as it is reconstructed, so on top of the output
+                only a few rows of the source and of the output are held, whatever the size of the source. Adam7
+                images accumulate the whole output instead of two rows of it.
+   Parameters:  Scale - Output size or factor, orientation is applied after scaling
+                uint8_t* - Destination buffer
+                size_t - Bytes between the start of two rows, 0 for tightly packed rows
+                size_t - Size of the destination buffer
+   Returns:     Status - FAIL if the scale is invalid, the buffer is too small, the stride is smaller than a row or
+                the image has already been decoded
  */
-void Png::parseICCP(const uint32_t cChunkLength)
+Status Png::decodeScaledInto(const Scale &crScale, uint8_t *pDst, const size_t cStride, const size_t cSize)
 {
-  std::vector<uint8_t> buffer(cChunkLength);
+  uint32_t width = 0;
+  uint32_t height = 0;
+  const size_t cRequired = getScaledSize(crScale, width, height, cStride);
+
+  if (pDst == nullptr || cRequired == 0 || cSize < cRequired)
+  {
+    return FAIL;
+  }
+
+  if ((mValidPngMask & IDAT_MASK) != 0 || (mValidPngMask & IEND_MASK) != 0)
+  {
+    return FAIL;
+  }
+
+  resolveScale(crScale, mScale.width, mScale.height);
+  mScale.factor = 0;
+  mScale.filter = crScale.filter;
+  mScaled = true;
+  mRegion = {0, 0, mIhdr.width, mIhdr.height};
+  mpOut = pDst;
+  mOutStride = (cStride == 0) ? static_cast<size_t>(width) * handlePngColorType(true) : cStride;
+  readChunks();
 
-  mPngFile.read((char *) buffer.data(), cChunkLength);
+  return SUCCESS;
 }
 
-/* Function:    readPng
-   Description: Parses an entire png file and stores rgb values to recreate img
-   Parameters:  None
-   Returns:     None
+/* Function:    nextFrame
+   Description: Decodes the next frame of an animated png after a DECODE_HEADER construction and draws it onto the
+                canvas, after applying the dispose op of the frame before it. Only one frame is ever decoded at a
+                time, so any length of animation plays in the memory of the canvas, one frame rectangle kept for
+                DISPOSE_PREVIOUS and one row of scratch. A png without acTL plays as a single frame. An IDAT image
+                that is not part of the animation is skipped without being inflated.
+   Parameters:  Frame - Set to the rectangle, delay and ops of the frame drawn
+   Returns:     Status - FAIL once there are no more frames or if the image was decoded some other way. Corrupt data
+                throws a PngException like decode.
  */
-void Png::readPng() {
-  std::vector<uint8_t> decompressedData;
-  uint8_t validPngMask = 0;
+Status Png::nextFrame(struct Frame &rFrame)
+{
   uint32_t chunkLength;
-  uint32_t crc;
-  std::vector<uint8_t> chunkType(5);
-  std::vector<uint8_t> signature(pngSignature.size());
-  std::vector<uint8_t> idatBuffer;
+  char chunkType[5] = {0};
+  const char *cpChain = "IDAT";
+  bool drawing = false;
+  bool drawn = false;
 
-// TODO: Move check
-  if(!mPngFile)
+  if (mAnimState == ANIM_DONE || mpPush != nullptr || mMetadataOnly ||
+      (mAnimState == ANIM_START && ((mValidPngMask & IDAT_MASK) != 0 || (mValidPngMask & IEND_MASK) != 0)))
   {
-    std::cout << "Png file descriptor is not good." << std::endl;
-    exit(-1);
+    return FAIL;
   }
 
-  // Header is 8 bytes long, every png has this, use to confirm file format is png
-  mPngFile.read((char *) signature.data(), sizeof(uint64_t));
-  signature[8] = '\0';
-
-  if(strcmp((char *)signature.data(), (char *)pngSignature.data()) != 0)
+  if (mAnimState == ANIM_START)
   {
-    std::cout << "Not a PNG format" << std::endl;
-    exit(-1);
+    startAnimation();
   }
-
-  while (strcmp((char *)chunkType.data(), "IEND\0") != 0 && mPngFile.good())
+  else
   {
-    // Format for data is 4 bytes to give length of chunk buffer
-    // 4 bytes for chunk type
-    // X bytes of chunk data
-    // Topped off with 4 bytes of crc
-    // This below reads the IHDR which should follow right after header
-    mPngFile.read((char*) &chunkLength, sizeof(uint32_t));
-    chunkLength = htonl(chunkLength);
-    mPngFile.read((char *) chunkType.data(), sizeof(uint32_t));
-    chunkType[4] = '\0';
+    disposeFrame();
+  }
 
-    // IDAT chain is broken so now uncompress all data collected
-    if((((validPngMask & IDAT_CHAIN) >> 3) == 1) && (strcmp((char *) chunkType.data(), "IDAT\0") != 0))
+  while (!drawn && mpSource->good())
+  {
+    if (!readChunkHeader(chunkLength, chunkType))
     {
-      validPngMask &= 0xF7;
-      //temp
-      uncompressIDAT(idatBuffer, decompressedData);
-      handlePngColorType(decompressedData);
-      idatBuffer.clear();
-      decompressedData.clear();
+      break;
     }
 
-    if((validPngMask & IHDR_MASK) == 0 && strcmp((char *) chunkType.data(), "IHDR\0") != 0)
+    // Frame data chain is broken so every scanline of the frame should have been decoded by now
+    if (((mValidPngMask & IDAT_CHAIN) != 0) && (strcmp(chunkType, cpChain) != 0))
     {
-      std::cout << "Error! Invalid PNG file, IHDR chunk did not follow PNG signature." << std::endl;
-      exit(-1);
-    } 
-    else if ((validPngMask & IHDR_MASK) == 0 && strcmp((char *) chunkType.data(), "IHDR\0") == 0)
+      mValidPngMask &= 0xF7;
+
+      if (drawing)
+      {
+        endFrame();
+        drawn = true;
+      }
+    }
+
+    if (strcmp(chunkType, "IDAT\0") == 0)
     {
-      validPngMask |= IHDR_MASK;
-      parseIHDR(chunkLength);
+      if ((mValidPngMask & IDAT_MASK) != 0 && (mValidPngMask & IDAT_CHAIN) == 0)
+      {
+        throw PngException("Error! IDAT chunks must be consecutive");
+      }
+
+      if ((mValidPngMask & IDAT_MASK) == 0)
+      {
+        mValidPngMask |= IDAT_MASK | IDAT_CHAIN;
+        cpChain = "IDAT";
+
+        // A still png is one frame covering the canvas, an animation without an fcTL first hides the IDAT image
+        if (!mAnimated)
+        {
+          mNextFrame = {0, 0, 0, mIhdr.width, mIhdr.height, 0, 0, DISPOSE_NONE, BLEND_SOURCE};
+          mHaveNextFrame = true;
+        }
+        else if (mHaveNextFrame && (mNextFrame.x != 0 || mNextFrame.y != 0 || mNextFrame.width != mIhdr.width ||
+                                    mNextFrame.height != mIhdr.height))
+        {
+          throw PngException("Error! fcTL of the IDAT image must cover the whole canvas.");
+        }
+
+        drawing = mHaveNextFrame;
+
+        if (drawing)
+        {
+          startFrame();
+        }
+      }
+
+      if (drawing)
+      {
+        uncompressIDAT(chunkLength);
+      }
+      else
+      {
+        skipChunkData(chunkLength);
+      }
     }
-    else if (strcmp((char *) chunkType.data(), "IDAT\0") == 0)
+    else if (strcmp(chunkType, "fdAT\0") == 0 && mAnimated)
     {
-      std::vector<uint8_t> tempBuffer(chunkLength);
-      mPngFile.read((char *) tempBuffer.data(), chunkLength);
-      idatBuffer.insert(idatBuffer.end(), tempBuffer.begin(), tempBuffer.end());
+      if (chunkLength < sizeof(uint32_t) || (mValidPngMask & IDAT_MASK) == 0)
+      {
+        throw PngException("Error! fdAT chunk must follow the IDAT chunks and hold a sequence number.");
+      }
 
-      if ((validPngMask & IDAT_MASK) == 0)
+      checkSequence(readChunkData(sizeof(uint32_t)));
+
+      if ((mValidPngMask & IDAT_CHAIN) == 0)
       {
-        validPngMask |= IDAT_MASK;
+        if (!mHaveNextFrame)
+        {
+          throw PngException("Error! fdAT chunk does not follow an fcTL chunk.");
+        }
+
+        mValidPngMask |= IDAT_CHAIN;
+        cpChain = "fdAT";
+        drawing = true;
+        startFrame();
       }
 
-      // Start of the IDAT chain, start appending all data to buffer
-      if ((validPngMask & IDAT_CHAIN) == 0)
+      uncompressIDAT(chunkLength - sizeof(uint32_t));
+    }
+    else if (strcmp(chunkType, "fcTL\0") == 0 && (mAnimated || (mValidPngMask & IDAT_MASK) == 0))
+    {
+      parseFCTL(chunkLength);
+    }
+    else if (strcmp(chunkType, "acTL\0") == 0)
+    {
+      parseACTL(chunkLength);
+    }
+    else if (strcmp(chunkType, "PLTE\0") == 0)
+    {
+      if ((mValidPngMask & IDAT_MASK) != 0)
       {
-        validPngMask |= IDAT_CHAIN;
+        throw PngException("Error! PLTE chunk must appear before first IDAT chunk");
       }
+
+      parsePLTE(chunkLength);
     }
-    else if (strcmp((char *) chunkType.data(), "iCCP\0") == 0)
+    else if (strcmp(chunkType, "tRNS\0") == 0)
     {
-      if ((validPngMask & IDAT_MASK) != 0)
+      if ((mValidPngMask & IDAT_MASK) != 0)
       {
-        std::cout << "Error! iCCP chunk must appear before first IDAT chunk" << std::endl;
-        exit(-1);
+        throw PngException("Error! tRNS chunk must appear before first IDAT chunk");
       }
-       //Temp
-       parseICCP(chunkLength);
+
+      parseTRNS(chunkLength);
+    }
+    else
+    {
+      skipChunkData(chunkLength);
+    }
+
+    checkChunkCrc(chunkType);
+
+    if (strcmp(chunkType, "IEND\0") == 0)
+    {
+      mValidPngMask |= IEND_MASK;
+      mAnimState = ANIM_DONE;
+      break;
     }
-    else 
+  }
+
+  // File ended in the middle of the frame data
+  if ((mValidPngMask & IDAT_CHAIN) != 0)
+  {
+    mValidPngMask &= 0xF7;
+
+    if (drawing)
     {
-      //Temp
-      parseICCP(chunkLength);
+      endFrame();
+      drawn = true;
     }
+  }
+
+  if (!drawn)
+  {
+    mAnimState = ANIM_DONE;
+    return FAIL;
+  }
+
+  rFrame = mFrame;
+
+  return SUCCESS;
+}
+
+/* Function:    getAnimation
+   Description: Reads the acTL chunk, indexed once nextFrame has read past it or after a DECODE_METADATA
+                construction
+   Parameters:  uint32_t - Set to the number of frames
+                uint32_t - Set to the number of times to play the animation, 0 to loop forever
+   Returns:     Status - FAIL if no valid acTL chunk has been indexed
+ */
+Status Png::getAnimation(uint32_t &rFrames, uint32_t &rPlays)
+{
+  const Chunk *cpChunk = findChunk("acTL");
+  const uint8_t *cpData = (cpChunk != nullptr && cpChunk->length == 8) ? getChunkData(*cpChunk) : nullptr;
 
-    mPngFile.read((char *) &crc, sizeof(uint32_t));
+  if (cpData == nullptr)
+  {
+    return FAIL;
   }
 
-  if (strcmp((char *) chunkType.data(), "IEND\0") == 0)
+  rFrames = readBigEndian32(cpData);
+  rPlays = readBigEndian32(cpData + sizeof(uint32_t));
+
+  return SUCCESS;
+}
+
+/* Function:    getCanvas
+   Description: Gets the animation canvas, RGBA8 or BGRA8 rows as wide as the image. Every call to nextFrame draws
+                over the same pixels.
+   Parameters:  None
+   Returns:     ByteSpan - Canvas pixels, empty before the first call to nextFrame
+ */
+ByteSpan Png::getCanvas() const
+{
+  if (mAnimState == ANIM_START)
   {
-    validPngMask |= IEND_MASK;
+    return {nullptr, 0};
   }
 
+  return {mImgData.data(), mImgData.size()};
 }
 
-/* Function:    Png
-   Description: Constructs png object
+/* Function:    parseProbe
+   Description: Parses the png signature and IHDR from the first bytes of a file without any side effects
+   Parameters:  uint8_t* - Start of the file
+                size_t - Bytes available, PROBE_SIZE are needed
+                IHDR - Set to the parsed IHDR
+   Returns:     Status - FAIL if the bytes do not start with a valid signature and IHDR
+ */
+Status Png::parseProbe(const uint8_t *cpData, const size_t cSize, struct IHDR &rIhdr)
+{
+  uint32_t chunkLength = 0;
+
+  if (cpData == nullptr || cSize < PROBE_SIZE || memcmp(cpData, pngSignature.data(), sizeof(uint64_t)) != 0)
+  {
+    return FAIL;
+  }
+
+  memcpy(&chunkLength, cpData + 8, sizeof(uint32_t));
+
+  if (htonl(chunkLength) != 13 || memcmp(cpData + 12, "IHDR", 4) != 0)
+  {
+    return FAIL;
+  }
+
+  memcpy(&rIhdr, cpData + 16, 13);
+  rIhdr.width = htonl(rIhdr.width);
+  rIhdr.height = htonl(rIhdr.height);
+
+  return ((rIhdr.width == 0) || (rIhdr.height == 0)) ? FAIL : SUCCESS;
+}
+
+/* Function:    probe
+   Description: Reads only the signature and IHDR of a png file. Nothing past IHDR is read and bad files are
+                reported through the return value, which makes this cheap enough to run over whole asset trees.
    Parameters:  std::string - Filepath for png file to read from
+                IHDR - Set to the parsed IHDR
+   Returns:     Status - FAIL if the file can not be read or does not start with a valid signature and IHDR
+ */
+Status Png::probe(const std::string &crPngPath, struct IHDR &rIhdr)
+{
+  uint8_t header[PROBE_SIZE];
+  std::ifstream pngFile(crPngPath.c_str(), std::ios::binary);
+
+  pngFile.read((char *) header, PROBE_SIZE);
+
+  return parseProbe(header, static_cast<size_t>(pngFile.gcount()), rIhdr);
+}
+
+/* Function:    probe
+   Description: Parses only the signature and IHDR of a png file in memory
+   Parameters:  ByteSpan - Png file, only the first PROBE_SIZE bytes are looked at
+                IHDR - Set to the parsed IHDR
+   Returns:     Status - FAIL if the bytes do not start with a valid signature and IHDR
+ */
+Status Png::probe(const ByteSpan &crPngBytes, struct IHDR &rIhdr)
+{
+  return parseProbe(crPngBytes.data, crPngBytes.size, rIhdr);
+}
+
+/* Function:    setScanlineDecoder
+   Description: Makes the next decode use a caller owned scanline decoder, so a thread decoding many images keeps
+                reusing one inflate backend and one set of row buffers
+   Parameters:  ScanlineDecoder* - Decoder to use, has to outlive the decode
    Returns:     None
  */
-Png::Png(const std::string &crPngPath)
+void Png::setScanlineDecoder(ScanlineDecoder *pScanlines)
 {
-  mPngFile.open(crPngPath.c_str(), std::ios::binary);
-  readPng();
+  mpScanlines = pScanlines;
 }
 
-/* Function:    compareSize
-   Description: Compares if png size matches given arguments
-   Parameters:  uint32_t - Width limit
-                uint32_t Height limit
-   Returns:     Status failure/success status of function
+/* Function:    setPipelined
+   Description: Lets the next decode of a large image inflate and unfilter on two threads at once. Images with less
+                than PIPELINE_MIN_BYTES of pixel data are still decoded on the calling thread.
+   Parameters:  bool - True to allow the pipeline
+   Returns:     None
  */
-Status Png::compareSize(const uint32_t cWidth, const uint32_t cHeight)
+void Png::setPipelined(const bool cPipelined)
 {
-  if(mIhdr.width != cWidth || mIhdr.height != cHeight)
-    return FAIL;
+  mPipelined = cPipelined;
+}
 
-  return SUCCESS;
+/* Function:    setBanded
+   Description: Lets the next decode of an image split into iDOT bands decode every band on its own thread, on
+                unless turned off here or by setBandMode, which also decides whether a single core machine does.
+   Parameters:  bool - True to decode bands in parallel
+   Returns:     None
+ */
+void Png::setBanded(const bool cBanded)
+{
+  mUseBands = cBanded;
 }
 
-/* Function:    ~Png
-   Description: Destroys png object
-   Parameters:  None
+/* Function:    setInflateEngine
+   Description: Selects the decompression backend of the next decode, zlib unless set otherwise
+   Parameters:  InflateEngine - INFLATE_ZLIB for zlib, INFLATE_FAST for the built in inflater
    Returns:     None
  */
-Png::~Png()
+void Png::setInflateEngine(const InflateEngine cEngine)
 {
-  mImgData.clear();
-  mPngFile.close();
+  mInflateEngine = cEngine;
 }
 
-/* Function:    getImgData
-   Description: Getter function for imgData
+/* Function:    setCrcMode
+   Description: Selects which chunk CRCs the next decode checks. IHDR is read by the constructor and is always
+                checked.
+   Parameters:  CrcMode - CRC_VERIFY_ALL, CRC_CRITICAL for critical chunks only or CRC_SKIP for trusted files
+   Returns:     None
+ */
+void Png::setCrcMode(const CrcMode cMode)
+{
+  mCrcMode = cMode;
+}
+
+/* Function:    setPassCallback
+   Description: Sets a callback for progressive display of interlaced images. It is called on the decoding thread
+                after each Adam7 pass, when the image buffer holds every pixel of that pass and all earlier ones.
+                Images that are not interlaced never call it.
+   Parameters:  PassCallback - Callback, empty to remove it
+   Returns:     None
+ */
+void Png::setPassCallback(const PassCallback &crCallback)
+{
+  mPassCallback = crCallback;
+}
+
+/* Function:    setOutputFormat
+   Description: Sets the pixel format the next decode writes. The conversion is part of writing each scanline, so
+                a renderer that wants premultiplied BGRA gets it without any extra pass over the image. Row sizes
+                from getRowBytes and getRequiredSize follow the format.
+   Parameters:  PixelFormat - PIXEL_NATIVE for the samples of the file, PIXEL_NATIVE8 to truncate 16 bit samples or
+                              one of the 4 byte formats
+                AlphaMode - ALPHA_PREMULTIPLIED to scale color by alpha, ignored by PIXEL_NATIVE and PIXEL_RGBX8
+   Returns:     None
+ */
+void Png::setOutputFormat(const PixelFormat cFormat, const AlphaMode cAlpha)
+{
+  mPixelFormat = cFormat;
+  mAlphaMode = cAlpha;
+}
+
+/* Function:    setOrientation
+   Description: Sets how the next decode orients the image. Each row is written straight to its flipped or rotated
+                place as it is reconstructed, so textures come out bottom up for OpenGL without a second pass.
+                Regions are given in file coordinates and crop before the orientation is applied, sizes from
+                getRowBytes and getRequiredSize are those of the oriented image.
+   Parameters:  Orientation - Flip or clockwise rotation
+   Returns:     None
+ */
+void Png::setOrientation(const Orientation cOrientation)
+{
+  mOrientation = cOrientation;
+}
+
+/* Function:    setColorTarget
+   Description: Sets the color space the next decode converts to, from the iCCP, sRGB, gAMA and cHRM chunks of the
+                image. Every row is converted right after it is expanded, so no separate pass over the image is
+                needed. Images that are already in the target space and push decodes are left as stored.
+   Parameters:  ColorTarget - COLOR_AS_STORED, COLOR_SRGB or COLOR_LINEAR
+   Returns:     None
+ */
+void Png::setColorTarget(const ColorTarget cTarget)
+{
+  mColorTarget = cTarget;
+}
+
+/* Function:    setCollectStats
+   Description: Turns stats collection on or off for the next decode, only has an effect when built with
+                LESTPNG_STATS. Stats of the IHDR read are included when this is set before a reset.
+   Parameters:  bool - True to collect stats
+   Returns:     None
+ */
+void Png::setCollectStats(const bool cCollect)
+{
+  mCollectStats = cCollect;
+}
+
+/* Function:    getStats
+   Description: Gets the stats of the last decode, all zero when they were not collected
    Parameters:  None
-   Returns:     std::vector<uint8_t> - Unfiltered image data
+   Returns:     DecodeStats - Stage times, byte and chunk counts, filter types and buffer use
  */
-std::vector<uint8_t> Png::getImgData()
+const DecodeStats &Png::getStats() const
 {
-  return mImgData;
+  return mStats;
 }
 
 /* Function:    getIhdr
@@ -505,36 +3087,56 @@ struct Png::IHDR Png::getIhdr()
   return mIhdr;
 }
 
-// Only for 8 bit depth for now
+/* Function:    reverseImg
+   Description: Flips the decoded image upside down in place, for images that were not decoded with
+                ORIENT_FLIP_VERTICAL. Works for every pixel size, using the size of the image the last decode into
+                the png object produced.
+   Parameters:  None
+   Returns:     None
+ */
 void Png::reverseImg()
 {
-  uint8_t rgbSize = (mIhdr.colorType == RGBTRIP) ? RGBSIZE : RGBASIZE;
-  uint32_t scanlineSize = (mIhdr.width * rgbSize);
-  uint8_t r = 0;
-  uint8_t g = 0;
-  uint8_t b = 0;
-  uint8_t a = 0;
-  uint32_t earlyIndex = 0;
-  uint32_t lateIndex = 0;
-  uint32_t midPoint = mIhdr.height / 2;
-  for (size_t i = mIhdr.height; i > midPoint ; i --)
-  {
-    for (size_t j = 0; j < scanlineSize; j+=4)
-    {
-      earlyIndex = scanlineSize * (mIhdr.height - i);
-      lateIndex = scanlineSize * (i - 1);
-      r = mImgData[earlyIndex + j];
-      g = mImgData[earlyIndex + j + 1];
-      b = mImgData[earlyIndex + j + 2];
-      a = mImgData[earlyIndex + j + 3];
-      mImgData[earlyIndex + j] = mImgData[lateIndex + j];
-      mImgData[earlyIndex + j + 1] = mImgData[lateIndex + j + 1];
-      mImgData[earlyIndex + j + 2] = mImgData[lateIndex + j + 2];
-      mImgData[earlyIndex + j + 3] = mImgData[lateIndex + j + 3];
-      mImgData[lateIndex + j] = r;
-      mImgData[lateIndex + j + 1] = g;
-      mImgData[lateIndex + j + 2] = b;
-      mImgData[lateIndex + j + 3] = a;
-    }
-  }
-}
\ No newline at end of file
+  const size_t cRowBytes = static_cast<size_t>(mImgWidth) * mImgPixelSize;
+
+  if (mImgData.size() < (cRowBytes * mImgHeight))
+  {
+    return;
+  }
+
+  flipVertical(mImgData.data(), cRowBytes, mImgHeight);
+}
+
+/* Function:    flipVertical
+   Description: Flips rows of pixels upside down in place. Rows are swapped whole, FLIP_BLOCK_BYTES at a time
+                through a buffer that stays in L1, instead of pixel by pixel.
+   Parameters:  uint8_t* - First row
+                size_t - Bytes of pixels in a row
+                uint32_t - Number of rows
+                size_t - Bytes between the start of two rows, 0 for tightly packed rows
+   Returns:     None
+ */
+void Png::flipVertical(uint8_t *pPixels, const size_t cRowBytes, const uint32_t cRows, const size_t cStride)
+{
+  const size_t cStrideBytes = (cStride == 0) ? cRowBytes : cStride;
+  uint8_t block[FLIP_BLOCK_BYTES];
+
+  if (pPixels == nullptr || cRows < 2)
+  {
+    return;
+  }
+
+  for (uint32_t top = 0, bottom = cRows - 1; top < bottom; top ++, bottom --)
+  {
+    uint8_t *pTop = pPixels + (static_cast<size_t>(top) * cStrideBytes);
+    uint8_t *pBottom = pPixels + (static_cast<size_t>(bottom) * cStrideBytes);
+
+    for (size_t offset = 0; offset < cRowBytes; offset += FLIP_BLOCK_BYTES)
+    {
+      const size_t cSize = std::min(cRowBytes - offset, static_cast<size_t>(FLIP_BLOCK_BYTES));
+
+      memcpy(block, pTop + offset, cSize);
+      memcpy(pTop + offset, pBottom + offset, cSize);
+      memcpy(pBottom + offset, block, cSize);
+    }
+  }
+}
@@ -5,9 +5,17 @@
 #include <cstdint>
 #include <vector>
 #include <string>
-#include <fstream>
+#include <memory>
+#include <functional>
 
 #include "common.hpp"
+#include "scanline.hpp"
+#include "band.hpp"
+#include "source.hpp"
+#include "expand.hpp"
+#include "scale.hpp"
+#include "stats.hpp"
+#include "color.hpp"
 
 
 #define IHDR_MASK  0x01
@@ -16,6 +24,26 @@
 #define IDAT_CHAIN 0x08
 #define CHUNK_SIZE 16384
 
+// Signature, IHDR length, type and data
+#define PROBE_SIZE 29
+
+// Pixel data a decode needs before setPipelined splits it over two threads
+#define PIPELINE_MIN_BYTES (8 * 1024 * 1024)
+
+#define ADAM7_PASSES 7
+
+// Largest iCCP profile or zTXt and iTXt text inflated on request, so a hostile file can not exhaust memory
+#define METADATA_MAX_BYTES (16 * 1024 * 1024)
+
+// Largest IHDR, PLTE or tRNS a push decode waits for in full before parsing, every other chunk is read in pieces
+#define PUSH_CHUNK_MAX 1024
+
+// Rows of a 90 or 270 degree rotation gathered before they are written out as columns
+#define ROTATE_BLOCK_ROWS 16
+
+// Bytes of two rows swapped at a time by flipVertical, small enough to stay in L1
+#define FLIP_BLOCK_BYTES 4096
+
 #define RGBSIZE 3
 #define RGBASIZE 4
 
@@ -46,6 +74,130 @@ struct RGB {
   uint8_t Alpha;
 };
 
+enum FileAccess {
+  FILE_STREAM,
+  FILE_MAP
+};
+
+// DECODE_METADATA indexes every chunk without reading IDAT payloads, the image can not be decoded afterwards
+enum DecodeMode {
+  DECODE_FULL,
+  DECODE_HEADER,
+  DECODE_METADATA
+};
+
+// Entry of the chunk index, offset is where the chunk data starts in the file
+struct Chunk {
+  char type[5];
+  uint64_t offset;
+  uint32_t length;
+};
+
+// Text from tEXt, zTXt or iTXt, iTXt text is UTF-8 and the others Latin-1
+struct Text {
+  std::string keyword;
+  std::string text;
+  std::string language;
+  std::string translatedKeyword;
+  bool compressed;
+};
+
+// Pixels per unit along x and y from pHYs, unit 1 is the meter and 0 means only the aspect ratio is known
+struct PhysicalSize {
+  uint32_t x;
+  uint32_t y;
+  uint8_t unit;
+};
+
+// White point and red, green and blue primaries from cHRM, CIE x and y times 100000
+struct Chromaticities {
+  uint32_t whiteX;
+  uint32_t whiteY;
+  uint32_t redX;
+  uint32_t redY;
+  uint32_t greenX;
+  uint32_t greenY;
+  uint32_t blueX;
+  uint32_t blueY;
+};
+
+// Columns and rows of the image to decode
+struct Region {
+  uint32_t x;
+  uint32_t y;
+  uint32_t width;
+  uint32_t height;
+};
+
+// Output size of a scaled decode, a non zero factor divides both sides rounding up and overrides width and height
+struct Scale {
+  uint32_t width;
+  uint32_t height;
+  uint32_t factor;
+  ScaleFilter filter;
+};
+
+// Chunks whose CRC is checked, critical chunks are the ones whose type starts with an upper case letter
+enum CrcMode {
+  CRC_VERIFY_ALL,
+  CRC_CRITICAL,
+  CRC_SKIP
+};
+
+// Applied to the decoded region while rows are written, rotations are clockwise
+enum Orientation {
+  ORIENT_NONE,
+  ORIENT_FLIP_VERTICAL,
+  ORIENT_ROTATE_90,
+  ORIENT_ROTATE_180,
+  ORIENT_ROTATE_270
+};
+
+// What a feed got to, see feed
+enum PushStatus {
+  PUSH_NEED_DATA,
+  PUSH_HEADER,
+  PUSH_ROWS,
+  PUSH_DONE
+};
+
+// Result of a feed, rows [firstRow, firstRow + rowCount) of the image were written during the call
+struct PushResult {
+  PushStatus status;
+  uint32_t firstRow;
+  uint32_t rowCount;
+};
+
+// What happens to a frame's rectangle before the next frame is drawn, from fcTL
+enum DisposeOp {
+  DISPOSE_NONE,
+  DISPOSE_BACKGROUND,
+  DISPOSE_PREVIOUS
+};
+
+// How a frame is drawn, BLEND_SOURCE replaces its rectangle and BLEND_OVER alpha blends over it
+enum BlendOp {
+  BLEND_SOURCE,
+  BLEND_OVER
+};
+
+// One APNG frame, the rectangle is in canvas pixels and it is shown for delayNum / delayDen seconds, where a
+// delayDen of 0 means 100
+struct Frame {
+  uint32_t index;
+  uint32_t x;
+  uint32_t y;
+  uint32_t width;
+  uint32_t height;
+  uint16_t delayNum;
+  uint16_t delayDen;
+  DisposeOp dispose;
+  BlendOp blend;
+};
+
+// Called with the Adam7 pass number, 1 to 7, once every pixel of that pass is in the image
+typedef std::function<void(const uint8_t cPass)> PassCallback;
+
 enum FilterMethods {
   NONE, 
   SUB, 
@@ -54,28 +206,213 @@ enum FilterMethods {
   PAETH
 };
 
+Png();
 Png(const std::string &crPngFile);
+Png(const std::string &crPngFile, const FileAccess cAccess, const DecodeMode cMode = DECODE_FULL);
+Png(const ByteSpan &crPngBytes, const DecodeMode cMode = DECODE_FULL);
 ~Png();
+void reset(const ByteSpan &crPngBytes, const DecodeMode cMode = DECODE_FULL);
+void resetPush();
+PushResult feed(const uint8_t *cpData, const size_t cSize);
+Status setPushOutput(uint8_t *pDst, const size_t cStride, const size_t cSize);
 std::vector<uint8_t> getImgData();
+std::vector<uint8_t> takeImgData();
+size_t getRowBytes();
+size_t getRequiredSize(const size_t cStride = 0);
+size_t getRequiredSize(const Region &crRegion, const size_t cStride = 0);
+Status decode();
+Status decodeRegion(const Region &crRegion);
+Status decodeInto(uint8_t *pDst, const size_t cStride, const size_t cSize);
+Status decodeRegionInto(const Region &crRegion, uint8_t *pDst, const size_t cStride, const size_t cSize);
+size_t getScaledSize(const Scale &crScale, uint32_t &rWidth, uint32_t &rHeight, const size_t cStride = 0);
+Status decodeScaled(const Scale &crScale);
+Status decodeScaledInto(const Scale &crScale, uint8_t *pDst, const size_t cStride, const size_t cSize);
+Status nextFrame(struct Frame &rFrame);
+Status getAnimation(uint32_t &rFrames, uint32_t &rPlays);
+ByteSpan getCanvas() const;
+void setScanlineDecoder(ScanlineDecoder *pScanlines);
+void setPipelined(const bool cPipelined);
+void setBanded(const bool cBanded);
+void setInflateEngine(const InflateEngine cEngine);
+void setCrcMode(const CrcMode cMode);
+void setPassCallback(const PassCallback &crCallback);
+void setOutputFormat(const PixelFormat cFormat, const AlphaMode cAlpha = ALPHA_STRAIGHT);
+void setOrientation(const Orientation cOrientation);
+void setColorTarget(const ColorTarget cTarget);
+void setCollectStats(const bool cCollect);
+const DecodeStats &getStats() const;
+static void flipVertical(uint8_t *pPixels, const size_t cRowBytes, const uint32_t cRows, const size_t cStride = 0);
+static Status probe(const std::string &crPngPath, struct IHDR &rIhdr);
+static Status probe(const ByteSpan &crPngBytes, struct IHDR &rIhdr);
 struct IHDR getIhdr();
+const std::vector<Chunk> &getChunks() const;
+const Chunk *findChunk(const char *cpType, const size_t cIndex = 0) const;
+const uint8_t *getChunkData(const Chunk &crChunk);
+Status getGamma(uint32_t &rGamma);
+Status getSrgbIntent(uint8_t &rIntent);
+Status getPhysicalSize(struct PhysicalSize &rSize);
+Status getChromaticities(struct Chromaticities &rChromaticities);
+Status getIccProfile(std::string &rName, std::vector<uint8_t> &rProfile);
+Status getText(std::vector<struct Text> &rText);
+Status getText(const std::string &crKeyword, std::string &rText);
 Status compareSize(const uint32_t cWidth, const uint32_t cHeight);
 void reverseImg();
 
 private:
-  void readPng();
+enum PushState {
+  PUSH_STATE_SIGNATURE,
+  PUSH_STATE_HEADER,
+  PUSH_STATE_DATA,
+  PUSH_STATE_CRC,
+  PUSH_STATE_END
+};
+
+enum AnimationState {
+  ANIM_START,
+  ANIM_FRAMES,
+  ANIM_DONE
+};
+
+  explicit Png(PngSource *pSource);
+  void readPng(const DecodeMode cMode);
+  bool readChunkHeader(uint32_t &rChunkLength, char *pChunkType);
+  void readSignature();
+  void readHeader();
+  PushStatus runPush();
+  void startPushChunk(const uint32_t cChunkLength);
+  bool readPushData();
+  void readChunks();
+  Status checkRegion(const Region &crRegion);
+  static Status parseProbe(const uint8_t *cpData, const size_t cSize, struct IHDR &rIhdr);
+  const uint8_t *readBytes(const size_t cSize);
+  const uint8_t *readChunkData(const size_t cSize);
+  void skipChunkData(const size_t cSize);
+  void checkChunkCrc(const char *cpChunkType);
   void parseIHDR(const uint32_t cChunkLength);
-  struct RGB subPixelRGB(const struct RGB cPixel1, const struct RGB cPixel2);
-  struct RGB addPixelRGB(const struct RGB cPixel1, const struct RGB cPixel2);
-  struct RGB paethRGBBitDepth8(const uint32_t cScanlineSize, const uint8_t cRgbSize, const uint32_t cCurrByte);
-  uint8_t calcPaethByte(const uint8_t cA, const uint8_t cB, const uint8_t cC);
-  void rgbBitDepth8(const std::vector<uint8_t> &crRgbData);
-  void handlePngColorType(const std::vector<uint8_t> &crRgbData);
-  void uncompressIDAT(const std::vector<uint8_t> &crBuffer, std::vector<uint8_t> &rDecompressedData);
-  void parseICCP(const uint32_t cChunkLength);
+  PixelFormat getDecodeFormat(const bool cScaled);
+  uint8_t handlePngColorType(const bool cScaled = false);
+  void startIDAT();
+  bool startBands(const size_t cScanlineSize, const uint8_t cBpp);
+  void setupColor(const PixelFormat cFormat);
+  AlphaMode getExpandAlpha() const;
+  void applyColor(uint8_t *pPixels, const uint32_t cCount);
+  void getOrientedSize(const Region &crRegion, uint32_t &rWidth, uint32_t &rHeight);
+  void setupOrientation(const uint32_t cWidth, const uint32_t cHeight);
+  void storeRow(const uint32_t cY, const uint8_t *cpRow);
+  void flushRotatedRows(const uint32_t cLastY);
+  Status resolveScale(const Scale &crScale, uint32_t &rWidth, uint32_t &rHeight);
+  void writeScaledRow(const uint32_t cY, const uint8_t *cpRow);
+  void finishStats(const uint64_t cStart);
+  void startInterlaced(const size_t cSampleBits, const uint8_t cBpp, const uint8_t cPixelSize);
+  void storeInterlacedRow(const uint32_t cRow, const uint8_t *cpRow);
+  void uncompressIDAT(const uint32_t cChunkLength);
+  void endIDAT();
+  void parsePLTE(const uint32_t cChunkLength);
+  void parseTRNS(const uint32_t cChunkLength);
+  Status parseText(const Chunk &crChunk, struct Text &rText, const bool cInflate);
+  void parseACTL(const uint32_t cChunkLength);
+  void parseFCTL(const uint32_t cChunkLength);
+  void checkSequence(const uint8_t *cpSequence);
+  void startAnimation();
+  void startFrame();
+  void storeFrameRow(const uint32_t cRow, const uint8_t *cpRow);
+  void storeFramePassRow(const uint32_t cRow, const uint8_t *cpRow);
+  void endFrame();
+  void disposeFrame();
   
   struct IHDR mIhdr;
+  uint8_t mValidPngMask;
+
+  // Every chunk seen so far, mChunkOffset is where the next chunk starts
+  std::vector<Chunk> mChunks;
+  uint64_t mChunkOffset;
+  bool mMetadataOnly;
   std::vector<uint8_t> mImgData;
-  std::ifstream mPngFile;
+  Region mRegion;
+  uint8_t *mpOut;
+  size_t mOutStride;
+
+  // Size of the image mImgData holds, tightly packed, once a decode into it has sized it
+  uint32_t mImgWidth;
+  uint32_t mImgHeight;
+  uint8_t mImgPixelSize;
+  std::unique_ptr<MappedFile> mpMappedFile;
+  std::unique_ptr<PngSource> mpSource;
+  std::unique_ptr<ScanlineDecoder> mpOwnScanlines;
+  ScanlineDecoder *mpScanlines;
+  bool mPipelined;
+
+  // iDOT images decode their bands on mpBands while mBanded is set, band offsets count from mIdotOffset
+  std::unique_ptr<BandDecoder> mpBands;
+  bool mUseBands;
+  bool mBanded;
+  uint64_t mIdotOffset;
+  InflateEngine mInflateEngine;
+  CrcMode mCrcMode;
+  bool mCheckCrc;
+  uint32_t mChunkCrc;
+  std::vector<uint8_t> mPalette;
+  uint16_t mPaletteEntries;
+
+  // Adam7 decoding, mPass is the pass the next row belongs to and mPassFirstRow its first row across all passes
+  PassCallback mPassCallback;
+  ExpandFn mExpand;
+  ScatterFn mScatter;
+  uint8_t mPixelSize;
+  uint8_t mPass;
+  uint32_t mPassFirstRow;
+  std::vector<uint8_t> mPassPixels;
+  std::vector<ScanlinePass> mPassLayout;
+  PixelFormat mPixelFormat;
+  AlphaMode mAlphaMode;
+
+  // Conversion of every expanded row to mColorTarget, shared with other decodes of the same color chunks
+  ColorTarget mColorTarget;
+  ColorRef mpColor;
+  ColorLayout mColorLayout;
+
+  // Pixel (x, y) of the region goes to mpOrigin + x * mColumnStep + y * mRowStep
+  Orientation mOrientation;
+  uint8_t *mpOrigin;
+  ptrdiff_t mColumnStep;
+  ptrdiff_t mRowStep;
+  std::vector<uint8_t> mRotateRows;
+  uint32_t mRotateCount;
+
+  // Push decoding, mpPush is the source when bytes come through feed and mPushRemaining counts chunk data not read
+  PushSource *mpPush;
+  PushState mPushState;
+  char mPushType[5];
+  uint32_t mPushRemaining;
+
+  // Rows of the region written to the output so far and Adam7 passes finished, for progress reports
+  uint32_t mRowsWritten;
+  uint8_t mPassesDone;
+
+  // Scaled decodes feed every row to mScaler, mScale holds the resolved output size before orientation
+  Downscaler mScaler;
+  bool mScaled;
+  Scale mScale;
+
+  // APNG frames are drawn over mImgData, mFrame is the last frame drawn and mNextFrame a frame control read ahead
+  // of its data. mSavedRect holds what a DISPOSE_PREVIOUS frame covered, mFramePixels an interlaced frame.
+  AnimationState mAnimState;
+  bool mAnimated;
+  bool mHaveNextFrame;
+  uint32_t mFrameCount;
+  uint32_t mSequence;
+  uint32_t mFramesDone;
+  struct Frame mFrame;
+  struct Frame mNextFrame;
+  BlendFn mBlend;
+  std::vector<uint8_t> mSavedRect;
+  std::vector<uint8_t> mFramePixels;
+
+  // Time spent inside the scanline decoder is not read time, mStatsCapacity holds buffer sizes before the decode
+  bool mCollectStats;
+  DecodeStats mStats;
+  uint64_t mScanlineNs;
+  size_t mStatsCapacity[3];
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,403 @@
+#include "scale.hpp"
+#include "unfilter.hpp"
+
+#include <cstring>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+  #define SCALE_X86 1
+  #include <immintrin.h>
+#endif
+
+/* Function:    getTapWeights
+   Description: Gets the unnormalized weights one source column or row has for the two output pixels it lands
+                between
+   Parameters:  uint32_t - Source column or row
+                uint32_t - Source size
+                uint32_t - Output size
+                ScaleFilter - Filter to weigh with
+                uint32_t - Set to the first output pixel
+                double - Set to the weight for the first output pixel
+                double - Set to the weight for the output pixel after it, 0 past the last one
+   Returns:     None
+ */
+static void getTapWeights(const uint32_t cX, const uint32_t cSrcSize, const uint32_t cDstSize,
+                          const ScaleFilter cFilter, uint32_t &rFirst, double &rWeight0, double &rWeight1)
+{
+  const double cScale = static_cast<double>(cSrcSize) / cDstSize;
+
+  if (cFilter == SCALE_BOX)
+  {
+    // Source pixel x covers [x, x + 1) and output pixel j covers [j * scale, (j + 1) * scale)
+    rFirst = static_cast<uint32_t>(static_cast<uint64_t>(cX) * cDstSize / cSrcSize);
+
+    const double cEnd = std::min(cX + 1.0, (rFirst + 1) * cScale);
+
+    rWeight0 = cEnd - cX;
+    rWeight1 = (rFirst + 1 < cDstSize) ? (cX + 1.0) - cEnd : 0.0;
+    return;
+  }
+
+  // Position in output pixels, output pixel j is centered on j and its tent reaches one output pixel either side
+  const double cPosition = ((cX + 0.5) / cScale) - 0.5;
+
+  rFirst = (cPosition <= 0.0) ? 0 : std::min(static_cast<uint32_t>(cPosition), cDstSize - 1);
+  rWeight0 = std::max(0.0, 1.0 - std::fabs(cPosition - rFirst));
+  rWeight1 = (rFirst + 1 < cDstSize) ? std::max(0.0, 1.0 - std::fabs(cPosition - (rFirst + 1.0))) : 0.0;
+}
+
+/* Function:    sumColumns
+   Description: Adds the weighted samples of one source row to the horizontal sums of the output pixels they land
+                on. Source columns can be cStepX apart, as in an Adam7 pass. Neighbouring pixels mostly land on the
+                same output pixel, so their sums are kept in registers until the output pixel changes.
+   Parameters:  uint32_t* - Horizontal sums, one per output sample
+                uint8_t* - Source pixels, packed
+                ScaleTap* - Tap of the first source column, the others are cStepX taps apart
+                uint32_t - Source columns between two pixels
+                uint32_t - Pixels in the row
+   Returns:     None
+ */
+template <uint8_t CHANNELS>
+static void sumColumns(uint32_t *pSums, const uint8_t *cpPixels, const ScaleTap *cpTaps, const uint32_t cStepX,
+                       const uint32_t cCount)
+{
+  uint32_t first = (cCount != 0) ? cpTaps[0].first : 0;
+  uint32_t sum0[CHANNELS] = {};
+  uint32_t sum1[CHANNELS] = {};
+
+  for (uint32_t i = 0; i < cCount; i ++)
+  {
+    const ScaleTap &crTap = cpTaps[static_cast<size_t>(i) * cStepX];
+
+    if (crTap.first != first)
+    {
+      uint32_t *pFirst = pSums + (static_cast<size_t>(first) * CHANNELS);
+
+      for (uint8_t c = 0; c < CHANNELS; c ++)
+      {
+        pFirst[c] += sum0[c];
+        pFirst[CHANNELS + c] += sum1[c];
+        sum0[c] = 0;
+        sum1[c] = 0;
+      }
+
+      first = crTap.first;
+    }
+
+    for (uint8_t c = 0; c < CHANNELS; c ++)
+    {
+      sum0[c] += static_cast<uint32_t>(crTap.weight[0]) * cpPixels[c];
+      sum1[c] += static_cast<uint32_t>(crTap.weight[1]) * cpPixels[c];
+    }
+
+    cpPixels += CHANNELS;
+  }
+
+  for (uint8_t c = 0; c < CHANNELS; c ++)
+  {
+    pSums[(static_cast<size_t>(first) * CHANNELS) + c] += sum0[c];
+    pSums[((static_cast<size_t>(first) + 1) * CHANNELS) + c] += sum1[c];
+  }
+}
+
+/* Function:    accumulateScalar
+   Description: Adds a row of horizontal sums into an output row of accumulators with one vertical weight
+   Parameters:  uint32_t* - Output row accumulators
+                uint32_t* - Horizontal sums
+                uint16_t - Vertical weight
+                size_t - Samples in the row, a multiple of SCALE_LANES
+   Returns:     None
+ */
+static void accumulateScalar(uint32_t *pAccum, const uint32_t *cpSums, const uint16_t cWeight, const size_t cLanes)
+{
+  for (size_t i = 0; i < cLanes; i ++)
+  {
+    pAccum[i] += ((cpSums[i] + (1u << (SCALE_ROW_SHIFT - 1))) >> SCALE_ROW_SHIFT) * cWeight;
+  }
+}
+
+#ifdef SCALE_X86
+/* Function:    sumColumnsSse2
+   Description: sumColumns for 4 byte pixels, every pixel is widened to four 32 bit lanes and multiplied by its
+                weights with madd against zero high halves
+ */
+static void sumColumnsSse2(uint32_t *pSums, const uint8_t *cpPixels, const ScaleTap *cpTaps, const uint32_t cStepX,
+                           const uint32_t cCount)
+{
+  const __m128i cZero = _mm_setzero_si128();
+  uint32_t first = (cCount != 0) ? cpTaps[0].first : 0;
+  __m128i sum0 = cZero;
+  __m128i sum1 = cZero;
+
+  for (uint32_t i = 0; i < cCount; i ++)
+  {
+    const ScaleTap &crTap = cpTaps[static_cast<size_t>(i) * cStepX];
+    int32_t pixel = 0;
+
+    if (crTap.first != first)
+    {
+      __m128i *pFirst = reinterpret_cast<__m128i *>(pSums + (static_cast<size_t>(first) * 4));
+
+      _mm_storeu_si128(pFirst, _mm_add_epi32(_mm_loadu_si128(pFirst), sum0));
+      _mm_storeu_si128(pFirst + 1, _mm_add_epi32(_mm_loadu_si128(pFirst + 1), sum1));
+      sum0 = cZero;
+      sum1 = cZero;
+      first = crTap.first;
+    }
+
+    memcpy(&pixel, cpPixels + (static_cast<size_t>(i) * 4), sizeof(pixel));
+
+    const __m128i cPixel = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(pixel), cZero), cZero);
+
+    sum0 = _mm_add_epi32(sum0, _mm_madd_epi16(cPixel, _mm_set1_epi32(crTap.weight[0])));
+    sum1 = _mm_add_epi32(sum1, _mm_madd_epi16(cPixel, _mm_set1_epi32(crTap.weight[1])));
+  }
+
+  __m128i *pFirst = reinterpret_cast<__m128i *>(pSums + (static_cast<size_t>(first) * 4));
+
+  _mm_storeu_si128(pFirst, _mm_add_epi32(_mm_loadu_si128(pFirst), sum0));
+  _mm_storeu_si128(pFirst + 1, _mm_add_epi32(_mm_loadu_si128(pFirst + 1), sum1));
+}
+
+/* Function:    accumulateSse2
+   Description: accumulateScalar for 8 samples at a time. Rounded sums are at most 255 << SCALE_ROW_SHIFT, so they
+                pack to 16 bits and multiply by the weight as a low and high half.
+ */
+static void accumulateSse2(uint32_t *pAccum, const uint32_t *cpSums, const uint16_t cWeight, const size_t cLanes)
+{
+  const __m128i cRound = _mm_set1_epi32(1 << (SCALE_ROW_SHIFT - 1));
+  const __m128i cWeight16 = _mm_set1_epi16(static_cast<short>(cWeight));
+
+  for (size_t i = 0; i < cLanes; i += SCALE_LANES)
+  {
+    const __m128i *cpIn = reinterpret_cast<const __m128i *>(cpSums + i);
+    __m128i *pOut = reinterpret_cast<__m128i *>(pAccum + i);
+    const __m128i cLo = _mm_srli_epi32(_mm_add_epi32(_mm_loadu_si128(cpIn), cRound), SCALE_ROW_SHIFT);
+    const __m128i cHi = _mm_srli_epi32(_mm_add_epi32(_mm_loadu_si128(cpIn + 1), cRound), SCALE_ROW_SHIFT);
+    const __m128i cSamples = _mm_packs_epi32(cLo, cHi);
+    const __m128i cLow = _mm_mullo_epi16(cSamples, cWeight16);
+    const __m128i cHigh = _mm_mulhi_epu16(cSamples, cWeight16);
+
+    _mm_storeu_si128(pOut, _mm_add_epi32(_mm_loadu_si128(pOut), _mm_unpacklo_epi16(cLow, cHigh)));
+    _mm_storeu_si128(pOut + 1, _mm_add_epi32(_mm_loadu_si128(pOut + 1), _mm_unpackhi_epi16(cLow, cHigh)));
+  }
+}
+#endif
+
+/* Function:    Downscaler
+   Description: Constructs downscaler, buffers are sized by begin
+   Parameters:  None
+   Returns:     None
+ */
+Downscaler::Downscaler() : mDstWidth(0), mDstHeight(0), mChannels(0), mFilter(SCALE_BOX), mRowLanes(0), mSlots(0),
+                           mNextRow(0), mInOrder(true)
+{
+}
+
+/* Function:    buildTaps
+   Description: Works out the fixed point weights of every source column or row. The weights of each output pixel
+                are normalized and rounded as a running total, so they add up to exactly 1 << SCALE_WEIGHT_BITS
+                without any of them going negative.
+   Parameters:  uint32_t - Source size
+                uint32_t - Output size
+                std::vector<ScaleTap> - Receives one tap per source column or row
+   Returns:     None
+ */
+void Downscaler::buildTaps(const uint32_t cSrcSize, const uint32_t cDstSize, std::vector<ScaleTap> &rTaps)
+{
+  const double cOne = static_cast<double>(1u << SCALE_WEIGHT_BITS);
+  uint32_t first = 0;
+  double weight[2] = {0.0, 0.0};
+
+  rTaps.resize(cSrcSize);
+  mTotals.assign(cDstSize + 1, 0.0);
+  mCumulative.assign(cDstSize + 1, 0.0);
+  mQuantized.assign(cDstSize + 1, 0);
+
+  for (uint32_t x = 0; x < cSrcSize; x ++)
+  {
+    getTapWeights(x, cSrcSize, cDstSize, mFilter, first, weight[0], weight[1]);
+    mTotals[first] += weight[0];
+    mTotals[first + 1] += weight[1];
+  }
+
+  for (uint32_t x = 0; x < cSrcSize; x ++)
+  {
+    getTapWeights(x, cSrcSize, cDstSize, mFilter, first, weight[0], weight[1]);
+    rTaps[x].first = first;
+
+    for (uint8_t i = 0; i < 2; i ++)
+    {
+      const uint32_t cOut = first + i;
+      uint32_t quantized = mQuantized[cOut];
+
+      if (weight[i] > 0.0)
+      {
+        mCumulative[cOut] += weight[i] / mTotals[cOut];
+        quantized = static_cast<uint32_t>(std::lround(std::min(1.0, mCumulative[cOut]) * cOne));
+      }
+
+      rTaps[x].weight[i] = static_cast<uint16_t>(quantized - mQuantized[cOut]);
+      mQuantized[cOut] = quantized;
+    }
+  }
+}
+
+/* Function:    begin
+   Description: Prepares for a new image, reusing the buffers of the previous one
+   Parameters:  uint32_t - Source width
+                uint32_t - Source height
+                uint32_t - Output width, 1 to the source width
+                uint32_t - Output height, 1 to the source height
+                uint8_t - Samples per pixel, 1 to 4
+                ScaleFilter - Filter to downscale with
+                bool - True if rows are added top to bottom, each exactly once
+                RowWriter - Called with every finished output row in order, the row is only valid during the call
+   Returns:     Status - FAIL if a size or the channel count is out of range
+ */
+Status Downscaler::begin(const uint32_t cSrcWidth, const uint32_t cSrcHeight, const uint32_t cDstWidth,
+                         const uint32_t cDstHeight, const uint8_t cChannels, const ScaleFilter cFilter,
+                         const bool cInOrder, const RowWriter &crWriter)
+{
+  if (cDstWidth == 0 || cDstHeight == 0 || cDstWidth > cSrcWidth || cDstHeight > cSrcHeight || cChannels == 0 ||
+      cChannels > 4)
+  {
+    return FAIL;
+  }
+
+  const size_t cRowSamples = static_cast<size_t>(cDstWidth) * cChannels;
+
+  mDstWidth = cDstWidth;
+  mDstHeight = cDstHeight;
+  mChannels = cChannels;
+  mFilter = cFilter;
+  mWriter = crWriter;
+  mInOrder = cInOrder;
+  mNextRow = 0;
+  buildTaps(cSrcWidth, cDstWidth, mColumnTaps);
+  buildTaps(cSrcHeight, cDstHeight, mRowTaps);
+
+  mRowLanes = ((cRowSamples + SCALE_LANES - 1) / SCALE_LANES) * SCALE_LANES;
+  mRowSums.assign(std::max(mRowLanes, cRowSamples + cChannels), 0);
+  mSlots = cInOrder ? 2 : cDstHeight;
+  mAccum.assign(mSlots * mRowLanes, 0);
+  mOutRow.resize(cRowSamples);
+
+  return SUCCESS;
+}
+
+/* Function:    addRow
+   Description: Filters one source row into the output rows it reaches, writing every output row no later row can
+                reach first when rows come in order
+   Parameters:  uint32_t - Source row
+                uint8_t* - Source pixels, packed
+                uint32_t - Source column of the first pixel
+                uint32_t - Source columns between two pixels, 1 for a whole row
+                uint32_t - Pixels in the row
+   Returns:     None
+ */
+void Downscaler::addRow(const uint32_t cY, const uint8_t *cpPixels, const uint32_t cFirstX, const uint32_t cStepX,
+                        const uint32_t cCount)
+{
+  const ScaleTap &crRowTap = mRowTaps[cY];
+  const ScaleTap *cpColumnTaps = mColumnTaps.data() + cFirstX;
+
+  while (mInOrder && mNextRow < crRowTap.first)
+  {
+    writeRow(mNextRow);
+    mNextRow ++;
+  }
+
+  memset(mRowSums.data(), 0, mRowSums.size() * sizeof(uint32_t));
+
+  switch (mChannels)
+  {
+    case 1:
+      sumColumns<1>(mRowSums.data(), cpPixels, cpColumnTaps, cStepX, cCount);
+      break;
+    case 2:
+      sumColumns<2>(mRowSums.data(), cpPixels, cpColumnTaps, cStepX, cCount);
+      break;
+    case 3:
+      sumColumns<3>(mRowSums.data(), cpPixels, cpColumnTaps, cStepX, cCount);
+      break;
+    default:
+#ifdef SCALE_X86
+      if (getUnfilterSimdLevel() >= SIMD_SSE2)
+      {
+        sumColumnsSse2(mRowSums.data(), cpPixels, cpColumnTaps, cStepX, cCount);
+        break;
+      }
+#endif
+      sumColumns<4>(mRowSums.data(), cpPixels, cpColumnTaps, cStepX, cCount);
+      break;
+  }
+
+  for (uint8_t i = 0; i < 2; i ++)
+  {
+    const uint32_t cRow = crRowTap.first + i;
+    uint32_t *pAccum = mAccum.data() + ((cRow % mSlots) * mRowLanes);
+
+    if (crRowTap.weight[i] == 0 || cRow >= mDstHeight)
+    {
+      continue;
+    }
+
+#ifdef SCALE_X86
+    if (getUnfilterSimdLevel() >= SIMD_SSE2)
+    {
+      accumulateSse2(pAccum, mRowSums.data(), crRowTap.weight[i], mRowLanes);
+      continue;
+    }
+#endif
+
+    accumulateScalar(pAccum, mRowSums.data(), crRowTap.weight[i], mRowLanes);
+  }
+}
+
+/* Function:    writeRow
+   Description: Rounds one output row of accumulators to 8 bit samples, hands it to the writer and clears its slot
+                for the row that reuses it
+   Parameters:  uint32_t - Output row
+   Returns:     None
+ */
+void Downscaler::writeRow(const uint32_t cRow)
+{
+  // Both passes scale by 1 << SCALE_WEIGHT_BITS and the horizontal sums lost SCALE_ROW_SHIFT bits in between
+  const uint32_t cShift = (2 * SCALE_WEIGHT_BITS) - SCALE_ROW_SHIFT;
+  uint32_t *pAccum = mAccum.data() + ((cRow % mSlots) * mRowLanes);
+
+  for (size_t i = 0; i < mOutRow.size(); i ++)
+  {
+    mOutRow[i] = static_cast<uint8_t>((pAccum[i] + (1u << (cShift - 1))) >> cShift);
+  }
+
+  memset(pAccum, 0, mRowLanes * sizeof(uint32_t));
+  mWriter(cRow, mOutRow.data());
+}
+
+/* Function:    finish
+   Description: Writes every output row not written yet, called once all source rows have been added
+   Parameters:  None
+   Returns:     None
+ */
+void Downscaler::finish()
+{
+  while (mNextRow < mDstHeight)
+  {
+    writeRow(mNextRow);
+    mNextRow ++;
+  }
+}
+
+/* Function:    getScratchBytes
+   Description: Gets the memory held by the taps, sums and accumulators
+   Parameters:  None
+   Returns:     size_t - Bytes allocated
+ */
+size_t Downscaler::getScratchBytes() const
+{
+  return ((mColumnTaps.capacity() + mRowTaps.capacity()) * sizeof(ScaleTap)) +
+         ((mRowSums.capacity() + mAccum.capacity() + mQuantized.capacity()) * sizeof(uint32_t)) +
+         ((mTotals.capacity() + mCumulative.capacity()) * sizeof(double)) + mOutRow.capacity();
+}
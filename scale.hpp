@@ -0,0 +1,84 @@
+#ifndef SCALE_HPP
+#define SCALE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <functional>
+
+#include "common.hpp"
+
+// Fraction bits of the filter weights, the weights of every output pixel add up to 1 << SCALE_WEIGHT_BITS
+#define SCALE_WEIGHT_BITS 14
+
+// Bits dropped from a horizontally filtered sample so it fits 16 bits for the vertical pass
+#define SCALE_ROW_SHIFT 7
+
+// Samples handled per step by the vertical pass, rows are padded to a multiple of it
+#define SCALE_LANES 8
+
+/* Filter a downscale averages source pixels with. SCALE_BOX averages the source pixels every output pixel covers,
+   weighted by how much of them it covers. SCALE_TRIANGLE weighs them by distance to the output pixel center out to
+   one output pixel away, which is smoother but a little softer.
+ */
+enum ScaleFilter {
+  SCALE_BOX,
+  SCALE_TRIANGLE
+};
+
+// Where a source column or row goes, weight[0] to output pixel first and weight[1] to the one after it
+struct ScaleTap {
+  uint32_t first;
+  uint16_t weight[2];
+};
+
+/* Shrinks an image with 8 bit samples while it is decoded, so the full size image never exists. Every source row
+   is filtered horizontally into one row of sums and added into the output rows it touches with a fixed point
+   weight. Output rows are written as soon as no later source row can reach them, so rows that arrive in order only
+   ever need two output rows of accumulators. Rows that arrive out of order, such as Adam7 passes, accumulate the
+   whole output and are written by finish. Downscaling only, every output side has to be between 1 and the source
+   side.
+ */
+class Downscaler {
+public:
+  typedef std::function<void(const uint32_t cRow, const uint8_t *cpRow)> RowWriter;
+
+  Downscaler();
+  Status begin(const uint32_t cSrcWidth, const uint32_t cSrcHeight, const uint32_t cDstWidth,
+               const uint32_t cDstHeight, const uint8_t cChannels, const ScaleFilter cFilter, const bool cInOrder,
+               const RowWriter &crWriter);
+  void addRow(const uint32_t cY, const uint8_t *cpPixels, const uint32_t cFirstX, const uint32_t cStepX,
+              const uint32_t cCount);
+  void finish();
+  size_t getScratchBytes() const;
+
+private:
+  void buildTaps(const uint32_t cSrcSize, const uint32_t cDstSize, std::vector<ScaleTap> &rTaps);
+  void writeRow(const uint32_t cRow);
+
+  uint32_t mDstWidth;
+  uint32_t mDstHeight;
+  uint8_t mChannels;
+  ScaleFilter mFilter;
+  RowWriter mWriter;
+  std::vector<ScaleTap> mColumnTaps;
+  std::vector<ScaleTap> mRowTaps;
+
+  // Horizontal sums of the current source row, one extra pixel so weight[1] of the last column needs no check
+  std::vector<uint32_t> mRowSums;
+  size_t mRowLanes;
+
+  // Output rows being accumulated, row r lives in slot r % mSlots and mNextRow is the next one to write
+  std::vector<uint32_t> mAccum;
+  uint32_t mSlots;
+  uint32_t mNextRow;
+  bool mInOrder;
+  std::vector<uint8_t> mOutRow;
+
+  // Running weight per output pixel while taps are built
+  std::vector<double> mTotals;
+  std::vector<double> mCumulative;
+  std::vector<uint32_t> mQuantized;
+};
+
+#endif
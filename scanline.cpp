@@ -0,0 +1,474 @@
+#include "scanline.hpp"
+#include "unfilter.hpp"
+
+#include <cstring>
+#include <utility>
+#include <algorithm>
+
+// Busy polls before a waiting pipeline stage starts giving up its time slice
+#define SPIN_LIMIT 64
+
+/* Function:    ScanlineDecoder
+   Description: Constructs scanline decoder, the inflate backend is created lazily on the first begin
+   Parameters:  None
+   Returns:     None
+ */
+ScanlineDecoder::ScanlineDecoder() : mEngine(INFLATE_ZLIB), mAllocator(), mStreamEnd(false), mRowBytes(0),
+                                     mFilled(0), mRows(0), mRowsInflated(0), mRowsDone(0), mKernels(), mPassIndex(0),
+                                     mPassEnd(0), mCollectStats(false), mStats(), mPipelined(false), mRingHead(0),
+                                     mRingTail(0), mInputDone(false), mAbort(false), mUnfilterFailed(false)
+{
+}
+
+/* Function:    ~ScanlineDecoder
+   Description: Destroys scanline decoder, stopping the unfilter thread if a pipelined decode never finished
+   Parameters:  None
+   Returns:     None
+ */
+ScanlineDecoder::~ScanlineDecoder()
+{
+  abort();
+}
+
+/* Function:    fail
+   Description: Records an error message
+   Parameters:  std::string - Error message
+   Returns:     Status - Always FAIL
+ */
+Status ScanlineDecoder::fail(const std::string &crError)
+{
+  mError = crError;
+  return FAIL;
+}
+
+/* Function:    begin
+   Description: Prepares for a new image, reusing the inflate backend and row buffers of the previous one
+   Parameters:  size_t - Bytes in one scanline, not counting the filter type byte
+                uint32_t - Number of scanlines
+                uint8_t - Bytes per complete pixel, rounded up to 1
+                RowSink - Called with every reconstructed scanline in order
+                bool - True to unfilter on a second thread while the caller inflates, the sink is then called from
+                that thread
+   Returns:     Status - FAIL if the inflate backend could not be initialized
+ */
+Status ScanlineDecoder::begin(const size_t cRowBytes, const uint32_t cRows, const uint8_t cBpp,
+                              const RowSink &crSink, const bool cPipelined)
+{
+  mPasses.assign(1, ScanlinePass{cRowBytes, cRows});
+  return start(cBpp, crSink, cPipelined);
+}
+
+/* Function:    begin
+   Description: Prepares for an image made of several sub-images one after the other, such as the passes of an
+                Adam7 image. Every pass starts over without a previous row, the sink is called with rows numbered
+                across all passes. Passes are never pipelined.
+   Parameters:  std::vector<ScanlinePass> - Row size and row count of every pass, empty passes left out
+                uint8_t - Bytes per complete pixel, rounded up to 1
+                RowSink - Called with every reconstructed scanline in order
+   Returns:     Status - FAIL if the inflate backend could not be initialized
+ */
+Status ScanlineDecoder::begin(const std::vector<ScanlinePass> &crPasses, const uint8_t cBpp, const RowSink &crSink)
+{
+  mPasses = crPasses;
+  return start(cBpp, crSink, false);
+}
+
+/* Function:    start
+   Description: Resets the decoder for the passes in mPasses
+   Parameters:  uint8_t - Bytes per complete pixel, rounded up to 1
+                RowSink - Called with every reconstructed scanline in order
+                bool - True to unfilter on a second thread, only honored for a single pass
+   Returns:     Status - FAIL if the inflate backend could not be initialized
+ */
+Status ScanlineDecoder::start(const uint8_t cBpp, const RowSink &crSink, const bool cPipelined)
+{
+  size_t maxRowBytes = 0;
+  const size_t cPrevCapacity = mPrev.capacity();
+  const size_t cCurrCapacity = mCurr.capacity();
+  const size_t cRingCapacity = mRing.capacity();
+  const bool cNewInflater = !mpInflater;
+
+  abort();
+
+  if (STATS_ENABLED && mCollectStats)
+  {
+    mStats = DecodeStats();
+  }
+
+  if (!mpInflater)
+  {
+    mpInflater.reset(createInflater(mEngine));
+    mpInflater->setAllocator(mAllocator);
+  }
+
+  if (mpInflater->reset() != SUCCESS)
+  {
+    return fail(mpInflater->getError());
+  }
+
+  mRows = 0;
+
+  for (const ScanlinePass &crPass : mPasses)
+  {
+    maxRowBytes = std::max(maxRowBytes, crPass.rowBytes);
+    mRows += crPass.rows;
+  }
+
+  // Byte 0 of each row buffer holds the filter type so rows can be inflated in one piece
+  mPrev.assign(maxRowBytes + 1, 0);
+  mCurr.assign(maxRowBytes + 1, 0);
+  mPassIndex = 0;
+  mRowBytes = mPasses.empty() ? 0 : mPasses[0].rowBytes;
+  mPassEnd = mPasses.empty() ? 0 : mPasses[0].rows;
+  mFilled = 0;
+  mRowsInflated = 0;
+  mRowsDone = 0;
+  mKernels = getUnfilterKernels(cBpp);
+  mSink = crSink;
+  mStreamEnd = false;
+  mError.clear();
+  mPipelined = cPipelined && (mPasses.size() == 1);
+
+  if (mPipelined)
+  {
+    mRing.resize(PIPELINE_SLOTS * (mRowBytes + 1));
+    mRingHead = 0;
+    mRingTail = 0;
+    mInputDone = false;
+    mAbort = false;
+    mUnfilterFailed = false;
+    mUnfilterError.clear();
+  }
+
+  if (STATS_ENABLED && mCollectStats)
+  {
+    mStats.allocations += cNewInflater + (mPrev.capacity() > cPrevCapacity) + (mCurr.capacity() > cCurrCapacity) +
+                          (mRing.capacity() > cRingCapacity);
+    mStats.peakScratchBytes = mPrev.capacity() + mCurr.capacity() + mRing.capacity();
+  }
+
+  if (mPipelined)
+  {
+    mUnfilterThread = std::thread(&ScanlineDecoder::unfilterLoop, this);
+  }
+
+  return SUCCESS;
+}
+
+/* Function:    slot
+   Description: Gets the ring slot a scanline is inflated into in pipelined mode
+   Parameters:  uint32_t - Row index
+   Returns:     uint8_t* - Slot holding the filter type byte and the scanline
+ */
+uint8_t *ScanlineDecoder::slot(const uint32_t cRow)
+{
+  return mRing.data() + ((cRow % PIPELINE_SLOTS) * (mRowBytes + 1));
+}
+
+/* Function:    waitForSlot
+   Description: Blocks the inflate side until the unfilter thread has given back the slot for the next row
+   Parameters:  None
+   Returns:     Status - FAIL if the unfilter thread stopped on an error
+ */
+Status ScanlineDecoder::waitForSlot()
+{
+  uint32_t spins = 0;
+
+  while ((mRowsInflated - mRingTail.load(std::memory_order_acquire)) >= PIPELINE_SLOTS)
+  {
+    if (mUnfilterFailed.load(std::memory_order_acquire))
+    {
+      return fail(mUnfilterError);
+    }
+
+    if (++ spins > SPIN_LIMIT)
+    {
+      std::this_thread::yield();
+    }
+  }
+
+  return SUCCESS;
+}
+
+/* Function:    feed
+   Description: Inflates the next piece of the IDAT stream, emitting every scanline it completes
+   Parameters:  uint8_t* - Compressed data, usually the payload of one IDAT chunk
+                size_t - Bytes of compressed data
+   Returns:     Status - FAIL on corrupt compressed data or an invalid filter type
+ */
+Status ScanlineDecoder::feed(const uint8_t *cpData, const size_t cSize)
+{
+  const uint8_t *cpIn = cpData;
+  size_t inSize = cSize;
+
+  while (!finished() && !mStreamEnd)
+  {
+    uint8_t *pRow = mCurr.data();
+    uint8_t *pOut = nullptr;
+    size_t outSize = 0;
+    InflateStatus status = INFLATE_OK;
+    uint64_t start = 0;
+
+    if (mPipelined)
+    {
+      if (mFilled == 0 && waitForSlot() != SUCCESS)
+      {
+        return FAIL;
+      }
+
+      pRow = slot(mRowsInflated);
+    }
+
+    pOut = pRow + mFilled;
+    outSize = mRowBytes + 1 - mFilled;
+    start = statsStart(mCollectStats);
+    status = mpInflater->inflate(cpIn, inSize, pOut, outSize);
+    statsStop(mStats.stageNs[STATS_INFLATE], start, mCollectStats);
+
+    if (status == INFLATE_ERROR)
+    {
+      return fail(mpInflater->getError());
+    }
+
+    mFilled = mRowBytes + 1 - outSize;
+    mStreamEnd = (status == INFLATE_STREAM_END);
+
+    // Space left in the row means the backend has used up all the input it was given
+    if (outSize != 0)
+    {
+      break;
+    }
+
+    mFilled = 0;
+    mRowsInflated ++;
+
+    if (STATS_ENABLED && mCollectStats)
+    {
+      mStats.filteredBytes += mRowBytes + 1;
+    }
+
+    if (mPipelined)
+    {
+      mRingHead.store(mRowsInflated, std::memory_order_release);
+      continue;
+    }
+
+    start = statsStart(mCollectStats);
+
+    if (unfilterRow(mKernels, mCurr[0], mCurr.data() + 1, mPrev.data() + 1, mRowBytes) != SUCCESS)
+    {
+      return fail("Invalid filter type " + std::to_string(mCurr[0]) + " on row " + std::to_string(mRowsDone));
+    }
+
+    statsStop(mStats.stageNs[STATS_UNFILTER], start, mCollectStats);
+    start = statsStart(mCollectStats);
+    mSink(mRowsDone, mCurr.data() + 1);
+    statsStop(mStats.stageNs[STATS_STORE], start, mCollectStats);
+
+    if (STATS_ENABLED && mCollectStats)
+    {
+      mStats.filterCounts[mCurr[0]] ++;
+    }
+
+    std::swap(mPrev, mCurr);
+    mRowsDone ++;
+
+    // The next pass starts over with its own row size and no previous row
+    if (mRowsInflated == mPassEnd && (mPassIndex + 1) < mPasses.size())
+    {
+      mPassIndex ++;
+      mRowBytes = mPasses[mPassIndex].rowBytes;
+      mPassEnd += mPasses[mPassIndex].rows;
+      memset(mPrev.data(), 0, mRowBytes + 1);
+    }
+  }
+
+  return SUCCESS;
+}
+
+/* Function:    unfilterLoop
+   Description: Unfilter thread of a pipelined decode. A slot is given back only once the row after it has been
+                reconstructed, so the previous row is always read in place from the ring.
+   Parameters:  None
+   Returns:     None
+ */
+void ScanlineDecoder::unfilterLoop()
+{
+  uint32_t spins = 0;
+  const uint8_t *cpPrev = mPrev.data();
+
+  for (uint32_t row = 0; row < mRows; row ++)
+  {
+    while (mRingHead.load(std::memory_order_acquire) <= row)
+    {
+      if (mAbort.load(std::memory_order_acquire) || mInputDone.load(std::memory_order_acquire))
+      {
+        // Input done is only final once no row raced in after it
+        if (mAbort.load(std::memory_order_acquire) || mRingHead.load(std::memory_order_acquire) <= row)
+        {
+          mRingTail.store(mRows, std::memory_order_release);
+          return;
+        }
+      }
+
+      if (++ spins > SPIN_LIMIT)
+      {
+        std::this_thread::yield();
+      }
+    }
+
+    spins = 0;
+    uint8_t *pRow = slot(row);
+    uint64_t start = statsStart(mCollectStats);
+
+    if (unfilterRow(mKernels, pRow[0], pRow + 1, cpPrev + 1, mRowBytes) != SUCCESS)
+    {
+      mUnfilterError = "Invalid filter type " + std::to_string(pRow[0]) + " on row " + std::to_string(row);
+      mUnfilterFailed.store(true, std::memory_order_release);
+      return;
+    }
+
+    statsStop(mStats.stageNs[STATS_UNFILTER], start, mCollectStats);
+    start = statsStart(mCollectStats);
+    mSink(row, pRow + 1);
+    statsStop(mStats.stageNs[STATS_STORE], start, mCollectStats);
+
+    if (STATS_ENABLED && mCollectStats)
+    {
+      mStats.filterCounts[pRow[0]] ++;
+    }
+    mRowsDone.store(row + 1, std::memory_order_release);
+    cpPrev = pRow;
+    mRingTail.store(row, std::memory_order_release);
+  }
+
+  mRingTail.store(mRows, std::memory_order_release);
+}
+
+/* Function:    finish
+   Description: Waits for the unfilter thread to reconstruct every row that was inflated. Has to be called before
+                the rows handed to the sink are used when decoding pipelined, and does nothing otherwise.
+   Parameters:  None
+   Returns:     Status - FAIL if the unfilter thread stopped on an error
+ */
+Status ScanlineDecoder::finish()
+{
+  if (!mUnfilterThread.joinable())
+  {
+    return SUCCESS;
+  }
+
+  mInputDone.store(true, std::memory_order_release);
+  mUnfilterThread.join();
+
+  if (mUnfilterFailed.load(std::memory_order_acquire))
+  {
+    return fail(mUnfilterError);
+  }
+
+  return SUCCESS;
+}
+
+/* Function:    abort
+   Description: Stops a pipelined decode without waiting for the remaining rows
+   Parameters:  None
+   Returns:     None
+ */
+void ScanlineDecoder::abort()
+{
+  if (mUnfilterThread.joinable())
+  {
+    mAbort.store(true, std::memory_order_release);
+    mUnfilterThread.join();
+  }
+}
+
+/* Function:    setInflateEngine
+   Description: Selects the decompression backend, takes effect from the next begin
+   Parameters:  InflateEngine - INFLATE_ZLIB for zlib, INFLATE_FAST for the built in inflater
+   Returns:     None
+ */
+void ScanlineDecoder::setInflateEngine(const InflateEngine cEngine)
+{
+  if (cEngine != mEngine)
+  {
+    abort();
+    mEngine = cEngine;
+    mpInflater.reset();
+  }
+}
+
+/* Function:    setAllocator
+   Description: Routes the allocations of the decompression backend through an allocator hook, takes effect from
+                the next begin
+   Parameters:  PngAllocator - Hook, a null allocate goes back to the default heap
+   Returns:     None
+ */
+void ScanlineDecoder::setAllocator(const PngAllocator &crAllocator)
+{
+  abort();
+  mAllocator = crAllocator;
+  mpInflater.reset();
+}
+
+/* Function:    setCollectStats
+   Description: Turns stats collection on or off from the next begin, only has an effect when built with
+                LESTPNG_STATS
+   Parameters:  bool - True to collect stats
+   Returns:     None
+ */
+void ScanlineDecoder::setCollectStats(const bool cCollect)
+{
+  mCollectStats = cCollect;
+}
+
+/* Function:    getStats
+   Description: Gets the inflate, unfilter and store counters of the current decode, complete once finish returns
+   Parameters:  None
+   Returns:     DecodeStats - Counters since the last begin
+ */
+const DecodeStats &ScanlineDecoder::getStats() const
+{
+  return mStats;
+}
+
+/* Function:    finished
+   Description: Checks if every scanline of the image has been inflated. Without a pipeline the rows have also been
+                reconstructed by then, with one finish has to be called first.
+   Parameters:  None
+   Returns:     bool - True once the last row has been inflated
+ */
+bool ScanlineDecoder::finished() const
+{
+  return mRowsInflated >= mRows;
+}
+
+/* Function:    rowsDone
+   Description: Getter function for the number of reconstructed scanlines
+   Parameters:  None
+   Returns:     uint32_t - Rows handed to the sink so far
+ */
+uint32_t ScanlineDecoder::rowsDone() const
+{
+  return mRowsDone.load(std::memory_order_acquire);
+}
+
+/* Function:    rows
+   Description: Getter function for the number of scanlines the current image needs, across all passes
+   Parameters:  None
+   Returns:     uint32_t - Rows passed to begin
+ */
+uint32_t ScanlineDecoder::rows() const
+{
+  return mRows;
+}
+
+/* Function:    getError
+   Description: Getter function for the last error message
+   Parameters:  None
+   Returns:     std::string - Error message, empty if nothing failed
+ */
+const std::string &ScanlineDecoder::getError() const
+{
+  return mError;
+}
@@ -0,0 +1,99 @@
+#ifndef SCANLINE_HPP
+#define SCANLINE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <memory>
+
+#include "common.hpp"
+#include "inflater.hpp"
+#include "unfilter.hpp"
+#include "stats.hpp"
+
+// Scanline slots in the ring between the inflate and unfilter threads of a pipelined decode
+#define PIPELINE_SLOTS 32
+
+// Rows of one sub-image of the IDAT stream, a plain image is one pass and an Adam7 image up to seven
+struct ScanlinePass {
+  size_t rowBytes;
+  uint32_t rows;
+};
+
+/* Inflates IDAT data as it arrives and reconstructs every scanline as soon as its last byte has been inflated.
+   Only the previous and the current scanline are kept, each reconstructed row is handed to the row sink and is
+   only valid for the duration of that call.
+
+   In pipelined mode the thread calling feed only inflates. Filtered scanlines go through a single producer single
+   consumer ring to a second thread that unfilters them and calls the row sink, so both stages run at once.
+ */
+class ScanlineDecoder {
+public:
+  typedef std::function<void(const uint32_t cRow, const uint8_t *cpRow)> RowSink;
+
+  ScanlineDecoder();
+  ~ScanlineDecoder();
+  ScanlineDecoder(const ScanlineDecoder &) = delete;
+  ScanlineDecoder &operator=(const ScanlineDecoder &) = delete;
+
+  Status begin(const size_t cRowBytes, const uint32_t cRows, const uint8_t cBpp, const RowSink &crSink,
+               const bool cPipelined = false);
+  Status begin(const std::vector<ScanlinePass> &crPasses, const uint8_t cBpp, const RowSink &crSink);
+  Status feed(const uint8_t *cpData, const size_t cSize);
+  Status finish();
+  void abort();
+  void setInflateEngine(const InflateEngine cEngine);
+  void setAllocator(const PngAllocator &crAllocator);
+  void setCollectStats(const bool cCollect);
+  const DecodeStats &getStats() const;
+  bool finished() const;
+  uint32_t rowsDone() const;
+  uint32_t rows() const;
+  const std::string &getError() const;
+
+private:
+  Status start(const uint8_t cBpp, const RowSink &crSink, const bool cPipelined);
+  Status fail(const std::string &crError);
+  uint8_t *slot(const uint32_t cRow);
+  Status waitForSlot();
+  void unfilterLoop();
+
+  std::unique_ptr<InflateBackend> mpInflater;
+  InflateEngine mEngine;
+  PngAllocator mAllocator;
+  bool mStreamEnd;
+  std::vector<uint8_t> mPrev;
+  std::vector<uint8_t> mCurr;
+  size_t mRowBytes;
+  size_t mFilled;
+  uint32_t mRows;
+  uint32_t mRowsInflated;
+  std::atomic<uint32_t> mRowsDone;
+  UnfilterKernels mKernels;
+  std::vector<ScanlinePass> mPasses;
+  size_t mPassIndex;
+  uint32_t mPassEnd;
+  RowSink mSink;
+  std::string mError;
+
+  // Inflate counters are written by the feed thread, unfilter and store counters by whichever thread unfilters
+  bool mCollectStats;
+  DecodeStats mStats;
+
+  // Pipelined mode, mRowsInflated doubles as the ring head and mRingTail counts slots given back
+  bool mPipelined;
+  std::vector<uint8_t> mRing;
+  std::thread mUnfilterThread;
+  std::atomic<uint32_t> mRingHead;
+  std::atomic<uint32_t> mRingTail;
+  std::atomic<bool> mInputDone;
+  std::atomic<bool> mAbort;
+  std::atomic<bool> mUnfilterFailed;
+  std::string mUnfilterError;
+};
+
+#endif
@@ -0,0 +1,516 @@
+#include "source.hpp"
+
+#include <algorithm>
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+#endif
+
+#define STREAM_READ_SIZE 16384
+
+/* Function:    StreamSource
+   Description: Opens a file to be read through a stream
+   Parameters:  std::string - Filepath to read from
+   Returns:     None
+ */
+StreamSource::StreamSource(const std::string &crPath) : mFile(crPath.c_str(), std::ios::binary), mSize(0)
+{
+  if (mFile.seekg(0, std::ios::end))
+  {
+    mSize = static_cast<uint64_t>(mFile.tellg());
+    mFile.seekg(0, std::ios::beg);
+  }
+}
+
+/* Function:    read
+   Description: Reads exactly the requested amount of bytes into the reusable buffer
+   Parameters:  size_t - Amount of bytes to read
+   Returns:     uint8_t* - Bytes read, nullptr if the file ended first
+ */
+const uint8_t *StreamSource::read(const size_t cSize)
+{
+  if (mBuffer.size() < cSize)
+  {
+    mBuffer.resize(cSize);
+  }
+
+  mFile.read((char *) mBuffer.data(), cSize);
+
+  return (static_cast<size_t>(mFile.gcount()) == cSize) ? mBuffer.data() : nullptr;
+}
+
+/* Function:    readSome
+   Description: Reads up to STREAM_READ_SIZE bytes so large chunks never need a buffer of their own size
+   Parameters:  size_t - Most bytes the caller wants
+                uint8_t** - Set to the bytes read
+   Returns:     size_t - Amount of bytes read, 0 if the file ended
+ */
+size_t StreamSource::readSome(const size_t cMaxSize, const uint8_t **ppData)
+{
+  const size_t cSize = std::min<size_t>(cMaxSize, STREAM_READ_SIZE);
+
+  if (mBuffer.size() < cSize)
+  {
+    mBuffer.resize(cSize);
+  }
+
+  mFile.read((char *) mBuffer.data(), cSize);
+  *ppData = mBuffer.data();
+
+  return static_cast<size_t>(mFile.gcount());
+}
+
+/* Function:    skip
+   Description: Seeks past bytes, so skipped chunks such as IDAT in a metadata read never come off the disk
+   Parameters:  size_t - Amount of bytes to skip
+   Returns:     bool - False if the file ended first
+ */
+bool StreamSource::skip(const size_t cSize)
+{
+  const std::streamoff cPosition = mFile.tellg();
+
+  if (cPosition < 0 || (mSize - static_cast<uint64_t>(cPosition)) < cSize)
+  {
+    mFile.setstate(std::ios::eofbit | std::ios::failbit);
+    return false;
+  }
+
+  mFile.seekg(static_cast<std::streamoff>(cSize), std::ios::cur);
+
+  return true;
+}
+
+/* Function:    readAt
+   Description: Reads bytes at an offset into the reusable buffer and seeks back to where the walk was
+   Parameters:  uint64_t - Offset from the start of the file
+                size_t - Amount of bytes to read
+   Returns:     uint8_t* - Bytes read, nullptr if the range is not inside the file
+ */
+const uint8_t *StreamSource::readAt(const uint64_t cOffset, const size_t cSize)
+{
+  const std::ios::iostate cState = mFile.rdstate();
+  const std::streamoff cPosition = mFile.tellg();
+  const uint8_t *cpData = nullptr;
+
+  if (cOffset > mSize || (mSize - cOffset) < cSize)
+  {
+    return nullptr;
+  }
+
+  mFile.clear();
+  mFile.seekg(static_cast<std::streamoff>(cOffset), std::ios::beg);
+  cpData = read(cSize);
+  mFile.clear();
+
+  if (cPosition >= 0)
+  {
+    mFile.seekg(cPosition, std::ios::beg);
+  }
+
+  mFile.setstate(cState);
+
+  return cpData;
+}
+
+/* Function:    good
+   Description: Checks if the stream can still be read from
+   Parameters:  None
+   Returns:     bool - Stream state
+ */
+bool StreamSource::good() const
+{
+  return mFile.good();
+}
+
+/* Function:    MemorySource
+   Description: Wraps bytes already in memory, the caller keeps them alive while the source is used
+   Parameters:  ByteSpan - Whole png file
+   Returns:     None
+ */
+MemorySource::MemorySource(const ByteSpan &crBytes) : mBytes(crBytes), mOffset(0), mGood(crBytes.data != nullptr)
+{
+}
+
+/* Function:    reset
+   Description: Starts over on another buffer, so one source can walk any number of files
+   Parameters:  ByteSpan - Bytes to walk, have to outlive the reads
+   Returns:     None
+ */
+void MemorySource::reset(const ByteSpan &crBytes)
+{
+  mBytes = crBytes;
+  mOffset = 0;
+  mGood = (crBytes.data != nullptr);
+}
+
+/* Function:    read
+   Description: Hands out the next bytes in place
+   Parameters:  size_t - Amount of bytes to read
+   Returns:     uint8_t* - Pointer into the buffer, nullptr if it ends first
+ */
+const uint8_t *MemorySource::read(const size_t cSize)
+{
+  const uint8_t *cpData = nullptr;
+
+  if (!mGood || (mBytes.size - mOffset) < cSize)
+  {
+    mGood = false;
+    mOffset = mBytes.size;
+    return nullptr;
+  }
+
+  cpData = mBytes.data + mOffset;
+  mOffset += cSize;
+
+  return cpData;
+}
+
+/* Function:    readSome
+   Description: Hands out as much of the requested range as the buffer holds, in one piece
+   Parameters:  size_t - Most bytes the caller wants
+                uint8_t** - Set to a pointer into the buffer
+   Returns:     size_t - Amount of bytes handed out, 0 if the buffer ended
+ */
+size_t MemorySource::readSome(const size_t cMaxSize, const uint8_t **ppData)
+{
+  const size_t cSize = std::min(cMaxSize, mBytes.size - mOffset);
+
+  if (cSize < cMaxSize)
+  {
+    mGood = false;
+  }
+
+  *ppData = mBytes.data + mOffset;
+  mOffset += cSize;
+
+  return cSize;
+}
+
+/* Function:    skip
+   Description: Moves past bytes, this is only a pointer bump
+   Parameters:  size_t - Amount of bytes to skip
+   Returns:     bool - False if the buffer ended first
+ */
+bool MemorySource::skip(const size_t cSize)
+{
+  if ((mBytes.size - mOffset) < cSize)
+  {
+    mGood = false;
+    mOffset = mBytes.size;
+    return false;
+  }
+
+  mOffset += cSize;
+  return true;
+}
+
+/* Function:    readAt
+   Description: Hands out bytes at an offset in place, the position of the walk does not move
+   Parameters:  uint64_t - Offset from the start of the buffer
+                size_t - Amount of bytes to read
+   Returns:     uint8_t* - Pointer into the buffer, nullptr if the range is not inside it
+ */
+const uint8_t *MemorySource::readAt(const uint64_t cOffset, const size_t cSize)
+{
+  if (mBytes.data == nullptr || cOffset > mBytes.size || (mBytes.size - cOffset) < cSize)
+  {
+    return nullptr;
+  }
+
+  return mBytes.data + cOffset;
+}
+
+/* Function:    good
+   Description: Checks if the buffer can still be read from
+   Parameters:  None
+   Returns:     bool - False once a read went past the end of the buffer
+ */
+bool MemorySource::good() const
+{
+  return mGood && (mOffset < mBytes.size);
+}
+
+/* Function:    PushSource
+   Description: Constructs an empty push source
+   Parameters:  None
+   Returns:     None
+ */
+PushSource::PushSource() : mPendingOffset(0), mBytes{nullptr, 0}, mOffset(0)
+{
+}
+
+/* Function:    reset
+   Description: Drops every byte not read yet so the source can start on another file, the pending buffer keeps
+                its capacity
+   Parameters:  None
+   Returns:     None
+ */
+void PushSource::reset()
+{
+  mPending.clear();
+  mPendingOffset = 0;
+  mBytes = {nullptr, 0};
+  mOffset = 0;
+}
+
+/* Function:    compact
+   Description: Drops pending bytes that have been read, pointers handed out before are no longer valid
+   Parameters:  None
+   Returns:     None
+ */
+void PushSource::compact()
+{
+  mPending.erase(mPending.begin(), mPending.begin() + static_cast<ptrdiff_t>(mPendingOffset));
+  mPendingOffset = 0;
+}
+
+/* Function:    append
+   Description: Makes the next bytes of the file readable, they are read in place so they have to stay alive until
+                keep is called
+   Parameters:  uint8_t* - Bytes that arrived
+                size_t - Amount of bytes
+   Returns:     None
+ */
+void PushSource::append(const uint8_t *cpData, const size_t cSize)
+{
+  compact();
+  mBytes = {cpData, (cpData == nullptr) ? 0 : cSize};
+  mOffset = 0;
+}
+
+/* Function:    keep
+   Description: Copies the bytes of the last append that were not read into the pending buffer, so the caller can
+                let go of its buffer
+   Parameters:  None
+   Returns:     None
+ */
+void PushSource::keep()
+{
+  compact();
+
+  if (mOffset < mBytes.size)
+  {
+    mPending.insert(mPending.end(), mBytes.data + mOffset, mBytes.data + mBytes.size);
+  }
+
+  mBytes = {nullptr, 0};
+  mOffset = 0;
+}
+
+/* Function:    available
+   Description: Gets the amount of bytes that arrived and have not been read
+   Parameters:  None
+   Returns:     size_t - Bytes readable right now
+ */
+size_t PushSource::available() const
+{
+  return (mPending.size() - mPendingOffset) + (mBytes.size - mOffset);
+}
+
+/* Function:    read
+   Description: Hands out the next bytes in place when they are all in the pending buffer or all in the last
+                append, a read that starts in one and ends in the other moves the rest of it to the pending buffer
+   Parameters:  size_t - Amount of bytes to read
+   Returns:     uint8_t* - Bytes read, nullptr if not all of them have arrived yet
+ */
+const uint8_t *PushSource::read(const size_t cSize)
+{
+  const size_t cPending = mPending.size() - mPendingOffset;
+  const uint8_t *cpData = nullptr;
+
+  if (available() < cSize)
+  {
+    return nullptr;
+  }
+
+  if (cPending == 0)
+  {
+    cpData = mBytes.data + mOffset;
+    mOffset += cSize;
+    return cpData;
+  }
+
+  if (cPending < cSize)
+  {
+    compact();
+    mPending.insert(mPending.end(), mBytes.data + mOffset, mBytes.data + mOffset + (cSize - cPending));
+    mOffset += cSize - cPending;
+  }
+
+  cpData = mPending.data() + mPendingOffset;
+  mPendingOffset += cSize;
+
+  return cpData;
+}
+
+/* Function:    readSome
+   Description: Hands out as much of the requested range as has arrived, in one piece
+   Parameters:  size_t - Most bytes the caller wants
+                uint8_t** - Set to the bytes read
+   Returns:     size_t - Amount of bytes handed out, 0 if nothing is waiting
+ */
+size_t PushSource::readSome(const size_t cMaxSize, const uint8_t **ppData)
+{
+  const size_t cPending = mPending.size() - mPendingOffset;
+  size_t size = 0;
+
+  if (cPending > 0)
+  {
+    size = std::min(cMaxSize, cPending);
+    *ppData = mPending.data() + mPendingOffset;
+    mPendingOffset += size;
+    return size;
+  }
+
+  size = std::min(cMaxSize, mBytes.size - mOffset);
+  *ppData = mBytes.data + mOffset;
+  mOffset += size;
+
+  return size;
+}
+
+/* Function:    skip
+   Description: Moves past bytes that have arrived
+   Parameters:  size_t - Amount of bytes to skip
+   Returns:     bool - False if not all of them have arrived yet, nothing is skipped then
+ */
+bool PushSource::skip(const size_t cSize)
+{
+  const size_t cPending = std::min(cSize, mPending.size() - mPendingOffset);
+
+  if (available() < cSize)
+  {
+    return false;
+  }
+
+  mPendingOffset += cPending;
+  mOffset += cSize - cPending;
+
+  return true;
+}
+
+/* Function:    readAt
+   Description: Bytes that have been read are not kept, so nothing can be read again
+   Parameters:  uint64_t - Offset from the start of the file
+                size_t - Amount of bytes to read
+   Returns:     uint8_t* - Always nullptr
+ */
+const uint8_t *PushSource::readAt(const uint64_t, const size_t)
+{
+  return nullptr;
+}
+
+/* Function:    good
+   Description: A push source never ends, running out of bytes only means waiting for more
+   Parameters:  None
+   Returns:     bool - Always true
+ */
+bool PushSource::good() const
+{
+  return true;
+}
+
+/* Function:    MappedFile
+   Description: Maps a whole file read only into memory
+   Parameters:  std::string - Filepath to map
+   Returns:     None
+ */
+MappedFile::MappedFile(const std::string &crPath) : mpData(nullptr), mSize(0), mGood(false)
+{
+#ifdef _WIN32
+  LARGE_INTEGER size;
+
+  mMapHandle = nullptr;
+  mFileHandle = CreateFileA(crPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+  if (mFileHandle == INVALID_HANDLE_VALUE || !GetFileSizeEx(mFileHandle, &size) || size.QuadPart == 0)
+  {
+    return;
+  }
+
+  mMapHandle = CreateFileMappingA(mFileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+  if (mMapHandle == nullptr)
+  {
+    return;
+  }
+
+  mpData = static_cast<const uint8_t *>(MapViewOfFile(mMapHandle, FILE_MAP_READ, 0, 0, 0));
+  mSize = static_cast<size_t>(size.QuadPart);
+  mGood = (mpData != nullptr);
+#else
+  struct stat info;
+  void *pMapping = nullptr;
+  const int cFd = open(crPath.c_str(), O_RDONLY);
+
+  if (cFd < 0)
+  {
+    return;
+  }
+
+  if (fstat(cFd, &info) == 0 && info.st_size > 0)
+  {
+    pMapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, cFd, 0);
+
+    if (pMapping != MAP_FAILED)
+    {
+      // The chunk walker goes front to back, let the kernel read ahead aggressively
+      madvise(pMapping, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+      mpData = static_cast<const uint8_t *>(pMapping);
+      mSize = static_cast<size_t>(info.st_size);
+      mGood = true;
+    }
+  }
+
+  // The mapping keeps its own reference to the file
+  close(cFd);
+#endif
+}
+
+/* Function:    ~MappedFile
+   Description: Unmaps the file
+   Parameters:  None
+   Returns:     None
+ */
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+  if (mpData != nullptr)
+    UnmapViewOfFile(mpData);
+
+  if (mMapHandle != nullptr)
+    CloseHandle(mMapHandle);
+
+  if (mFileHandle != INVALID_HANDLE_VALUE)
+    CloseHandle(mFileHandle);
+#else
+  if (mpData != nullptr)
+    munmap(const_cast<uint8_t *>(mpData), mSize);
+#endif
+}
+
+/* Function:    good
+   Description: Checks if the file was mapped
+   Parameters:  None
+   Returns:     bool - Mapping state
+ */
+bool MappedFile::good() const
+{
+  return mGood;
+}
+
+/* Function:    getBytes
+   Description: Getter function for the mapped bytes
+   Parameters:  None
+   Returns:     ByteSpan - Whole file contents
+ */
+ByteSpan MappedFile::getBytes() const
+{
+  return {mpData, mSize};
+}
@@ -0,0 +1,107 @@
+#ifndef SOURCE_HPP
+#define SOURCE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include "common.hpp"
+
+/* Where the chunk walker gets its bytes from. Pointers handed out stay valid until the next call on the source, so
+   memory backed sources can give out pointers straight into the caller's buffer without copying anything. readAt
+   goes back to a chunk found earlier and leaves the position of the walk where it was.
+ */
+class PngSource {
+public:
+  virtual ~PngSource() {}
+  virtual const uint8_t *read(const size_t cSize) = 0;
+  virtual size_t readSome(const size_t cMaxSize, const uint8_t **ppData) = 0;
+  virtual bool skip(const size_t cSize) = 0;
+  virtual const uint8_t *readAt(const uint64_t cOffset, const size_t cSize) = 0;
+  virtual bool good() const = 0;
+};
+
+/* Reads through a std::ifstream into one reusable buffer, skipped bytes are seeked over and never read */
+class StreamSource : public PngSource {
+public:
+  StreamSource(const std::string &crPath);
+  const uint8_t *read(const size_t cSize) override;
+  size_t readSome(const size_t cMaxSize, const uint8_t **ppData) override;
+  bool skip(const size_t cSize) override;
+  const uint8_t *readAt(const uint64_t cOffset, const size_t cSize) override;
+  bool good() const override;
+
+private:
+  std::ifstream mFile;
+  std::vector<uint8_t> mBuffer;
+  uint64_t mSize;
+};
+
+/* Walks a buffer already in memory, nothing is ever copied */
+class MemorySource : public PngSource {
+public:
+  MemorySource(const ByteSpan &crBytes);
+  void reset(const ByteSpan &crBytes);
+  const uint8_t *read(const size_t cSize) override;
+  size_t readSome(const size_t cMaxSize, const uint8_t **ppData) override;
+  bool skip(const size_t cSize) override;
+  const uint8_t *readAt(const uint64_t cOffset, const size_t cSize) override;
+  bool good() const override;
+
+private:
+  ByteSpan mBytes;
+  size_t mOffset;
+  bool mGood;
+};
+
+/* Fed by the caller as bytes arrive. Reads are served in place from the last append while it lasts, only a read
+   that is split over two appends and the bytes left over when the parser stops are copied into a pending buffer.
+   A read that asks for more than has arrived returns nullptr without consuming anything, so the parser can try
+   again after the next append. Bytes that have been read are gone, readAt always fails.
+ */
+class PushSource : public PngSource {
+public:
+  PushSource();
+  void reset();
+  void append(const uint8_t *cpData, const size_t cSize);
+  void keep();
+  size_t available() const;
+  const uint8_t *read(const size_t cSize) override;
+  size_t readSome(const size_t cMaxSize, const uint8_t **ppData) override;
+  bool skip(const size_t cSize) override;
+  const uint8_t *readAt(const uint64_t cOffset, const size_t cSize) override;
+  bool good() const override;
+
+private:
+  void compact();
+
+  // Bytes held over from earlier appends come before the bytes of the current one
+  std::vector<uint8_t> mPending;
+  size_t mPendingOffset;
+  ByteSpan mBytes;
+  size_t mOffset;
+};
+
+/* Read only memory mapping of a whole file */
+class MappedFile {
+public:
+  MappedFile(const std::string &crPath);
+  ~MappedFile();
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  bool good() const;
+  ByteSpan getBytes() const;
+
+private:
+  const uint8_t *mpData;
+  size_t mSize;
+  bool mGood;
+#ifdef _WIN32
+  void *mFileHandle;
+  void *mMapHandle;
+#endif
+};
+
+#endif
@@ -0,0 +1,33 @@
+#include "stats.hpp"
+
+#include <algorithm>
+
+/* Function:    addDecodeStats
+   Description: Adds the counters of a decode to a running total, peak scratch is the largest of the two
+   Parameters:  DecodeStats - Total to add to
+                DecodeStats - Counters to add
+   Returns:     None
+ */
+void addDecodeStats(DecodeStats &rTotal, const DecodeStats &crStats)
+{
+  for (uint8_t i = 0; i < STATS_STAGES; i ++)
+  {
+    rTotal.stageNs[i] += crStats.stageNs[i];
+  }
+
+  for (uint8_t i = 0; i < FILTER_TYPES; i ++)
+  {
+    rTotal.filterCounts[i] += crStats.filterCounts[i];
+  }
+
+  rTotal.totalNs += crStats.totalNs;
+  rTotal.bytesIn += crStats.bytesIn;
+  rTotal.compressedBytes += crStats.compressedBytes;
+  rTotal.filteredBytes += crStats.filteredBytes;
+  rTotal.bytesOut += crStats.bytesOut;
+  rTotal.chunks += crStats.chunks;
+  rTotal.idatChunks += crStats.idatChunks;
+  rTotal.allocations += crStats.allocations;
+  rTotal.peakScratchBytes = std::max(rTotal.peakScratchBytes, crStats.peakScratchBytes);
+  rTotal.decodes += crStats.decodes;
+}
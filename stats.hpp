@@ -0,0 +1,83 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+
+#include "unfilter.hpp"
+
+/* Decode statistics are built in with -DLESTPNG_STATS (make STATS=1) and then collected only for decodes that ask
+   for them. Without the define every hook is a branch on a constant false and compiles to nothing.
+ */
+#ifdef LESTPNG_STATS
+  #define STATS_ENABLED true
+#else
+  #define STATS_ENABLED false
+#endif
+
+// Read covers chunk I/O, CRCs and parsing, store covers pixel expansion, format conversion and orientation
+enum StatsStage {
+  STATS_READ,
+  STATS_INFLATE,
+  STATS_UNFILTER,
+  STATS_STORE,
+  STATS_STAGES
+};
+
+/* Counters of one decode, or of many added up with addDecodeStats. Stage times of a pipelined decode overlap, so
+   they can add up to more than totalNs.
+ */
+struct DecodeStats {
+  uint64_t stageNs[STATS_STAGES];
+  uint64_t totalNs;
+
+  // Png bytes of every chunk visited, IDAT payload, inflated scanlines with filter bytes and pixels written
+  uint64_t bytesIn;
+  uint64_t compressedBytes;
+  uint64_t filteredBytes;
+  uint64_t bytesOut;
+  uint32_t chunks;
+  uint32_t idatChunks;
+  uint64_t filterCounts[FILTER_TYPES];
+
+  // Decoder buffers and inflate backends created or grown, and the largest row, ring and pass scratch in use
+  uint32_t allocations;
+  size_t peakScratchBytes;
+  uint32_t decodes;
+};
+
+void addDecodeStats(DecodeStats &rTotal, const DecodeStats &crStats);
+
+/* Function:    statsStart
+   Description: Starts timing a section, the clock is only read when stats are built in and turned on
+   Parameters:  bool - Runtime stats flag
+   Returns:     uint64_t - Start time in nanoseconds, 0 when not collecting
+ */
+static inline uint64_t statsStart(const bool cCollect)
+{
+  if (STATS_ENABLED && cCollect)
+  {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                 std::chrono::steady_clock::now().time_since_epoch()).count());
+  }
+
+  return 0;
+}
+
+/* Function:    statsStop
+   Description: Adds the time since statsStart to a counter
+   Parameters:  uint64_t - Counter to add to
+                uint64_t - Value statsStart returned
+                bool - Runtime stats flag, the same one given to statsStart
+   Returns:     None
+ */
+static inline void statsStop(uint64_t &rTotal, const uint64_t cStart, const bool cCollect)
+{
+  if (STATS_ENABLED && cCollect)
+  {
+    rTotal += statsStart(true) - cStart;
+  }
+}
+
+#endif
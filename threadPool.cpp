@@ -0,0 +1,170 @@
+#include "threadPool.hpp"
+
+#include <algorithm>
+
+/* Function:    ThreadPool
+   Description: Starts the worker threads
+   Parameters:  size_t - Number of workers, 0 to use one per hardware thread
+   Returns:     None
+ */
+ThreadPool::ThreadPool(const size_t cThreads) : mQueued(0), mPending(0), mNextQueue(0), mStop(false)
+{
+  const size_t cWorkers = (cThreads != 0) ? cThreads : std::max<size_t>(1, std::thread::hardware_concurrency());
+
+  for (size_t i = 0; i < cWorkers; i ++)
+  {
+    mQueues.emplace_back(new WorkerQueue());
+  }
+
+  for (size_t i = 0; i < cWorkers; i ++)
+  {
+    mThreads.emplace_back(&ThreadPool::workerLoop, this, i);
+  }
+}
+
+/* Function:    ~ThreadPool
+   Description: Runs every task still queued and joins the workers
+   Parameters:  None
+   Returns:     None
+ */
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStop = true;
+  }
+
+  mWake.notify_all();
+
+  for (std::thread &rThread : mThreads)
+  {
+    rThread.join();
+  }
+}
+
+/* Function:    submit
+   Description: Queues a task. Tasks are dealt out to the worker queues in turn, so tasks submitted in order of
+                decreasing cost leave every queue sorted the same way.
+   Parameters:  Task - Work to run
+   Returns:     None
+ */
+void ThreadPool::submit(const Task &crTask)
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    WorkerQueue &rQueue = *mQueues[mNextQueue];
+
+    mNextQueue = (mNextQueue + 1) % mQueues.size();
+    mPending ++;
+
+    // Counted under the queue lock before the task can be popped, so a worker never takes the count below zero
+    std::lock_guard<std::mutex> queueLock(rQueue.mutex);
+    mQueued ++;
+    rQueue.tasks.push_back(crTask);
+  }
+
+  mWake.notify_one();
+}
+
+/* Function:    wait
+   Description: Blocks until every submitted task has finished
+   Parameters:  None
+   Returns:     None
+ */
+void ThreadPool::wait()
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+
+  mDone.wait(lock, [this]() { return mPending == 0; });
+}
+
+/* Function:    size
+   Description: Getter function for the number of workers
+   Parameters:  None
+   Returns:     size_t - Number of workers
+ */
+size_t ThreadPool::size() const
+{
+  return mThreads.size();
+}
+
+/* Function:    popTask
+   Description: Takes the next task from the worker's own queue, or steals one from the back of another queue
+   Parameters:  size_t - Worker looking for work
+                Task - Set to the task taken
+   Returns:     bool - False if every queue was empty
+ */
+bool ThreadPool::popTask(const size_t cWorker, Task &rTask)
+{
+  for (size_t i = 0; i < mQueues.size(); i ++)
+  {
+    WorkerQueue &rQueue = *mQueues[(cWorker + i) % mQueues.size()];
+    std::lock_guard<std::mutex> lock(rQueue.mutex);
+
+    if (rQueue.tasks.empty())
+    {
+      continue;
+    }
+
+    if (i == 0)
+    {
+      rTask = std::move(rQueue.tasks.front());
+      rQueue.tasks.pop_front();
+    }
+    else
+    {
+      rTask = std::move(rQueue.tasks.back());
+      rQueue.tasks.pop_back();
+    }
+
+    mQueued --;
+    return true;
+  }
+
+  return false;
+}
+
+/* Function:    workerLoop
+   Description: Runs tasks until the pool is destroyed and every queue is empty
+   Parameters:  size_t - Index of this worker
+   Returns:     None
+ */
+void ThreadPool::workerLoop(const size_t cWorker)
+{
+  Task task;
+
+  while (true)
+  {
+    if (popTask(cWorker, task))
+    {
+      // A throwing task must not take the worker down with it, callers report their own errors
+      try
+      {
+        task(cWorker);
+      }
+      catch (...)
+      {
+      }
+
+      task = nullptr;
+
+      std::lock_guard<std::mutex> lock(mMutex);
+
+      if (-- mPending == 0)
+      {
+        mDone.notify_all();
+      }
+
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    mWake.wait(lock, [this]() { return mStop || mQueued > 0; });
+
+    if (mStop && mQueued == 0)
+    {
+      return;
+    }
+  }
+}
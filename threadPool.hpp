@@ -0,0 +1,51 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <cstddef>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+
+/* Work stealing thread pool. Every worker has its own queue and works through it front to back, a worker that runs
+   dry steals from the back of the other queues. Tasks are told which worker runs them so they can use per worker
+   scratch state without any locking.
+ */
+class ThreadPool {
+public:
+  typedef std::function<void(const size_t cWorker)> Task;
+
+  explicit ThreadPool(const size_t cThreads = 0);
+  ~ThreadPool();
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  void submit(const Task &crTask);
+  void wait();
+  size_t size() const;
+
+private:
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  bool popTask(const size_t cWorker, Task &rTask);
+  void workerLoop(const size_t cWorker);
+
+  std::vector<std::unique_ptr<WorkerQueue>> mQueues;
+  std::vector<std::thread> mThreads;
+  std::mutex mMutex;
+  std::condition_variable mWake;
+  std::condition_variable mDone;
+  std::atomic<size_t> mQueued;
+  size_t mPending;
+  size_t mNextQueue;
+  bool mStop;
+};
+
+#endif
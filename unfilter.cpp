@@ -0,0 +1,607 @@
+#include "unfilter.hpp"
+
+#include <cstring>
+#include <cstdlib>
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+  #define UNFILTER_X86 1
+  #include <immintrin.h>
+#endif
+
+// Bytes per pixel of every legal color type and bit depth, 1, 2, 3, 4, 6 and 8, plus one class for anything else
+#define BPP_CLASSES  7
+
+/* Function:    bppClass
+   Description: Maps bytes per pixel to a column of the kernel tables
+   Parameters:  uint8_t - Bytes per pixel
+   Returns:     uint8_t - Column for 1, 2, 3, 4, 6 and 8 bytes per pixel, 6 for everything else
+ */
+static inline uint8_t bppClass(const uint8_t cBpp)
+{
+  switch (cBpp)
+  {
+    case 1:
+      return 0;
+    case 2:
+      return 1;
+    case 3:
+      return 2;
+    case 4:
+      return 3;
+    case 6:
+      return 4;
+    case 8:
+      return 5;
+    default:
+      return 6;
+  }
+}
+
+/* Function:    calcPaethByte
+   Description: Paeth predictor for a single byte, ties favor a over b over c
+   Parameters:  uint8_t - Byte to the left
+                uint8_t - Byte above
+                uint8_t - Byte to the upper left
+   Returns:     uint8_t - Predicted byte
+ */
+static inline uint8_t calcPaethByte(const uint8_t cA, const uint8_t cB, const uint8_t cC)
+{
+  // int32_t type cast needed because values can be negative
+  const int32_t p  = static_cast<int32_t>(cA) + static_cast<int32_t>(cB) - static_cast<int32_t>(cC);
+  const int32_t pa = abs(p - static_cast<int32_t>(cA));
+  const int32_t pb = abs(p - static_cast<int32_t>(cB));
+  const int32_t pc = abs(p - static_cast<int32_t>(cC));
+
+  if ((pa <= pb) && (pa <= pc))
+  {
+    return cA;
+  }
+  else if (pb <= pc)
+  {
+    return cB;
+  }
+
+  return cC;
+}
+
+static void noneScalar(uint8_t *, const uint8_t *, const size_t, const uint8_t)
+{
+}
+
+static void subScalar(uint8_t *pRow, const uint8_t *, const size_t cRowBytes, const uint8_t cBpp)
+{
+  for (size_t i = cBpp; i < cRowBytes; i ++)
+  {
+    pRow[i] += pRow[i - cBpp];
+  }
+}
+
+static void upScalar(uint8_t *pRow, const uint8_t *cpPrev, const size_t cRowBytes, const uint8_t)
+{
+  for (size_t i = 0; i < cRowBytes; i ++)
+  {
+    pRow[i] += cpPrev[i];
+  }
+}
+
+static void averageScalar(uint8_t *pRow, const uint8_t *cpPrev, const size_t cRowBytes, const uint8_t cBpp)
+{
+  size_t i = 0;
+
+  for (; i < cBpp && i < cRowBytes; i ++)
+  {
+    pRow[i] += cpPrev[i] >> 1;
+  }
+
+  for (; i < cRowBytes; i ++)
+  {
+    pRow[i] += (static_cast<uint32_t>(pRow[i - cBpp]) + cpPrev[i]) >> 1;
+  }
+}
+
+static void paethScalar(uint8_t *pRow, const uint8_t *cpPrev, const size_t cRowBytes, const uint8_t cBpp)
+{
+  size_t i = 0;
+
+  // With no pixel to the left a and c are 0, so the predictor is always the byte above
+  for (; i < cBpp && i < cRowBytes; i ++)
+  {
+    pRow[i] += cpPrev[i];
+  }
+
+  for (; i < cRowBytes; i ++)
+  {
+    pRow[i] += calcPaethByte(pRow[i - cBpp], cpPrev[i], cpPrev[i - cBpp]);
+  }
+}
+
+/* The same loops with the pixel size as a template parameter, so the compiler sees a constant distance to the left
+   pixel and can unroll the first pixel and the neighbour loads
+ */
+template <uint8_t BPP>
+static void subBpp(uint8_t *pRow, const uint8_t *, const size_t cRowBytes, const uint8_t)
+{
+  for (size_t i = BPP; i < cRowBytes; i ++)
+  {
+    pRow[i] += pRow[i - BPP];
+  }
+}
+
+template <uint8_t BPP>
+static void averageBpp(uint8_t *pRow, const uint8_t *cpPrev, const size_t cRowBytes, const uint8_t)
+{
+  size_t i = 0;
+
+  for (; i < BPP && i < cRowBytes; i ++)
+  {
+    pRow[i] += cpPrev[i] >> 1;
+  }
+
+  for (; i < cRowBytes; i ++)
+  {
+    pRow[i] += (static_cast<uint32_t>(pRow[i - BPP]) + cpPrev[i]) >> 1;
+  }
+}
+
+template <uint8_t BPP>
+static void paethBpp(uint8_t *pRow, const uint8_t *cpPrev, const size_t cRowBytes, const uint8_t)
+{
+  size_t i = 0;
+
+  for (; i < BPP && i < cRowBytes; i ++)
+  {
+    pRow[i] += cpPrev[i];
+  }
+
+  for (; i < cRowBytes; i ++)
+  {
+    pRow[i] += calcPaethByte(pRow[i - BPP], cpPrev[i], cpPrev[i - BPP]);
+  }
+}
+
+#ifdef UNFILTER_X86
+
+/* Pixels of 3 and 4 bytes are moved in and out of the vector registers with memcpy so that unaligned scanlines are
+   never an issue. Loading 4 bytes for a 3 byte pixel is only done when that extra byte is still inside the row.
+ */
+static inline __m128i load3(const uint8_t *cpSrc)
+{
+  uint32_t value = 0;
+  memcpy(&value, cpSrc, 3);
+  return _mm_cvtsi32_si128(static_cast<int32_t>(value));
+}
+
+static inline __m128i load4(const uint8_t *cpSrc)
+{
+  int32_t value;
+  memcpy(&value, cpSrc, 4);
+  return _mm_cvtsi32_si128(value);
+}
+
+static inline void store3(uint8_t *pDst, const __m128i cValue)
+{
+  const int32_t value = _mm_cvtsi128_si32(cValue);
+  memcpy(pDst, &value, 3);
+}
+
+static inline void store4(uint8_t *pDst, const __m128i cValue)
+{
+  const int32_t value = _mm_cvtsi128_si32(cValue);
+  memcpy(pDst, &value, 4);
+}
+
+static inline void store12(uint8_t *pDst, const __m128i cValue)
+{
+  _mm_storel_epi64((__m128i *) pDst, cValue);
+  store4(pDst + 8, _mm_srli_si128(cValue, 8));
+}
+
+/* Function:    subSse2Bpp3
+   Description: Sub filter for 3 bytes per pixel. Four pixels are reconstructed per iteration with a log step prefix
+                sum inside the register and then offset by the last pixel of the previous group.
+ */
+static void subSse2Bpp3(uint8_t *pRow, const uint8_t *cpPrev, const size_t cRowBytes, const uint8_t cBpp)
+{
+  const __m128i pixelMask = _mm_setr_epi32(0x00FFFFFF, 0, 0, 0);
+  __m128i carry = _mm_setzero_si128();
+  size_t i = 0;
+
+  for (; i + 16 <= cRowBytes; i += 12)
+  {
+    __m128i x = _mm_loadu_si128((const __m128i *) (pRow + i));
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 3));
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 6));
+    x = _mm_add_epi8(x, carry);
+    store12(pRow + i, x);
+
+    carry = _mm_and_si128(_mm_srli_si128(x, 9), pixelMask);
+    carry = _mm_or_si128(carry, _mm_slli_si128(carry, 3));
+    carry = _mm_or_si128(carry, _mm_slli_si128(carry, 6));
+  }
+
+  subScalar(pRow + ((i > 0) ? i - cBpp : 0), cpPrev, cRowBytes - ((i > 0) ? i - cBpp : 0), cBpp);
+}
+
+static void subSse2Bpp4(uint8_t *pRow, const uint8_t *cpPrev, const size_t cRowBytes, const uint8_t cBpp)
+{
+  __m128i carry = _mm_setzero_si128();
+  size_t i = 0;
+
+  for (; i + 16 <= cRowBytes; i += 16)
+  {
+    __m128i x = _mm_loadu_si128((const __m128i *) (pRow + i));
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+    x = _mm_add_epi8(x, carry);
+    _mm_storeu_si128((__m128i *) (pRow + i), x);
+    carry = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+  }
+
+  subScalar(pRow + ((i > 0) ? i - cBpp : 0), cpPrev, cRowBytes - ((i > 0) ? i - cBpp : 0), cBpp);
+}
+
+static void upSse2(uint8_t *pRow, const uint8_t *cpPrev, const size_t cRowBytes, const uint8_t cBpp)
+{
+  size_t i = 0;
+
+  for (; i + 16 <= cRowBytes; i += 16)
+  {
+    const __m128i x = _mm_loadu_si128((const __m128i *) (pRow + i));
+    const __m128i b = _mm_loadu_si128((const __m128i *) (cpPrev + i));
+    _mm_storeu_si128((__m128i *) (pRow + i), _mm_add_epi8(x, b));
+  }
+
+  upScalar(pRow + i, cpPrev + i, cRowBytes - i, cBpp);
+}
+
+/* Function:    averageSse2
+   Description: Average filter for 3 or 4 bytes per pixel. _mm_avg_epu8 rounds up, so the low bit of a ^ b is
+                subtracted back out to get the floor the PNG spec asks for.
+ */
+template <uint8_t BPP>
+static void averageSse2(uint8_t *pRow, const uint8_t *cpPrev, const size_t cRowBytes, const uint8_t)
+{
+  const __m128i ones = _mm_set1_epi8(1);
+  __m128i a = _mm_setzero_si128();
+  size_t i = 0;
+
+  for (; i + BPP <= cRowBytes; i += BPP)
+  {
+    const bool cWide = (BPP == 4) || (i + 4 <= cRowBytes);
+    const __m128i b = cWide ? load4(cpPrev + i) : load3(cpPrev + i);
+    const __m128i x = cWide ? load4(pRow + i) : load3(pRow + i);
+    __m128i avg = _mm_avg_epu8(a, b);
+    avg = _mm_sub_epi8(avg, _mm_and_si128(_mm_xor_si128(a, b), ones));
+    a = _mm_add_epi8(x, avg);
+
+    if (BPP == 4)
+      store4(pRow + i, a);
+    else
+      store3(pRow + i, a);
+  }
+}
+
+/* Function:    paethPredict
+   Description: Selects the Paeth predictor from a, b and c widened to 16 bit lanes given |p - a|, |p - b| and |p - c|
+ */
+static inline __m128i paethPredict(const __m128i cA, const __m128i cB, const __m128i cC, const __m128i cPa,
+                                   const __m128i cPb, const __m128i cPc)
+{
+  const __m128i smallest = _mm_min_epi16(cPc, _mm_min_epi16(cPa, cPb));
+  const __m128i useA = _mm_cmpeq_epi16(smallest, cPa);
+  const __m128i useB = _mm_cmpeq_epi16(smallest, cPb);
+  const __m128i bOrC = _mm_or_si128(_mm_and_si128(useB, cB), _mm_andnot_si128(useB, cC));
+
+  return _mm_or_si128(_mm_and_si128(useA, cA), _mm_andnot_si128(useA, bOrC));
+}
+
+static inline __m128i absSse2(const __m128i cX)
+{
+  return _mm_max_epi16(cX, _mm_sub_epi16(_mm_setzero_si128(), cX));
+}
+
+/* Function:    paethSse2
+   Description: Paeth filter for 3 or 4 bytes per pixel. The predictor works on 9 bit signed intermediates, so each
+                pixel is widened to 16 bit lanes, the result is added with 8 bit wrap around and narrowed again.
+ */
+template <uint8_t BPP>
+static void paethSse2(uint8_t *pRow, const uint8_t *cpPrev, const size_t cRowBytes, const uint8_t)
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i a = zero;
+  __m128i c = zero;
+  size_t i = 0;
+
+  for (; i + BPP <= cRowBytes; i += BPP)
+  {
+    const bool cWide = (BPP == 4) || (i + 4 <= cRowBytes);
+    const __m128i b = _mm_unpacklo_epi8(cWide ? load4(cpPrev + i) : load3(cpPrev + i), zero);
+    __m128i x = _mm_unpacklo_epi8(cWide ? load4(pRow + i) : load3(pRow + i), zero);
+
+    const __m128i pa = _mm_sub_epi16(b, c);
+    const __m128i pb = _mm_sub_epi16(a, c);
+    const __m128i pc = _mm_add_epi16(pa, pb);
+
+    x = _mm_add_epi8(x, paethPredict(a, b, c, absSse2(pa), absSse2(pb), absSse2(pc)));
+
+    if (BPP == 4)
+      store4(pRow + i, _mm_packus_epi16(x, x));
+    else
+      store3(pRow + i, _mm_packus_epi16(x, x));
+
+    a = x;
+    c = b;
+  }
+}
+
+__attribute__((target("ssse3")))
+static void subSsse3Bpp3(uint8_t *pRow, const uint8_t *cpPrev, const size_t cRowBytes, const uint8_t cBpp)
+{
+  const __m128i lastPixel = _mm_setr_epi8(9, 10, 11, 9, 10, 11, 9, 10, 11, 9, 10, 11, -1, -1, -1, -1);
+  __m128i carry = _mm_setzero_si128();
+  size_t i = 0;
+
+  for (; i + 16 <= cRowBytes; i += 12)
+  {
+    __m128i x = _mm_loadu_si128((const __m128i *) (pRow + i));
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 3));
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 6));
+    x = _mm_add_epi8(x, carry);
+    store12(pRow + i, x);
+    carry = _mm_shuffle_epi8(x, lastPixel);
+  }
+
+  subScalar(pRow + ((i > 0) ? i - cBpp : 0), cpPrev, cRowBytes - ((i > 0) ? i - cBpp : 0), cBpp);
+}
+
+template <uint8_t BPP>
+__attribute__((target("ssse3")))
+static void paethSsse3(uint8_t *pRow, const uint8_t *cpPrev, const size_t cRowBytes, const uint8_t)
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i a = zero;
+  __m128i c = zero;
+  size_t i = 0;
+
+  for (; i + BPP <= cRowBytes; i += BPP)
+  {
+    const bool cWide = (BPP == 4) || (i + 4 <= cRowBytes);
+    const __m128i b = _mm_unpacklo_epi8(cWide ? load4(cpPrev + i) : load3(cpPrev + i), zero);
+    __m128i x = _mm_unpacklo_epi8(cWide ? load4(pRow + i) : load3(pRow + i), zero);
+
+    const __m128i pa = _mm_sub_epi16(b, c);
+    const __m128i pb = _mm_sub_epi16(a, c);
+    const __m128i pc = _mm_add_epi16(pa, pb);
+
+    x = _mm_add_epi8(x, paethPredict(a, b, c, _mm_abs_epi16(pa), _mm_abs_epi16(pb), _mm_abs_epi16(pc)));
+
+    if (BPP == 4)
+      store4(pRow + i, _mm_packus_epi16(x, x));
+    else
+      store3(pRow + i, _mm_packus_epi16(x, x));
+
+    a = x;
+    c = b;
+  }
+}
+
+__attribute__((target("avx2")))
+static void upAvx2(uint8_t *pRow, const uint8_t *cpPrev, const size_t cRowBytes, const uint8_t cBpp)
+{
+  size_t i = 0;
+
+  for (; i + 32 <= cRowBytes; i += 32)
+  {
+    const __m256i x = _mm256_loadu_si256((const __m256i *) (pRow + i));
+    const __m256i b = _mm256_loadu_si256((const __m256i *) (cpPrev + i));
+    _mm256_storeu_si256((__m256i *) (pRow + i), _mm256_add_epi8(x, b));
+  }
+
+  upScalar(pRow + i, cpPrev + i, cRowBytes - i, cBpp);
+}
+
+/* Function:    subAvx2Bpp4
+   Description: Sub filter for 4 bytes per pixel, eight pixels per iteration. Shifts only work inside each 128 bit
+                lane, so the low lane total is carried into the high lane before adding the previous group.
+ */
+__attribute__((target("avx2")))
+static void subAvx2Bpp4(uint8_t *pRow, const uint8_t *cpPrev, const size_t cRowBytes, const uint8_t cBpp)
+{
+  const __m256i lastPixel = _mm256_set1_epi32(7);
+  __m256i carry = _mm256_setzero_si256();
+  size_t i = 0;
+
+  for (; i + 32 <= cRowBytes; i += 32)
+  {
+    __m256i x = _mm256_loadu_si256((const __m256i *) (pRow + i));
+    x = _mm256_add_epi8(x, _mm256_slli_si256(x, 4));
+    x = _mm256_add_epi8(x, _mm256_slli_si256(x, 8));
+    x = _mm256_add_epi8(x, _mm256_shuffle_epi32(_mm256_permute2x128_si256(x, x, 0x08), 0xFF));
+    x = _mm256_add_epi8(x, carry);
+    _mm256_storeu_si256((__m256i *) (pRow + i), x);
+    carry = _mm256_permutevar8x32_epi32(x, lastPixel);
+  }
+
+  subScalar(pRow + ((i > 0) ? i - cBpp : 0), cpPrev, cRowBytes - ((i > 0) ? i - cBpp : 0), cBpp);
+}
+
+#endif
+
+/* Kernel tables indexed by [filter type][bytes per pixel class]. The vector kernels exist for 3 and 4 bytes per pixel
+   (and for Up, which does not care about pixel size), every other pixel size goes through the fixed size scalar loops.
+ */
+static const UnfilterFn cScalarKernels[FILTER_TYPES][BPP_CLASSES] = {
+  {noneScalar,    noneScalar,    noneScalar,    noneScalar,    noneScalar,    noneScalar,    noneScalar},
+  {subBpp<1>,     subBpp<2>,     subBpp<3>,     subBpp<4>,     subBpp<6>,     subBpp<8>,     subScalar},
+  {upScalar,      upScalar,      upScalar,      upScalar,      upScalar,      upScalar,      upScalar},
+  {averageBpp<1>, averageBpp<2>, averageBpp<3>, averageBpp<4>, averageBpp<6>, averageBpp<8>, averageScalar},
+  {paethBpp<1>,   paethBpp<2>,   paethBpp<3>,   paethBpp<4>,   paethBpp<6>,   paethBpp<8>,   paethScalar}
+};
+
+#ifdef UNFILTER_X86
+static const UnfilterFn cSse2Kernels[FILTER_TYPES][BPP_CLASSES] = {
+  {noneScalar,    noneScalar,    noneScalar,     noneScalar,     noneScalar,    noneScalar,    noneScalar},
+  {subBpp<1>,     subBpp<2>,     subSse2Bpp3,    subSse2Bpp4,    subBpp<6>,     subBpp<8>,     subScalar},
+  {upSse2,        upSse2,        upSse2,         upSse2,         upSse2,        upSse2,        upSse2},
+  {averageBpp<1>, averageBpp<2>, averageSse2<3>, averageSse2<4>, averageBpp<6>, averageBpp<8>, averageScalar},
+  {paethBpp<1>,   paethBpp<2>,   paethSse2<3>,   paethSse2<4>,   paethBpp<6>,   paethBpp<8>,   paethScalar}
+};
+
+static const UnfilterFn cSsse3Kernels[FILTER_TYPES][BPP_CLASSES] = {
+  {noneScalar,    noneScalar,    noneScalar,     noneScalar,     noneScalar,    noneScalar,    noneScalar},
+  {subBpp<1>,     subBpp<2>,     subSsse3Bpp3,   subSse2Bpp4,    subBpp<6>,     subBpp<8>,     subScalar},
+  {upSse2,        upSse2,        upSse2,         upSse2,         upSse2,        upSse2,        upSse2},
+  {averageBpp<1>, averageBpp<2>, averageSse2<3>, averageSse2<4>, averageBpp<6>, averageBpp<8>, averageScalar},
+  {paethBpp<1>,   paethBpp<2>,   paethSsse3<3>,  paethSsse3<4>,  paethBpp<6>,   paethBpp<8>,   paethScalar}
+};
+
+// Average and Paeth depend on the reconstructed pixel to the left, so they gain nothing from wider registers
+static const UnfilterFn cAvx2Kernels[FILTER_TYPES][BPP_CLASSES] = {
+  {noneScalar,    noneScalar,    noneScalar,     noneScalar,     noneScalar,    noneScalar,    noneScalar},
+  {subBpp<1>,     subBpp<2>,     subSsse3Bpp3,   subAvx2Bpp4,    subBpp<6>,     subBpp<8>,     subScalar},
+  {upAvx2,        upAvx2,        upAvx2,         upAvx2,         upAvx2,        upAvx2,        upAvx2},
+  {averageBpp<1>, averageBpp<2>, averageSse2<3>, averageSse2<4>, averageBpp<6>, averageBpp<8>, averageScalar},
+  {paethBpp<1>,   paethBpp<2>,   paethSsse3<3>,  paethSsse3<4>,  paethBpp<6>,   paethBpp<8>,   paethScalar}
+};
+#endif
+
+/* Function:    kernelsFor
+   Description: Gets the kernel table for an instruction set level
+   Parameters:  SimdLevel - Instruction set level
+   Returns:     Kernel table
+ */
+static const UnfilterFn (*kernelsFor(const SimdLevel cLevel))[BPP_CLASSES]
+{
+#ifdef UNFILTER_X86
+  switch (cLevel)
+  {
+    case SIMD_AVX2:
+      return cAvx2Kernels;
+    case SIMD_SSSE3:
+      return cSsse3Kernels;
+    case SIMD_SSE2:
+      return cSse2Kernels;
+    default:
+      break;
+  }
+#else
+  (void) cLevel;
+#endif
+
+  return cScalarKernels;
+}
+
+/* Function:    detectSimdLevel
+   Description: Queries the cpu for the best instruction set the unfilter kernels can use
+   Parameters:  None
+   Returns:     SimdLevel - Highest supported level
+ */
+SimdLevel detectSimdLevel()
+{
+#ifdef UNFILTER_X86
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx2"))
+    return SIMD_AVX2;
+
+  if (__builtin_cpu_supports("ssse3"))
+    return SIMD_SSSE3;
+
+  if (__builtin_cpu_supports("sse2"))
+    return SIMD_SSE2;
+#endif
+
+  return SIMD_SCALAR;
+}
+
+static std::atomic<SimdLevel> &activeLevel()
+{
+  static std::atomic<SimdLevel> level(detectSimdLevel());
+  return level;
+}
+
+/* Function:    getUnfilterSimdLevel
+   Description: Gets the instruction set level the unfilter kernels are dispatched to
+   Parameters:  None
+   Returns:     SimdLevel - Active level
+ */
+SimdLevel getUnfilterSimdLevel()
+{
+  return activeLevel().load(std::memory_order_relaxed);
+}
+
+/* Function:    setUnfilterSimdLevel
+   Description: Restricts the unfilter kernels to an instruction set level, mainly for testing and benchmarking.
+                Levels the cpu does not support are clamped to the detected level.
+   Parameters:  SimdLevel - Requested level
+   Returns:     None
+ */
+void setUnfilterSimdLevel(const SimdLevel cLevel)
+{
+  const SimdLevel cDetected = detectSimdLevel();
+
+  activeLevel().store((cLevel > cDetected) ? cDetected : cLevel, std::memory_order_relaxed);
+}
+
+/* Function:    getUnfilterKernels
+   Description: Picks the kernels for one pixel size at the active instruction set level, so an image looks them up
+                once instead of on every scanline
+   Parameters:  uint8_t - Bytes per complete pixel, rounded up to 1 for bit depths below 8
+   Returns:     UnfilterKernels - One kernel per filter type
+ */
+UnfilterKernels getUnfilterKernels(const uint8_t cBpp)
+{
+  const UnfilterFn (*cpTable)[BPP_CLASSES] = kernelsFor(getUnfilterSimdLevel());
+  UnfilterKernels kernels;
+
+  for (uint8_t filter = 0; filter < FILTER_TYPES; filter ++)
+  {
+    kernels.kernels[filter] = cpTable[filter][bppClass(cBpp)];
+  }
+
+  kernels.bpp = cBpp;
+  return kernels;
+}
+
+/* Function:    unfilterRow
+   Description: Reverses the filter on one scanline in place with kernels picked by getUnfilterKernels
+   Parameters:  UnfilterKernels - Kernels for the pixel size of the image
+                uint8_t - Filter type byte that preceded the scanline
+                uint8_t* - Filtered scanline, overwritten with the reconstructed bytes
+                uint8_t* - Previous reconstructed scanline, all zeros for the first row
+                size_t - Bytes in the scanline, not counting the filter type byte
+   Returns:     Status - FAIL if the filter type is not one the PNG spec defines
+ */
+Status unfilterRow(const UnfilterKernels &crKernels, const uint8_t cFilter, uint8_t *pRow, const uint8_t *cpPrev,
+                   const size_t cRowBytes)
+{
+  if (cFilter >= FILTER_TYPES)
+  {
+    return FAIL;
+  }
+
+  crKernels.kernels[cFilter](pRow, cpPrev, cRowBytes, crKernels.bpp);
+  return SUCCESS;
+}
+
+/* Function:    unfilterRow
+   Description: Reverses the filter on one scanline in place
+   Parameters:  uint8_t - Filter type byte that preceded the scanline
+                uint8_t* - Filtered scanline, overwritten with the reconstructed bytes
+                uint8_t* - Previous reconstructed scanline, all zeros for the first row
+                size_t - Bytes in the scanline, not counting the filter type byte
+                uint8_t - Bytes per complete pixel, rounded up to 1 for bit depths below 8
+   Returns:     Status - FAIL if the filter type is not one the PNG spec defines
+ */
+Status unfilterRow(const uint8_t cFilter, uint8_t *pRow, const uint8_t *cpPrev, const size_t cRowBytes,
+                   const uint8_t cBpp)
+{
+  if (cFilter >= FILTER_TYPES)
+  {
+    return FAIL;
+  }
+
+  kernelsFor(getUnfilterSimdLevel())[cFilter][bppClass(cBpp)](pRow, cpPrev, cRowBytes, cBpp);
+  return SUCCESS;
+}
@@ -0,0 +1,37 @@
+#ifndef UNFILTER_HPP
+#define UNFILTER_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+#include "common.hpp"
+
+enum SimdLevel {
+  SIMD_SCALAR,
+  SIMD_SSE2,
+  SIMD_SSSE3,
+  SIMD_AVX2
+};
+
+#define FILTER_TYPES 5
+
+/* Every kernel reconstructs one scanline in place. pRow holds the filtered bytes (without the leading filter type
+   byte) and cpPrev holds the previously reconstructed scanline, which is all zeros for the first row of an image.
+ */
+typedef void (*UnfilterFn)(uint8_t *pRow, const uint8_t *cpPrev, const size_t cRowBytes, const uint8_t cBpp);
+
+struct UnfilterKernels {
+  UnfilterFn kernels[FILTER_TYPES];
+  uint8_t bpp;
+};
+
+SimdLevel detectSimdLevel();
+SimdLevel getUnfilterSimdLevel();
+void setUnfilterSimdLevel(const SimdLevel cLevel);
+UnfilterKernels getUnfilterKernels(const uint8_t cBpp);
+Status unfilterRow(const UnfilterKernels &crKernels, const uint8_t cFilter, uint8_t *pRow, const uint8_t *cpPrev,
+                   const size_t cRowBytes);
+Status unfilterRow(const uint8_t cFilter, uint8_t *pRow, const uint8_t *cpPrev, const size_t cRowBytes,
+                   const uint8_t cBpp);
+
+#endif
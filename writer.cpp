@@ -0,0 +1,426 @@
+#include "writer.hpp"
+#include "filter.hpp"
+#include "crc.hpp"
+
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <zlib.h>
+
+static const uint8_t cSignature[] = {0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A};
+
+// Largest width, height and chunk length a png may hold
+#define PNG_MAX_VALUE 0x7FFFFFFFu
+
+// Most bytes zlib takes or gives in one call, its counts are a uInt
+#define WRITER_ZLIB_BYTES UINT_MAX
+
+/* Function:    putBigEndian
+   Description: Appends a 32 bit value in network byte order
+   Parameters:  std::vector<uint8_t> - Buffer to append to
+                uint32_t - Value
+   Returns:     None
+ */
+static inline void putBigEndian(std::vector<uint8_t> &rOut, const uint32_t cValue)
+{
+  rOut.push_back(static_cast<uint8_t>(cValue >> 24));
+  rOut.push_back(static_cast<uint8_t>(cValue >> 16));
+  rOut.push_back(static_cast<uint8_t>(cValue >> 8));
+  rOut.push_back(static_cast<uint8_t>(cValue));
+}
+
+/* Function:    PngWriter
+   Description: Starts the thread pool the bands are compressed on
+   Parameters:  size_t - Number of worker threads, 0 to use one per hardware thread
+   Returns:     None
+ */
+PngWriter::PngWriter(const size_t cThreads) : mPool(cThreads), mLevel(Z_DEFAULT_COMPRESSION),
+                                              mIdatSize(WRITER_IDAT_BYTES), mpPixels(nullptr), mStride(0),
+                                              mRowBytes(0), mBpp(0), mSwap16(false)
+{
+}
+
+/* Function:    setCompressionLevel
+   Description: Sets the deflate level every band is compressed with
+   Parameters:  int - 0 to 9 like zlib, anything else picks zlib's default
+   Returns:     None
+ */
+void PngWriter::setCompressionLevel(const int cLevel)
+{
+  mLevel = ((cLevel < 0) || (cLevel > 9)) ? Z_DEFAULT_COMPRESSION : cLevel;
+}
+
+/* Function:    setIdatSize
+   Description: Sets the largest IDAT chunk the compressed stream is split into
+   Parameters:  uint32_t - Bytes per IDAT chunk, 0 keeps the default
+   Returns:     None
+ */
+void PngWriter::setIdatSize(const uint32_t cIdatSize)
+{
+  mIdatSize = (cIdatSize == 0) ? WRITER_IDAT_BYTES : std::min(cIdatSize, PNG_MAX_VALUE);
+}
+
+/* Function:    getThreads
+   Description: Gets the number of threads bands are compressed on
+   Parameters:  None
+   Returns:     size_t - Worker threads
+ */
+size_t PngWriter::getThreads() const
+{
+  return mPool.size();
+}
+
+/* Function:    getError
+   Description: Gets the reason the last encode or write failed
+   Parameters:  None
+   Returns:     std::string - Error message, empty after a successful encode
+ */
+const std::string &PngWriter::getError() const
+{
+  return mError;
+}
+
+/* Function:    checkIhdr
+   Description: Checks the image can be written and works out the row layout
+   Parameters:  IHDR - Header of the image to write
+   Returns:     Status - FAIL for sizes and formats the writer does not handle
+ */
+Status PngWriter::checkIhdr(const struct Png::IHDR &crIhdr)
+{
+  if ((crIhdr.width == 0) || (crIhdr.height == 0) || (crIhdr.width > PNG_MAX_VALUE) ||
+      (crIhdr.height > PNG_MAX_VALUE))
+  {
+    mError = "Error! Invalid image size.";
+    return FAIL;
+  }
+
+  if ((crIhdr.bitDepth != 8) && (crIhdr.bitDepth != 16))
+  {
+    mError = "Error! Only 8 and 16 bit images can be written.";
+    return FAIL;
+  }
+
+  if ((crIhdr.colorType == Png::PLTE) || (getExpandKernel(crIhdr.colorType, crIhdr.bitDepth) == nullptr))
+  {
+    mError = "Error! Only gray, gray alpha, rgb and rgba images can be written.";
+    return FAIL;
+  }
+
+  if (crIhdr.interfaceMethod != 0)
+  {
+    mError = "Error! Interlaced images can not be written.";
+    return FAIL;
+  }
+
+  mBpp = static_cast<uint8_t>(getSampleChannels(crIhdr.colorType) * (crIhdr.bitDepth / 8));
+  mRowBytes = static_cast<size_t>(crIhdr.width) * mBpp;
+  mSwap16 = (crIhdr.bitDepth == 16);
+
+  return SUCCESS;
+}
+
+/* Function:    rawRow
+   Description: Gets one row of the image as png samples, 16 bit samples are converted to network byte order
+   Parameters:  uint32_t - Row
+                uint8_t* - Buffer of one row used when samples have to be converted
+   Returns:     uint8_t* - Row in png sample layout
+ */
+const uint8_t *PngWriter::rawRow(const uint32_t cRow, uint8_t *pSwap) const
+{
+  const uint8_t *cpRow = mpPixels + (static_cast<size_t>(cRow) * mStride);
+
+  if (!mSwap16)
+  {
+    return cpRow;
+  }
+
+  for (size_t i = 0; i < mRowBytes; i += 2)
+  {
+    uint16_t value;
+
+    memcpy(&value, cpRow + i, sizeof(value));
+    pSwap[i] = static_cast<uint8_t>(value >> 8);
+    pSwap[i + 1] = static_cast<uint8_t>(value);
+  }
+
+  return pSwap;
+}
+
+/* Function:    filterRows
+   Description: Filters a run of rows into the scanline layout that gets deflated, a filter type byte followed by
+                the filtered row
+   Parameters:  uint32_t - First row
+                uint32_t - Number of rows
+                std::vector<uint8_t> - Receives the filtered scanlines
+   Returns:     None
+ */
+void PngWriter::filterRows(const uint32_t cFirstRow, const uint32_t cRows, std::vector<uint8_t> &rFiltered) const
+{
+  const size_t cScanline = mRowBytes + 1;
+  std::vector<uint8_t> zeros(mRowBytes, 0);
+  std::vector<uint8_t> scratch(mRowBytes);
+  std::vector<uint8_t> swapRow(mSwap16 ? mRowBytes : 0);
+  std::vector<uint8_t> swapPrev(mSwap16 ? mRowBytes : 0);
+  const uint8_t *cpPrev = (cFirstRow == 0) ? zeros.data() : rawRow(cFirstRow - 1, swapPrev.data());
+
+  rFiltered.resize(static_cast<size_t>(cRows) * cScanline);
+
+  for (uint32_t i = 0; i < cRows; i ++)
+  {
+    uint8_t *pOut = rFiltered.data() + (static_cast<size_t>(i) * cScanline);
+    const uint8_t *cpRow = rawRow(cFirstRow + i, swapRow.data());
+
+    pOut[0] = filterRowAdaptive(pOut + 1, scratch.data(), cpRow, cpPrev, mRowBytes, mBpp);
+
+    // The converted row becomes the previous row, so the two buffers trade places
+    if (mSwap16)
+    {
+      swapRow.swap(swapPrev);
+    }
+
+    cpPrev = cpRow;
+  }
+}
+
+/* Function:    compressBand
+   Description: Filters and deflates one band as raw deflate data. Every band but the first is primed with the last
+                32 KiB of filtered data before it, refiltering those rows is cheap and keeps the ratio close to a
+                single stream. Bands end on a sync flush so they can be joined, the last one finishes the stream.
+   Parameters:  Band - Band to compress, receives the deflate data and the adler32 of its filtered bytes
+                bool - True for the last band of the image
+   Returns:     None
+ */
+void PngWriter::compressBand(Band &rBand, const bool cLast)
+{
+  std::vector<uint8_t> filtered;
+  z_stream stream = {};
+
+  filterRows(rBand.firstRow, rBand.rows, filtered);
+  rBand.filteredSize = filtered.size();
+  rBand.adler = adler32(0, Z_NULL, 0);
+
+  // zlib counts bytes in a uInt, so a band of 4 GiB or more is handed over in pieces
+  for (size_t offset = 0; offset < filtered.size(); offset += WRITER_ZLIB_BYTES)
+  {
+    const size_t cPiece = std::min(filtered.size() - offset, static_cast<size_t>(WRITER_ZLIB_BYTES));
+
+    rBand.adler = adler32(rBand.adler, filtered.data() + offset, static_cast<uInt>(cPiece));
+  }
+
+  if (deflateInit2(&stream, mLevel, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+  {
+    rBand.failed = true;
+    return;
+  }
+
+  if (rBand.firstRow > 0)
+  {
+    const size_t cScanline = mRowBytes + 1;
+    const uint32_t cDictRows = static_cast<uint32_t>(std::min(static_cast<size_t>(rBand.firstRow),
+                                                              (WRITER_DICT_BYTES + cScanline - 1) / cScanline));
+    std::vector<uint8_t> dict;
+
+    filterRows(rBand.firstRow - cDictRows, cDictRows, dict);
+
+    const size_t cDictSize = std::min(dict.size(), static_cast<size_t>(WRITER_DICT_BYTES));
+
+    deflateSetDictionary(&stream, dict.data() + (dict.size() - cDictSize), static_cast<uInt>(cDictSize));
+  }
+
+  // Room for the worst case plus the empty stored block a sync flush ends with
+  rBand.deflated.resize(deflateBound(&stream, static_cast<uLong>(filtered.size())) + 16);
+  stream.next_in = filtered.data();
+  stream.next_out = rBand.deflated.data();
+
+  size_t inLeft = filtered.size();
+  size_t outLeft = rBand.deflated.size();
+  int result = Z_OK;
+
+  // The flush only goes with the last piece of input, a full piece of output is topped up and deflate runs again
+  do
+  {
+    const uInt cIn = static_cast<uInt>(std::min(inLeft, static_cast<size_t>(WRITER_ZLIB_BYTES)));
+    const uInt cOut = static_cast<uInt>(std::min(outLeft, static_cast<size_t>(WRITER_ZLIB_BYTES)));
+
+    stream.avail_in = cIn;
+    stream.avail_out = cOut;
+    result = deflate(&stream, (cIn == inLeft) ? (cLast ? Z_FINISH : Z_SYNC_FLUSH) : Z_NO_FLUSH);
+    inLeft -= cIn - stream.avail_in;
+    outLeft -= cOut - stream.avail_out;
+  } while ((result == Z_OK) && (outLeft > 0) && ((inLeft > 0) || (stream.avail_out == 0)));
+
+  rBand.failed = cLast ? (result != Z_STREAM_END) : ((result != Z_OK) || (inLeft > 0) || (stream.avail_out == 0));
+  rBand.deflated.resize(rBand.deflated.size() - outLeft);
+  deflateEnd(&stream);
+}
+
+/* Function:    writeChunk
+   Description: Appends a chunk with its length, type, data and CRC
+   Parameters:  std::vector<uint8_t> - Png being built
+                char* - Four letter chunk type
+                uint8_t* - Chunk data
+                uint32_t - Bytes of chunk data
+   Returns:     None
+ */
+void PngWriter::writeChunk(std::vector<uint8_t> &rPng, const char *cpType, const uint8_t *cpData,
+                           const uint32_t cSize) const
+{
+  const size_t cTypeStart = rPng.size() + 4;
+
+  putBigEndian(rPng, cSize);
+  rPng.insert(rPng.end(), cpType, cpType + 4);
+  rPng.insert(rPng.end(), cpData, cpData + cSize);
+  putBigEndian(rPng, crc32Update(0, rPng.data() + cTypeStart, cSize + 4));
+}
+
+/* Function:    encode
+   Description: Encodes an image into a png file in memory
+   Parameters:  IHDR - Width, height, bit depth and color type of the image, interlacing is not supported
+                uint8_t* - Pixels in the layout Png decodes to, 16 bit samples in host byte order
+                size_t - Bytes from one row to the next, 0 for tightly packed rows
+                std::vector<uint8_t> - Receives the png file
+   Returns:     Status - FAIL if the image can not be written, getError tells why
+ */
+Status PngWriter::encode(const struct Png::IHDR &crIhdr, const uint8_t *cpPixels, const size_t cStride,
+                         std::vector<uint8_t> &rPng)
+{
+  mError.clear();
+  rPng.clear();
+
+  if ((cpPixels == nullptr) || (checkIhdr(crIhdr) == FAIL))
+  {
+    if (mError.empty())
+    {
+      mError = "Error! No pixels to write.";
+    }
+
+    return FAIL;
+  }
+
+  if ((cStride != 0) && (cStride < mRowBytes))
+  {
+    mError = "Error! Stride is smaller than a row.";
+    return FAIL;
+  }
+
+  mpPixels = cpPixels;
+  mStride = (cStride == 0) ? mRowBytes : cStride;
+
+  // Splitting only pays off when the bands run side by side, one thread gets bands as large as zlib takes in one go
+  const size_t cBandBytes = (mPool.size() <= 1) ? WRITER_SERIAL_BAND_BYTES : WRITER_BAND_BYTES;
+  const size_t cBandRows = std::max(static_cast<size_t>(1), cBandBytes / (mRowBytes + 1));
+  std::vector<Band> bands;
+
+  for (uint32_t row = 0; row < crIhdr.height; row += bands.back().rows)
+  {
+    Band band;
+
+    band.firstRow = row;
+    band.rows = static_cast<uint32_t>(std::min(cBandRows, static_cast<size_t>(crIhdr.height - row)));
+    band.adler = 0;
+    band.filteredSize = 0;
+    band.failed = false;
+    bands.push_back(std::move(band));
+  }
+
+  for (size_t i = 0; i < bands.size(); i ++)
+  {
+    Band *pBand = &bands[i];
+    const bool cLast = (i + 1 == bands.size());
+
+    mPool.submit([this, pBand, cLast](const size_t)
+    {
+      try
+      {
+        compressBand(*pBand, cLast);
+      }
+      catch (const std::exception &)
+      {
+        pBand->failed = true;
+      }
+    });
+  }
+
+  mPool.wait();
+  mpPixels = nullptr;
+
+  // zlib header for a 32 KiB window, the level hint follows zlib's own mapping
+  const uint8_t cLevelHint = (mLevel == Z_DEFAULT_COMPRESSION) ? 2 : (mLevel < 2) ? 0 : (mLevel < 6) ? 1 :
+                             (mLevel == 6) ? 2 : 3;
+  uint8_t flags = static_cast<uint8_t>(cLevelHint << 6);
+  std::vector<uint8_t> stream = {0x78};
+  uint32_t adler = adler32(0, Z_NULL, 0);
+
+  flags = static_cast<uint8_t>(flags + (31 - (((0x78 << 8) | flags) % 31)));
+  stream.push_back(flags);
+
+  for (const Band &crBand : bands)
+  {
+    if (crBand.failed)
+    {
+      mError = "Error! Failed to compress image data.";
+      return FAIL;
+    }
+
+    stream.insert(stream.end(), crBand.deflated.begin(), crBand.deflated.end());
+    adler = adler32_combine(adler, crBand.adler, static_cast<z_off_t>(crBand.filteredSize));
+  }
+
+  putBigEndian(stream, adler);
+
+  std::vector<uint8_t> ihdr;
+
+  putBigEndian(ihdr, crIhdr.width);
+  putBigEndian(ihdr, crIhdr.height);
+  ihdr.push_back(crIhdr.bitDepth);
+  ihdr.push_back(crIhdr.colorType);
+
+  // Compression, filter and interlace method
+  ihdr.insert(ihdr.end(), 3, 0);
+
+  rPng.reserve(sizeof(cSignature) + stream.size() + (((stream.size() / mIdatSize) + 3) * 12) + ihdr.size());
+  rPng.insert(rPng.end(), cSignature, cSignature + sizeof(cSignature));
+  writeChunk(rPng, "IHDR", ihdr.data(), static_cast<uint32_t>(ihdr.size()));
+
+  for (size_t offset = 0; offset < stream.size(); offset += mIdatSize)
+  {
+    const uint32_t cSize = static_cast<uint32_t>(std::min(stream.size() - offset, static_cast<size_t>(mIdatSize)));
+
+    writeChunk(rPng, "IDAT", stream.data() + offset, cSize);
+  }
+
+  writeChunk(rPng, "IEND", nullptr, 0);
+
+  return SUCCESS;
+}
+
+/* Function:    write
+   Description: Encodes an image and writes it to a png file
+   Parameters:  std::string - Filepath for png file to write
+                IHDR - Width, height, bit depth and color type of the image, interlacing is not supported
+                uint8_t* - Pixels in the layout Png decodes to, 16 bit samples in host byte order
+                size_t - Bytes from one row to the next, 0 for tightly packed rows
+   Returns:     Status - FAIL if the image can not be encoded or the file can not be written
+ */
+Status PngWriter::write(const std::string &crPngPath, const struct Png::IHDR &crIhdr, const uint8_t *cpPixels,
+                        const size_t cStride)
+{
+  std::vector<uint8_t> png;
+
+  if (encode(crIhdr, cpPixels, cStride, png) == FAIL)
+  {
+    return FAIL;
+  }
+
+  std::ofstream pngFile(crPngPath.c_str(), std::ios::binary | std::ios::trunc);
+
+  pngFile.write(reinterpret_cast<const char *>(png.data()), static_cast<std::streamsize>(png.size()));
+
+  if (!pngFile)
+  {
+    mError = "Error! Failed to write " + crPngPath + ".";
+    return FAIL;
+  }
+
+  return SUCCESS;
+}
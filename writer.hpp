@@ -0,0 +1,70 @@
+#ifndef WRITER_HPP
+#define WRITER_HPP
+
+#include <cstdint>
+#include <vector>
+#include <string>
+
+#include "common.hpp"
+#include "png.hpp"
+#include "threadPool.hpp"
+
+// Filtered bytes every band compresses, the same block size pigz uses by default
+#define WRITER_BAND_BYTES (128 * 1024)
+
+// Band size with a single thread, kept well inside what zlib can take in one call
+#define WRITER_SERIAL_BAND_BYTES (1024 * 1024 * 1024)
+
+// Bytes of the previous band handed to deflate as a preset dictionary, the full deflate window
+#define WRITER_DICT_BYTES 32768
+
+#define WRITER_IDAT_BYTES 65536
+
+/* Png encoder. Every row is filtered with the filter type that gives the lowest sum of absolute differences, then the
+   image is split into bands of rows that are deflated in parallel, pigz style. Every band is primed with the end of
+   the band before it and ends on a sync flush, so the bands join into one zlib stream that is split over IDAT chunks.
+   Takes gray, gray alpha, rgb and rgba at 8 or 16 bits in the same layout Png decodes to, 16 bit samples in host
+   byte order.
+ */
+class PngWriter {
+public:
+  explicit PngWriter(const size_t cThreads = 0);
+  void setCompressionLevel(const int cLevel);
+  void setIdatSize(const uint32_t cIdatSize);
+  size_t getThreads() const;
+  Status encode(const struct Png::IHDR &crIhdr, const uint8_t *cpPixels, const size_t cStride,
+                std::vector<uint8_t> &rPng);
+  Status write(const std::string &crPngPath, const struct Png::IHDR &crIhdr, const uint8_t *cpPixels,
+               const size_t cStride);
+  const std::string &getError() const;
+
+private:
+  struct Band {
+    uint32_t firstRow;
+    uint32_t rows;
+    std::vector<uint8_t> deflated;
+    uint32_t adler;
+    size_t filteredSize;
+    bool failed;
+  };
+
+  Status checkIhdr(const struct Png::IHDR &crIhdr);
+  void compressBand(Band &rBand, const bool cLast);
+  const uint8_t *rawRow(const uint32_t cRow, uint8_t *pSwap) const;
+  void filterRows(const uint32_t cFirstRow, const uint32_t cRows, std::vector<uint8_t> &rFiltered) const;
+  void writeChunk(std::vector<uint8_t> &rPng, const char *cpType, const uint8_t *cpData, const uint32_t cSize) const;
+
+  ThreadPool mPool;
+  int mLevel;
+  uint32_t mIdatSize;
+  std::string mError;
+
+  // Image being encoded, only valid during encode
+  const uint8_t *mpPixels;
+  size_t mStride;
+  size_t mRowBytes;
+  uint8_t mBpp;
+  bool mSwap16;
+};
+
+#endif